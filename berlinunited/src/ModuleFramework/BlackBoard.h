@@ -34,6 +34,16 @@
 
   ...
 
+* Every representation is assigned a slot when it is created. Code that accesses
+* a representation repeatedly (e.g. every frame) should resolve a handle once and
+* use it afterwards, which avoids the name lookup and the type check:
+
+  BlackBoard::Handle<A> a = b.getHandle<A>("a");
+  ...
+  a->x = 2;
+
+* The representations are allocated from an arena owned by the blackboard, so
+* they are placed next to each other in memory and never move.
 */
 
 
@@ -43,7 +53,11 @@
 #include <iostream>
 #include <map>
 #include <string>
+#include <vector>
 #include <typeinfo>
+#include <algorithm>
+#include <cstdint>
+#include <new>
 #include <assert.h>
 
 //#include "Tools/Debug/NaoTHAssert.h"
@@ -59,17 +73,72 @@ public:
 	 */
 	class BlackBoardData {
 	public:
+		BlackBoardData()
+			: slot(-1)
+		{}
+
+		/** slot index of the representation in the blackboard */
+		int getSlot() const {
+			return slot;
+		}
+
 		virtual const std::string getTypeName() const = 0;
 		virtual const std::string getName() const = 0;
 		virtual const Representation& getRepresentation() const = 0;
 		virtual Representation& getRepresentation() = 0;
 
 		virtual ~BlackBoardData() {}
+
+	private:
+		friend class BlackBoard;
+		int slot;
 	}; //end class BlackBoardData
 
 	/** */
 	typedef std::map<std::string, BlackBoardData*> Registry;
 
+	/**
+	 * A handle to a representation of type T, resolved once by name. Accessing the
+	 * representation through the handle is a plain pointer dereference.
+	 */
+	template<class T>
+	class Handle {
+	public:
+		Handle()
+			: slot(-1)
+			, data(NULL)
+		{}
+
+		T& operator*() const {
+			assert(data != NULL);
+			return *data;
+		}
+
+		T* operator->() const {
+			assert(data != NULL);
+			return data;
+		}
+
+		bool isValid() const {
+			return data != NULL;
+		}
+
+		int getSlot() const {
+			return slot;
+		}
+
+	private:
+		friend class BlackBoard;
+
+		Handle(int slot, T* data)
+			: slot(slot)
+			, data(data)
+		{}
+
+		int slot;
+		T* data;
+	}; //end class Handle
+
 private:
 	/**
 	 * class BlackBoardDataHolder holds a data of type T as a member.
@@ -111,19 +180,76 @@ private:
 	/** holds the pointers to  */
 	Registry registry;
 
+	/** the representations, indexed by their slot */
+	std::vector<BlackBoardData*> slots;
+
+	/** the memory blocks of the arena the representations are allocated from */
+	std::vector<char*> arenaBlocks;
+	size_t arenaUsed;
+
+	static const size_t ARENA_BLOCK_SIZE = 16*1024;
+
+	/**
+	 *  allocates memory for a representation from the arena
+	 */
+	void* allocate(size_t size, size_t alignment) {
+		uintptr_t address = 0;
+		if (false == arenaBlocks.empty()) {
+			uintptr_t start = reinterpret_cast<uintptr_t>(arenaBlocks.back());
+			address = (start + arenaUsed + alignment - 1) & ~(uintptr_t)(alignment - 1);
+			if (address + size > start + ARENA_BLOCK_SIZE)
+				address = 0;
+		}
+
+		// start a new block (large representations get a block of their own)
+		if (address == 0) {
+			size_t blockSize = std::max(ARENA_BLOCK_SIZE, size + alignment);
+			arenaBlocks.push_back(new char[blockSize]);
+			uintptr_t start = reinterpret_cast<uintptr_t>(arenaBlocks.back());
+			address = (start + alignment - 1) & ~(uintptr_t)(alignment - 1);
+		}
+
+		arenaUsed = address + size - reinterpret_cast<uintptr_t>(arenaBlocks.back());
+		return reinterpret_cast<void*>(address);
+	}
+
+	/**
+	 *  creates a representation in the arena and assigns a slot to it
+	 */
+	template<class T>
+	BlackBoardDataHolder<T>* create(const std::string& name) {
+		void* memory = allocate(sizeof(BlackBoardDataHolder<T>), alignof(BlackBoardDataHolder<T>));
+		BlackBoardDataHolder<T>* typedData = new (memory) BlackBoardDataHolder<T>(name);
+
+		typedData->slot = slots.size();
+		slots.push_back(typedData);
+		registry[name] = typedData;
+		return typedData;
+	}
+
 public:
 	BlackBoard()
 		: registry()
+		, slots()
+		, arenaBlocks()
+		, arenaUsed(0)
 	{}
 	BlackBoard(BlackBoard& /*blackBoard*/)
 		: registry()
+		, slots()
+		, arenaBlocks()
+		, arenaUsed(0)
 	{}
 
 	virtual ~BlackBoard() {
-		// delete the registry
+		// destroy the representations (the memory belongs to the arena)
 		for (Registry::iterator iter = registry.begin(); iter != registry.end();
 				iter++) {
-			delete iter->second;
+			iter->second->~BlackBoardData();
+		}
+
+		for (char* block : arenaBlocks) {
+			delete[] block;
 		}
 	}
 
@@ -184,9 +310,7 @@ public:
 
 		// create Representation, if necessary
 		if (iter == registry.end()) {
-			BlackBoardDataHolder<T>* typedData = new BlackBoardDataHolder<T>(name);
-			registry[name] = typedData;
-			return **typedData;
+			return **create<T>(name);
 		} //end if
 
 		// retrive the representation and try to cast
@@ -204,6 +328,32 @@ public:
 
 		return **typedData;
 	} //end getRepresentation
+
+	/**
+	 *  returns a handle to a representation stored on the blackboard. A
+	 *  new instance is created if the required representation is not
+	 *  existing.
+	 */
+	template<class T>
+	Handle<T> getHandle(const std::string& name) {
+		T& representation = getRepresentation<T>(name);
+		return Handle<T>(registry.find(name)->second->getSlot(), &representation);
+	}
+
+	/**
+	 *  returns the number of slots (i.e. representations)
+	 */
+	size_t getSlotCount() const {
+		return slots.size();
+	}
+
+	/**
+	 *  returns the representation stored at the given slot
+	 */
+	BlackBoardData* getData(int slot) const {
+		assert(slot >= 0 && (size_t)slot < slots.size());
+		return slots[slot];
+	}
 };
 
 #endif //__BlackBoard_h_
@@ -31,6 +31,7 @@ class Representation;
 	class module; \
 	namespace { \
 		auto cfgModule##module##Enabled = ConfigRegistry::registerOption<bool>("modules."#manager"."#module, enabled, description); \
+		auto cfgModule##module##Budget  = ConfigRegistry::registerOption<Millisecond>("modules.budget."#manager"."#module, 0*milliseconds, "Time budget for module " # module " (0 = none), exceeding it is reported"); \
 		auto MODULETEMPVAR(__LINE__, module) = ModuleManagers::getInstance().get<manager>()->registerModule<module>(std::string(#module)); \
 		auto MODULETEMPVAR(__LINE__, debug)  = \
 			::Debugging::getInstance().registerDebugOption(module::getModuleDebugSymbol(), TEXT, NONET | CMDLOUT, __FILE__, "Text debug output (console only) for module " # module); \
@@ -423,7 +424,7 @@ protected:
 		} \
 		inline void debug(const char* format, ...) const __attribute__ ((format (printf, 2, 3))) { \
 			static const DebuggingOption* debugOption = ::Debugging::getInstance().getDebugOption(getModuleDebugSymbol()); \
-			if (debugOption && debugOption->enabled) { \
+			if (debugOption && debugOption->isEnabled()) { \
 				va_list vl; \
 				va_start(vl, format); \
 				::Debugging::getInstance().sendDebugText(debugOption, format, vl); \
@@ -11,6 +11,8 @@
 #include "BlackBoardInterface.h"
 #include "debug.h"
 
+#include "utils/units.h"
+
 class Module;
 
 /**
@@ -23,6 +25,9 @@ class AbstractModuleCreator
 public:
 	virtual void setEnabled(bool value) = 0;
 	virtual bool isEnabled() const = 0;
+	virtual void setTimeBudget(Millisecond budget) = 0;
+	virtual Millisecond getTimeBudget() const = 0;
+	virtual void init() = 0;
 	virtual void execute() = 0;
 	virtual Module* getModule() = 0;
 	virtual ~AbstractModuleCreator() {};
@@ -68,6 +73,9 @@ private:
 	// whether module is initialized
 	bool initialized;
 
+	// maximum time the module may take per execution (0 == no budget)
+	Millisecond timeBudget;
+
 public:
 
 	ModuleCreator(BlackBoard& theBlackBoard)
@@ -75,6 +83,7 @@ public:
 		, theInstance(NULL)
 		, enabled(false)
 		, initialized(false)
+		, timeBudget(0*milliseconds)
 	{
 	}
 
@@ -94,6 +103,14 @@ public:
 		enabled = value;
 	}
 
+	virtual void setTimeBudget(Millisecond budget) {
+		timeBudget = budget;
+	}
+
+	virtual Millisecond getTimeBudget() const {
+		return timeBudget;
+	}
+
 	virtual bool isInitialized() {
 		ASSERT(isEnabled());
 		if (theInstance == NULL)
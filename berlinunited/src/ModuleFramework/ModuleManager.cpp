@@ -7,6 +7,7 @@
 
 #include "debug.h"
 #include "debugging/stopwatch.h"
+#include "debugging/tracer.h"
 
 #include "utils/utils.h"
 
@@ -32,6 +33,9 @@ REGISTER_DEBUG("modules.showActiveModules", TEXT, CMDLOUT);
 
 namespace {
 	auto switchShow = ConfigRegistry::getInstance().registerSwitch("showmodules", "Show calculated execution list");
+
+	auto cfgThreads   = ConfigRegistry::registerOption<int>("modules.threads", 0, "Number of worker threads executing independent modules in parallel (0 = serial execution), requires modules.execution = inline");
+	auto cfgExecution = ConfigRegistry::registerOption<std::string>("modules.execution", "async", "How modules are executed: async (in a separate thread, detects hung modules) or inline (in the manager's thread, only modules with a time budget are watched)");
 }
 
 
@@ -44,7 +48,13 @@ namespace {
 ModuleManager::ModuleManager()
 	: logWriter(nullptr)
 	, runLevel(-1)
+	, executionMode(EXECUTION_ASYNC)
+	, threadCount(0)
+	, serialExecution(false)
 	, framenumber(0)
+	, runtimesName()
+	, runtimesOption(nullptr)
+	, traceName(nullptr)
 {
 	executorCS.setName("ModuleManager::executorCS");
 	startCS.setName("ModuleManager::startCS");
@@ -94,6 +104,10 @@ void ModuleManager::startManager(int level) {
 	else {
 		ERROR("%s's ASyncModuleExecutor is already running.", getName());
 	}
+
+	// worker threads for independent modules
+	if (false == serialExecution && threadCount > 0)
+		threadPool.start(threadCount);
 }
 
 
@@ -102,7 +116,15 @@ void ModuleManager::startManager(int level) {
 void ModuleManager::stopManager() {
 	CriticalSectionLock lock(startCS);
 
+	threadPool.stop();
 	executor.cancel();
+
+	// write the frames that are still queued and close the log file
+	if (logWriter) {
+		CriticalSectionLock executorLock(executorCS);
+		delete logWriter;
+		logWriter = nullptr;
+	}
 }
 
 
@@ -110,6 +132,10 @@ void ModuleManager::stopManager() {
 
 /**
  ** @brief Execute all active modules.
+ **
+ ** Independent modules of one execution level run in parallel on the thread
+ ** pool, but they are created and initialized one after another in this
+ ** thread beforehand, so init() never runs concurrently.
  */
 
 void ModuleManager::executeModules() {
@@ -117,38 +143,62 @@ void ModuleManager::executeModules() {
 
 	++framenumber;
 
-	std::string runtimesStr = std::string(getName()) + ".runtimes";
-	std::transform(runtimesStr.begin(), runtimesStr.end(), runtimesStr.begin(), ::tolower);
-	DebuggingOption *debugOption = ::Debugging::getInstance().getDebugOption(runtimesStr);
-
-	for (const auto& name : getExecutionList()) {
-		// get entry
-		AbstractModuleCreator* module = getModule(name);
-		if (module != NULL && module->isEnabled()) {
-			robottime_t startTime = getCurrentTime();
-
-			bool stopWatchEnabled = (debugOption && debugOption->enabled);
-			StopwatchItem& stopwatch = Stopwatch::getInstance().getStopwatchReference(runtimesStr, name);
-			if (stopWatchEnabled)
-				Stopwatch::getInstance().notifyStart(stopwatch, runtimesStr, name);
-
-			// execute asynchronously
-			executor.executeModule(module);
-			Millisecond lastOutput = startTime;
-			while (! executor.waitForModuleToFinish(1000*milliseconds)) {
-				if (getCurrentTime() - startTime > 1000*milliseconds) {
-					ERROR("%s module %s has been running for longer than %.1f seconds", getName(), name.c_str(), Second(getCurrentTime() - startTime).value());
-					lastOutput = getCurrentTime();
-				}
-			}
+	// modules were registered since the last calculation
+	if (schedule.empty())
+		calculateExecutionList();
+
+	TraceScope trace("frame", traceName);
+
+	if (nullptr == runtimesOption)
+		runtimesOption = ::Debugging::getInstance().getDebugOption(runtimesName);
+
+	bool stopWatchEnabled = (runtimesOption && runtimesOption->isEnabled());
 
-			if (stopWatchEnabled)
-				Stopwatch::getInstance().notifyStop(stopwatch, runtimesStr, name);
+	// take over the latest representations published by other managers
+	for (const auto& subscriber : subscribers)
+		subscriber();
+
+	for (const auto& level : schedule) {
+		// nothing to run in parallel
+		if (level.size() == 1 || threadPool.getThreadCount() == 0) {
+			for (const auto& scheduled : level)
+				runModule(scheduled, stopWatchEnabled);
+			continue;
 		}
+
+		// modules that are watched by the AsyncModuleExecutor are executed
+		// one after another once the others are finished
+		std::vector<ModuleThreadPool::Task> tasks;
+		std::vector<const ScheduledModule*> watchedModules;
+		for (const auto& scheduled : level) {
+			AbstractModuleCreator* module = scheduled.module;
+			if (module == NULL || false == module->isEnabled())
+				continue;
+
+			// create and initialize the modules one after another, init() of
+			// different modules must not run concurrently
+			module->init();
+
+			if (executionMode == EXECUTION_INLINE && module->getTimeBudget() <= 0*milliseconds)
+				tasks.push_back([this, &scheduled, stopWatchEnabled]() {
+					runModule(scheduled, stopWatchEnabled);
+				});
+			else
+				watchedModules.push_back(&scheduled);
+		}
+
+		threadPool.execute(tasks);
+
+		for (const ScheduledModule* scheduled : watchedModules)
+			runModule(*scheduled, stopWatchEnabled);
 	}
 
-	if (debugOption && debugOption->enabled)
-		Stopwatch::getInstance().send(runtimesStr);
+	// publish a consistent snapshot of this frame to other managers
+	for (const auto& publisher : publishers)
+		publisher();
+
+	if (stopWatchEnabled)
+		Stopwatch::getInstance().send(runtimesName);
 
 	// write log file if available
 	if (logWriter) {
@@ -157,6 +207,64 @@ void ModuleManager::executeModules() {
 }
 
 
+/*------------------------------------------------------------------------------------------------*/
+
+/** Execute a single module (if enabled) and measure its runtime.
+ **
+ ** @param scheduled          Module to execute
+ ** @param stopWatchEnabled   Whether to measure the runtime
+ */
+
+void ModuleManager::runModule(const ScheduledModule &scheduled, bool stopWatchEnabled) {
+	if (scheduled.module == NULL || false == scheduled.module->isEnabled())
+		return;
+
+	if (stopWatchEnabled)
+		Stopwatch::getInstance().start(scheduled.stopwatch);
+
+	TraceScope trace("module", scheduled.traceName);
+
+	executeModule(scheduled.name, scheduled.module);
+
+	if (stopWatchEnabled)
+		Stopwatch::getInstance().stop(scheduled.stopwatch);
+}
+
+
+/*------------------------------------------------------------------------------------------------*/
+
+/** Execute a single module, either directly or through the asynchronous
+ ** module executor (depending on the execution mode and its time budget).
+ **
+ ** @param name     Name of the module (for output purposes only)
+ ** @param module   Module to execute
+ */
+
+void ModuleManager::executeModule(const std::string &name, AbstractModuleCreator* module) {
+	Millisecond budget = module->getTimeBudget();
+
+	// no need to watch the module, so execute it right here
+	if (executionMode == EXECUTION_INLINE && budget <= 0*milliseconds) {
+		module->execute();
+		return;
+	}
+
+	robottime_t startTime = getCurrentTime();
+
+	// execute asynchronously
+	executor.executeModule(module);
+	if (budget > 0*milliseconds && false == executor.waitForModuleToFinish(budget)) {
+		WARNING("%s module %s exceeded its time budget of %.1f ms", getName(), name.c_str(), budget.value());
+	}
+
+	while (! executor.waitForModuleToFinish(1000*milliseconds)) {
+		if (getCurrentTime() - startTime > 1000*milliseconds) {
+			ERROR("%s module %s has been running for longer than %.1f seconds", getName(), name.c_str(), Second(getCurrentTime() - startTime).value());
+		}
+	}
+}
+
+
 /*------------------------------------------------------------------------------------------------*/
 
 /** Enables/disables the modules based on the provided configuration
@@ -177,7 +285,30 @@ void ModuleManager::setActiveModules(const Config &config) {
 
 		DEBUG_TEXT("modules.showActiveModules", "Activating %s module %s: %s", getName(), (*name).c_str(), active ? "yes" : "no");
 		setModuleEnabled(*name, active);
+
+		std::string budgetKey = std::string("modules.budget.") + getName() + "." + *name;
+		if (config.exists(budgetKey))
+			setModuleTimeBudget(*name, config.get<Millisecond>(budgetKey));
+	}
+
+	// select how the modules are executed
+	const std::string &mode = config.get<std::string>("modules.execution");
+	if (mode == "inline")
+		setExecutionMode(EXECUTION_INLINE);
+	else {
+		if (mode != "async")
+			ERROR("Unknown module execution mode '%s', using async", mode.c_str());
+		setExecutionMode(EXECUTION_ASYNC);
 	}
+
+	// number of threads for independent modules, only inline executed modules
+	// are run on them
+	int threads = config.get<int>("modules.threads");
+	if (threads > 0 && executionMode != EXECUTION_INLINE) {
+		WARNING("modules.threads = %d has no effect unless modules.execution is inline, executing the modules of %s serially", threads, getName());
+		threads = 0;
+	}
+	setThreadCount(threads > 0 ? threads : 0);
 }
 
 
@@ -203,6 +334,25 @@ void ModuleManager::setModuleEnabled(std::string moduleName, bool value, bool re
 }
 
 
+/*------------------------------------------------------------------------------------------------*/
+
+/** Sets the time budget of the module 'moduleName' (if it is registered). A
+ ** module with a time budget is always executed through the asynchronous
+ ** module executor, so overruns can be reported.
+ **
+ ** @param moduleName   Name of the module (as registered)
+ ** @param budget       Maximum execution time, 0 to disable
+ */
+
+void ModuleManager::setModuleTimeBudget(std::string moduleName, Millisecond budget) {
+	if (moduleExecutionMap.find(moduleName) != moduleExecutionMap.end()) {
+		moduleExecutionMap[moduleName]->setTimeBudget(budget);
+	} else {
+		std::cerr << "Setting time budget of module " << moduleName << " failed as it was not found!\n";
+	}
+}
+
+
 /*------------------------------------------------------------------------------------------------*/
 
 /**
@@ -241,87 +391,158 @@ const AbstractModuleCreator* ModuleManager::getModule(const std::string& name) c
 
 /** Calculate the execution list automatically from the dependencies.
  **
+ ** A dependency graph is built from the representations of the enabled modules: a module providing
+ ** a representation has to be executed before the modules requiring it, and a module recycling a
+ ** representation (i.e. using the value of the last frame) has to be executed before the modules
+ ** providing it. The modules are then grouped into levels (longest path from a module without
+ ** dependencies), modules of one level do not depend on each other and may run in parallel. Within
+ ** a level, the modules are kept in the order of their registration.
  */
 
 void ModuleManager::calculateExecutionList() {
 	CriticalSectionLock lock1(startCS);
 	CriticalSectionLock lock2(executorCS);
 
-	bool changed = true;
-	std::list<std::string>::iterator start = moduleExecutionList.begin();
-	const int maxAttempts = moduleExecutionList.size() * 10;
-	int iterations = 0;
+	// collect the enabled modules in the order of their registration
+	std::vector<std::string> names;
+	std::vector<Module*>     modules;
+	for (const auto& name : moduleRegistrationList) {
+		if (moduleExecutionMap[name]->isEnabled()) {
+			names.push_back(name);
+			modules.push_back(moduleExecutionMap[name]->getModule());
+		}
+	}
+	const size_t moduleCount = names.size();
 
-	while (changed && iterations < maxAttempts) {
-		changed = false;
-		iterations++;
+	// find the providers of every representation
+	std::map<std::string, std::vector<size_t>> providers;
+	for (size_t i = 0; i < moduleCount; i++) {
+		for (const auto& representation : modules[i]->getProvidedRepresentations())
+			providers[representation->getName()].push_back(i);
+	}
 
-		for (auto it1 = start; it1 != moduleExecutionList.end(); it1++) {
-			start = it1;
-			if (!moduleExecutionMap[*it1]->isEnabled())
-				continue;
-			Module* m1 = moduleExecutionMap[*it1]->getModule();
+	// build the dependency graph
+	std::vector< std::set<size_t> > successors(moduleCount);
+	std::vector<size_t> predecessorCount(moduleCount, 0);
+	auto addDependency = [&](size_t before, size_t after) {
+		if (before != after && successors[before].insert(after).second)
+			predecessorCount[after]++;
+	};
+
+	for (size_t i = 0; i < moduleCount; i++) {
+		for (const auto& representation : modules[i]->getRequiredRepresentations()) {
+			auto it = providers.find(representation->getName());
+			if (it != providers.end()) {
+				for (size_t provider : it->second)
+					addDependency(provider, i);
+			}
+		}
 
-			for (auto it2 = it1; it2 != moduleExecutionList.end(); it2++) {
-				if (!moduleExecutionMap[*it2]->isEnabled())
-					continue;
-				Module* m2 = moduleExecutionMap[*it2]->getModule();
+		for (const auto& representation : modules[i]->getRecycledRepresentations()) {
+			auto it = providers.find(representation->getName());
+			if (it != providers.end()) {
+				for (size_t provider : it->second)
+					addDependency(i, provider);
+			}
+		}
+	}
 
-				// m2 is currently executed after m1. Make sure that m2 does not provide a value
-				// that m1 requires.
-				for (auto itReq = m1->getRequiredRepresentations().begin();
-				     itReq != m1->getRequiredRepresentations().end();
-				     itReq++)
-				{
-					std::string repName = (*itReq)->getName();
-					for (auto r = m2->getProvidedRepresentations().begin();
-					     r != m2->getProvidedRepresentations().end();
-					     ++r)
-					{
-						if ((*r)->getName() == repName) {
-							std::swap(*it1, *it2);
-							changed = true;
-							break;
-						}
-					} //end for
-					if (changed)
-						break;
-				} //end for
-				if (changed)
-					break;
+	// sort the modules topologically, level by level
+	std::vector< std::vector<size_t> > levels;
+	std::vector<size_t> currentLevel;
+	for (size_t i = 0; i < moduleCount; i++) {
+		if (predecessorCount[i] == 0)
+			currentLevel.push_back(i);
+	}
 
-				// m2 is currently executed after m1. Make sure that m1 does not provide a value
-				// that m2 recycles.
-				for (auto itProv = m1->getProvidedRepresentations().begin();
-				     itProv != m1->getProvidedRepresentations().end();
-				     itProv++)
-				{
-					std::string repName = (*itProv)->getName();
-					for (auto r = m2->getRecycledRepresentations().begin();
-					     r != m2->getRecycledRepresentations().end();
-					     ++r)
-					{
-						if ((*r)->getName() == repName) {
-							std::swap(*it1, *it2);
-							changed = true;
-							break;
-						}
-					} //end for
-					if (changed)
-						break;
-				} //end for
-				if (changed)
+	size_t sortedCount = 0;
+	while (false == currentLevel.empty()) {
+		std::vector<size_t> nextLevel;
+		for (size_t i : currentLevel) {
+			for (size_t successor : successors[i]) {
+				if (--predecessorCount[successor] == 0)
+					nextLevel.push_back(successor);
+			}
+		}
+
+		sortedCount += currentLevel.size();
+		levels.push_back(currentLevel);
+
+		std::sort(nextLevel.begin(), nextLevel.end());
+		currentLevel = nextLevel;
+	}
+
+	// anything left is part of a cycle, execute it in order of registration
+	if (sortedCount < moduleCount) {
+		WARNING("Cyclic dependencies between modules of %s, executing them in order of registration", getName());
+		for (size_t i = 0; i < moduleCount; i++) {
+			if (predecessorCount[i] > 0)
+				levels.push_back(std::vector<size_t>(1, i));
+		}
+	}
+
+	// modules providing the same representation must not run at the same time
+	executionLevels.clear();
+	for (const auto& level : levels) {
+		std::vector< std::vector<size_t> > splitLevels;
+		for (size_t i : level) {
+			auto target = splitLevels.begin();
+			for (; target != splitLevels.end(); ++target) {
+				bool conflict = false;
+				for (size_t other : *target) {
+					for (const auto& representation : modules[i]->getProvidedRepresentations()) {
+						const auto& otherProvided = modules[other]->getProvidedRepresentations();
+						if (std::find(otherProvided.begin(), otherProvided.end(), representation) != otherProvided.end())
+							conflict = true;
+					}
+				}
+				if (false == conflict)
 					break;
-			} //end for
-			if (changed)
-				break;
-		} //end for
+			}
+
+			if (target == splitLevels.end())
+				splitLevels.push_back(std::vector<size_t>(1, i));
+			else
+				target->push_back(i);
+		}
 
-	} //end while
+		for (const auto& splitLevel : splitLevels) {
+			executionLevels.push_back(std::vector<std::string>());
+			for (size_t i : splitLevel)
+				executionLevels.back().push_back(names[i]);
+		}
+	}
 
-	if (iterations >= maxAttempts) {
-		WARNING("Maximal number of iterations reached for module execution list calculation");
-	} //end if
+	// the execution list contains the enabled modules (in order) followed by the disabled
+	// ones, which will be executed at the end if they get enabled later on
+	moduleExecutionList.clear();
+	for (const auto& level : executionLevels)
+		moduleExecutionList.insert(moduleExecutionList.end(), level.begin(), level.end());
+
+	for (const auto& name : moduleRegistrationList) {
+		if (false == moduleExecutionMap[name]->isEnabled()) {
+			moduleExecutionList.push_back(name);
+			executionLevels.push_back(std::vector<std::string>(1, name));
+		}
+	}
+
+	// resolve the stopwatches and trace names once instead of in every frame
+	runtimesName = std::string(getName()) + ".runtimes";
+	std::transform(runtimesName.begin(), runtimesName.end(), runtimesName.begin(), ::tolower);
+	traceName = Tracer::getInstance().intern(getName());
+
+	schedule.clear();
+	for (const auto& level : executionLevels) {
+		schedule.push_back(std::vector<ScheduledModule>());
+		for (const auto& name : level) {
+			ScheduledModule scheduled;
+			scheduled.name      = name;
+			scheduled.module    = moduleExecutionMap[name];
+			scheduled.stopwatch = Stopwatch::getInstance().registerStopwatch(runtimesName, name);
+			scheduled.traceName = Tracer::getInstance().intern(name);
+			schedule.back().push_back(scheduled);
+		}
+	}
 
 	// check that all REQUIRE have a PROVIDE somewhere
 	for (auto it1 = moduleExecutionList.begin();
@@ -363,12 +584,11 @@ void ModuleManager::calculateExecutionList() {
 	// print execution list
 	DEBUG_TEXT("modules.showExecutionList",
 			"Calculated Module Execution List:");
-	for (auto itExec = moduleExecutionList.begin();
-	     itExec != moduleExecutionList.end();
-	     itExec++)
-	{
-		if (moduleExecutionMap[*itExec]->isEnabled()) {
-			DEBUG_TEXT("modules.showExecutionList", "  %s", (*itExec).c_str());
+	for (size_t level = 0; level < executionLevels.size(); level++) {
+		for (const auto& name : executionLevels[level]) {
+			if (moduleExecutionMap[name]->isEnabled()) {
+				DEBUG_TEXT("modules.showExecutionList", "  %2zu %s", level, name.c_str());
+			}
 		}
 	}
 }
@@ -382,13 +602,12 @@ void ModuleManager::calculateExecutionList() {
  */
 
 void ModuleManager::printExecutionList() {
-	printf("Calculated execution list for '%s':\n", getName());
-	for (auto itExec = moduleExecutionList.begin();
-	     itExec != moduleExecutionList.end();
-	     itExec++)
-	{
-		if (((AbstractModuleCreator*) getModule(*itExec))->isEnabled()) {
-			printf("  %s\n", (*itExec).c_str());
+	printf("Calculated execution list for '%s' (level, module):\n", getName());
+	for (size_t level = 0; level < executionLevels.size(); level++) {
+		for (const auto& name : executionLevels[level]) {
+			if (getModule(name)->isEnabled()) {
+				printf("  %2zu %s\n", level, name.c_str());
+			}
 		}
 	}
 }
@@ -12,19 +12,25 @@
 #include <string>
 #include <list>
 #include <vector>
+#include <functional>
 
 #include "asyncModuleExecutor.h"
+#include "moduleThreadPool.h"
 #include "BlackBoard.h"
+#include "DataHolder.h"
+#include "PublishedRepresentation.h"
 #include "Module.h"
 #include "ModuleCreator.h"
 #include "utils/namedInstance.h"
 #include "management/config/config.h"
+#include "debugging/stopwatch.h"
 
 /*------------------------------------------------------------------------------------------------*/
 
 // forward declarations
 class LogWriter;
 class LogPlayer;
+struct DebuggingOption;
 
 
 /*------------------------------------------------------------------------------------------------*/
@@ -38,6 +44,15 @@ class ModuleManager
 		, virtual public NamedInstance
 {
 public:
+	/// how executeModules() dispatches the enabled modules
+	enum ExecutionMode {
+		/// every module is run by the AsyncModuleExecutor (allows to detect hung modules)
+		  EXECUTION_ASYNC
+		/// modules run on the manager's own thread, only modules with a time budget are
+		/// watched by the AsyncModuleExecutor
+		, EXECUTION_INLINE
+	};
+
 	ModuleManager();
 	virtual ~ModuleManager();
 
@@ -77,8 +92,11 @@ public:
 	ModuleCreator<T>* registerModule(std::string name, bool enable = false) {
 		// module does not exist
 		if (moduleExecutionMap.find(name) == moduleExecutionMap.end()) {
+			moduleRegistrationList.push_back(name);
 			moduleExecutionList.push_back(name);
 			moduleExecutionMap[name] = createModule<T>();
+			executionLevels.clear();
+			schedule.clear();
 		}
 
 		AbstractModuleCreator* module = moduleExecutionMap.find(name)->second;
@@ -105,6 +123,69 @@ public:
 
 	void setModuleEnabled(std::string moduleName, bool value = true, bool recalculateExecutionList = false);
 
+	void setModuleTimeBudget(std::string moduleName, Millisecond budget);
+
+	/// set how modules are dispatched
+	void setExecutionMode(ExecutionMode mode) {
+		executionMode = mode;
+	}
+
+	ExecutionMode getExecutionMode() const {
+		return executionMode;
+	}
+
+	/// set the number of worker threads for independent modules (0 == serial execution),
+	/// only modules executed inline without a time budget run on them
+	void setThreadCount(unsigned int count) {
+		threadCount = count;
+	}
+
+	/// force serial execution of all modules (e.g. for log replay), independent of the thread count
+	void setSerialExecution(bool serial) {
+		serialExecution = serial;
+	}
+
+	/** Publish a representation to other module managers. After every frame, a
+	 ** snapshot of the representation is published to the given channel.
+	 **
+	 ** @param channelName          name of the exchange channel
+	 ** @param representationName   name of the representation on our blackboard
+	 */
+	template<class T>
+	void publishRepresentation(const std::string &channelName, const std::string &representationName) {
+		CriticalSectionLock lock(executorCS);
+
+		auto channel = PublishedRepresentations::getInstance().get<T>(channelName);
+		auto handle  = getBlackBoard().getHandle< DataHolder<T> >(representationName);
+		publishers.push_back([channel, handle]() {
+			channel->publish(**handle);
+		});
+	}
+
+	/** Subscribe to a representation published by another module manager. Before
+	 ** every frame, a newly published snapshot is applied to our representation
+	 ** (by default it is copied). This never waits for the publishing manager.
+	 **
+	 ** @param channelName          name of the exchange channel
+	 ** @param representationName   name of the representation on our blackboard
+	 ** @param apply                function applying the snapshot to our representation
+	 */
+	template<class T>
+	void subscribeRepresentation(
+			const std::string &channelName,
+			const std::string &representationName,
+			std::function<void(T&, const T&)> apply = [](T& own, const T& published) { own = published; })
+	{
+		CriticalSectionLock lock(executorCS);
+
+		auto channel = PublishedRepresentations::getInstance().get<T>(channelName);
+		auto handle  = getBlackBoard().getHandle< DataHolder<T> >(representationName);
+		subscribers.push_back([channel, handle, apply]() {
+			if (channel->hasUpdate())
+				apply(**handle, channel->latest());
+		});
+	}
+
 public: // TODO: make protected, at the moment required by SimStar support
 	AbstractModuleCreator* getModule(const std::string& name);
 	const AbstractModuleCreator* getModule(const std::string& name) const;
@@ -118,7 +199,21 @@ protected:
 		return moduleExecutionList;
 	}
 
+	const std::vector< std::vector<std::string> >& getExecutionLevels() {
+		return executionLevels;
+	}
+
+	/// a module of the execution list, with everything resolved that is needed to run it
+	struct ScheduledModule {
+		std::string            name;
+		AbstractModuleCreator *module;
+		StopwatchHandle        stopwatch;
+		const char            *traceName;
+	};
+
 	virtual void executeModules();
+	void executeModule(const std::string &name, AbstractModuleCreator* module);
+	void runModule(const ScheduledModule &scheduled, bool stopWatchEnabled);
 
 	void calculateExecutionList();
 	void printExecutionList();
@@ -136,6 +231,14 @@ protected:
 	// asynchronous module executor instance
 	AsyncModuleExecutor executor;
 
+	// how modules are dispatched
+	ExecutionMode executionMode;
+
+	// worker threads for the modules within one level of the execution graph
+	ModuleThreadPool threadPool;
+	unsigned int threadCount;
+	bool serialExecution;
+
 	// the number of iterations
 	uint32_t framenumber;
 
@@ -148,8 +251,29 @@ private:
 	/** store the mapping name->module */
 	std::map<std::string, AbstractModuleCreator*> moduleExecutionMap;
 
+	/** list of names of modules in the order of registration */
+	std::vector<std::string> moduleRegistrationList;
+
 	/** list of names of modules in the order of execution */
 	std::list<std::string> moduleExecutionList;
+
+	/** names of modules grouped by their level in the dependency graph, the
+	 ** modules of one level do not depend on each other */
+	std::vector< std::vector<std::string> > executionLevels;
+
+	/** the execution levels as executed by executeModules() */
+	std::vector< std::vector<ScheduledModule> > schedule;
+
+	/** debug option (and its name) of the stopwatches measuring the runtimes */
+	std::string      runtimesName;
+	DebuggingOption *runtimesOption;
+
+	/** name of the frames in the trace */
+	const char *traceName;
+
+	/** exchange of representations with other module managers */
+	std::vector< std::function<void()> > subscribers;
+	std::vector< std::function<void()> > publishers;
 };
 
 #endif //__ModuleManager_h_
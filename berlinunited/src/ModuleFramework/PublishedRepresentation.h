@@ -0,0 +1,161 @@
+/**
+ * @file PublishedRepresentation.h
+ *
+ * Exchange of representations between module managers that run in different
+ * threads (e.g. cognition -> motion).
+ *
+ * A PublishedRepresentation<T> is a triple buffer: the producer always owns
+ * one buffer to write into, the consumer always owns one buffer to read from
+ * and the third buffer holds the latest published snapshot. Publishing and
+ * taking the latest snapshot are a single atomic exchange each, so neither
+ * side ever waits for the other one (and a slow producer never stalls the
+ * consumer). A consumer always sees a frame-consistent snapshot.
+ *
+ * There must only be one producer and one consumer per published
+ * representation.
+ *
+ * Usage (see ModuleManager::publishRepresentation and
+ * ModuleManager::subscribeRepresentation):
+
+  // producing manager, publishes its MotorPositionRequest after every frame
+  cognition->publishRepresentation<MotorPositionRequest>("CognitionMotorPositionRequest", "MotorPositionRequest");
+
+  // consuming manager, merges every new snapshot into its own representation
+  motion->subscribeRepresentation<MotorPositionRequest>("CognitionMotorPositionRequest", "MotorPositionRequest",
+      [](MotorPositionRequest& own, const MotorPositionRequest& published) { own.merge(published); });
+
+ */
+
+#ifndef __PublishedRepresentation_h_
+#define __PublishedRepresentation_h_
+
+#include "platform/system/thread.h"
+#include "utils/patterns/singleton.h"
+
+#include <atomic>
+#include <map>
+#include <memory>
+#include <string>
+#include <typeinfo>
+#include <assert.h>
+
+
+/*------------------------------------------------------------------------------------------------*/
+
+class PublishedRepresentationBase {
+public:
+	virtual ~PublishedRepresentationBase() {}
+};
+
+
+/*------------------------------------------------------------------------------------------------*/
+
+/**
+ ** Lock-free triple buffer holding the latest snapshot of a representation.
+ */
+
+template<class T>
+class PublishedRepresentation : public PublishedRepresentationBase {
+private:
+	// bit in the state that marks the shared buffer as not yet consumed
+	static const uint8_t FRESH = 0x4;
+	static const uint8_t INDEX = 0x3;
+
+	T buffers[3];
+
+	// index of the shared buffer (and the FRESH bit)
+	std::atomic<uint8_t> state;
+
+	// index of the buffer owned by the producer and by the consumer
+	uint8_t back;
+	uint8_t front;
+
+	// number of published snapshots
+	std::atomic<uint32_t> sequence;
+
+public:
+	PublishedRepresentation()
+		: state(1)
+		, back(0)
+		, front(2)
+		, sequence(0)
+	{}
+
+	/** (producer) publish a snapshot of the representation
+	 **
+	 ** @param representation   the representation to publish
+	 */
+	void publish(const T& representation) {
+		buffers[back] = representation;
+		back = state.exchange(back | FRESH, std::memory_order_acq_rel) & INDEX;
+		sequence.fetch_add(1, std::memory_order_relaxed);
+	}
+
+	/** (consumer) check whether a snapshot was published since the last call to latest()
+	 */
+	bool hasUpdate() const {
+		return (state.load(std::memory_order_acquire) & FRESH) != 0;
+	}
+
+	/** (consumer) get the latest published snapshot, never blocks
+	 */
+	const T& latest() {
+		if (hasUpdate())
+			front = state.exchange(front, std::memory_order_acq_rel) & INDEX;
+		return buffers[front];
+	}
+
+	/** number of snapshots published so far
+	 */
+	uint32_t getSequence() const {
+		return sequence.load(std::memory_order_relaxed);
+	}
+};
+
+
+/*------------------------------------------------------------------------------------------------*/
+
+/**
+ ** Registry of the published representations, so producing and consuming
+ ** managers can find each other by name. Only accessed while setting up the
+ ** exchange, never per frame.
+ */
+
+class PublishedRepresentations : public Singleton<PublishedRepresentations> {
+	friend class Singleton<PublishedRepresentations>;
+
+private:
+	PublishedRepresentations() {
+		cs.setName("PublishedRepresentations");
+	}
+
+	CriticalSection cs;
+	std::map<std::string, std::shared_ptr<PublishedRepresentationBase>> channels;
+
+public:
+	/** get (or create) the published representation with the given name
+	 **
+	 ** @param name   name of the exchange channel
+	 */
+	template<class T>
+	std::shared_ptr<PublishedRepresentation<T>> get(const std::string &name) {
+		CriticalSectionLock lock(cs);
+
+		auto it = channels.find(name);
+		if (it == channels.end()) {
+			auto channel = std::make_shared<PublishedRepresentation<T>>();
+			channels[name] = channel;
+			return channel;
+		}
+
+		auto channel = std::dynamic_pointer_cast<PublishedRepresentation<T>>(it->second);
+		if (channel == nullptr) {
+			std::cerr << "Published representation type mismatch: " << name
+			          << " is not of type " << typeid(T).name() << std::endl;
+			assert(false);
+		}
+		return channel;
+	}
+};
+
+#endif //__PublishedRepresentation_h_
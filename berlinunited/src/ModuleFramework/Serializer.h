@@ -3,6 +3,8 @@
 
 #include <typeinfo>
 #include <iostream>
+#include <memory>
+#include <stddef.h>
 
 #include "debug.h"
 
@@ -75,6 +77,26 @@ public:
 };
 
 
+/*------------------------------------------------------------------------------------------------*/
+
+/** Take a block of binary data from an archive without copying it. This is
+ ** only possible if the archive reads from memory that is shared (e.g. a
+ ** memory-mapped log file, see LogInputArchive), otherwise nullptr is
+ ** returned and the data has to be read with make_binary_object().
+ **
+ ** @param archive   Archive to read from
+ ** @param bytes     Number of bytes to take
+ ** @return the data, nullptr if it can not be taken without copying
+ */
+
+std::shared_ptr<void> aliasBinaryData(DESERIALIZER &archive, size_t bytes);
+
+template<class Archive>
+inline std::shared_ptr<void> aliasBinaryData(Archive &, size_t) {
+	return nullptr;
+}
+
+
 /*------------------------------------------------------------------------------------------------*/
 //BOOST_CLASS_EXPORT(REPRESENTATION);
 
@@ -0,0 +1,218 @@
+#include "moduleThreadPool.h"
+
+#include <algorithm>
+#include <thread>
+
+
+/*------------------------------------------------------------------------------------------------*/
+
+/**
+ **
+ */
+
+ModuleThreadPool::ModuleThreadPool()
+	: batch(0)
+	, stopping(false)
+	, pending(0)
+{
+	// the calling thread always has a queue
+	queues.emplace_back(new TaskQueue());
+}
+
+
+/*------------------------------------------------------------------------------------------------*/
+
+/**
+ **
+ */
+
+ModuleThreadPool::~ModuleThreadPool() {
+	stop();
+}
+
+
+/*------------------------------------------------------------------------------------------------*/
+
+/** Start the worker threads.
+ **
+ ** @param threadCount   Number of worker threads to start
+ */
+
+void ModuleThreadPool::start(unsigned int threadCount) {
+	stop();
+
+	{
+		std::unique_lock<std::mutex> lock(mutex);
+		stopping = false;
+
+		queues.clear();
+		for (unsigned int i = 0; i <= threadCount; i++)
+			queues.emplace_back(new TaskQueue());
+	}
+
+	for (unsigned int i = 0; i < threadCount; i++) {
+		workers.emplace_back(new Worker(*this, i));
+		workers.back()->run();
+	}
+}
+
+
+/*------------------------------------------------------------------------------------------------*/
+
+/** Stop the worker threads.
+ */
+
+void ModuleThreadPool::stop() {
+	{
+		std::unique_lock<std::mutex> lock(mutex);
+		stopping = true;
+	}
+	wakeupCV.notify_all();
+
+	// cancel the workers before destroying them, a worker that was just
+	// started may not have entered threadMain yet
+	for (auto &worker : workers)
+		worker->cancel();
+	workers.clear();
+}
+
+
+/*------------------------------------------------------------------------------------------------*/
+
+/** Give all worker threads realtime priority and pin worker i to core i+1,
+ ** so the workers neither get preempted by lower priority threads nor
+ ** migrate between the cores in the middle of a batch. No worker is pinned to
+ ** core 0, the calling thread (which is not pinned) and the other threads of
+ ** the process run there or on the remaining cores.
+ **
+ ** @param priority   Realtime priority of the workers
+ ** @return false if there are not more cores than workers, or if the priority
+ **         or the affinity of a worker could not be set
+ */
+
+bool ModuleThreadPool::setRealTimePriority(int priority) {
+	const unsigned int cores = std::max(1u, std::thread::hardware_concurrency());
+
+	// workers sharing a core (with each other or with the calling thread)
+	// would stall the batch, which is worse than not having them
+	if (workers.size() >= cores)
+		return false;
+
+	bool success = true;
+	for (unsigned int i = 0; i < workers.size(); i++) {
+		success = workers[i]->setRealTimePriority(priority) && success;
+		success = workers[i]->setAffinity(i + 1) && success;
+	}
+
+	return success;
+}
+
+
+/*------------------------------------------------------------------------------------------------*/
+
+/** Execute the tasks and wait for all of them to finish. Without worker
+ ** threads, the tasks are executed in the given order.
+ **
+ ** @param tasks   Tasks to execute, they must not depend on each other
+ */
+
+void ModuleThreadPool::execute(const std::vector<Task> &tasks) {
+	if (workers.empty() || tasks.size() <= 1) {
+		for (const auto &task : tasks)
+			task();
+		return;
+	}
+
+	{
+		std::unique_lock<std::mutex> lock(mutex);
+
+		// the batch state has to be set up before the first task is queued, a
+		// worker that is still looking for work of the previous batch may take
+		// (and finish) a task as soon as it is in a queue
+		pending = tasks.size();
+		batch++;
+
+		// distribute the tasks, starting with the calling thread's queue
+		const unsigned int callerIndex = queues.size() - 1;
+		for (unsigned int i = 0; i < tasks.size(); i++) {
+			TaskQueue &queue = *queues[(callerIndex + i) % queues.size()];
+			std::unique_lock<std::mutex> queueLock(queue.mutex);
+			queue.tasks.push_back(&tasks[i]);
+		}
+	}
+	wakeupCV.notify_all();
+
+	// help out until there is nothing left to take
+	while (runTask(queues.size() - 1)) {}
+
+	// wait for the tasks still running in the workers
+	std::unique_lock<std::mutex> lock(mutex);
+	finishedCV.wait(lock, [this]{ return pending == 0; });
+}
+
+
+/*------------------------------------------------------------------------------------------------*/
+
+/** Take a task from the own queue or steal one from another queue and
+ ** execute it.
+ **
+ ** @param index   Index of the queue of the executing thread
+ ** @return true if a task was executed, false if all queues are empty
+ */
+
+bool ModuleThreadPool::runTask(unsigned int index) {
+	const Task* task = nullptr;
+
+	for (unsigned int i = 0; i < queues.size() && task == nullptr; i++) {
+		TaskQueue &queue = *queues[(index + i) % queues.size()];
+		std::unique_lock<std::mutex> queueLock(queue.mutex);
+		if (queue.tasks.empty())
+			continue;
+
+		// take own tasks from the front, steal from the back
+		if (i == 0) {
+			task = queue.tasks.front();
+			queue.tasks.pop_front();
+		} else {
+			task = queue.tasks.back();
+			queue.tasks.pop_back();
+		}
+	}
+
+	if (task == nullptr)
+		return false;
+
+	(*task)();
+
+	if (--pending == 0) {
+		std::unique_lock<std::mutex> lock(mutex);
+		finishedCV.notify_all();
+	}
+
+	return true;
+}
+
+
+/*------------------------------------------------------------------------------------------------*/
+
+/** Main loop of the worker threads.
+ **
+ ** @param index   Index of the worker
+ */
+
+void ModuleThreadPool::workerMain(unsigned int index) {
+	uint32_t lastBatch = 0;
+
+	while (true) {
+		{
+			std::unique_lock<std::mutex> lock(mutex);
+			wakeupCV.wait(lock, [&]{ return stopping || batch != lastBatch; });
+			if (stopping)
+				return;
+
+			lastBatch = batch;
+		}
+
+		while (runTask(index)) {}
+	}
+}
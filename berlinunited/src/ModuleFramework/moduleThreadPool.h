@@ -0,0 +1,93 @@
+#ifndef MODULETHREADPOOL_H_
+#define MODULETHREADPOOL_H_
+
+#include "platform/system/thread.h"
+
+#include <atomic>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <vector>
+
+/** The ModuleThreadPool executes batches of independent tasks (i.e. the
+ ** modules of one level of the execution graph) on a small set of worker
+ ** threads.
+ **
+ ** Every worker (and the calling thread) owns a task queue. Tasks of a batch
+ ** are distributed round-robin onto these queues, a thread that runs out of
+ ** tasks steals from the back of the other queues. The calling thread takes
+ ** part in the execution and execute() only returns once all tasks of the
+ ** batch have finished.
+ */
+
+class ModuleThreadPool {
+public:
+	typedef std::function<void()> Task;
+
+	ModuleThreadPool();
+	~ModuleThreadPool();
+
+	/// start the given number of worker threads (0 == execute everything in the calling thread)
+	void start(unsigned int threadCount);
+
+	/// stop all worker threads
+	void stop();
+
+	/// the number of worker threads (not counting the calling thread)
+	unsigned int getThreadCount() const {
+		return workers.size();
+	}
+
+	/// give the workers realtime priority and pin each to its own core other than core 0 (false if any of it failed)
+	bool setRealTimePriority(int priority);
+
+	/// execute all tasks and wait for them to finish
+	void execute(const std::vector<Task> &tasks);
+
+protected:
+	class Worker : public Thread {
+	public:
+		Worker(ModuleThreadPool &pool, unsigned int index)
+			: pool(pool)
+			, index(index)
+		{}
+
+		virtual const char* getName() const override {
+			return "ModuleThreadPool";
+		}
+
+	protected:
+		ModuleThreadPool &pool;
+		unsigned int index;
+
+		virtual void threadMain() override {
+			pool.workerMain(index);
+		}
+	};
+
+	struct TaskQueue {
+		std::mutex              mutex;
+		std::deque<const Task*> tasks;
+	};
+
+	// one queue per worker, the last one belongs to the calling thread
+	std::vector<std::unique_ptr<TaskQueue>> queues;
+	std::vector<std::unique_ptr<Worker>>    workers;
+
+	// protects the batch state and is used with the condition variables
+	std::mutex              mutex;
+	std::condition_variable wakeupCV;
+	std::condition_variable finishedCV;
+
+	// increased for every batch so sleeping workers know that there is work
+	uint32_t batch;
+	bool     stopping;
+
+	// number of tasks of the current batch that have not finished yet
+	std::atomic<int> pending;
+
+	void workerMain(unsigned int index);
+	bool runTask(unsigned int index);
+};
+
+#endif
@@ -11,6 +11,7 @@
 #include "management/config/configRegistry.h"
 #include "management/config/config.h"
 #include "debug.h"
+#include "debugging/tracer.h"
 #include "messageRegistry.h"
 
 #include "msg_segment.pb.h"
@@ -41,6 +42,7 @@
 #define OP_MESSAGE       42
 
 #define MSG_FLAG_COMPRESSED 2
+#define MSG_FLAG_BATCH      4
 
 
 /*------------------------------------------------------------------------------------------------*/
@@ -54,6 +56,66 @@ namespace {
 
 	auto cfgCompression          = ConfigRegistry::registerOption<bool>("comm.compression.enabled",  false,    "Whether to compress outgoing messages (1) or not (0)");
 	auto cfgCompressionThreshold = ConfigRegistry::registerOption<int>("comm.compression.threshold", 32000,    "Minimum size (in bytes) of messages to compress");
+
+	auto cfgReassemblyMemory  = ConfigRegistry::registerOption<int>("comm.reassembly.memory",  8*1024*1024, "Maximum number of bytes held for incomplete segmented messages");
+	auto cfgReassemblyTimeout = ConfigRegistry::registerOption<int>("comm.reassembly.timeout", 1000,        "Time (in ms) after which incomplete segmented messages are discarded");
+
+	auto cfgCoalesceInterval = ConfigRegistry::registerOption<int>("comm.coalesce.interval", 0,    "Time (in ms) small broadcast messages are held back to be sent together (0 to disable, receivers need to support batches)");
+	auto cfgCoalesceSize     = ConfigRegistry::registerOption<int>("comm.coalesce.size",     1024, "Maximum size (in bytes) of messages that are held back");
+}
+
+
+/*------------------------------------------------------------------------------------------------*/
+
+namespace {
+	/** Buffer outgoing messages are serialized into. The memory is kept per thread
+	 ** and reused for the next message. A message that is sent while another one
+	 ** is being sent (e.g. a warning) gets its own memory.
+	 */
+	class SendBuffer {
+	public:
+		SendBuffer() {
+			data.swap(getThreadBuffer());
+			data.clear();
+		}
+
+		~SendBuffer() {
+			getThreadBuffer().swap(data);
+		}
+
+		std::string data;
+
+	private:
+		static std::string& getThreadBuffer() {
+			static thread_local std::string buffer;
+			return buffer;
+		}
+	};
+
+	/// write the header of a message
+	void writeHeader(uint8_t *header, uint8_t flags, uint32_t dataLen) {
+		uint16_t operationBE = htons(OP_MESSAGE);
+		uint32_t dataLenBE   = htonl(dataLen);
+		memset(header, 0, COMM_HEADER_SIZE + 8);
+		memcpy(header,     &operationBE, 2);
+		memcpy(header + 2, &flags,       1);
+		memcpy(header + 8, &dataLenBE,   4);
+	}
+
+	/// read the header of a message in memory, false if it is not a complete message
+	bool readHeader(const uint8_t *data, uint32_t dataLen, uint8_t &flags, uint32_t &messageSize) {
+		if (dataLen < COMM_HEADER_SIZE + 8)
+			return false;
+
+		uint16_t messageType;
+		memcpy(&messageType, data,     2);
+		memcpy(&messageSize, data + 8, 4);
+		messageType = ntohs(messageType);
+		messageSize = ntohl(messageSize);
+		flags       = data[2];
+
+		return messageType == OP_MESSAGE && messageSize <= dataLen - COMM_HEADER_SIZE - 8;
+	}
 }
 
 
@@ -69,6 +131,10 @@ Comm::Comm()
 	, totalBytesSent(0)
 	, totalBytesRead(0)
 	, compressionThreshold(UINT_MAX)
+	, reassembler()
+	, coalesceInterval(0*milliseconds)
+	, coalesceSize(0)
+	, sendQueues()
 	, handlers()
 	, broadcastConnection(0)
 	, simulatorBroadcastConnection(0)
@@ -113,6 +179,11 @@ bool Comm::init() {
 	else
 		compressionThreshold = cfgCompressionThreshold->get();
 
+	reassembler.setLimits(std::max(0, cfgReassemblyMemory->get()), cfgReassemblyTimeout->get()*milliseconds);
+
+	coalesceInterval = std::max(0, cfgCoalesceInterval->get())*milliseconds;
+	coalesceSize     = std::max(0, cfgCoalesceSize->get());
+
 	// get ports to use
 	int simBroadcastPort = cfgSimPort->get();
 	int localPort        = cfgPort->get();
@@ -159,14 +230,20 @@ bool Comm::init() {
 /*------------------------------------------------------------------------------------------------*/
 
 /**
- ** Thread main function
+ ** Thread main function, sends out the messages that were held back.
  **
 **/
 
 void Comm::threadMain() {
 	while (isRunning()) {
-		sleep(1);
+		if (coalesceInterval > 0*milliseconds) {
+			delay(coalesceInterval);
+			flushSendQueues();
+		} else
+			sleep(1);
 	}
+
+	flushSendQueues();
 }
 
 
@@ -180,7 +257,7 @@ void Comm::threadMain() {
 bool Comm::process(RemoteConnectionPtr remote) {
 	// read request and handle it
 	uint16_t messageType;
-	uint16_t messageDummy;
+	uint8_t  messageFlags[2];
 	uint32_t messageSize;
 
 	/* the header of each message is defined as
@@ -200,7 +277,7 @@ bool Comm::process(RemoteConnectionPtr remote) {
 		return false;
 
 	// read flags and the unused byte
-	received = remote->read((uint8_t*)&messageDummy, 2);
+	received = remote->read(messageFlags, 2);
 	if (received != 2)
 		return false;
 
@@ -226,25 +303,138 @@ bool Comm::process(RemoteConnectionPtr remote) {
 
 	messageSize = ntohl(messageSize);
 
-	uint8_t *messageData = new uint8_t[messageSize];
-	received = remote->read(messageData, messageSize);
-	if (received != (signed)messageSize)
-		return false;
+	// parse directly from the receive buffer if possible, otherwise read a copy
+	std::unique_ptr<uint8_t[]> messageCopy;
+	const uint8_t *messageData = remote->readInPlace(messageSize);
+	if (nullptr == messageData) {
+		messageCopy.reset(new uint8_t[messageSize]);
+		received = remote->read(messageCopy.get(), messageSize);
+		if (received != (signed)messageSize)
+			return false;
+		messageData = messageCopy.get();
+	}
+
+	if (messageFlags[0] & MSG_FLAG_BATCH)
+		return processBatch(messageData, messageSize, std::move(remote));
 
 	de::fumanoids::message::Message msg;
-	msg.ParseFromArray(messageData, messageSize);
-	delete[] messageData;
+	if (false == parseMessage(messageFlags[0], messageData, messageSize, msg))
+		return false;
+
+	handleMessage(msg, std::move(remote));
+	return true;
+}
+
+
+/*------------------------------------------------------------------------------------------------*/
+
+/**
+ ** Parse the data of a message.
+ **
+ ** @param flags     Flags from the message header
+ ** @param data      Message data (without header)
+ ** @param dataLen   Length of message data
+ ** @param msg       Message to parse into
+ **
+ ** @return true iff the message was parsed successfully
+ */
+
+bool Comm::parseMessage(uint8_t flags, const uint8_t *data, uint32_t dataLen, de::fumanoids::message::Message &msg) {
+	if (flags & MSG_FLAG_COMPRESSED) {
+		google::protobuf::io::ArrayInputStream arrayStream(data, dataLen);
+		google::protobuf::io::GzipInputStream gzipStream(&arrayStream, google::protobuf::io::GzipInputStream::GZIP);
+		if (false == msg.ParsePartialFromZeroCopyStream(&gzipStream)) {
+			WARNING("Could not uncompress message");
+			return false;
+		}
+	} else {
+		msg.ParsePartialFromArray(data, dataLen);
+	}
 
 	if (msg.IsInitialized() == false) {
 		WARNING("Received incorrect message: %s", msg.InitializationErrorString().c_str());
 		return false;
 	}
 
+	return true;
+}
+
+
+/*------------------------------------------------------------------------------------------------*/
+
+/**
+ ** Process a message in memory, e.g. one that was reassembled from segments.
+ ** The data is the complete message, including its header.
+ **
+ ** @param data      Message
+ ** @param dataLen   Length of the message
+ ** @param remote    Remote connection the message was received from
+ **
+ ** @return true iff the message was handled
+ */
+
+bool Comm::processBuffer(const uint8_t *data, uint32_t dataLen, RemoteConnectionPtr remote) {
+	uint8_t  flags;
+	uint32_t messageSize;
+	if (false == readHeader(data, dataLen, flags, messageSize)) {
+		WARNING("Message has an invalid header (%d bytes)", (int)dataLen);
+		return false;
+	}
+
+	if (flags & MSG_FLAG_BATCH)
+		return processBatch(data + COMM_HEADER_SIZE + 8, messageSize, std::move(remote));
+
+	de::fumanoids::message::Message msg;
+	if (false == parseMessage(flags, data + COMM_HEADER_SIZE + 8, messageSize, msg))
+		return false;
+
 	handleMessage(msg, std::move(remote));
 	return true;
 }
 
 
+/*------------------------------------------------------------------------------------------------*/
+
+/**
+ ** Process a batch of messages that were sent together (see flushSendQueue()).
+ ** The data consists of complete messages, each with its header.
+ **
+ ** @param data      Messages
+ ** @param dataLen   Length of all messages
+ ** @param remote    Remote connection the batch was received from
+ **
+ ** @return true iff the batch was valid
+ */
+
+bool Comm::processBatch(const uint8_t *data, uint32_t dataLen, RemoteConnectionPtr remote) {
+	// parse all messages first, the remote connection is handed on with the last one
+	std::vector<de::fumanoids::message::Message> messages;
+	for (uint32_t offset = 0; offset < dataLen; ) {
+		uint8_t  flags;
+		uint32_t messageSize;
+		if (false == readHeader(data + offset, dataLen - offset, flags, messageSize) || (flags & MSG_FLAG_BATCH)) {
+			WARNING("Received an invalid batch of messages");
+			return false;
+		}
+
+		messages.emplace_back();
+		if (false == parseMessage(flags, data + offset + COMM_HEADER_SIZE + 8, messageSize, messages.back()))
+			messages.pop_back();
+
+		offset += COMM_HEADER_SIZE + 8 + messageSize;
+	}
+
+	for (size_t i = 0; i < messages.size(); i++) {
+		if (i + 1 < messages.size())
+			handleMessage(messages[i], remote->duplicate());
+		else
+			handleMessage(messages[i], std::move(remote));
+	}
+
+	return true;
+}
+
+
 /*------------------------------------------------------------------------------------------------*/
 
 /**
@@ -265,85 +455,117 @@ void Comm::broadcastMessage(de::fumanoids::message::Message &message) {
 /*------------------------------------------------------------------------------------------------*/
 
 /**
- ** Sends a protobuf message
+ ** Sends a protobuf message. If enabled, small messages are held back for a
+ ** short time to be sent together with others to the same destination.
  **
  ** @param  message      Protobuf message
  ** @param  connection   Recipient
 **/
 
 void Comm::sendMessage(de::fumanoids::message::Message &message, std::shared_ptr<RemoteConnection> connection) {
-	sendMessage(message, connection.get());
-}
+	if (coalesceInterval <= 0*milliseconds || nullptr == connection || (uint32_t)message.ByteSize() > coalesceSize) {
+		// the messages held back have to go out first
+		if (coalesceInterval > 0*milliseconds) {
+			CriticalSectionLock lock(cs);
+			std::map<RemoteConnection*, SendQueue>::iterator it = sendQueues.find(connection.get());
+			if (it != sendQueues.end())
+				flushSendQueue(it->second);
+		}
 
-void Comm::sendMessage(de::fumanoids::message::Message &message, RemoteConnection* connection) {
-	if (nullptr == connection || false == connection->isConnected()) {
-		//printf("connection not established, not sending\n");
+		sendMessage(message, connection.get());
 		return;
 	}
 
-	// include our id
-	message.set_robotid( services.getID() );
-
-	if (message.IsInitialized() == false) {
-		WARNING("Message sending failed due to wrong initialization: %s", message.InitializationErrorString().c_str());
+	if (false == prepareMessage(message, connection.get()))
 		return;
-	}
 
+	CriticalSectionLock lock(cs);
+	SendQueue &queue = sendQueues[connection.get()];
+	queue.connection = connection;
+
+	// all messages held back have to fit into one package
 	uint32_t dataLen = (uint32_t)message.ByteSize();
-	if (dataLen > compressionThreshold) {
-		sendMessageCompressed(message, connection);
-	} else {
-		sendMessageUncompressed(message, connection);
-	}
+	if (queue.count > 0 && queue.data.size() + 2*(COMM_HEADER_SIZE + 8) + dataLen > connection->getMaxPackageSize())
+		flushSendQueue(queue);
+
+	serializeMessage(message, queue.data);
+	queue.count++;
+}
+
+void Comm::sendMessage(de::fumanoids::message::Message &message, RemoteConnection* connection) {
+	if (false == prepareMessage(message, connection))
+		return;
+
+	SendBuffer buffer;
+	serializeMessage(message, buffer.data);
+	transmit((const uint8_t*)buffer.data.data(), buffer.data.size(), connection);
 }
 
 
 /*------------------------------------------------------------------------------------------------*/
 
 /**
- **
+ ** Send out all messages that were held back.
 **/
 
-bool Comm::sendMessageUncompressed(de::fumanoids::message::Message &message, RemoteConnection* connection) {
-	// include our id
-	message.set_robotid( services.getID() );
-
-	int dataLen = message.ByteSize();
+void Comm::flushSendQueues() {
+	CriticalSectionLock lock(cs);
 
-	uint32_t  msgLen = COMM_HEADER_SIZE + 8 + dataLen;
-	uint8_t  *msg    = (uint8_t*)malloc(msgLen);
+	for (std::map<RemoteConnection*, SendQueue>::iterator it = sendQueues.begin(); it != sendQueues.end(); ) {
+		std::map<RemoteConnection*, SendQueue>::iterator current = it++;
+		flushSendQueue(current->second);
 
-	if (msg == 0) {
-		ERROR("ERROR allocating memory for message structure");
-		return false;
+		// forget about connections nobody else uses anymore
+		if (current->second.count == 0 && current->second.connection.use_count() == 1)
+			sendQueues.erase(current);
 	}
+}
 
-	google::protobuf::io::ArrayOutputStream outputStream(msg + COMM_HEADER_SIZE + 8, dataLen);
 
-	uint16_t operationBE = htons(OP_MESSAGE);
-	uint8_t  flags       = 0;
-	memset(msg, 0, COMM_HEADER_SIZE);
-	memcpy(msg,   &operationBE, 2);
-	memcpy(msg+2, &flags, 1);
+/*------------------------------------------------------------------------------------------------*/
 
-	int dataLenBE = htonl(dataLen);
-	memset(msg+4, 0,          4);
-	memcpy(msg+8, &dataLenBE, 4);
+/**
+ ** Send out the messages held back for one destination. Several messages are
+ ** sent as one batch, its header and the messages are gathered from separate
+ ** buffers.
+ **
+ ** @param queue   Messages to send
+ **
+ ** @return true iff the messages were sent
+**/
 
-	if (!message.SerializeToZeroCopyStream(&outputStream)) {
-		ERROR("Could not serialize message");
-		free(msg);
-		return false;
-	}
+bool Comm::flushSendQueue(SendQueue &queue) {
+	if (queue.count == 0)
+		return true;
+
+	// sending may hold back further messages (e.g. warnings), so take the data out of the queue
+	std::shared_ptr<RemoteConnection> connection = queue.connection;
+	std::string data;
+	data.swap(queue.data);
+	uint32_t count = queue.count;
+	queue.count = 0;
 
-	bool success = false;
-	if ((unsigned)msgLen > connection->getMaxPackageSize()) {
-		success = sendMessageSegmented(msg, msgLen, connection);
+	bool success;
+	if (count == 1) {
+		success = transmit((const uint8_t*)data.data(), data.size(), connection.get());
 	} else {
-		success = connection->send(msg, msgLen);
+		uint8_t header[COMM_HEADER_SIZE + 8];
+		writeHeader(header, MSG_FLAG_BATCH, data.size());
+
+		struct iovec iov[2];
+		iov[0].iov_base = header;
+		iov[0].iov_len  = sizeof header;
+		iov[1].iov_base = const_cast<char*>(data.data());
+		iov[1].iov_len  = data.size();
+		success = connection->sendv(iov, 2);
+	}
+
+	// keep the memory for the next messages
+	if (queue.data.empty()) {
+		data.clear();
+		queue.data.swap(data);
 	}
 
-	free(msg);
 	return success;
 }
 
@@ -351,66 +573,96 @@ bool Comm::sendMessageUncompressed(de::fumanoids::message::Message &message, Rem
 /*------------------------------------------------------------------------------------------------*/
 
 /**
+ ** Check that a message can be sent and add our id.
  **
+ ** @param  message      Protobuf message
+ ** @param  connection   Recipient
+ **
+ ** @return true iff the message can be sent
 **/
 
-bool Comm::sendMessageCompressed(de::fumanoids::message::Message &message, RemoteConnection* connection) {
+bool Comm::prepareMessage(de::fumanoids::message::Message &message, RemoteConnection* connection) {
+	if (nullptr == connection || false == connection->isConnected()) {
+		//printf("connection not established, not sending\n");
+		return false;
+	}
+
 	// include our id
 	message.set_robotid( services.getID() );
 
-	std::string compressedData;
-	google::protobuf::io::StringOutputStream stream(&compressedData);
-
-	google::protobuf::io::GzipOutputStream::Options gzipOptions;
-	gzipOptions.format = google::protobuf::io::GzipOutputStream::GZIP;
-	google::protobuf::io::GzipOutputStream gzipStream(&stream, gzipOptions);
-
-	if (false == message.SerializeToZeroCopyStream( &gzipStream )) {
-		printf("Could not serialize message\n");
+	if (message.IsInitialized() == false) {
+		WARNING("Message sending failed due to wrong initialization: %s", message.InitializationErrorString().c_str());
 		return false;
 	}
 
-	if (false == gzipStream.Close()) {
-		printf("Error compressing message: %s\n", gzipStream.ZlibErrorMessage());
-		return false;
-	}
+	return true;
+}
 
-	// don't send data out if compressed size is larger than the uncompressed one
-	if (message.ByteSize() < (int)compressedData.size()) {
-		return sendMessageUncompressed(message, connection);
-	}
 
-	int dataLen = (int)compressedData.size();
+/*------------------------------------------------------------------------------------------------*/
 
-	uint32_t  msgLen = COMM_HEADER_SIZE + 8 + dataLen;
-	uint8_t  *msg    = (uint8_t*)malloc(msgLen);
+/**
+ ** Append a message including its header to a buffer. The header is written
+ ** in place, the message data is serialized (and compressed) directly behind
+ ** it.
+ **
+ ** @param  message      Protobuf message
+ ** @param  buffer       Buffer to append the message to
+ ** @param  compress     Whether to compress the message if it exceeds the compression threshold
+**/
 
-	if (msg == 0) {
-		ERROR("ERROR allocating memory for message structure");
-		return false;
-	}
+void Comm::serializeMessage(de::fumanoids::message::Message &message, std::string &buffer, bool compress) {
+	const size_t   start   = buffer.size();
+	const size_t   payload = start + COMM_HEADER_SIZE + 8;
+	const uint32_t dataLen = (uint32_t)message.ByteSize();
 
-	uint16_t operationBE = htons(OP_MESSAGE);
-	uint8_t  flags       = MSG_FLAG_COMPRESSED;
-	memset(msg, 0, COMM_HEADER_SIZE);
-	memcpy(msg,   &operationBE, 2);
-	memcpy(msg+2, &flags, 1);
+	if (compress && dataLen > compressionThreshold) {
+		buffer.resize(payload);
 
-	int dataLenBE = htonl(dataLen);
-	memset(msg+4, 0,          4);
-	memcpy(msg+8, &dataLenBE, 4);
+		bool compressed;
+		{
+			google::protobuf::io::StringOutputStream stream(&buffer);
 
-	memcpy(msg + COMM_HEADER_SIZE + 8, compressedData.c_str(), dataLen);
+			google::protobuf::io::GzipOutputStream::Options gzipOptions;
+			gzipOptions.format = google::protobuf::io::GzipOutputStream::GZIP;
+			google::protobuf::io::GzipOutputStream gzipStream(&stream, gzipOptions);
 
-	bool success;
-	if ((unsigned)msgLen > connection->getMaxPackageSize()) {
-		success = sendMessageSegmented(msg, msgLen, connection);
-	} else {
-		success = connection->send(msg, msgLen);
+			compressed = message.SerializeToZeroCopyStream(&gzipStream) && gzipStream.Close();
+			if (false == compressed)
+				fprintf(stderr, "Error compressing message: %s\n", gzipStream.ZlibErrorMessage() ? gzipStream.ZlibErrorMessage() : "");
+		}
+
+		// don't send data out compressed if compressed size is larger than the uncompressed one
+		if (compressed && buffer.size() - payload <= dataLen) {
+			writeHeader((uint8_t*)&buffer[start], MSG_FLAG_COMPRESSED, buffer.size() - payload);
+			return;
+		}
 	}
 
-	free(msg);
-	return success;
+	buffer.resize(payload + dataLen);
+	writeHeader((uint8_t*)&buffer[start], 0, dataLen);
+	message.SerializeWithCachedSizesToArray((uint8_t*)&buffer[payload]);
+}
+
+
+/*------------------------------------------------------------------------------------------------*/
+
+/**
+ ** Send a serialized message, split into segments if it is too large for the
+ ** connection.
+ **
+ ** @param  data         Message including its header
+ ** @param  dataLen      Length of the message
+ ** @param  connection   Recipient
+ **
+ ** @return true iff the message was sent
+**/
+
+bool Comm::transmit(const uint8_t *data, uint32_t dataLen, RemoteConnection* connection) {
+	if (dataLen > connection->getMaxPackageSize())
+		return sendMessageSegmented(data, dataLen, connection);
+	else
+		return connection->send(data, dataLen);
 }
 
 
@@ -458,17 +710,22 @@ bool Comm::sendMessageSegmented(const uint8_t *data, uint32_t dataLen, RemoteCon
 
 	// send each segment, abort if one segment fails
 	bool success = true;
+	std::string segmentData;
 	for (uint32_t i = 0; i < count && success; i ++) {
 		de::fumanoids::message::Message msg;
 		de::fumanoids::message::MessageSegment &segment = *msg.MutableExtension(de::fumanoids::message::messageSegment);
 
+		msg.set_robotid( services.getID() );
+
 		segment.set_id(id);
 		segment.set_packagenumber(i);
 		segment.set_totalpackagecount(count);
 
 		segment.set_payload(data + i*segmentSize, i == count - 1 ? (dataLen - i*segmentSize) : segmentSize);
 
-		success = success && sendMessageUncompressed(msg, connection);
+		segmentData.clear();
+		serializeMessage(msg, segmentData, false);
+		success = success && connection->send(segmentData.data(), segmentData.size());
 		if (!success) {
 			fprintf(stderr, "Segmented sending of %d bytes failed at segment %d of %d\n", dataLen, i, count);
 		}
@@ -487,7 +744,16 @@ bool Comm::sendMessageSegmented(const uint8_t *data, uint32_t dataLen, RemoteCon
  */
 
 void Comm::handleMessage(const de::fumanoids::message::Message &msg, RemoteConnectionPtr remote) {
+	// segments are collected until the message they belong to is complete
+	if (msg.HasExtension(de::fumanoids::message::messageSegment)) {
+		std::string data;
+		if (reassembler.addSegment(msg.robotid(), msg.GetExtension(de::fumanoids::message::messageSegment), getCurrentTime(), data))
+			processBuffer((const uint8_t*)data.data(), data.size(), std::move(remote));
+		return;
+	}
+
 	// execute callbacks
+	TRACE_SCOPE("comm", "handleMessage");
 	services.getMessageRegistry().handleMessage(msg, msg.robotid(), std::move(remote));
 
 	// from here on, 'remote' is INVALID!
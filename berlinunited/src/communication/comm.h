@@ -4,12 +4,14 @@
 #include "platform/system/thread.h"
 
 #include "commHandlerManager.h"
+#include "messageReassembler.h"
 
 #include <arpa/inet.h>
 #include <stdarg.h>
 
 #include <vector>
 #include <map>
+#include <string>
 
 // forward declarations
 namespace de {
@@ -69,13 +71,37 @@ protected:
 	// minimum number of message bytes to enable compression
 	uint32_t     compressionThreshold;
 
+	/// puts segmented messages back together
+	MessageReassembler reassembler;
+
+	/// small messages waiting to be sent together to one destination
+	struct SendQueue {
+		std::shared_ptr<RemoteConnection> connection;
+		std::string                       data;
+		uint32_t                          count;
+	};
+
+	/// time small messages are held back to be sent together (0 to disable)
+	Millisecond coalesceInterval;
+
+	/// maximum size of a message to hold back
+	uint32_t    coalesceSize;
+
+	std::map<RemoteConnection*, SendQueue> sendQueues;
+
 	/// thread main function, waits for incoming packets
 	void threadMain();
 
 	void handleMessage(const de::fumanoids::message::Message &msg, RemoteConnectionPtr remote);
+	bool parseMessage(uint8_t flags, const uint8_t *data, uint32_t dataLen, de::fumanoids::message::Message &msg);
+	bool processBuffer(const uint8_t *data, uint32_t dataLen, RemoteConnectionPtr remote);
+	bool processBatch(const uint8_t *data, uint32_t dataLen, RemoteConnectionPtr remote);
+
+	bool prepareMessage(de::fumanoids::message::Message &message, RemoteConnection* connection);
+	void serializeMessage(de::fumanoids::message::Message &message, std::string &buffer, bool compress = true);
+	bool transmit(const uint8_t *message, uint32_t messageLength, RemoteConnection *connection);
+	bool flushSendQueue(SendQueue &queue);
 	bool sendMessageSegmented(const uint8_t *message, uint32_t messageLength, RemoteConnection *connection);
-	bool sendMessageCompressed(de::fumanoids::message::Message &message, RemoteConnection* remote);
-	bool sendMessageUncompressed(de::fumanoids::message::Message &message, RemoteConnection* remote);
 
 	void logCommand(const char* commandName, uint8_t* data, uint16_t dataLen, struct sockaddr_in *remoteAddress);
 
@@ -102,8 +128,14 @@ public:
 	void sendMessage(de::fumanoids::message::Message &message, std::shared_ptr<RemoteConnection> remote);
 	void sendMessage(de::fumanoids::message::Message &message, RemoteConnection* remote);
 	void broadcastMessage(de::fumanoids::message::Message &message);
+	void flushSendQueues();
 
 	virtual bool process(RemoteConnectionPtr remote);
+
+	/// the reassembler for segmented messages (for statistics)
+	const MessageReassembler& getReassembler() const {
+		return reassembler;
+	}
 };
 
 
@@ -0,0 +1,215 @@
+#include "messageReassembler.h"
+
+#include "debug.h"
+
+#include "msg_segment.pb.h"
+
+
+/*------------------------------------------------------------------------------------------------*/
+
+/** Constructor
+ **
+ ** @param maxBytes          Maximum number of bytes to hold for incomplete messages
+ ** @param timeout           Time after the last received segment when an incomplete message is discarded
+ ** @param minSegmentBytes   Minimum payload of a segment (except for the last one) of a valid message
+ */
+
+MessageReassembler::MessageReassembler(uint32_t maxBytes, Millisecond timeout, uint32_t minSegmentBytes)
+	: cs()
+	, maxBytes(maxBytes)
+	, timeout(timeout)
+	, minSegmentBytes(std::max(1u, minSegmentBytes))
+	, pending()
+	, bufferedBytes(0)
+	, completed(0)
+	, discarded(0)
+{
+	cs.setName("MessageReassembler");
+}
+
+
+/*------------------------------------------------------------------------------------------------*/
+
+/** Destructor
+ */
+
+MessageReassembler::~MessageReassembler() {
+}
+
+
+/*------------------------------------------------------------------------------------------------*/
+
+/** Set the limits for incomplete messages.
+ **
+ ** @param newMaxBytes   Maximum number of bytes to hold for incomplete messages
+ ** @param newTimeout    Time after the last received segment when an incomplete message is discarded
+ */
+
+void MessageReassembler::setLimits(uint32_t newMaxBytes, Millisecond newTimeout) {
+	CriticalSectionLock lock(cs);
+	maxBytes = newMaxBytes;
+	timeout  = newTimeout;
+}
+
+
+/*------------------------------------------------------------------------------------------------*/
+
+/** Add a received segment.
+ **
+ ** @param senderID   ID of the sending robot
+ ** @param segment    Received segment
+ ** @param now        Current time
+ ** @param message    Receives the reassembled message if the segment completed it
+ **
+ ** @return true iff the segment completed a message
+ */
+
+bool MessageReassembler::addSegment(
+		int32_t                                       senderID,
+		const de::fumanoids::message::MessageSegment &segment,
+		robottime_t                                   now,
+		std::string                                  &message)
+{
+	CriticalSectionLock lock(cs);
+
+	expire(now);
+
+	const uint32_t count  = segment.totalpackagecount();
+	const uint32_t number = segment.packagenumber();
+	const uint32_t bytes  = segment.payload().size();
+
+	// a message with more segments than fit into the memory can never be completed
+	if (count == 0 || number >= count || count > maxBytes / minSegmentBytes + 1) {
+		WARNING("Received invalid segment %d of %d from %d", number, count, senderID);
+		return false;
+	}
+
+	// a message consisting of only one segment does not need to be buffered
+	if (count == 1) {
+		message = segment.payload();
+		completed++;
+		return true;
+	}
+
+	Key key = { senderID, segment.id() };
+	PendingMessages::iterator it = pending.find(key);
+	if (it == pending.end()) {
+		// the bookkeeping of the segments is allocated up front, so it has to fit as well
+		const uint64_t metadataBytes = getMetadataBytes(count);
+		if (false == makeRoom(metadataBytes, pending.end())) {
+			WARNING("Segmented message %llu from %d exceeds the reassembly memory", (unsigned long long)key.segmentID, senderID);
+			discarded++;
+			return false;
+		}
+
+		PendingMessage newMessage;
+		newMessage.segments.resize(count);
+		newMessage.received.resize(count, false);
+		newMessage.receivedCount = 0;
+		newMessage.bytes         = 0;
+		newMessage.metadataBytes = metadataBytes;
+		newMessage.firstSegment  = now;
+		newMessage.lastSegment   = now;
+		it = pending.insert(std::make_pair(key, std::move(newMessage))).first;
+		bufferedBytes += metadataBytes;
+	} else if (it->second.segments.size() != count) {
+		WARNING("Segment count of message %llu from %d changed, discarding it", (unsigned long long)key.segmentID, senderID);
+		discard(it);
+		return false;
+	}
+
+	PendingMessage &pendingMessage = it->second;
+
+	// duplicates (e.g. from a second network interface) are ignored
+	if (pendingMessage.received[number])
+		return false;
+
+	if (false == makeRoom(bytes, it)) {
+		WARNING("Segmented message %llu from %d exceeds the reassembly memory", (unsigned long long)key.segmentID, senderID);
+		discard(it);
+		return false;
+	}
+
+	pendingMessage.segments[number]  = segment.payload();
+	pendingMessage.received[number]  = true;
+	pendingMessage.receivedCount    += 1;
+	pendingMessage.bytes            += bytes;
+	pendingMessage.lastSegment       = now;
+	bufferedBytes                   += bytes;
+
+	if (pendingMessage.receivedCount < count)
+		return false;
+
+	// all segments are there, put them together
+	message.clear();
+	message.reserve(pendingMessage.bytes);
+	for (const auto &data : pendingMessage.segments)
+		message.append(data);
+
+	bufferedBytes -= pendingMessage.bytes + pendingMessage.metadataBytes;
+	pending.erase(it);
+	completed++;
+	return true;
+}
+
+
+/*------------------------------------------------------------------------------------------------*/
+
+/** Discard incomplete messages that did not receive a segment within the timeout.
+ **
+ ** @param now   Current time
+ */
+
+void MessageReassembler::expire(robottime_t now) {
+	CriticalSectionLock lock(cs);
+
+	for (PendingMessages::iterator it = pending.begin(); it != pending.end(); ) {
+		PendingMessages::iterator current = it++;
+		if (now - current->second.lastSegment > timeout) {
+			discard(current);
+		}
+	}
+}
+
+
+/*------------------------------------------------------------------------------------------------*/
+
+/** Discard an incomplete message.
+ **
+ ** @param it   Message to discard
+ */
+
+void MessageReassembler::discard(PendingMessages::iterator it) {
+	bufferedBytes -= it->second.bytes + it->second.metadataBytes;
+	pending.erase(it);
+	discarded++;
+}
+
+
+/*------------------------------------------------------------------------------------------------*/
+
+/** Discard the oldest incomplete messages until the given number of bytes fits
+ ** into the memory limit.
+ **
+ ** @param bytes   Number of bytes to add
+ ** @param keep    Message the bytes are added to (is never discarded)
+ **
+ ** @return false if the bytes do not fit even after discarding all other messages
+ */
+
+bool MessageReassembler::makeRoom(uint64_t bytes, const PendingMessages::iterator &keep) {
+	while (bufferedBytes + bytes > maxBytes) {
+		PendingMessages::iterator oldest = pending.end();
+		for (PendingMessages::iterator it = pending.begin(); it != pending.end(); ++it) {
+			if (it != keep && (oldest == pending.end() || it->second.firstSegment < oldest->second.firstSegment))
+				oldest = it;
+		}
+
+		if (oldest == pending.end())
+			return false;
+
+		discard(oldest);
+	}
+
+	return true;
+}
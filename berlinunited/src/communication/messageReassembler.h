@@ -0,0 +1,119 @@
+#ifndef MESSAGEREASSEMBLER_H_
+#define MESSAGEREASSEMBLER_H_
+
+#include "platform/system/thread.h"
+#include "platform/system/timer.h"
+
+#include <map>
+#include <string>
+#include <vector>
+#include <inttypes.h>
+
+// forward declarations
+namespace de {
+	namespace fumanoids {
+		namespace message {
+			class MessageSegment;
+		}
+	}
+}
+
+
+/*------------------------------------------------------------------------------------------------*/
+
+/**
+ ** The MessageReassembler puts messages back together that were split into
+ ** MessageSegments (see Comm::sendMessageSegmented).
+ **
+ ** Segments are collected per sender and segment id and may arrive in any
+ ** order. Incomplete messages are discarded once no segment was received for
+ ** them for a while, and the memory used for incomplete messages is limited:
+ ** if a new segment would exceed the limit, the oldest incomplete messages
+ ** are discarded. The bookkeeping per segment of an incomplete message is
+ ** charged to the limit as well, and messages claiming more segments than
+ ** could be held with the minimum segment size are rejected right away.
+ */
+
+class MessageReassembler {
+public:
+	MessageReassembler(uint32_t maxBytes = 8*1024*1024, Millisecond timeout = 1000*milliseconds, uint32_t minSegmentBytes = 1024);
+	virtual ~MessageReassembler();
+
+	void setLimits(uint32_t maxBytes, Millisecond timeout);
+
+	/// number of bytes charged for the bookkeeping of a message with the given number of segments
+	static uint64_t getMetadataBytes(uint32_t count) {
+		return uint64_t(count) * (sizeof(std::string) + sizeof(bool));
+	}
+
+	bool addSegment(
+			int32_t                                       senderID,
+			const de::fumanoids::message::MessageSegment &segment,
+			robottime_t                                   now,
+			std::string                                  &message);
+
+	void expire(robottime_t now);
+
+	/// number of incomplete messages
+	size_t getPendingCount() const {
+		CriticalSectionLock lock(cs);
+		return pending.size();
+	}
+
+	/// number of bytes held for incomplete messages
+	uint32_t getBufferedBytes() const {
+		CriticalSectionLock lock(cs);
+		return bufferedBytes;
+	}
+
+	/// number of messages that were completed
+	uint32_t getCompletedCount() const {
+		CriticalSectionLock lock(cs);
+		return completed;
+	}
+
+	/// number of incomplete messages that were discarded (timeout or memory limit)
+	uint32_t getDiscardedCount() const {
+		CriticalSectionLock lock(cs);
+		return discarded;
+	}
+
+protected:
+	struct Key {
+		int32_t  senderID;
+		uint64_t segmentID;
+
+		bool operator<(const Key &other) const {
+			return senderID < other.senderID || (senderID == other.senderID && segmentID < other.segmentID);
+		}
+	};
+
+	struct PendingMessage {
+		std::vector<std::string> segments;
+		std::vector<bool>        received;
+		uint32_t                 receivedCount;
+		uint32_t                 bytes;
+		uint32_t                 metadataBytes;
+		robottime_t              firstSegment;
+		robottime_t              lastSegment;
+	};
+
+	typedef std::map<Key, PendingMessage> PendingMessages;
+
+	CriticalSection cs;
+
+	uint32_t    maxBytes;
+	Millisecond timeout;
+	uint32_t    minSegmentBytes;
+
+	PendingMessages pending;
+	uint32_t        bufferedBytes;
+
+	uint32_t completed;
+	uint32_t discarded;
+
+	void discard(PendingMessages::iterator it);
+	bool makeRoom(uint64_t bytes, const PendingMessages::iterator &keep);
+};
+
+#endif /* MESSAGEREASSEMBLER_H_ */
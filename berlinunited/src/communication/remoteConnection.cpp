@@ -1,5 +1,7 @@
 #include "remoteConnection.h"
 
+#include <string>
+
 
 /*------------------------------------------------------------------------------------------------*/
 
@@ -19,3 +21,23 @@ RemoteConnection::RemoteConnection() {
 
 RemoteConnection::~RemoteConnection() {
 }
+
+
+/*------------------------------------------------------------------------------------------------*/
+
+/** Send data gathered from several buffers as one package. The default
+ ** implementation copies the buffers together.
+ **
+ ** @param iov      Buffers to send
+ ** @param iovcnt   Number of buffers
+ **
+ ** @return true iff all data was sent
+**/
+
+bool RemoteConnection::sendv(const struct iovec *iov, int iovcnt) {
+	std::string data;
+	for (int i = 0; i < iovcnt; i++)
+		data.append((const char*)iov[i].iov_base, iov[i].iov_len);
+
+	return send(data.data(), data.size());
+}
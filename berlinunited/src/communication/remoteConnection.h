@@ -5,6 +5,8 @@
 #include <inttypes.h>
 #include <memory>
 
+#include <sys/uio.h>
+
 
 /*------------------------------------------------------------------------------------------------*/
 
@@ -22,6 +24,19 @@ public:
 	virtual int32_t read(uint8_t    *data, uint32_t dataLength) = 0;
 	virtual bool    send(void const *data, uint32_t dataLength) = 0;
 
+	/// send data gathered from several buffers as one package
+	virtual bool    sendv(const struct iovec *iov, int iovcnt);
+
+	/// read without copying (only valid while the connection exists), nullptr if not supported
+	virtual const uint8_t* readInPlace(uint32_t dataLength) {
+		return nullptr;
+	}
+
+	/// a connection to the same remote party, nullptr if not supported
+	virtual std::unique_ptr<RemoteConnection> duplicate() {
+		return nullptr;
+	}
+
 	virtual uint32_t getMaxPackageSize()                        = 0;
 };
 
@@ -41,6 +41,21 @@ bool RemoteTCPConnection::send(void const* data, uint32_t dataLength) {
 }
 
 
+/*------------------------------------------------------------------------------------------------*/
+
+/**
+ **
+**/
+
+bool RemoteTCPConnection::sendv(const struct iovec *iov, int iovcnt) {
+	uint32_t dataLength = 0;
+	for (int i = 0; i < iovcnt; i++)
+		dataLength += iov[i].iov_len;
+
+	return (signed)dataLength == transport->write(iov, iovcnt);
+}
+
+
 /*------------------------------------------------------------------------------------------------*/
 
 /**
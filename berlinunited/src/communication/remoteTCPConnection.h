@@ -31,6 +31,7 @@ public:
 
 	virtual int32_t read(uint8_t    *data, uint32_t dataLength);
 	virtual bool    send(void const *data, uint32_t dataLength);
+	virtual bool    sendv(const struct iovec *iov, int iovcnt);
 
 	virtual uint32_t getMaxPackageSize() {
 		return UINT_MAX;
@@ -7,13 +7,27 @@
 
 #include "platform/system/transport/transport_udp.h"
 
+#include <errno.h>
 #include <stdio.h>
 
 
+namespace {
+	/// whether a send failed only because the socket buffer is full
+	bool isSocketBusy(int error) {
+#if EAGAIN != EWOULDBLOCK
+		if (error == EWOULDBLOCK)
+			return true;
+#endif
+		return error == EAGAIN;
+	}
+}
+
+
 /*------------------------------------------------------------------------------------------------*/
 
-/**
+/** Create a connection to send data through (e.g. for broadcasting).
  **
+ ** @param transport   UDP transport to use
 **/
 
 RemoteUDPConnection::RemoteUDPConnection(TransportUDP *transport)
@@ -21,15 +35,37 @@ RemoteUDPConnection::RemoteUDPConnection(TransportUDP *transport)
 	, broadcasting(false)
 	, remoteAddress()
 	, transport(transport)
-	, buffer(NULL)
+	, buffer()
 	, bufferIndex(0)
 	, bufferSize(0)
 {
-	if (transport->waitForData(1, 100*microseconds)) {
-		buffer = new uint8_t[BUFSIZE];
-		bufferSize = transport->read(buffer, BUFSIZE, &remoteAddress); // TODO: may block
-	}
+	cs.setName("RemoteUDPConnection::cs");
+}
 
+
+/*------------------------------------------------------------------------------------------------*/
+
+/** Create a connection for a received datagram.
+ **
+ ** @param transport       UDP transport the datagram was received on
+ ** @param buffer          Buffer holding the datagram (not copied)
+ ** @param bufferSize      Size of the datagram
+ ** @param remoteAddress   Sender of the datagram (replies are sent there)
+**/
+
+RemoteUDPConnection::RemoteUDPConnection(
+		TransportUDP                   *transport,
+		const std::shared_ptr<uint8_t> &buffer,
+		uint32_t                        bufferSize,
+		const struct sockaddr_in       &remoteAddress)
+	: cs()
+	, broadcasting(false)
+	, remoteAddress(remoteAddress)
+	, transport(transport)
+	, buffer(buffer)
+	, bufferIndex(0)
+	, bufferSize(bufferSize)
+{
 	cs.setName("RemoteUDPConnection::cs");
 }
 
@@ -41,10 +77,6 @@ RemoteUDPConnection::RemoteUDPConnection(TransportUDP *transport)
 **/
 
 RemoteUDPConnection::~RemoteUDPConnection() {
-	if (buffer) {
-		delete[] buffer;
-		buffer = NULL;
-	}
 }
 
 
@@ -72,7 +104,7 @@ bool RemoteUDPConnection::send(void const* data, uint32_t dataLength) {
 	cs.enter();
 	int bytesWritten = transport->write(data, dataLength, broadcasting ? NULL : &remoteAddress);
 	if (bytesWritten < 0) {
-		if (errno == EAGAIN || errno == EWOULDBLOCK)
+		if (isSocketBusy(errno))
 			fprintf(stderr, "UDP socket busy (buffer full), could not send %d bytes\n", dataLength);
 		else
 			fprintf(stderr, "error sending message: %s\n", strerror(errno));
@@ -85,6 +117,42 @@ bool RemoteUDPConnection::send(void const* data, uint32_t dataLength) {
 }
 
 
+/*------------------------------------------------------------------------------------------------*/
+
+/** Send data gathered from several buffers as one datagram.
+ **
+ ** @param iov      Buffers to send
+ ** @param iovcnt   Number of buffers
+ **
+ ** @return true iff the datagram was sent
+**/
+
+bool RemoteUDPConnection::sendv(const struct iovec *iov, int iovcnt) {
+	uint32_t dataLength = 0;
+	for (int i = 0; i < iovcnt; i++)
+		dataLength += iov[i].iov_len;
+
+	if (dataLength > 65000) {
+		ERROR("Message is too large for UDP");
+		return false;
+	} else if (false == transport->isConnected()) {
+		fprintf(stderr, "Trying to send through disconnected UDP transport\n");
+		return false;
+	}
+
+	CriticalSectionLock lock(cs);
+	int bytesWritten = transport->write(iov, iovcnt, broadcasting ? NULL : &remoteAddress);
+	if (bytesWritten < 0) {
+		if (isSocketBusy(errno))
+			fprintf(stderr, "UDP socket busy (buffer full), could not send %d bytes\n", dataLength);
+		else
+			fprintf(stderr, "error sending message: %s\n", strerror(errno));
+	}
+
+	return (bytesWritten == (signed)dataLength);
+}
+
+
 /*------------------------------------------------------------------------------------------------*/
 
 /**
@@ -147,9 +215,43 @@ int32_t RemoteUDPConnection::read(uint8_t *data, uint32_t dataLength) {
 //	printf("bs %d bi %d dl %d rd %d\n", bufferSize, bufferIndex, dataLength, remainingData);
 	int32_t dataCount = std::min(dataLength, remainingData);
 	if (dataCount > 0) {
-		memcpy(data, buffer + bufferIndex, dataCount);
+		memcpy(data, buffer.get() + bufferIndex, dataCount);
 		bufferIndex += dataCount;
 	}
 
 	return dataCount;
 }
+
+
+/*------------------------------------------------------------------------------------------------*/
+
+/** Read data without copying it.
+ **
+ ** @param dataLength   Number of bytes to read
+ **
+ ** @return pointer to the data in the receive buffer, nullptr if not enough data is available
+**/
+
+const uint8_t* RemoteUDPConnection::readInPlace(uint32_t dataLength) {
+	if (buffer == 0 || bufferIndex + (int64_t)dataLength > bufferSize)
+		return nullptr;
+
+	const uint8_t *data = buffer.get() + bufferIndex;
+	bufferIndex += dataLength;
+	return data;
+}
+
+
+/*------------------------------------------------------------------------------------------------*/
+
+/** Create a connection to the same remote party, sharing the received datagram.
+ **
+ ** @return the new connection
+**/
+
+std::unique_ptr<RemoteConnection> RemoteUDPConnection::duplicate() {
+	std::unique_ptr<RemoteUDPConnection> copy(new RemoteUDPConnection(transport, buffer, bufferSize, remoteAddress));
+	copy->broadcasting = broadcasting;
+	copy->bufferIndex  = bufferIndex;
+	return copy;
+}
@@ -20,6 +20,11 @@ class TransportUDP;
 class RemoteUDPConnection : public RemoteConnection {
 public:
 	RemoteUDPConnection(TransportUDP *transport);
+	RemoteUDPConnection(
+			TransportUDP                   *transport,
+			const std::shared_ptr<uint8_t> &buffer,
+			uint32_t                        bufferSize,
+			const struct sockaddr_in       &remoteAddress);
 	virtual ~RemoteUDPConnection();
 
 	void setToBroadcast();
@@ -29,6 +34,11 @@ public:
 
 	virtual int32_t read(uint8_t    *data, uint32_t dataLength);
 	virtual bool    send(void const *data, uint32_t dataLength);
+	virtual bool    sendv(const struct iovec *iov, int iovcnt);
+
+	virtual const uint8_t* readInPlace(uint32_t dataLength);
+
+	virtual std::unique_ptr<RemoteConnection> duplicate();
 
 	virtual uint32_t getMaxPackageSize() {
 		return 65000;
@@ -42,11 +52,10 @@ private:
 
 	TransportUDP       *transport;
 
-	// data
-#define BUFSIZE 65536
-	uint8_t  *buffer;
-	int32_t   bufferIndex;
-	int32_t   bufferSize;
+	// data (the received datagram, the buffer belongs to the UDPHandler's pool)
+	std::shared_ptr<uint8_t> buffer;
+	int32_t                  bufferIndex;
+	int32_t                  bufferSize;
 
 	// we are using pointers, it does not make sense to copy this handler so prevent it
 	RemoteUDPConnection(const RemoteUDPConnection &) = delete;
@@ -13,6 +13,18 @@
 
 #include "debug.h"
 
+#include <string.h>
+
+
+/*------------------------------------------------------------------------------------------------*/
+
+namespace {
+	/// space for the SO_RXQ_OVFL control message of a datagram
+	const size_t controlSize = CMSG_SPACE(sizeof(uint32_t));
+}
+
+REGISTER_DEBUG("comm.udp.statistics", TABLE, BASIC);
+
 
 /*------------------------------------------------------------------------------------------------*/
 
@@ -24,7 +36,18 @@ UDPHandler::UDPHandler(CommHandlerManager *manager)
 	: CommHandler(manager)
 	, cs()
 	, transport(0)
+	, buffers(batchSize)
+	, messages(batchSize)
+	, iovecs(batchSize)
+	, addresses(batchSize)
+	, controls(batchSize * controlSize)
+	, statistics()
+	, lastStatistics()
+	, lastStatisticsTime(0)
+	, kernelDrops(0)
 {
+	for (uint32_t i = 0; i < batchSize; i++)
+		buffers[i].reset(new uint8_t[bufferSize], std::default_delete<uint8_t[]>());
 }
 
 
@@ -67,12 +90,123 @@ void UDPHandler::init(int localPort, int broadcastPort) {
 **/
 
 void UDPHandler::threadMain() {
+	lastStatisticsTime = getCurrentTime();
+
 	while (isRunning()) {
 		if (transport->waitForData(1, Microsecond(500*milliseconds))) {
-			RemoteUDPConnection* process = new RemoteUDPConnection(transport);
-			manager->process( RemoteConnectionPtr(process)  );
+			// drain the socket
+			while (receiveBatch() == (int)batchSize) {}
+		}
+
+		updateStatistics();
+	}
+}
+
+
+/*------------------------------------------------------------------------------------------------*/
+
+/** Receive the available datagrams (up to batchSize) and process them.
+ **
+ ** @return number of datagrams received
+**/
+
+int UDPHandler::receiveBatch() {
+	for (uint32_t i = 0; i < batchSize; i++) {
+		// a buffer that is still referenced by a connection can not be reused
+		if (buffers[i].use_count() > 1)
+			buffers[i].reset(new uint8_t[bufferSize], std::default_delete<uint8_t[]>());
+
+		iovecs[i].iov_base = buffers[i].get();
+		iovecs[i].iov_len  = bufferSize;
+
+		memset(&messages[i], 0, sizeof(messages[i]));
+		messages[i].msg_hdr.msg_name       = &addresses[i];
+		messages[i].msg_hdr.msg_namelen    = sizeof(addresses[i]);
+		messages[i].msg_hdr.msg_iov        = &iovecs[i];
+		messages[i].msg_hdr.msg_iovlen     = 1;
+		messages[i].msg_hdr.msg_control    = &controls[i * controlSize];
+		messages[i].msg_hdr.msg_controllen = controlSize;
+	}
+
+	int received = transport->read(messages.data(), batchSize);
+	if (received <= 0)
+		return 0;
+
+	for (int i = 0; i < received; i++) {
+		const struct msghdr &header = messages[i].msg_hdr;
+
+#ifdef SO_RXQ_OVFL
+		// the kernel reports the total number of dropped datagrams
+		for (struct cmsghdr *cmsg = CMSG_FIRSTHDR(&header); cmsg; cmsg = CMSG_NXTHDR(const_cast<struct msghdr*>(&header), cmsg)) {
+			if (cmsg->cmsg_level == SOL_SOCKET && cmsg->cmsg_type == SO_RXQ_OVFL) {
+				uint32_t drops;
+				memcpy(&drops, CMSG_DATA(cmsg), sizeof(drops));
+				{
+					CriticalSectionLock lock(cs);
+					statistics.drops += (uint32_t)(drops - kernelDrops);
+				}
+				kernelDrops = drops;
+			}
+		}
+#endif
+
+		{
+			CriticalSectionLock lock(cs);
+			if (header.msg_flags & MSG_TRUNC) {
+				statistics.drops++;
+				continue;
+			}
+
+			statistics.datagrams++;
+			statistics.bytes += messages[i].msg_len;
 		}
+
+		manager->process(RemoteConnectionPtr(new RemoteUDPConnection(transport, buffers[i], messages[i].msg_len, addresses[i])));
 	}
+
+	return received;
+}
+
+
+/*------------------------------------------------------------------------------------------------*/
+
+/** Update the receive rates (once per second).
+**/
+
+void UDPHandler::updateStatistics() {
+	robottime_t now = getCurrentTime();
+	Second elapsed = Second(now - lastStatisticsTime);
+	if (elapsed < 1*seconds)
+		return;
+
+	UDPReceiveStatistics current;
+	{
+		CriticalSectionLock lock(cs);
+		statistics.datagramsPerSecond = (statistics.datagrams - lastStatistics.datagrams) / elapsed.value();
+		statistics.bytesPerSecond     = (statistics.bytes     - lastStatistics.bytes)     / elapsed.value();
+		statistics.dropsPerSecond     = (statistics.drops     - lastStatistics.drops)     / elapsed.value();
+		current = statistics;
+	}
+
+	lastStatistics     = current;
+	lastStatisticsTime = now;
+
+	DEBUG_TABLE("comm.udp.statistics", "datagrams/s", current.datagramsPerSecond);
+	DEBUG_TABLE("comm.udp.statistics", "bytes/s",     current.bytesPerSecond);
+	DEBUG_TABLE("comm.udp.statistics", "drops/s",     current.dropsPerSecond);
+	DEBUG_TABLE("comm.udp.statistics", "drops",       (double)current.drops);
+}
+
+
+/*------------------------------------------------------------------------------------------------*/
+
+/**
+ ** @return statistics about the received datagrams
+**/
+
+UDPReceiveStatistics UDPHandler::getStatistics() {
+	CriticalSectionLock lock(cs);
+	return statistics;
 }
 
 
@@ -3,13 +3,37 @@
 
 #include "commHandler.h"
 
+#include "platform/system/timer.h"
+
+#include <memory>
+#include <vector>
+
+#include <netinet/in.h>
+#include <sys/socket.h>
+
 // forward declaration
 class RemoteConnection;
 class TransportUDP;
 
 
+/** Statistics about the datagrams received by a UDPHandler.
+ */
+struct UDPReceiveStatistics {
+	uint64_t datagrams;           ///< number of datagrams received
+	uint64_t bytes;               ///< number of bytes received
+	uint64_t drops;               ///< number of datagrams lost (receive buffer full or truncated)
+
+	double datagramsPerSecond;    ///< over the last second
+	double bytesPerSecond;        ///< over the last second
+	double dropsPerSecond;        ///< over the last second
+};
+
+
 /** The UDP Comm Handler is responsible for managing incoming UDP requests.
  **
+ ** Datagrams are received in batches (with a single system call) into a pool
+ ** of preallocated buffers. A buffer is reused for later datagrams as soon as
+ ** the connection created for its datagram does not exist anymore.
  */
 class UDPHandler : public CommHandler {
 public:
@@ -26,11 +50,34 @@ public:
 
 	RemoteConnection *getBroadcastConnection();
 
+	UDPReceiveStatistics getStatistics();
+
+	/// maximum number of datagrams received with one system call
+	static const uint32_t batchSize  = 16;
+
+	/// maximum size of a datagram
+	static const uint32_t bufferSize = 65536;
+
 protected:
 
 	CriticalSection     cs;
 	TransportUDP       *transport;
 
+	// receive buffers and the structures describing them to the kernel
+	std::vector<std::shared_ptr<uint8_t>> buffers;
+	std::vector<struct mmsghdr>           messages;
+	std::vector<struct iovec>             iovecs;
+	std::vector<struct sockaddr_in>       addresses;
+	std::vector<uint8_t>                  controls;
+
+	UDPReceiveStatistics statistics;
+	UDPReceiveStatistics lastStatistics;
+	robottime_t          lastStatisticsTime;
+	uint32_t             kernelDrops;
+
+	int  receiveBatch();
+	void updateStatistics();
+
 	// we are using pointers, it does not make sense to copy this handler so prevent it
 	UDPHandler(const UDPHandler &) = delete;
 	UDPHandler& operator=(const UDPHandler &) = delete;
@@ -109,8 +109,8 @@ DEBUG_PLOTTER("localization.plotter", "last beliefs", currentTime, getLocalizati
 
 Stopwatches are grouped by the debug option. Per registered debug option, you can store as
 many different stopwatches as required, giving them a unique name. Measurements are collected
-and min/max/mean are calculated automatically. Do note that no data is sent out unless you
-explicitely call STOPWATCH_SEND, in order to minimize the amount of traffic.
+and min/max/mean as well as percentiles are calculated automatically. Do note that no data is
+sent out unless you explicitely call STOPWATCH_SEND, in order to minimize the amount of traffic.
 
 \code
 // include header
@@ -133,6 +133,21 @@ STOPWATCH_SEND("modules.cognition.runtimes");
 Optimization is included to keep the overhead in start/stop minimal, provided that the option
 and stopwatch name are static (i.e. do not change).
 
+While stopwatches summarize runtimes, the Tracer (debugging/tracer.h) records a timeline of
+what every thread did when. Module execution, event callbacks and log file I/O are recorded
+automatically once debugging.trace.enabled is set, the trace is written on termination to
+debugging.trace.file and can be opened with chrome://tracing or ui.perfetto.dev. Further
+scopes are added with TRACE_SCOPE:
+
+\code
+#include "debugging/tracer.h"
+
+void MyModule::execute() {
+	TRACE_SCOPE("mymodule", "findBall");
+	...
+}
+\endcode
+
 \subsection Example_DRAWING
 
 Drawings are made on the robot, send via network to FUremote and displayed there.
@@ -245,48 +260,48 @@ DRAWDEBUG("my.draw.option", {
 #define DEBUG_TEXT(option, format, ...) \
 		{ \
 			static DebuggingOption *_debug_option = ::Debugging::getInstance().getDebugOption(option); \
-			if (_debug_option && _debug_option->enabled) { ::Debugging::getInstance().sendDebugText(_debug_option, format, ##__VA_ARGS__); } \
+			if (_debug_option && _debug_option->isEnabled()) { ::Debugging::getInstance().sendDebugText(_debug_option, format, ##__VA_ARGS__); } \
 		}
 
 #define DEBUG_PLOTTER(option, series, x, y) \
 		{ \
 			static DebuggingOption *_debug_option = ::Debugging::getInstance().getDebugOption(option); \
-			if (_debug_option && _debug_option->enabled) { ::Debugging::getInstance().sendDebugPlot(_debug_option, series, x, y); } \
+			if (_debug_option && _debug_option->isEnabled()) { ::Debugging::getInstance().sendDebugPlot(_debug_option, series, x, y); } \
 		}
 
 #define DEBUG_TABLE(option, key, payload) \
 		{ \
 			static DebuggingOption *_debug_option = ::Debugging::getInstance().getDebugOption(option); \
-			if (_debug_option && _debug_option->enabled) { ::Debugging::getInstance().sendDebugTable(_debug_option, key, payload); } \
+			if (_debug_option && _debug_option->isEnabled()) { ::Debugging::getInstance().sendDebugTable(_debug_option, key, payload); } \
 		}
 
 #define STOPWATCH(option, name, code) \
 	{ \
 		static DebuggingOption *_debug_option = ::Debugging::getInstance().getDebugOption(option); \
-		static StopwatchItem& _debug_stopwatch_item_ = Stopwatch::getInstance().getStopwatchReference(option, name); \
-		if (_debug_option && _debug_option->enabled) Stopwatch::getInstance().notifyStart(_debug_stopwatch_item_, option, name); \
+		static StopwatchHandle _debug_stopwatch_ = Stopwatch::getInstance().registerStopwatch(option, name); \
+		if (_debug_option && _debug_option->isEnabled()) Stopwatch::getInstance().start(_debug_stopwatch_); \
 		{ code } \
-		if (_debug_option && _debug_option->enabled) Stopwatch::getInstance().notifyStop(_debug_stopwatch_item_, option, name); \
+		if (_debug_option && _debug_option->isEnabled()) Stopwatch::getInstance().stop(_debug_stopwatch_); \
 	}
 
 #define STOPWATCH_START(option, name) \
 	{ \
 		static DebuggingOption *_debug_option = ::Debugging::getInstance().getDebugOption(option); \
-		static StopwatchItem& _debug_stopwatch_item_ = Stopwatch::getInstance().getStopwatchReference(option, name); \
-		if (_debug_option && _debug_option->enabled) Stopwatch::getInstance().notifyStart(_debug_stopwatch_item_, option, name); \
+		static StopwatchHandle _debug_stopwatch_ = Stopwatch::getInstance().registerStopwatch(option, name); \
+		if (_debug_option && _debug_option->isEnabled()) Stopwatch::getInstance().start(_debug_stopwatch_); \
 	}
 
 #define STOPWATCH_STOP(option, name) \
 	{ \
 		static DebuggingOption *_debug_option = ::Debugging::getInstance().getDebugOption(option); \
-		static StopwatchItem& _debug_stopwatch_item_ = Stopwatch::getInstance().getStopwatchReference(option, name); \
-		if (_debug_option->enabled) Stopwatch::getInstance().notifyStop(_debug_stopwatch_item_, option, name); \
+		static StopwatchHandle _debug_stopwatch_ = Stopwatch::getInstance().registerStopwatch(option, name); \
+		if (_debug_option->isEnabled()) Stopwatch::getInstance().stop(_debug_stopwatch_); \
 	}
 
 #define STOPWATCH_SEND(option) \
 	{ \
 		static DebuggingOption *_debug_option = ::Debugging::getInstance().getDebugOption(option); \
-		if (_debug_option->enabled) Stopwatch::getInstance().send(option); \
+		if (_debug_option->isEnabled()) Stopwatch::getInstance().send(option); \
 	}
 
 #endif /* NO_DEBUG */
@@ -11,7 +11,7 @@
 		static DebuggingOption *_debug_option = ::Debugging::getInstance().getDebugOption(option); \
 		if (_debug_option == nullptr) { \
 			ERROR("3D debug option %s doesn't exist", std::string(option).c_str()); \
-		} else if (_debug_option->enabled) { \
+		} else if (_debug_option->isEnabled()) { \
 			DebugStream3D debug3d; \
 			code \
 			debug3d.send(_debug_option); \
@@ -0,0 +1,281 @@
+#include "debugSender.h"
+
+#include "services.h"
+#include "communication/comm.h"
+#include "management/config/config.h"
+
+
+/*------------------------------------------------------------------------------------------------*/
+
+namespace {
+	auto cfgSendInterval     = ConfigRegistry::registerOption<Millisecond>("debugging.sendinterval", 10*milliseconds, "How often (every X ms) to send out the queued debug output");
+	auto cfgBandwidth        = ConfigRegistry::registerOption<int>("debugging.bandwidth.total",  512*1024, "Maximum bandwidth (in bytes/s) of all debug output (0 for no limit)");
+	auto cfgOptionBandwidth  = ConfigRegistry::registerOption<int>("debugging.bandwidth.option", 0,        "Maximum bandwidth (in bytes/s) of the output of a single debug option (0 for no limit)");
+	auto cfgMaxPending       = ConfigRegistry::registerOption<int>("debugging.queue",            4096,     "Maximum number of debug messages waiting to be sent");
+
+	/// a bucket may hold the tokens for 100ms of data
+	TokenBucket createBucket(uint32_t bandwidth) {
+		return TokenBucket(bandwidth, bandwidth / 10.);
+	}
+}
+
+
+/*------------------------------------------------------------------------------------------------*/
+
+/**
+ ** Constructor
+ */
+
+DebugSender::DebugSender()
+	: incoming()
+	, pendingCount(0)
+	, tables()
+	, bucket()
+	, optionBuckets()
+	, optionBandwidth(0)
+	, maxPending(4096)
+	, dropped(0)
+	, aggregated(0)
+{
+}
+
+
+/*------------------------------------------------------------------------------------------------*/
+
+/**
+ ** Destructor
+ */
+
+DebugSender::~DebugSender() {
+	if (isRunning()) {
+		cancel(true);
+	}
+
+	collect();
+	for (int priority = 0; priority < PRIORITY_COUNT; priority++) {
+		while (false == pending[priority].empty()) {
+			release(pending[priority].front());
+			pending[priority].pop_front();
+		}
+	}
+}
+
+
+/*------------------------------------------------------------------------------------------------*/
+
+/**
+ ** Apply the configuration and start the sender thread.
+ **
+ ** @return true iff initialization succeeded
+ */
+
+bool DebugSender::init() {
+	setLimits(std::max(0, cfgBandwidth->get()), std::max(0, cfgOptionBandwidth->get()), std::max(1, cfgMaxPending->get()));
+	run();
+
+	return true;
+}
+
+
+/*------------------------------------------------------------------------------------------------*/
+
+/**
+ ** Set the bandwidth limits. Must not be called while the thread is running.
+ **
+ ** @param newBandwidth         Maximum number of bytes per second of all debug output (0 for no limit)
+ ** @param newOptionBandwidth   Maximum number of bytes per second of a single option (0 for no limit)
+ ** @param newMaxPending        Maximum number of messages waiting to be sent
+ */
+
+void DebugSender::setLimits(uint32_t newBandwidth, uint32_t newOptionBandwidth, uint32_t newMaxPending) {
+	bucket          = createBucket(newBandwidth);
+	optionBandwidth = newOptionBandwidth;
+	maxPending      = newMaxPending;
+	optionBuckets.clear();
+}
+
+
+/*------------------------------------------------------------------------------------------------*/
+
+/**
+ ** Queue a message to be sent by the sender thread. Does not block, may be
+ ** called from any thread.
+ **
+ ** @param option    Debug option the message belongs to
+ ** @param key       Key of a table entry (only the latest value of a key is sent), empty otherwise
+ ** @param message   Message to send, its content is taken over
+ */
+
+void DebugSender::queue(const DebuggingOption *option, const std::string &key, de::fumanoids::message::Message &message) {
+	assert(option != nullptr);
+
+	Entry *entry  = new Entry();
+	entry->option = option;
+	entry->key    = key;
+	entry->message.Swap(&message);
+
+	incoming.push(entry);
+}
+
+
+/*------------------------------------------------------------------------------------------------*/
+
+/**
+ ** Thread main function, regularly sends out the queued messages.
+ */
+
+void DebugSender::threadMain() {
+	Millisecond interval = cfgSendInterval->get();
+
+	while (isRunning()) {
+		process(getCurrentTime());
+		delay(interval);
+	}
+
+	// send what was queued while the thread was stopped
+	process(getCurrentTime());
+}
+
+
+/*------------------------------------------------------------------------------------------------*/
+
+/**
+ ** Send out as many waiting messages as the bandwidth limits allow, the ones
+ ** with the highest priority first. Must only be called from one thread.
+ **
+ ** @param now   Current time
+ */
+
+void DebugSender::process(robottime_t now) {
+	collect();
+
+	for (int priority = PRIORITY_COUNT - 1; priority >= 0; priority--) {
+		std::deque<Entry*> &entries = pending[priority];
+
+		// entries of options that exceed their own limit wait for the next round
+		std::deque<Entry*> waiting;
+
+		bool exhausted = false;
+		while (false == entries.empty()) {
+			Entry   *entry = entries.front();
+			uint32_t bytes = entry->message.ByteSize();
+
+			if (false == bucket.has(bytes, now)) {
+				exhausted = true;
+				break;
+			}
+
+			std::map<const DebuggingOption*, TokenBucket>::iterator optionBucket = optionBuckets.find(entry->option);
+			if (optionBucket == optionBuckets.end())
+				optionBucket = optionBuckets.insert(std::make_pair(entry->option, createBucket(optionBandwidth))).first;
+
+			entries.pop_front();
+			if (false == optionBucket->second.has(bytes, now)) {
+				waiting.push_back(entry);
+				continue;
+			}
+
+			bucket.take(bytes);
+			optionBucket->second.take(bytes);
+
+			transmit(entry->message);
+			release(entry);
+		}
+
+		entries.insert(entries.begin(), waiting.begin(), waiting.end());
+
+		if (exhausted)
+			break;
+	}
+}
+
+
+/*------------------------------------------------------------------------------------------------*/
+
+/**
+ ** Send a message.
+ **
+ ** @param message   Message to send
+ */
+
+void DebugSender::transmit(de::fumanoids::message::Message &message) {
+	services.getComm().broadcastMessage(message);
+}
+
+
+/*------------------------------------------------------------------------------------------------*/
+
+/**
+ ** Take over all messages that were queued by other threads.
+ */
+
+void DebugSender::collect() {
+	while (Entry *entry = incoming.pop())
+		add(entry);
+}
+
+
+/*------------------------------------------------------------------------------------------------*/
+
+/**
+ ** Add a message to the ones waiting to be sent.
+ **
+ ** @param entry   Queued message
+ */
+
+void DebugSender::add(Entry *entry) {
+	// a table entry that is still waiting gets the new value
+	if (false == entry->key.empty()) {
+		TableKey key(entry->option, entry->key);
+		std::map<TableKey, Entry*>::iterator it = tables.find(key);
+		if (it != tables.end()) {
+			it->second->message.Swap(&entry->message);
+			delete entry;
+			aggregated++;
+			return;
+		}
+
+		tables[key] = entry;
+	}
+
+	pending[entry->option->priority].push_back(entry);
+	pendingCount++;
+
+	while (pendingCount > maxPending)
+		dropOldest();
+}
+
+
+/*------------------------------------------------------------------------------------------------*/
+
+/**
+ ** Drop the oldest message of the lowest priority.
+ */
+
+void DebugSender::dropOldest() {
+	for (int priority = 0; priority < PRIORITY_COUNT; priority++) {
+		if (false == pending[priority].empty()) {
+			release(pending[priority].front());
+			pending[priority].pop_front();
+			dropped++;
+			return;
+		}
+	}
+}
+
+
+/*------------------------------------------------------------------------------------------------*/
+
+/**
+ ** Free a message that was sent or dropped.
+ **
+ ** @param entry   Message that is no longer waiting
+ */
+
+void DebugSender::release(Entry *entry) {
+	if (false == entry->key.empty())
+		tables.erase(TableKey(entry->option, entry->key));
+
+	pendingCount--;
+	delete entry;
+}
@@ -0,0 +1,161 @@
+#ifndef DEBUGSENDER_H_
+#define DEBUGSENDER_H_
+
+#include "debugging.h"
+
+#include "platform/system/thread.h"
+#include "platform/system/timer.h"
+#include "utils/mpscQueue.h"
+#include "utils/patterns/singleton.h"
+
+#include "msg_message.pb.h"
+
+#include <atomic>
+#include <deque>
+#include <map>
+#include <string>
+
+
+/** @addtogroup debug
+ * @{
+ */
+
+
+/*------------------------------------------------------------------------------------------------*/
+
+/**
+ ** Token bucket to limit a bandwidth. The bucket is refilled with 'rate'
+ ** bytes per second up to 'burst' bytes. A message may be sent if the bucket
+ ** holds enough tokens for it, or if it is full (for messages larger than the
+ ** burst size).
+ */
+
+class TokenBucket {
+public:
+	TokenBucket(double rate = 0, double burst = 0)
+		: rate(rate)
+		, burst(burst)
+		, tokens(burst)
+		, lastRefill(0)
+	{}
+
+	/// whether the bandwidth is limited at all
+	bool isLimited() const {
+		return rate > 0;
+	}
+
+	/// check whether 'bytes' may be sent now
+	bool has(uint32_t bytes, robottime_t now) {
+		if (false == isLimited())
+			return true;
+
+		tokens = std::min(burst, tokens + rate * Second(now - lastRefill).value());
+		lastRefill = now;
+		return tokens >= bytes || tokens >= burst;
+	}
+
+	/// take the tokens for 'bytes' that were sent
+	void take(uint32_t bytes) {
+		if (isLimited())
+			tokens -= bytes;
+	}
+
+private:
+	double      rate;
+	double      burst;
+	double      tokens;
+	robottime_t lastRefill;
+};
+
+
+/*------------------------------------------------------------------------------------------------*/
+
+/**
+ ** The DebugSender transmits the debug output of all threads. Module threads
+ ** only add their messages to a lock-free queue, the network is accessed by the
+ ** sender thread alone.
+ **
+ ** The sender thread sends the queued messages every few milliseconds, the
+ ** ones of options with a higher priority first. The total bandwidth and the
+ ** bandwidth of each option are limited by token buckets, messages that
+ ** exceed the limit wait for the next round (and the oldest messages of the
+ ** lowest priority are dropped if too many are waiting). A table entry that is
+ ** updated before it was sent only sends its latest value.
+ */
+
+class DebugSender : public Thread, public Singleton<DebugSender> {
+public:
+	virtual ~DebugSender();
+
+	virtual const char* getName() const override {
+		return "DebugSender";
+	}
+
+	bool init();
+
+	void setLimits(uint32_t bandwidth, uint32_t optionBandwidth, uint32_t maxPending);
+
+	void queue(const DebuggingOption *option, const std::string &key, de::fumanoids::message::Message &message);
+
+	void process(robottime_t now);
+
+	/// number of messages that were dropped because too many were waiting
+	uint32_t getDroppedCount() const {
+		return dropped;
+	}
+
+	/// number of table updates that replaced a waiting one
+	uint32_t getAggregatedCount() const {
+		return aggregated;
+	}
+
+	/// number of messages waiting to be sent
+	size_t getPendingCount() const {
+		return pendingCount;
+	}
+
+protected:
+	DebugSender();
+	friend class Singleton<DebugSender>;
+
+	struct Entry : public MPSCQueueNode {
+		const DebuggingOption          *option;
+		std::string                     key;
+		de::fumanoids::message::Message message;
+	};
+
+	typedef std::pair<const DebuggingOption*, std::string> TableKey;
+
+	virtual void threadMain() override;
+	virtual void transmit(de::fumanoids::message::Message &message);
+
+	void collect();
+	void add(Entry *entry);
+	void dropOldest();
+	void release(Entry *entry);
+
+	MPSCQueue<Entry> incoming;
+
+	/// messages waiting to be sent, by priority
+	std::deque<Entry*>  pending[PRIORITY_COUNT];
+	std::atomic<size_t> pendingCount;
+
+	/// table entries waiting to be sent
+	std::map<TableKey, Entry*> tables;
+
+	/// bandwidth limits (in total and per option)
+	TokenBucket                                   bucket;
+	std::map<const DebuggingOption*, TokenBucket> optionBuckets;
+	uint32_t                                      optionBandwidth;
+	uint32_t                                      maxPending;
+
+	std::atomic<uint32_t> dropped;
+	std::atomic<uint32_t> aggregated;
+};
+
+
+/**
+ * @}
+ */
+
+#endif /* DEBUGSENDER_H_ */
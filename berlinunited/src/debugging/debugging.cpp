@@ -4,6 +4,7 @@
  */
 
 #include "debugging.h"
+#include "debugSender.h"
 #include "imageDebugger.h"
 #include "services.h"
 
@@ -107,9 +108,9 @@ bool Debugging::registerDebugOption(
 	new_option->description = description ? description : new_option->srcLocation;
 
 	if ((flags & ENABLED) == ENABLED)
-		new_option->enabled = true;
+		new_option->setEnabled(true);
 	else
-		new_option->enabled = false;
+		new_option->setEnabled(false);
 
 	if ((flags & CMDLOUT) == CMDLOUT)
 		new_option->cmdlineout = true;
@@ -126,6 +127,13 @@ bool Debugging::registerDebugOption(
 	} else
 		new_option->netout = true;
 
+	if ((flags & PRIOHIGH) == PRIOHIGH)
+		new_option->priority = PRIORITY_HIGH;
+	else if ((flags & PRIOLOW) == PRIOLOW)
+		new_option->priority = PRIORITY_LOW;
+	else
+		new_option->priority = PRIORITY_NORMAL;
+
 	typedef Debugging::DebugOptionContainer::value_type pair;
 	if (debugging_options.insert( pair(new_option->name, new_option) ).second == false ) {
 		printf("ERROR: debug option %s already exists.\n", new_option->name.c_str());
@@ -186,7 +194,7 @@ bool Debugging::messageCallback(
 
 			option.set_name((*it).second->name);
 			option.set_type((de::fumanoids::message::DebuggingCommands_DebuggingOptionType)(*it).second->type);
-			option.set_enabled((*it).second->enabled);
+			option.set_enabled((*it).second->isEnabled());
 			option.set_description((*it).second->description);
 			option.set_srclocation((*it).second->srcLocation);
 		}
@@ -227,7 +235,7 @@ void Debugging::switchOption(const std::string &option, bool enable) {
 		if (   (*it).second->name.find(option + ".") == 0
 			|| (*it).second->name == option)
 		{
-			(*it).second->enabled = enable;
+			(*it).second->setEnabled(enable);
 		}
 	}
 }
@@ -265,7 +273,7 @@ void Debugging::processMessageOut(
 	txt.set_option(option->name);
 	txt.set_payload(payload);
 
-	sendMessage(msg);
+	sendMessage(option, "", msg);
 }
 
 
@@ -290,7 +298,7 @@ void Debugging::processMessageOut(const DebuggingOption *option, const char *pay
 	txt.set_option(option->name);
 	txt.set_payload(payload);
 
-	sendMessage(msg);
+	sendMessage(option, "", msg);
 }
 
 
@@ -324,7 +332,7 @@ void Debugging::processMessageOut(
 	plotter.set_x(x);
 	plotter.set_y(y);
 
-	sendMessage(msg);
+	sendMessage(option, "", msg);
 }
 
 /**
@@ -351,7 +359,7 @@ void Debugging::processMessageOut(
 	plotter3d.set_option(option->name);
 	*plotter3d.mutable_data() = commands;
 
-	sendMessage(msg);
+	sendMessage(option, "", msg);
 }
 
 
@@ -383,7 +391,7 @@ void Debugging::processMessageOut(
 	table.set_key(key);
 	table.set_payload(payload);
 
-	sendMessage(msg);
+	sendMessage(option, key, msg);
 }
 
 
@@ -413,14 +421,20 @@ void Debugging::processMessageOut(
 
 /*------------------------------------------------------------------------------------------------*/
 
-/**
+/** Send out a debug message. Once the DebugSender is running, the message is
+ ** only queued and sent by the sender thread.
  **
- ** @param msg
- ** @return
+ ** @param option   Debug option the message belongs to
+ ** @param key      Key of a table entry (only the latest value of a key is sent), empty otherwise
+ ** @param msg      Message to send (its content is taken over if it is queued)
  */
 
-void Debugging::sendMessage(de::fumanoids::message::Message &msg) const {
-	services.getComm().broadcastMessage(msg);
+void Debugging::sendMessage(const DebuggingOption *option, const std::string &key, de::fumanoids::message::Message &msg) const {
+	DebugSender &sender = DebugSender::getInstance();
+	if (sender.isRunning())
+		sender.queue(option, key, msg);
+	else
+		services.getComm().broadcastMessage(msg);
 }
 
 
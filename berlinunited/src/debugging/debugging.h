@@ -8,6 +8,8 @@
 #include "msg_debuggingcommands.pb.h"
 #include "msg_3d.pb.h"
 
+#include <algorithm>
+#include <atomic>
 #include <map>
 #include <string>
 
@@ -45,12 +47,28 @@ typedef enum {
 #define ENABLED (1<<0) /* enabled by default */
 #define CMDLOUT (1<<1) /* print to cmdline */
 #define NONET   (1<<2) /* do not send debug output via any network, applies only to TEXT */
+#define PRIOHIGH (1<<3) /* send network output before the one of other options */
+#define PRIOLOW  (1<<4) /* send network output after the one of other options */
+
+
+/**
+ ** Priority of the network output of a debug option.
+ */
+typedef enum {
+	PRIORITY_LOW    = 0,
+	PRIORITY_NORMAL = 1,
+	PRIORITY_HIGH   = 2,
+	PRIORITY_COUNT
+} DebuggingPriority;
 
 
 /**
  ** DebuggingOption describes a single option with
  ** its name, type and current status.
  **
+ ** Options are registered once and then referred to by their pointer, so
+ ** checking whether an option is enabled only takes a single relaxed load.
+ **
  */
 typedef struct DebuggingOption {
 	DebuggingOption()
@@ -61,6 +79,7 @@ typedef struct DebuggingOption {
 		, enabled(false)
 		, cmdlineout(false)
 		, netout(false)
+		, priority(PRIORITY_NORMAL)
 	{}
 
 	std::string name;
@@ -69,9 +88,20 @@ typedef struct DebuggingOption {
 
 	DebuggingOptionType type;
 
-	bool enabled;
+	/// whether the option is enabled (may be changed by another thread at any time)
+	inline bool isEnabled() const {
+		return enabled.load(std::memory_order_relaxed);
+	}
+
+	inline void setEnabled(bool enable) {
+		enabled.store(enable, std::memory_order_relaxed);
+	}
+
+	std::atomic<bool> enabled;
 	bool cmdlineout;
 	bool netout;
+
+	DebuggingPriority priority;
 } DebuggingOption;
 
 typedef enum {
@@ -123,9 +153,16 @@ public:
 	 ** @return a pointer to the debug option, or nullptr if no such option was registered
 	 */
 
-	inline DebuggingOption* getDebugOption(std::string option) const {
-		std::transform(option.begin(), option.end(), option.begin(), ::tolower);
+	inline DebuggingOption* getDebugOption(const std::string &option) const {
 		DebugOptionContainer::const_iterator it = debugging_options.find(option);
+
+		// option names are stored in lower case
+		if (it == debugging_options.end() && std::any_of(option.begin(), option.end(), ::isupper)) {
+			std::string lowerCaseOption = option;
+			std::transform(lowerCaseOption.begin(), lowerCaseOption.end(), lowerCaseOption.begin(), ::tolower);
+			it = debugging_options.find(lowerCaseOption);
+		}
+
 		if (it != debugging_options.end())
 			return it->second;
 		else {
@@ -157,7 +194,7 @@ public:
 		std::transform(option.begin(), option.end(), option.begin(), ::tolower);
 		DebuggingOption *debugOption = getDebugOption(option);
 		if (debugOption != nullptr)
-			return debugOption->enabled;
+			return debugOption->isEnabled();
 		else
 			return false;
 	}
@@ -229,7 +266,7 @@ public:
 	 */
 
 	inline void sendDebugText(const DebuggingOption *option, const char *format, ...) const __attribute__ ((format (printf, 3, 4))) {
-		if (option && option->enabled) {
+		if (option && option->isEnabled()) {
 			va_list vl;
 			va_start(vl, format);
 
@@ -256,7 +293,7 @@ public:
 	 */
 
 	inline void sendDebugPlot(const DebuggingOption *option, const std::string &series, double x, double y) const {
-		if (option && option->enabled)
+		if (option && option->isEnabled())
 			processMessageOut(option, series, x, y);
 	}
 
@@ -269,7 +306,7 @@ public:
 	 */
 
 	inline void sendDebugPlot(const DebuggingOption *option, const std::string &series, Millisecond x, double y) const {
-		if (option && option->enabled)
+		if (option && option->isEnabled())
 			processMessageOut(option, series, x.value(), y);
 	}
 
@@ -282,7 +319,7 @@ public:
 	 */
 
 	inline void sendDebug3D(const DebuggingOption *option, const de::fumanoids::message::Debug3D &commands) const {
-		if (option && option->enabled)
+		if (option && option->isEnabled())
 			processMessageOut(option, commands);
 	}
 
@@ -294,7 +331,7 @@ public:
 	 */
 
 	inline void sendDebugTable(const DebuggingOption *option, const std::string &key, const std::string &payload) const {
-		if (option && option->enabled)
+		if (option && option->isEnabled())
 			processMessageOut(option, key, payload);
 	}
 
@@ -306,7 +343,7 @@ public:
 	 */
 
 	inline void sendDebugTable(const DebuggingOption *option, const std::string &key, const double payload) const {
-		if (option && option->enabled)
+		if (option && option->isEnabled())
 			processMessageOut(option, key, payload);
 	}
 
@@ -334,6 +371,8 @@ public:
 
 	void sendImageDebug(int frameNumber);
 
+	void sendMessage(const DebuggingOption *option, const std::string &key, de::fumanoids::message::Message &msg) const;
+
 private:
 	Debugging();
 	friend class Singleton<Debugging>;
@@ -356,8 +395,6 @@ private:
 	void processMessageOut(const DebuggingOption *option, const std::string &key, double value) const;
 	void processMessageOut(const DebuggingOption *option, const de::fumanoids::message::Debug3D &commands) const;
 
-	void sendMessage(de::fumanoids::message::Message &msg) const;
-
 	/** Checks whether a debug option should also be printed on console (if enabled)
 	 **
 	 ** @param option  Debug option
@@ -380,7 +417,7 @@ private:
 	inline void enableDebugOption(const std::string &option) {
 		DebuggingOption *ptr = getDebugOption(option);
 		if (ptr != nullptr) {
-			ptr->enabled = true;
+			ptr->setEnabled(true);
 		}
 	}
 
@@ -392,7 +429,7 @@ private:
 	inline void disableDebugOption(const std::string &option) {
 		DebuggingOption *ptr = getDebugOption(option);
 		if (ptr != nullptr) {
-			ptr->enabled = false;
+			ptr->setEnabled(false);
 		}
 	}
 };
@@ -17,7 +17,7 @@
 		static DebuggingOption *_debug_option = ::Debugging::getInstance().getDebugOption(option); \
 		if (_debug_option == nullptr) { \
 			ERROR("debug option %s doesn't exist", std::string(option).c_str()); \
-		} else if (_debug_option->enabled) { \
+		} else if (_debug_option->isEnabled()) { \
 			static __attribute__ ((unused))ImageDebugger &imageDebugger = ::Debugging::getInstance().getImageDebugger(DEFAULTIMAGE); \
 			code \
 		} \
@@ -0,0 +1,142 @@
+#ifndef LOGBUFFER_H_
+#define LOGBUFFER_H_
+
+#include <algorithm>
+#include <memory>
+#include <streambuf>
+#include <vector>
+#include <string.h>
+
+
+/*------------------------------------------------------------------------------------------------*/
+
+/** \class LogBuffer
+ ** \brief In-memory stream buffer a log frame is serialized into.
+ **
+ ** The buffer only ever grows, so once a LogBuffer has been used for a few
+ ** frames, serializing into it does not allocate anymore. Space for headers
+ ** whose content is only known later (e.g. the size of the data following
+ ** it) can be reserved and filled in afterwards, without having to seek in
+ ** the stream.
+ */
+
+class LogBuffer : public std::streambuf {
+public:
+	LogBuffer()
+		: used(0)
+	{}
+
+	/// discard the content (but keep the memory)
+	void clear() {
+		used = 0;
+	}
+
+	/// number of bytes in the buffer
+	size_t size() const {
+		return used;
+	}
+
+	const char* data() const {
+		return buffer.data();
+	}
+
+	/** Reserve space to be filled in later.
+	 **
+	 ** @param bytes   Number of bytes to reserve
+	 ** @return offset of the reserved space (pointers may be invalidated by later writes)
+	 */
+	size_t reserve(size_t bytes) {
+		size_t offset = used;
+		grow(bytes);
+		used += bytes;
+		return offset;
+	}
+
+	/// pointer to the given offset, only valid until the next write
+	char* at(size_t offset) {
+		return buffer.data() + offset;
+	}
+
+	/// discard everything after the given number of bytes
+	void truncate(size_t bytes) {
+		used = std::min(used, bytes);
+	}
+
+	/// append raw data
+	void append(const char* src, size_t bytes) {
+		grow(bytes);
+		memcpy(buffer.data() + used, src, bytes);
+		used += bytes;
+	}
+
+protected:
+	std::vector<char> buffer;
+	size_t            used;
+
+	void grow(size_t bytes) {
+		if (used + bytes > buffer.size())
+			buffer.resize(std::max(2*buffer.size(), used + bytes));
+	}
+
+	virtual int_type overflow(int_type c) override {
+		if (traits_type::eq_int_type(c, traits_type::eof()))
+			return traits_type::not_eof(c);
+
+		char ch = traits_type::to_char_type(c);
+		append(&ch, 1);
+		return c;
+	}
+
+	virtual std::streamsize xsputn(const char* s, std::streamsize n) override {
+		append(s, n);
+		return n;
+	}
+};
+
+
+/*------------------------------------------------------------------------------------------------*/
+
+/** \class LogInputBuffer
+ ** \brief Stream buffer to deserialize from a block of memory (without copying it).
+ **
+ ** If the memory is owned by a shared pointer (e.g. a memory-mapped log
+ ** file), large blocks of binary data (such as image data) can be taken from
+ ** the buffer without copying them, see alias(). As a boost archive does not
+ ** give access to its stream buffer, deserialize with a LogInputArchive to
+ ** make the buffer known to the deserialization code.
+ */
+
+class LogInputBuffer : public std::streambuf {
+public:
+	LogInputBuffer(const char* begin, size_t size, std::shared_ptr<char> owner = nullptr)
+		: owner(owner)
+	{
+		char* p = const_cast<char*>(begin);
+		setg(p, p, p + size);
+	}
+
+	/// number of bytes consumed so far
+	size_t consumed() const {
+		return gptr() - eback();
+	}
+
+	/** Take the data at the current position without copying it. The data
+	 ** stays valid as long as the returned pointer exists.
+	 **
+	 ** @param bytes   Number of bytes to take
+	 ** @return pointer to the data, nullptr if the memory is not shared (or not enough data is left)
+	 */
+	std::shared_ptr<void> alias(size_t bytes) {
+		if (nullptr == owner || (size_t)(egptr() - gptr()) < bytes)
+			return nullptr;
+
+		std::shared_ptr<void> data(owner, gptr());
+		gbump(bytes);
+		return data;
+	}
+
+protected:
+	std::shared_ptr<char> owner;
+};
+
+#endif
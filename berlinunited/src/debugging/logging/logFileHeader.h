@@ -1,9 +1,6 @@
 #ifndef LOGFILEHEADER_H_
 #define LOGFILEHEADER_H_
 
-#include "logFrameHeader.h"
-#include "logRepresentationHeader.h"
-
 #include <boost/serialization/serialization.hpp>
 #include <boost/serialization/version.hpp>
 #include <boost/serialization/vector.hpp>
@@ -26,34 +23,32 @@ private:
 
 	template<class Archive>
 	void serialize(Archive &ar, const unsigned int fileVersion) {
-		if (1 == fileVersion) {
-			ar & timestamp;
-			ar & moduleManagerName;
-			ar & buildInfo;
-			ar & moduleNames;
-			ar & representationNames;
-
-			// boost stores additional information in the archive the first
-			// time a class is serialized. As we are overwriting both the
-			// frame and the representation header during serialization (in
-			// order to update the data size), this would corrupt our archive.
-			// So, as a little hack, we write a dummy frame and representation
-			// header here, resolving this issue once and for all :-)
-			LogFrameHeader          dummyFrame;
-			LogRepresentationHeader dummyRepresentation;
-			ar & dummyFrame;
-			ar & dummyRepresentation;
-
-		} else {
-			assert(false);
-		}
+		version = fileVersion;
+
+		ar & timestamp;
+		ar & moduleManagerName;
+		ar & buildInfo;
+		ar & moduleNames;
+		ar & representationNames;
+
+		if (fileVersion >= 3)
+			ar & compressed;
+
+		// version 1 logs were written as one continuous archive, followed by
+		// a dummy frame and representation header. Those logs can not be
+		// replayed anymore, we only read the header to be able to tell so.
 	}
 
 public:
 	LogFileHeader()
-		: timestamp(0*milliseconds)
+		: version(0)
+		, timestamp(0*milliseconds)
+		, compressed(false)
 	{}
 
+	/// version of the log file format (as read from the file)
+	unsigned int version;
+
 	/// date/time of log
 	robottime_t timestamp;
 
@@ -69,10 +64,18 @@ public:
 
 	/// The modules that are being logged
 	std::vector<std::string> moduleNames;
+
+	/// whether the frame data is compressed (with zlib, every frame on its own)
+	bool compressed;
+
+	/// In a compressed log, the data of every frame starts with its uncompressed
+	/// size. If this bit of the size is set, the frame could not be compressed
+	/// and its data follows as is.
+	static const uint32_t storedFrameFlag = 0x80000000;
 };
 
 
-BOOST_CLASS_VERSION(LogFileHeader, 1)
+BOOST_CLASS_VERSION(LogFileHeader, 3)
 BOOST_CLASS_TRACKING(LogFileHeader, boost::serialization::track_never)
 
 #endif
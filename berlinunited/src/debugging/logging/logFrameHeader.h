@@ -1,11 +1,9 @@
 #ifndef LOGFRAMEHEADER_H_
 #define LOGFRAMEHEADER_H_
 
-#include <boost/serialization/serialization.hpp>
-#include <boost/serialization/version.hpp>
-
 #include <string>
 #include <inttypes.h>
+#include <string.h>
 
 #include "platform/system/timer.h"
 
@@ -14,29 +12,38 @@
 
 /** \class LogFrameHeader
  ** \brief Header before each log frame.
+ **
+ ** The header is stored with a fixed size (and not through boost), so frames
+ ** can be assembled in memory and read without any archive state.
  */
 
 class LogFrameHeader {
-private:
-	friend class boost::serialization::access;
-
-	template<class Archive>
-	void serialize(Archive &ar, const unsigned int fileVersion) {
-		ar & timestamp;
-		ar & framenumber;
-		ar & framesize;
-		ar & repCount;
-	}
-
 public:
 	robottime_t timestamp; // TODO: which time?
 	uint32_t    framenumber;
 	uint32_t    framesize;      //!< frame data length (in bytes) without header
 	uint16_t    repCount;       //!< how many representations are serialized
-};
 
-BOOST_CLASS_VERSION(LogFrameHeader, 1)
-BOOST_CLASS_TRACKING(LogFrameHeader, boost::serialization::track_never)
+	/// size of the header in the log file
+	static const size_t headerSize = sizeof(double) + 2*sizeof(uint32_t) + sizeof(uint16_t);
+
+	void write(char* dst) const {
+		double time = timestamp.value();
+		memcpy(dst, &time,        sizeof(time));        dst += sizeof(time);
+		memcpy(dst, &framenumber, sizeof(framenumber)); dst += sizeof(framenumber);
+		memcpy(dst, &framesize,   sizeof(framesize));   dst += sizeof(framesize);
+		memcpy(dst, &repCount,    sizeof(repCount));
+	}
+
+	void read(const char* src) {
+		double time;
+		memcpy(&time,        src, sizeof(time));        src += sizeof(time);
+		memcpy(&framenumber, src, sizeof(framenumber)); src += sizeof(framenumber);
+		memcpy(&framesize,   src, sizeof(framesize));   src += sizeof(framesize);
+		memcpy(&repCount,    src, sizeof(repCount));
+		timestamp = time*milliseconds;
+	}
+};
 
 
 #endif
@@ -0,0 +1,145 @@
+#include "logIndex.h"
+#include "logFrameHeader.h"
+
+#include "debug.h"
+
+#include <algorithm>
+#include <string.h>
+
+
+/*------------------------------------------------------------------------------------------------*/
+
+/** Write the index (and the trailer) to the stream.
+ **
+ ** @param os       Stream to write to, positioned at the end of the frames
+ ** @param offset   Position of the stream in the file
+ */
+
+void LogIndex::write(std::ostream &os, uint64_t offset) {
+	framesEnd = offset;
+
+	for (const auto &entry : entries) {
+		double timestamp = entry.timestamp.value();
+		os.write((const char*)&entry.framenumber, sizeof(entry.framenumber));
+		os.write((const char*)&timestamp,         sizeof(timestamp));
+		os.write((const char*)&entry.offset,      sizeof(entry.offset));
+	}
+
+	uint32_t count = entries.size();
+	uint32_t magicNumber = magic;
+	os.write((const char*)&framesEnd,   sizeof(framesEnd));
+	os.write((const char*)&count,       sizeof(count));
+	os.write((const char*)&magicNumber, sizeof(magicNumber));
+}
+
+
+/*------------------------------------------------------------------------------------------------*/
+
+/** Read the index from the end of a log file.
+ **
+ ** @param file       The log file
+ ** @param fileSize   Size of the log file (to ignore data that was appended)
+ ** @return true if the file has a valid index
+ */
+
+bool LogIndex::read(const LogMappedFile &file, uint64_t fileSize) {
+	clear();
+
+	if (fileSize < trailerSize || fileSize > file.size())
+		return false;
+
+	std::shared_ptr<char> trailer = file.read(fileSize - trailerSize, trailerSize);
+	if (nullptr == trailer)
+		return false;
+
+	uint64_t offset;
+	uint32_t count, magicNumber;
+	const char* src = trailer.get();
+	memcpy(&offset,      src, sizeof(offset));      src += sizeof(offset);
+	memcpy(&count,       src, sizeof(count));       src += sizeof(count);
+	memcpy(&magicNumber, src, sizeof(magicNumber));
+
+	if (magicNumber != magic || offset + uint64_t(count)*entrySize + trailerSize != fileSize)
+		return false;
+
+	std::shared_ptr<char> data = file.read(offset, count*entrySize);
+	if (nullptr == data)
+		return false;
+
+	entries.resize(count);
+	src = data.get();
+	for (auto &entry : entries) {
+		double timestamp;
+		memcpy(&entry.framenumber, src, sizeof(entry.framenumber)); src += sizeof(entry.framenumber);
+		memcpy(&timestamp,         src, sizeof(timestamp));         src += sizeof(timestamp);
+		memcpy(&entry.offset,      src, sizeof(entry.offset));      src += sizeof(entry.offset);
+		entry.timestamp = timestamp*milliseconds;
+	}
+
+	framesEnd = offset;
+	return true;
+}
+
+
+/*------------------------------------------------------------------------------------------------*/
+
+/** Rebuild the index of a log file without one by reading all frame headers.
+ ** A truncated last frame is ignored.
+ **
+ ** @param file               The log file
+ ** @param fileSize           Size of the log file (to ignore data that was appended)
+ ** @param firstFrameOffset   Position of the first frame in the file
+ */
+
+void LogIndex::rebuild(const LogMappedFile &file, uint64_t fileSize, uint64_t firstFrameOffset) {
+	clear();
+
+	uint64_t offset = firstFrameOffset;
+	while (offset + LogFrameHeader::headerSize <= fileSize) {
+		std::shared_ptr<char> data = file.read(offset, LogFrameHeader::headerSize);
+		if (nullptr == data)
+			break;
+
+		LogFrameHeader header;
+		header.read(data.get());
+
+		uint64_t next = offset + LogFrameHeader::headerSize + header.framesize;
+		if (next > fileSize)
+			break;
+
+		add(header.framenumber, header.timestamp, offset);
+		offset = next;
+	}
+
+	framesEnd = offset;
+}
+
+
+/*------------------------------------------------------------------------------------------------*/
+
+/** Find a frame by its frame number.
+ **
+ ** @param framenumber   Frame number to look for
+ ** @return index of the first frame with a frame number >= framenumber (size() if there is none)
+ */
+
+size_t LogIndex::findFrame(uint32_t framenumber) const {
+	auto it = std::lower_bound(entries.begin(), entries.end(), framenumber,
+			[](const Entry &entry, uint32_t framenumber) { return entry.framenumber < framenumber; });
+	return it - entries.begin();
+}
+
+
+/*------------------------------------------------------------------------------------------------*/
+
+/** Find a frame by its time.
+ **
+ ** @param timestamp   Time to look for
+ ** @return index of the first frame recorded at or after timestamp (size() if there is none)
+ */
+
+size_t LogIndex::findTime(robottime_t timestamp) const {
+	auto it = std::lower_bound(entries.begin(), entries.end(), timestamp,
+			[](const Entry &entry, robottime_t timestamp) { return entry.timestamp < timestamp; });
+	return it - entries.begin();
+}
@@ -0,0 +1,86 @@
+#ifndef LOGINDEX_H_
+#define LOGINDEX_H_
+
+#include "logMappedFile.h"
+
+#include "platform/system/timer.h"
+
+#include <iostream>
+#include <vector>
+#include <inttypes.h>
+
+
+/*------------------------------------------------------------------------------------------------*/
+
+/** \class LogIndex
+ ** \brief Maps the frames of a log file to their position in the file.
+ **
+ ** The index is written to the end of the log file when logging is stopped:
+ **
+ ** INDEX
+ **     ENTRY (repeated)
+ **         uint32_t framenumber
+ **         double   timestamp (in milliseconds)
+ **         uint64_t offset of the frame header in the file
+ **     TRAILER
+ **         uint64_t offset of the first entry in the file (== end of the frames)
+ **         uint32_t number of entries
+ **         uint32_t magic number
+ **
+ ** If a log file has no index (e.g. because the robot was switched off while
+ ** logging), it can be rebuilt by skipping from frame header to frame header.
+ */
+
+class LogIndex {
+public:
+	struct Entry {
+		uint32_t    framenumber;
+		robottime_t timestamp;
+		uint64_t    offset;
+	};
+
+	LogIndex()
+		: framesEnd(0)
+	{}
+
+	void clear() {
+		entries.clear();
+		framesEnd = 0;
+	}
+
+	void add(uint32_t framenumber, robottime_t timestamp, uint64_t offset) {
+		entries.push_back(Entry{framenumber, timestamp, offset});
+	}
+
+	/// number of frames
+	size_t size() const {
+		return entries.size();
+	}
+
+	const Entry& operator[](size_t i) const {
+		return entries[i];
+	}
+
+	/// offset in the file right after the last frame
+	uint64_t getFramesEnd() const {
+		return framesEnd;
+	}
+
+	void write(std::ostream &os, uint64_t offset);
+	bool read(const LogMappedFile &file, uint64_t fileSize);
+	void rebuild(const LogMappedFile &file, uint64_t fileSize, uint64_t firstFrameOffset);
+
+	size_t findFrame(uint32_t framenumber) const;
+	size_t findTime(robottime_t timestamp) const;
+
+protected:
+	static const uint32_t magic = 0x58444e49; // "INDX"
+
+	static const size_t entrySize   = sizeof(uint32_t) + sizeof(double) + sizeof(uint64_t);
+	static const size_t trailerSize = sizeof(uint64_t) + 2*sizeof(uint32_t);
+
+	std::vector<Entry> entries;
+	uint64_t           framesEnd;
+};
+
+#endif
@@ -0,0 +1,17 @@
+#include "logInputArchive.h"
+
+
+/*------------------------------------------------------------------------------------------------*/
+
+/** Take a block of binary data from an archive without copying it, see
+ ** Serializer.h. Only a LogInputArchive reading from shared memory can do so.
+ **
+ ** @param archive   Archive to read from
+ ** @param bytes     Number of bytes to take
+ ** @return the data, nullptr if it can not be taken without copying
+ */
+
+std::shared_ptr<void> aliasBinaryData(DESERIALIZER &archive, size_t bytes) {
+	LogInputBuffer *buffer = getLogInputBuffer(archive);
+	return nullptr != buffer ? buffer->alias(bytes) : nullptr;
+}
@@ -0,0 +1,48 @@
+#ifndef LOGINPUTARCHIVE_H_
+#define LOGINPUTARCHIVE_H_
+
+#include "ModuleFramework/Serializer.h"
+#include "debugging/logging/logBuffer.h"
+
+
+/*------------------------------------------------------------------------------------------------*/
+
+/** \class LogInputArchive
+ ** \brief Archive deserializing from a LogInputBuffer.
+ **
+ ** Representations are deserialized through a DESERIALIZER, which does not
+ ** give access to its stream buffer. This archive keeps the buffer, so the
+ ** serialization code can take large blocks of binary data (such as image
+ ** data) without copying them, see aliasBinaryData() in Serializer.h.
+ */
+
+class LogInputArchive : public DESERIALIZER {
+public:
+	LogInputArchive(LogInputBuffer &buffer, unsigned int flags = 0)
+		: DESERIALIZER(buffer, flags)
+		, buffer(buffer)
+	{}
+
+	LogInputBuffer& getBuffer() {
+		return buffer;
+	}
+
+protected:
+	LogInputBuffer &buffer;
+};
+
+
+/*------------------------------------------------------------------------------------------------*/
+
+/// the buffer the archive reads from, nullptr if the archive is no LogInputArchive
+template<class Archive>
+inline LogInputBuffer* getLogInputBuffer(Archive &) {
+	return nullptr;
+}
+
+inline LogInputBuffer* getLogInputBuffer(DESERIALIZER &archive) {
+	LogInputArchive *logArchive = dynamic_cast<LogInputArchive*>(&archive);
+	return nullptr != logArchive ? &logArchive->getBuffer() : nullptr;
+}
+
+#endif
@@ -0,0 +1,126 @@
+#include "logMappedFile.h"
+
+#include "debug.h"
+
+#include <limits>
+#include <stdexcept>
+
+#include <errno.h>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+
+/*------------------------------------------------------------------------------------------------*/
+
+namespace {
+#ifdef __linux__
+	// log files can be larger than 2 GB, also on 32 bit systems
+	typedef struct stat64 FileStatus;
+
+	inline int     openFile(const char *filename)                                { return open64(filename, O_RDONLY); }
+	inline int     getFileStatus(int fd, FileStatus *status)                     { return fstat64(fd, status); }
+	inline ssize_t readFile(int fd, char *dst, size_t bytes, uint64_t offset)   { return pread64(fd, dst, bytes, offset); }
+#else
+	typedef struct stat FileStatus;
+
+	inline int     openFile(const char *filename)                                { return open(filename, O_RDONLY); }
+	inline int     getFileStatus(int fd, FileStatus *status)                     { return fstat(fd, status); }
+	inline ssize_t readFile(int fd, char *dst, size_t bytes, uint64_t offset)   { return pread(fd, dst, bytes, offset); }
+#endif
+}
+
+
+/*------------------------------------------------------------------------------------------------*/
+
+/** Open the file and map it into memory.
+ **
+ ** @param filename   Name of the log file
+ ** @param map        Whether to map the file (otherwise it is always read with pread())
+ ** @throw std::runtime_error if the file can not be opened
+ */
+
+LogMappedFile::LogMappedFile(const std::string &filename, bool map)
+	: fd(-1)
+	, fileSize(0)
+{
+	fd = openFile(filename.c_str());
+	if (fd < 0)
+		throw std::runtime_error("Could not open log file " + filename);
+
+	FileStatus status;
+	if (getFileStatus(fd, &status) != 0 || status.st_size == 0) {
+		close(fd);
+		throw std::runtime_error("Could not determine size of log file " + filename);
+	}
+	fileSize = status.st_size;
+
+	if (false == map)
+		return;
+
+	// no access pattern is advised: playback reads the frames front to back,
+	// but seeking jumps through the file
+	void* p = MAP_FAILED;
+	if (fileSize <= std::numeric_limits<size_t>::max())
+		p = mmap(nullptr, fileSize, PROT_READ | PROT_WRITE, MAP_PRIVATE, fd, 0);
+
+	if (MAP_FAILED == p) {
+		WARNING("Could not map log file %s, reading it frame by frame", filename.c_str());
+		return;
+	}
+
+	size_t size = fileSize;
+	mapping = std::shared_ptr<char>((char*)p, [size](char* p) { munmap(p, size); });
+
+	// the mapping does not need the file descriptor
+	close(fd);
+	fd = -1;
+}
+
+
+/*------------------------------------------------------------------------------------------------*/
+
+/**
+ **
+ */
+
+LogMappedFile::~LogMappedFile() {
+	if (fd >= 0)
+		close(fd);
+}
+
+
+/*------------------------------------------------------------------------------------------------*/
+
+/** Get a part of the file.
+ **
+ ** @param offset   Position in the file
+ ** @param bytes    Number of bytes
+ ** @return the data (pointing into the mapping if the file is mapped), nullptr if it is not (completely) in the file
+ */
+
+std::shared_ptr<char> LogMappedFile::read(uint64_t offset, size_t bytes) const {
+	if (offset > fileSize || bytes > fileSize - offset)
+		return nullptr;
+
+	if (nullptr != mapping)
+		return std::shared_ptr<char>(mapping, mapping.get() + offset);
+
+	std::shared_ptr<char> data(new char[bytes > 0 ? bytes : 1], std::default_delete<char[]>());
+	size_t done = 0;
+	while (done < bytes) {
+		ssize_t res = readFile(fd, data.get() + done, bytes - done, offset + done);
+		if (res < 0 && errno == EINTR)
+			continue;
+
+		if (res <= 0) {
+			ERROR("Could not read %d bytes from log file at position %llu", (int)bytes, (unsigned long long)offset);
+			return nullptr;
+		}
+
+		done += res;
+	}
+
+	return data;
+}
@@ -0,0 +1,56 @@
+#ifndef LOGMAPPEDFILE_H_
+#define LOGMAPPEDFILE_H_
+
+#include <memory>
+#include <string>
+#include <inttypes.h>
+#include <stddef.h>
+
+
+/*------------------------------------------------------------------------------------------------*/
+
+/** \class LogMappedFile
+ ** \brief A log file mapped into memory.
+ **
+ ** The mapping is private (copy-on-write), so data taken from the file can be
+ ** modified in place without changing the file. Data returned by read() stays
+ ** valid as long as the returned pointer (or one aliasing it) exists, even
+ ** after the LogMappedFile itself was destroyed.
+ **
+ ** A file that can not be mapped (e.g. a log of several GB that does not fit
+ ** into the address space of a 32 bit system) is read with pread() instead,
+ ** read() then returns a copy of the requested bytes.
+ */
+
+class LogMappedFile {
+public:
+	LogMappedFile(const std::string &filename, bool map = true);
+	~LogMappedFile();
+
+	LogMappedFile(const LogMappedFile&) = delete;
+	LogMappedFile& operator=(const LogMappedFile&) = delete;
+
+	/// whether the file is mapped into memory
+	bool isMapped() const {
+		return nullptr != mapping;
+	}
+
+	/// content of the whole file, nullptr if the file is not mapped
+	const char* data() const {
+		return mapping.get();
+	}
+
+	/// size of the file
+	uint64_t size() const {
+		return fileSize;
+	}
+
+	std::shared_ptr<char> read(uint64_t offset, size_t bytes) const;
+
+protected:
+	int                   fd;
+	uint64_t              fileSize;
+	std::shared_ptr<char> mapping;
+};
+
+#endif
@@ -1,11 +1,14 @@
 #include "logPlayer.h"
 
+#include "debugging/logging/logBuffer.h"
 #include "debugging/logging/logFileHeader.h"
 #include "debugging/logging/logFrameHeader.h"
+#include "debugging/logging/logInputArchive.h"
 #include "debugging/logging/logRepresentationHeader.h"
 
 #include "ModuleFramework/ModuleManager.h"
 
+#include "management/commandLine.h"
 #include "management/config/config.h"
 
 #include "utils/ansiTools.h"
@@ -13,11 +16,20 @@
 #include "utils/stringTools.h"
 #include "utils/utils.h"
 
+#include "debugging/stopwatch.h"
+#include "services.h"
+
+#include <zlib.h>
+
 
 /*------------------------------------------------------------------------------------------------*/
 
 namespace {
-	auto cfgPlayLog  = ConfigRegistry::registerOption<std::string>("play", "", "The log files to use");
+	auto cfgPlayLog   = ConfigRegistry::registerOption<std::string>("play",      "", "The log files to use");
+	auto cfgPlayRange = ConfigRegistry::registerOption<std::string>("playrange", "", "Frame numbers to play back (FIRST-LAST)");
+	auto cfgPlayDiff  = ConfigRegistry::registerOption<std::string>("playdiff",  "", "Representations to compare with the logged ones during replay (comma-separated)");
+
+	auto switchReplay = ConfigRegistry::getInstance().registerSwitch("replay", "Replay the log file (see 'play') as fast as possible without user interaction and report module runtimes");
 }
 
 
@@ -63,10 +75,26 @@ bool LogPlayer::isActive(const std::string &moduleManagerName) {
 */
 
 LogPlayer::LogPlayer()
-	: ifs(nullptr)
-	, archive(nullptr)
+	: LogPlayer(cfgPlayLog->get())
+{
+}
+
+
+/*------------------------------------------------------------------------------------------------*/
+
+/**
+ ** @param cfg   Log file and modules to play (same format as the 'play' option)
+ */
+
+LogPlayer::LogPlayer(const std::string &cfg)
+	: currentFrame(0)
+	, rangeBegin(0)
+	, rangeEnd(0)
+	, replayedFrames(0)
+	, moduleManager(nullptr)
+	, frameData(nullptr)
+	, uncompressedFrameCapacity(0)
 {
-	std::string cfg = cfgPlayLog->get();
 	if (cfg.find(";") != cfg.npos) {
 		throw std::runtime_error("Only one module manager can be played back (at the moment)");
 	}
@@ -81,17 +109,45 @@ LogPlayer::LogPlayer()
 
 	logFileName = tokens[0];
 
-	ifs = new std::ifstream(logFileName, std::ios::in | std::ios::binary);
-	archive = new DESERIALIZER(*ifs);
+	file.reset(new LogMappedFile(logFileName));
+
+	// the file header is a boost archive of its own, preceded by its size
+	uint32_t headerSize = 0;
+	std::shared_ptr<char> headerSizeData = file->read(0, sizeof(headerSize));
+	if (nullptr != headerSizeData)
+		memcpy(&headerSize, headerSizeData.get(), sizeof(headerSize));
+
+	std::shared_ptr<char> headerData = file->read(sizeof(headerSize), headerSize);
+	if (headerSize == 0 || nullptr == headerData)
+		throw std::runtime_error("Could not read header of log file " + logFileName);
 
-	archive->register_type<LogFileHeader>();
-	archive->register_type<LogFrameHeader>();
-	archive->register_type<LogRepresentationHeader>();
+	LogInputBuffer headerBuffer(headerData.get(), headerSize);
+	DESERIALIZER archive(headerBuffer);
+	archive & header;
 
-	*archive & header;
+	if (header.version < 2)
+		throw std::runtime_error("Log file " + logFileName + " was recorded in an old format that is not supported anymore");
 
 	// also add the modules that were logged to be enabled
 	modules.insert( modules.end(), header.moduleNames.begin(), header.moduleNames.end() );
+
+	// a log file that was not closed properly has no index, so we need to
+	// find the frames ourselves
+	if (false == index.read(*file, file->size())) {
+		WARNING("Log file %s has no index, scanning frames", logFileName.c_str());
+		index.rebuild(*file, file->size(), sizeof(headerSize) + headerSize);
+	}
+
+	currentFrame = index.size();
+	rangeBegin   = 0;
+	rangeEnd     = index.size();
+
+	std::vector<std::string> range;
+	split(cfgPlayRange->get(), "-", range);
+	if (range.size() >= 1 && range[0] != "")
+		rangeBegin = index.findFrame(atoi(range[0].c_str()));
+	if (range.size() >= 2 && range[1] != "")
+		rangeEnd = index.findFrame(atoi(range[1].c_str()) + 1);
 }
 
 
@@ -120,11 +176,15 @@ void LogPlayer::start(ModuleManager* moduleManager) {
 
 /*------------------------------------------------------------------------------------------------*/
 
-/*
-**
-*/
+/** Set up the module manager to play back the log file: enable the modules
+ ** to run and disable all others.
+ **
+ ** @param moduleManager   Module manager the log file was recorded from
+ */
+
+void LogPlayer::prepare(ModuleManager* moduleManager) {
+	this->moduleManager = moduleManager;
 
-void LogPlayer::threadMain() {
 	// activate all requested modules
 	for (const auto& module : modules) {
 		moduleManager->setModuleEnabled(module, true, false);
@@ -133,6 +193,9 @@ void LogPlayer::threadMain() {
 	// calculate the execution list based on the representation dependencies
 	moduleManager->calculateExecutionList();
 
+	// replay has to be deterministic, so do not run any modules in parallel
+	moduleManager->setSerialExecution(true);
+
 	// start the manager
 	moduleManager->ModuleManager::startManager(1);
 
@@ -143,6 +206,31 @@ void LogPlayer::threadMain() {
 	}
 
 	representations = header.representationNames;
+}
+
+
+/*------------------------------------------------------------------------------------------------*/
+
+/*
+**
+*/
+
+void LogPlayer::threadMain() {
+	prepare(moduleManager);
+
+	// batch mode, replay everything and quit
+	if (CommandLine::getInstance().isSwitchEnabled("replay")) {
+		std::vector<std::string> diffRepresentations;
+		if (cfgPlayDiff->get() != "")
+			split(cfgPlayDiff->get(), ",", diffRepresentations);
+
+		Microsecond start = getCurrentMicroTime();
+		ReplayDiffs diffs = replay(diffRepresentations);
+		printReplayReport(diffs, getCurrentMicroTime() - start);
+
+		services.triggerTermination();
+		return;
+	}
 
 	takeKeyboard();
 
@@ -152,15 +240,20 @@ void LogPlayer::threadMain() {
 		"   Log file %s\n"
 		"       -> build info: %s\n"
 		"       -> recorded from %s\n"
-		"   x frames serialized\n"
+		"   %d frames serialized\n"
 		"====================================================================\n" TERM_RESET
 		"\n"
 		"usage:\n"
 		" - SPACE:    process next frame\n"
+		" - b:        process previous frame\n"
+		" - g:        jump to frame number\n"
+		" - t:        jump to time (in seconds since start of log)\n"
+		" - p:        play frames until end of range (any key to stop)\n"
 		"\n"
 		, logFileName.c_str()
 		, header.buildInfo.c_str()
 		, header.moduleManagerName.c_str()
+		, (int)index.size()
 		);
 
 	printf("Modules executed:\n");
@@ -170,46 +263,421 @@ void LogPlayer::threadMain() {
 	while (isRunning()) {
 		int c = getKeyWithUsTimeout(500);
 		if (c == ' ') {
-			deserialize(moduleManager->getBlackBoard().getRegistry());
-			moduleManager->executeModules();
+			playNextFrame();
+		} else if (c == 'b') {
+			playPreviousFrame();
+		} else if (c == 'g') {
+			std::string input = readInput("Frame number: ");
+			if (input != "")
+				playFrameNumber(atoi(input.c_str()));
+		} else if (c == 't') {
+			std::string input = readInput("Time (s): ");
+			if (input != "")
+				playTime(Millisecond(atof(input.c_str())*seconds));
+		} else if (c == 'p') {
+			playRange(rangeEnd);
 		}
 	}
-	
+
 	releaseKeyboard();
 }
 
 
 /*------------------------------------------------------------------------------------------------*/
 
-/**
+/** Read a line from the keyboard (which is in raw mode).
+ **
+ ** @param prompt   Text to show
+ ** @return entered text, empty if aborted with ESC
+ */
+
+std::string LogPlayer::readInput(const char* prompt) {
+	printf("%s", prompt);
+	fflush(stdout);
+
+	std::string input;
+	while (isRunning()) {
+		int c = getKey();
+		if (c == '\n' || c == '\r') {
+			break;
+		} else if (c == 27) {
+			input = "";
+			break;
+		} else if ((c == 127 || c == '\b') && input.size() > 0) {
+			input.pop_back();
+			printf("\b \b");
+		} else if (isdigit(c) || c == '.') {
+			input.push_back(c);
+			printf("%c", c);
+		}
+		fflush(stdout);
+	}
+
+	printf("\n");
+	return input;
+}
+
+
+/*------------------------------------------------------------------------------------------------*/
+
+/** Load the given frame into the representations and execute the modules.
+ **
+ ** @param frame   Index of the frame in the log file
+ ** @return false if there is no such frame
  */
 
-void LogPlayer::deserialize(const BlackBoard::Registry &registry) {
+bool LogPlayer::playFrame(size_t frame) {
+	if (frame >= index.size()) {
+		INFO("End of log file reached");
+		return false;
+	}
+
+	if (false == deserialize(frame, moduleManager->getBlackBoard().getRegistry()))
+		return false;
+
+	INFO("Played frame %d", index[frame].framenumber);
+
+	currentFrame = frame;
+	moduleManager->executeModules();
+	return true;
+}
+
+
+/*------------------------------------------------------------------------------------------------*/
+
+/** Play the frame following the one played last (or the first one of the range).
+ */
+
+bool LogPlayer::playNextFrame() {
+	if (currentFrame >= index.size())
+		return playFrame(rangeBegin);
+	return playFrame(currentFrame + 1);
+}
+
+
+/*------------------------------------------------------------------------------------------------*/
+
+/** Play the frame preceding the one played last.
+ */
+
+bool LogPlayer::playPreviousFrame() {
+	if (currentFrame >= index.size() || currentFrame == 0) {
+		INFO("Start of log file reached");
+		return false;
+	}
+	return playFrame(currentFrame - 1);
+}
+
+
+/*------------------------------------------------------------------------------------------------*/
+
+/** Play the frame with the given frame number (or the next one available).
+ **
+ ** @param framenumber   Frame number as logged by the module manager
+ */
+
+bool LogPlayer::playFrameNumber(uint32_t framenumber) {
+	return playFrame(index.findFrame(framenumber));
+}
+
+
+/*------------------------------------------------------------------------------------------------*/
+
+/** Play the frame recorded at the given time (or the next one available).
+ **
+ ** @param time   Time relative to the first frame of the log file
+ */
+
+bool LogPlayer::playTime(Millisecond time) {
+	if (index.size() == 0)
+		return false;
+	return playFrame(index.findTime(index[0].timestamp + time));
+}
+
+
+/*------------------------------------------------------------------------------------------------*/
+
+/** Play all frames until the given frame with the pace they were recorded at.
+ ** Stops when a key is pressed.
+ **
+ ** @param end   Index of the frame to stop at (exclusive)
+ */
+
+void LogPlayer::playRange(size_t end) {
+	Millisecond start = getCurrentTime();
+	size_t first = (currentFrame >= index.size()) ? rangeBegin : currentFrame + 1;
+
+	for (size_t frame = first; frame < end && isRunning(); frame++) {
+		// wait until the frame is due
+		Millisecond due = index[frame].timestamp - index[first].timestamp;
+		while (getCurrentTime() - start < due) {
+			if (getKeyWithUsTimeout(1000) > 0)
+				return;
+		}
+
+		if (false == playFrame(frame))
+			return;
+	}
+}
+
+
+/*------------------------------------------------------------------------------------------------*/
+
+/** Replay all frames (of the range) as fast as possible. The runtimes of the
+ ** modules are measured by the Stopwatch of the module manager.
+ **
+ ** @param diffRepresentations   Representations to compare with the logged values after the
+ **                              modules were executed
+ ** @return result of the comparison for each representation
+ */
+
+LogPlayer::ReplayDiffs LogPlayer::replay(const std::vector<std::string> &diffRepresentations) {
+	ReplayDiffs diffs;
+	std::map<uint16_t, std::string> diffNames;
+
+	diffData.clear();
+	for (const auto &name : diffRepresentations) {
+		auto it = std::find(representations.begin(), representations.end(), name);
+		if (it == representations.end()) {
+			ERROR("Representation %s was not logged, can not compare it", name.c_str());
+			continue;
+		}
+
+		diffs[name] = ReplayDiff();
+		diffNames[it - representations.begin()] = name;
+		diffData[it - representations.begin()] = std::make_pair(0, 0);
+	}
+
+	// measure the runtimes of the modules, without the overhead of the asynchronous executor
+	std::string runtimesStr = std::string(moduleManager->getName()) + ".runtimes";
+	std::transform(runtimesStr.begin(), runtimesStr.end(), runtimesStr.begin(), ::tolower);
+	DebuggingOption *runtimesOption = ::Debugging::getInstance().getDebugOption(runtimesStr);
+	if (runtimesOption)
+		runtimesOption->setEnabled(true);
+	moduleManager->setExecutionMode(ModuleManager::EXECUTION_INLINE);
+
+	const BlackBoard::Registry &registry = moduleManager->getBlackBoard().getRegistry();
+	LogBuffer buffer;
+
+	replayedFrames = 0;
+	for (size_t frame = rangeBegin; frame < rangeEnd && frame < index.size(); frame++) {
+		for (auto &data : diffData)
+			data.second = std::make_pair(0, 0);
+
+		if (false == deserialize(frame, registry))
+			break;
+
+		currentFrame = frame;
+		moduleManager->executeModules();
+		replayedFrames++;
+
+		for (const auto &data : diffData) {
+			const std::string &name = diffNames[data.first];
+			auto it = registry.find(name);
+			if (it == registry.end())
+				continue;
+
+			buffer.clear();
+			{
+				SERIALIZER archive(buffer, boost::archive::no_header | boost::archive::no_codecvt);
+				it->second->getRepresentation().serialize(archive);
+			}
+
+			ReplayDiff &diff = diffs[name];
+			diff.compared++;
+			if (buffer.size() != data.second.second || 0 != memcmp(buffer.data(), frameData + data.second.first, buffer.size())) {
+				if (diff.differing++ == 0)
+					diff.firstDifferingFrame = index[frame].framenumber;
+			}
+		}
+	}
+
+	diffData.clear();
+	return diffs;
+}
+
+
+/*------------------------------------------------------------------------------------------------*/
+
+/** Print the runtimes of the modules and the result of the comparison.
+ **
+ ** @param diffs      Result of the comparison
+ ** @param duration   Duration of the replay
+ */
+
+void LogPlayer::printReplayReport(const ReplayDiffs &diffs, Microsecond duration) {
+	std::string runtimesStr = std::string(moduleManager->getName()) + ".runtimes";
+	std::transform(runtimesStr.begin(), runtimesStr.end(), runtimesStr.begin(), ::tolower);
+
+	printf(TERM_BLUE
+		"====================================================================\n"
+		"Replay of %s\n"
+		"   %d frames in %.3f s (%.1f frames/s)\n"
+		"====================================================================\n" TERM_RESET
+		, logFileName.c_str()
+		, replayedFrames
+		, Second(duration).value()
+		, replayedFrames / std::max(Second(duration).value(), 1e-6)
+		);
+
+	printf("%-40s %10s %10s %10s %10s %10s %10s\n", "Module", "calls", "mean [ms]", "min [ms]", "p95 [ms]", "p99 [ms]", "max [ms]");
+	for (const auto &it : Stopwatch::getInstance().getStopwatches(runtimesStr)) {
+		const StopwatchItem &item = it.second;
+		if (item.n == 0)
+			continue;
+
+		printf("%-40s %10d %10.4f %10.4f %10.4f %10.4f %10.4f\n",
+				item.name.c_str(),
+				(int)item.n,
+				Millisecond(item.mean).value(),
+				Millisecond(item.min).value(),
+				Millisecond(item.percentile95).value(),
+				Millisecond(item.percentile99).value(),
+				Millisecond(item.max).value());
+	}
+
+	for (const auto &it : diffs) {
+		const ReplayDiff &diff = it.second;
+		if (diff.differing > 0)
+			printf(TERM_RED "%s differs from the log in %d of %d frames (first in frame %d)\n" TERM_RESET,
+					it.first.c_str(), diff.differing, diff.compared, diff.firstDifferingFrame);
+		else
+			printf("%s matches the log in all %d frames\n", it.first.c_str(), diff.compared);
+	}
+}
+
+
+/*------------------------------------------------------------------------------------------------*/
+
+/** Read a frame from the log file into the representations.
+ **
+ ** @param frame      Index of the frame in the log file
+ ** @param registry   Representations of the module manager
+ ** @return false if the frame could not be read
+ */
+
+bool LogPlayer::deserialize(size_t frame, const BlackBoard::Registry &registry) {
+	uint64_t offset = index[frame].offset;
+	std::shared_ptr<char> headerData = file->read(offset, LogFrameHeader::headerSize);
+	if (nullptr == headerData)
+		return false;
+
 	LogFrameHeader header;
-	*archive & header;
+	header.read(headerData.get());
+	offset += LogFrameHeader::headerSize;
+
+	fileFrame = file->read(offset, header.framesize);
+	if (nullptr == fileFrame) {
+		ERROR("Frame %d is incomplete", header.framenumber);
+		return false;
+	}
+
+	frameData = fileFrame.get();
+	size_t frameSize = header.framesize;
 
-	INFO("Deserializing frame %d", header.framenumber);
+	// data taken from the frame without copying it keeps the memory alive
+	std::shared_ptr<char> owner = fileFrame;
+	if (this->header.compressed) {
+		if (false == uncompress(frameSize, header.framenumber))
+			return false;
 
-	auto dataPos = ifs->tellg();
+		// frames stored uncompressed are still taken from the file
+		if (frameData == uncompressedFrame.get())
+			owner = uncompressedFrame;
+	}
 
+	size_t pos = 0;
 	for (uint32_t i = 0; i < header.repCount; i++) {
-		LogRepresentationHeader header;
-		*archive & header;
+		if (pos + LogRepresentationHeader::headerSize > frameSize) {
+			ERROR("Mismatch in de-serialization of frame %d", header.framenumber);
+			break;
+		}
+
+		LogRepresentationHeader repHeader;
+		repHeader.read(frameData + pos);
+		pos += LogRepresentationHeader::headerSize;
 
-		auto it = registry.find(representations[header.id]);
+		if (repHeader.id >= representations.size() || pos + repHeader.size > frameSize) {
+			ERROR("Mismatch in de-serialization of frame %d", header.framenumber);
+			break;
+		}
+
+		// remember where the logged data is to compare it after the modules were executed
+		auto diffIt = diffData.find(repHeader.id);
+		if (diffIt != diffData.end())
+			diffIt->second = std::make_pair(pos, repHeader.size);
+
+		auto it = registry.find(representations[repHeader.id]);
 		if (registry.end() == it) {
-			ERROR("Representation %s not found", representations[header.id].c_str());
+			ERROR("Representation %s not found", representations[repHeader.id].c_str());
 		} else {
-			it->second->getRepresentation().deserialize(*archive);
+			// large binary data (e.g. images) is taken directly from the frame
+			LogInputBuffer buffer(frameData + pos, repHeader.size, owner);
+			LogInputArchive archive(buffer, boost::archive::no_header | boost::archive::no_codecvt);
+			it->second->getRepresentation().deserialize(archive);
+
+			if (buffer.consumed() != repHeader.size) {
+				ERROR("Mismatch in de-serialization of %s. Expected to read %d bytes, but read %d bytes.",
+						representations[repHeader.id].c_str(),
+						repHeader.size,
+						(uint32_t)buffer.consumed());
+			}
 		}
+
+		// continue with the next representation, regardless of what was read
+		pos += repHeader.size;
 	}
 
-	if ( (uint32_t)(ifs->tellg() - dataPos) != header.framesize ) {
-		ERROR("Mismatch in de-serialization. Expected to read %d bytes, but read %d bytes.",
-				header.framesize,
-				(uint32_t)(ifs->tellg() - dataPos));
+	return true;
+}
+
 
-		// correct position
-		ifs->seekg((int)dataPos + header.framesize);
+/*------------------------------------------------------------------------------------------------*/
+
+/** Uncompress the current frame (#frameData) into #uncompressedFrame and
+ ** point #frameData to it.
+ **
+ ** @param frameSize     Size of the compressed frame data, set to the size of the uncompressed data
+ ** @param framenumber   Frame number (for error messages)
+ ** @return false if the frame could not be uncompressed
+ */
+
+bool LogPlayer::uncompress(size_t &frameSize, uint32_t framenumber) {
+	uint32_t uncompressedSize = 0;
+	if (frameSize < sizeof(uncompressedSize)) {
+		ERROR("Frame %d is incomplete", framenumber);
+		return false;
 	}
+	memcpy(&uncompressedSize, frameData, sizeof(uncompressedSize));
+
+	// a frame the writer could not compress is stored as is
+	if (uncompressedSize & LogFileHeader::storedFrameFlag) {
+		uncompressedSize &= ~LogFileHeader::storedFrameFlag;
+		if (frameSize - sizeof(uncompressedSize) != uncompressedSize) {
+			ERROR("Frame %d is incomplete", framenumber);
+			return false;
+		}
+
+		frameData += sizeof(uncompressedSize);
+		frameSize  = uncompressedSize;
+		return true;
+	}
+
+	// the memory of the previous frame can only be reused if nothing refers to it anymore
+	if (nullptr == uncompressedFrame || uncompressedFrame.use_count() > 1 || uncompressedFrameCapacity < uncompressedSize) {
+		uncompressedFrameCapacity = std::max((size_t)uncompressedSize, uncompressedFrameCapacity);
+		uncompressedFrame = std::shared_ptr<char>(new char[uncompressedFrameCapacity], std::default_delete<char[]>());
+	}
+
+	uLongf size = uncompressedSize;
+	int res = ::uncompress((Bytef*)uncompressedFrame.get(), &size,
+	                       (const Bytef*)frameData + sizeof(uncompressedSize), frameSize - sizeof(uncompressedSize));
+	if (res != Z_OK || size != uncompressedSize) {
+		ERROR("Could not uncompress frame %d (zlib error %d)", framenumber, res);
+		return false;
+	}
+
+	frameData = uncompressedFrame.get();
+	frameSize = uncompressedSize;
+	return true;
 }
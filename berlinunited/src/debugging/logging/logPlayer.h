@@ -6,17 +6,20 @@
 #include "ModuleFramework/Serializer.h"
 
 #include "logFileHeader.h"
+#include "logIndex.h"
+#include "logMappedFile.h"
 
 #include "utils/units.h"
 
+#include <memory>
 #include <string>
-#include <fstream>
 
 class LogPlayer
 	: public Thread
 {
 public:
 	LogPlayer();
+	LogPlayer(const std::string &configuration);
 	virtual ~LogPlayer();
 
 	virtual const char* getName() const override {
@@ -27,25 +30,85 @@ public:
 	bool isActive(const std::string &moduleManagerName);
 
 	void start(ModuleManager* moduleManager);
+	void prepare(ModuleManager* moduleManager);
 
 	virtual void threadMain() override;
 
+	/// number of frames in the log file
+	size_t getFrameCount() const {
+		return index.size();
+	}
+
+	bool playFrame(size_t frame);
+	bool playNextFrame();
+	bool playPreviousFrame();
+	bool playFrameNumber(uint32_t framenumber);
+	bool playTime(Millisecond time);
+	void playRange(size_t end);
+
+	/// comparison of a representation computed during replay with the logged one
+	struct ReplayDiff {
+		ReplayDiff()
+			: compared(0)
+			, differing(0)
+			, firstDifferingFrame(0)
+		{}
+
+		uint32_t compared;             ///< number of frames in which it was compared
+		uint32_t differing;            ///< number of frames in which it differed
+		uint32_t firstDifferingFrame;  ///< frame number of the first difference
+	};
+
+	typedef std::map<std::string, ReplayDiff> ReplayDiffs;
+
+	ReplayDiffs replay(const std::vector<std::string> &diffRepresentations);
+	void printReplayReport(const ReplayDiffs &diffs, Microsecond duration);
+
+	/// number of frames played by the last call to replay()
+	uint32_t getReplayedFrames() const {
+		return replayedFrames;
+	}
+
 protected:
 	std::string   logFileName;
 	LogFileHeader header;
 
-	uint32_t currentFrameNumber;
+	/// frame positions in the log file
+	LogIndex index;
+
+	/// index of the frame played last (index.size() if none was played yet)
+	size_t currentFrame;
+
+	/// frames to play (from the 'playrange' option), end is exclusive
+	size_t rangeBegin;
+	size_t rangeEnd;
+
+	uint32_t replayedFrames;
 
 	ModuleManager *moduleManager;
 
 	std::vector<std::string> modules;
 	std::vector<std::string> representations;
 
-	// logging
-	std::ifstream *ifs;
-	DESERIALIZER  *archive;
+	/// the log file, mapped into memory (if possible)
+	std::unique_ptr<LogMappedFile> file;
+
+	/// the current frame as read from the file
+	std::shared_ptr<char> fileFrame;
+
+	/// data of the current frame (points into #fileFrame or #uncompressedFrame)
+	const char* frameData;
+
+	/// data of the current frame if the log file is compressed
+	std::shared_ptr<char> uncompressedFrame;
+	size_t                uncompressedFrameCapacity;
+
+	/// position of the logged representations to compare in #frameData (by representation id)
+	std::map<uint16_t, std::pair<size_t, uint32_t>> diffData;
 
-	void deserialize(const BlackBoard::Registry &registry);
+	bool deserialize(size_t frame, const BlackBoard::Registry &registry);
+	bool uncompress(size_t &frameSize, uint32_t framenumber);
+	std::string readInput(const char* prompt);
 };
 
 
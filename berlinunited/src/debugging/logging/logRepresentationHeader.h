@@ -1,29 +1,32 @@
 #ifndef LOGREPRESENTATIONHEADER_H_
 #define LOGREPRESENTATIONHEADER_H_
 
-#include <boost/serialization/serialization.hpp>
-#include <boost/serialization/version.hpp>
-
 #include <string>
 #include <inttypes.h>
+#include <string.h>
 
-class LogRepresentationHeader {
-private:
-	friend class boost::serialization::access;
-
-	template<class Archive>
-	void serialize(Archive &ar, const unsigned int fileVersion) {
-		ar & id;
-		ar & size;
-	}
+/** \class LogRepresentationHeader
+ ** \brief Header before each representation within a log frame (fixed size).
+ */
 
+class LogRepresentationHeader {
 public:
 	uint16_t    id;        //!< id of serialized representation
 	uint32_t    size;      //!< representation data length (in bytes) without header
-};
 
-BOOST_CLASS_VERSION(LogRepresentationHeader, 1)
-BOOST_CLASS_TRACKING(LogRepresentationHeader, boost::serialization::track_never)
+	/// size of the header in the log file
+	static const size_t headerSize = sizeof(uint16_t) + sizeof(uint32_t);
+
+	void write(char* dst) const {
+		memcpy(dst, &id, sizeof(id)); dst += sizeof(id);
+		memcpy(dst, &size, sizeof(size));
+	}
+
+	void read(const char* src) {
+		memcpy(&id, src, sizeof(id)); src += sizeof(id);
+		memcpy(&size, src, sizeof(size));
+	}
+};
 
 
 #endif /* LOGREPRESENTATIONHEADER_H_ */
@@ -4,6 +4,7 @@
 #include "debugging/logging/logFileHeader.h"
 #include "debugging/logging/logFrameHeader.h"
 #include "debugging/logging/logRepresentationHeader.h"
+#include "debugging/tracer.h"
 
 #include "ModuleFramework/ModuleManager.h"
 
@@ -21,12 +22,17 @@
 
 #include <boost/algorithm/string/join.hpp>
 
+#include <zlib.h>
+
 
 /*------------------------------------------------------------------------------------------------*/
 
 namespace {
 	auto cfgLog      = ConfigRegistry::registerOption<std::string>("log",     "",     "Which modules/representations to log.");
 	auto cfgLogDir   = ConfigRegistry::registerOption<std::string>("logdir",  "log/", "Directory to store log files into");
+	auto cfgLogQueue = ConfigRegistry::registerOption<int>("logqueue",        16,     "Number of frames that may wait to be written to the log file");
+	auto cfgLogBlock = ConfigRegistry::registerOption<bool>("logblock",       false,  "Wait for the log file to be written instead of dropping frames if the queue is full");
+	auto cfgLogZip   = ConfigRegistry::registerOption<int>("logcompression",  0,      "zlib compression level of the log frames (0 = no compression, 1 = fastest, 9 = smallest)");
 }
 
 
@@ -64,18 +70,36 @@ bool LogWriter::isConfigured(const std::string &managerName) {
  **
  ** FILE HEADER
  **     uint32_t size of header
- **     string
+ **     LogFileHeader (boost archive)
  **
  ** FRAME (repeated)
- **     FRAME HEADER
- **         uint64_t timestamp  (in milliseconds) (TODO: which time?)
+ **     FRAME HEADER (LogFrameHeader::headerSize bytes)
+ **         double   timestamp  (in milliseconds) (TODO: which time?)
  **         uint32_t framenumber
  **         uint32_t frame data length (in bytes) without header
+ **         uint16_t number of representations
  **     FRAME DATA
+ **         uint32_t uncompressed length (only if compressed, followed by the zlib stream of the following)
  **         REPRESENTATION (repeated)
- **             representation name
- **             serialized representation
+ **             REPRESENTATION HEADER (LogRepresentationHeader::headerSize bytes)
+ **                 uint16_t representation id (index into LogFileHeader::representationNames)
+ **                 uint32_t data length (in bytes) without header
+ **             serialized representation (boost archive without header)
+ **
+ ** INDEX (see LogIndex)
+ **
+ ** Every representation is serialized into an archive of its own, so frames
+ ** (and representations) can be read independently of each other and a
+ ** dropped frame does not affect the rest of the log.
+ **
+ ** Frames are serialized into an in-memory buffer in the module manager's
+ ** thread and handed to an I/O thread which writes them to the file. If the
+ ** I/O thread can not keep up, the frame is dropped (or, if configured with
+ ** 'logblock', the module manager waits for a buffer to become available).
  **
+ ** With 'logcompression', the I/O thread compresses every frame on its own
+ ** before writing it. The frame header stays uncompressed, so the index
+ ** still allows to read any frame without reading the ones before.
  */
 
 
@@ -86,16 +110,37 @@ bool LogWriter::isConfigured(const std::string &managerName) {
  */
 
 LogWriter::LogWriter(ModuleManager *moduleManager)
+	: LogWriter(moduleManager, cfgLog->get())
+{
+	assert(LogWriter::isConfigured(manager->getName()));
+}
+
+
+/*------------------------------------------------------------------------------------------------*/
+
+/**
+ ** @param moduleManager   Module manager to log
+ ** @param cfg             What to log (same format as the 'log' option)
+ */
+
+LogWriter::LogWriter(ModuleManager *moduleManager, const std::string &cfg)
 	: manager(moduleManager)
 	, ofs(nullptr)
-	, archive(nullptr)
 	, logAll(false)
 	, isHeaderWritten(false)
+	, fileOffset(0)
+	, compressionLevel(std::min(std::max(0, cfgLogZip->get()), 9))
+	, stopping(false)
+	, policy(cfgLogBlock->get() ? BLOCK : DROP_FRAMES)
+	, queueSize(std::max(1, cfgLogQueue->get()))
+	, maxQueueDepth(0)
+	, droppedFrames(0)
+	, writtenFrames(0)
+	, uncompressedBytes(0)
+	, compressedBytes(0)
 {
 	std::string managerName = manager->getName();
-	assert(LogWriter::isConfigured(managerName));
 
-	std::string cfg = cfgLog->get();
 	if ("all" == cfg) {
 		logAll = true;
 		INFO("Logging enabled for manager %s for all representations", managerName.c_str());
@@ -187,8 +232,8 @@ LogWriter::LogWriter(ModuleManager *moduleManager)
  */
 
 LogWriter::~LogWriter() {
-	delete archive;
-	delete ofs;
+	if (ofs)
+		stop();
 }
 
 
@@ -258,44 +303,229 @@ void LogWriter::start(const std::string &directory) {
 void LogWriter::start(const std::string &directory, const std::string &filename) {
 	assert(nullptr != manager);
 	assert(nullptr == ofs);
-	assert(nullptr == archive);
 
 	ofs = new std::ofstream(directory + "/" + filename, std::ios::out | std::ios::binary);
-	archive = new SERIALIZER(*ofs);
 
-	// register the management classes
-	archive->register_type<LogFileHeader>();
-	archive->register_type<LogFrameHeader>();
-	archive->register_type<LogRepresentationHeader>();
+	index.clear();
+	fileOffset = 0;
+	uncompressedBytes = 0;
+	compressedBytes = 0;
+	stopping = false;
+	ioThread.reset(new IOThread(*this));
+	ioThread->run();
 }
 
 
 /*------------------------------------------------------------------------------------------------*/
 
-/*
+/* Writes all pending frames and closes the log file.
 **
 */
 
 void LogWriter::stop() {
-	assert(nullptr != archive);
-	delete archive;
-	archive = nullptr;
-
 	assert(nullptr != ofs);
+
+	{
+		std::unique_lock<std::mutex> lock(queueMutex);
+		stopping = true;
+	}
+	queuedCV.notify_all();
+
+	// the I/O thread writes all queued frames before it quits (cancel before
+	// destroying it, the thread may not even have entered threadMain yet)
+	ioThread->cancel();
+	ioThread.reset();
+
+	index.write(*ofs, fileOffset);
 	ofs->close();
 	delete ofs;
 	ofs = nullptr;
+
+	INFO("LOG: %d frames written, %d frames dropped (max queue depth %d)",
+			(int)writtenFrames, (int)droppedFrames, maxQueueDepth);
+	if (compressionLevel > 0 && uncompressedBytes > 0)
+		INFO("LOG: frames compressed to %d%%", (int)(100 * compressedBytes / uncompressedBytes));
 }
 
 
 /*------------------------------------------------------------------------------------------------*/
 
-/*
-**
-*/
+/** Set what happens when frames are produced faster than they can be written.
+ **
+ ** @param newPolicy      Whether to drop frames or to wait for the I/O thread
+ ** @param newQueueSize   Number of frames that may be waiting to be written
+ */
+
+void LogWriter::setQueuePolicy(QueuePolicy newPolicy, unsigned int newQueueSize) {
+	std::unique_lock<std::mutex> lock(queueMutex);
+	policy    = newPolicy;
+	queueSize = std::max(1u, newQueueSize);
+}
+
+
+/*------------------------------------------------------------------------------------------------*/
+
+/** Set the compression of the frames. Must be called before the first frame
+ ** is serialized.
+ **
+ ** @param level   zlib compression level (0 for no compression)
+ */
+
+void LogWriter::setCompression(int level) {
+	assert(false == isHeaderWritten);
+	compressionLevel = std::min(std::max(0, level), 9);
+}
+
+
+/*------------------------------------------------------------------------------------------------*/
+
+/**
+ ** @return the number of frames currently waiting to be written
+ */
+
+unsigned int LogWriter::getQueueDepth() {
+	std::unique_lock<std::mutex> lock(queueMutex);
+	return queue.size();
+}
+
+
+/*------------------------------------------------------------------------------------------------*/
+
+/** Get an unused buffer from the pool.
+ **
+ ** @param mayDrop   whether the frame may be dropped if the queue is full
+ ** @return buffer to serialize into, nullptr if the frame should be dropped
+ */
+
+LogBuffer* LogWriter::acquireBuffer(bool mayDrop) {
+	std::unique_lock<std::mutex> lock(queueMutex);
+
+	if (freeBuffers.empty() && buffers.size() < queueSize) {
+		buffers.emplace_back(new LogBuffer());
+		freeBuffers.push_back(buffers.back().get());
+	}
+
+	if (freeBuffers.empty()) {
+		if (mayDrop && policy == DROP_FRAMES)
+			return nullptr;
+
+		writtenCV.wait(lock, [this]{ return false == freeBuffers.empty(); });
+	}
+
+	LogBuffer* buffer = freeBuffers.front();
+	freeBuffers.pop_front();
+	buffer->clear();
+	return buffer;
+}
+
+
+/*------------------------------------------------------------------------------------------------*/
+
+/** Main function of the I/O thread, writes the queued frames to the file.
+ */
+
+void LogWriter::ioMain() {
+	while (true) {
+		LogBuffer* buffer = nullptr;
+		{
+			std::unique_lock<std::mutex> lock(queueMutex);
+			queuedCV.wait(lock, [this]{ return stopping || false == queue.empty(); });
+			if (queue.empty())
+				return;
+
+			buffer = queue.front();
+			queue.pop_front();
+		}
+
+		// everything but the file header (which is always written first) is a frame
+		LogBuffer *data = buffer;
+		const bool isFrame = fileOffset > 0;
+		if (isFrame) {
+			LogFrameHeader header;
+			header.read(buffer->data());
+			index.add(header.framenumber, header.timestamp, fileOffset);
+
+			if (compressionLevel > 0) {
+				TRACE_SCOPE("log", "compress");
+				compressFrame(*buffer);
+				data = &compressedFrame;
+			}
+		}
+
+		{
+			TRACE_SCOPE("log", "write");
+			ofs->write(data->data(), data->size());
+			fileOffset += data->size();
+		}
+
+		{
+			std::unique_lock<std::mutex> lock(queueMutex);
+			freeBuffers.push_back(buffer);
+		}
+		writtenCV.notify_one();
+
+		if (isFrame)
+			writtenFrames++;
+	}
+}
+
+
+/*------------------------------------------------------------------------------------------------*/
+
+/** Compress a frame into #compressedFrame (called from the I/O thread). A
+ ** frame that can not be compressed is stored uncompressed, flagged with
+ ** LogFileHeader::storedFrameFlag, so it is never lost.
+ **
+ ** @param frame   Frame (including its header) to compress
+ */
+
+void LogWriter::compressFrame(LogBuffer &frame) {
+	LogFrameHeader header;
+	header.read(frame.data());
+
+	uint32_t uncompressedSize = header.framesize;
+	uLongf   compressedSize   = compressBound(uncompressedSize);
+
+	compressedFrame.clear();
+	size_t headerPos = compressedFrame.reserve(LogFrameHeader::headerSize);
+	size_t sizePos   = compressedFrame.reserve(sizeof(uncompressedSize));
+	size_t dataPos   = compressedFrame.reserve(compressedSize);
+
+	int res = compress2((Bytef*)compressedFrame.at(dataPos), &compressedSize,
+	                    (const Bytef*)frame.data() + LogFrameHeader::headerSize, uncompressedSize,
+	                    compressionLevel);
+
+	uint32_t storedSize = uncompressedSize;
+	if (res != Z_OK) {
+		// can only happen if we run out of memory, store the frame as it is
+		ERROR("LOG: Could not compress frame %d (zlib error %d), storing it uncompressed", header.framenumber, res);
+		storedSize |= LogFileHeader::storedFrameFlag;
+		compressedFrame.truncate(dataPos);
+		compressedFrame.append(frame.data() + LogFrameHeader::headerSize, uncompressedSize);
+	} else {
+		compressedFrame.truncate(dataPos + compressedSize);
+	}
+
+	memcpy(compressedFrame.at(sizePos), &storedSize, sizeof(storedSize));
+	header.framesize = compressedFrame.size() - LogFrameHeader::headerSize;
+	header.write(compressedFrame.at(headerPos));
+
+	uncompressedBytes += uncompressedSize;
+	compressedBytes   += header.framesize;
+}
+
+
+/*------------------------------------------------------------------------------------------------*/
+
+/** Serialize a frame and queue it to be written to the log file.
+ **
+ ** @param framenumber   Frame number of the module manager
+ ** @param registry      Representations of the module manager
+ */
 
 void LogWriter::serialize(int framenumber, const BlackBoard::Registry &registry) {
-	assert(nullptr != archive);
+	assert(nullptr != ofs);
+	TRACE_SCOPE("log", "serialize");
 
 	// write header
 	if (false == isHeaderWritten) {
@@ -303,6 +533,7 @@ void LogWriter::serialize(int framenumber, const BlackBoard::Registry &registry)
 		header.timestamp         = getCurrentTime();
 		header.moduleManagerName = manager->getName();
 		header.moduleNames       = moduleNames;
+		header.compressed        = compressionLevel > 0;
 
 		if (logAll) {
 			for (auto &it : registry)
@@ -315,29 +546,43 @@ void LogWriter::serialize(int framenumber, const BlackBoard::Registry &registry)
 		for (uint16_t i=0; i < header.representationNames.size(); i++)
 			rep2ID[header.representationNames[i]] = i;
 
-		*archive & header;
+		// the header must never be dropped
+		LogBuffer *buffer = acquireBuffer(false);
+		size_t sizePos = buffer->reserve(sizeof(uint32_t));
+		{
+			SERIALIZER archive(*buffer);
+			archive & header;
+		}
+		uint32_t headerSize = buffer->size() - sizeof(uint32_t);
+		memcpy(buffer->at(sizePos), &headerSize, sizeof(headerSize));
+
+		{
+			std::unique_lock<std::mutex> lock(queueMutex);
+			queue.push_back(buffer);
+		}
+		queuedCV.notify_one();
 		isHeaderWritten = true;
 	}
 
-	// remember position of header (we will overwrite the header later)
-	int headerPos = ofs->tellp();
-
-	// write initial header
-	LogFrameHeader frameHeader;
-	frameHeader.timestamp   = getCurrentTime();
-	frameHeader.framenumber = framenumber;
-	frameHeader.framesize   = 0;
-	frameHeader.repCount    = 0;
-	*archive & frameHeader;
+	LogBuffer *buffer = acquireBuffer(true);
+	if (nullptr == buffer) {
+		if (0 == droppedFrames++)
+			WARNING("LOG: Log file can not be written fast enough, dropping frames");
+		return;
+	}
 
-	// remember current position in stream
-	int dataPos = ofs->tellp();
+	// the frame header is filled in once the size of the frame is known
+	size_t headerPos = buffer->reserve(LogFrameHeader::headerSize);
 
 	// serialize representations
 	int representationCount = 0;
 	if (logAll) {
 		for (auto &it : registry) {
-			serialize(it.second->getRepresentation());
+			// representations created after the header was written are not logged
+			if (rep2ID.find(it.first) == rep2ID.end())
+				continue;
+
+			serialize(it.second->getRepresentation(), *buffer);
 			representationCount++;
 		}
 	} else {
@@ -345,48 +590,45 @@ void LogWriter::serialize(int framenumber, const BlackBoard::Registry &registry)
 			if (registry.find(representationName) == registry.end())
 				throw std::runtime_error("Unknown representation " + representationName);
 
-			serialize( registry.find(representationName)->second->getRepresentation() );
+			serialize( registry.find(representationName)->second->getRepresentation(), *buffer );
 			representationCount++;
 		}
 	}
-	int endPos = ofs->tellp();
 
-	// update frame header
-	frameHeader.framesize = endPos - dataPos;
-	frameHeader.repCount = representationCount;
-
-	ofs->seekp(headerPos);
-	*archive & frameHeader;
-	assert(ofs->tellp() == dataPos);
-	ofs->seekp(endPos);
+	LogFrameHeader frameHeader;
+	frameHeader.timestamp   = getCurrentTime();
+	frameHeader.framenumber = framenumber;
+	frameHeader.framesize   = buffer->size() - headerPos - LogFrameHeader::headerSize;
+	frameHeader.repCount    = representationCount;
+	frameHeader.write(buffer->at(headerPos));
+
+	{
+		std::unique_lock<std::mutex> lock(queueMutex);
+		queue.push_back(buffer);
+		maxQueueDepth = std::max(maxQueueDepth, (unsigned int)queue.size());
+	}
+	queuedCV.notify_one();
 }
 
 
 /*------------------------------------------------------------------------------------------------*/
 
-/*
-**
-*/
-
-void LogWriter::serialize(Representation& representation) {
-	LogRepresentationHeader header;
-	header.id   = rep2ID[ representation.getName() ];
-	header.size = 0;
-
-	auto headerPos = ofs->tellp();
-	*archive & header;
-
-	auto dataPos = ofs->tellp();
-	representation.serialize(*archive);
-
-	auto endPos = ofs->tellp();
+/** Serialize a representation (with its header) into the frame buffer.
+ **
+ ** @param representation   Representation to serialize
+ ** @param buffer           Buffer of the frame
+ */
 
-	ofs->seekp(headerPos);
-	header.size = endPos - dataPos;
-	*archive & header;
+void LogWriter::serialize(Representation& representation, LogBuffer &buffer) {
+	size_t headerPos = buffer.reserve(LogRepresentationHeader::headerSize);
 
-	assert(ofs->tellp() == dataPos);
-	ofs->seekp(endPos);
+	{
+		SERIALIZER archive(buffer, boost::archive::no_header | boost::archive::no_codecvt);
+		representation.serialize(archive);
+	}
 
-//	printf("  serialized %s (header %d, data %d)\n", representation.getName().c_str(), (int)headerPos, (int)dataPos);
+	LogRepresentationHeader header;
+	header.id   = rep2ID[ representation.getName() ];
+	header.size = buffer.size() - headerPos - LogRepresentationHeader::headerSize;
+	header.write(buffer.at(headerPos));
 }
@@ -5,14 +5,23 @@
 #include "ModuleFramework/ModuleManager.h"
 #include "ModuleFramework/Serializer.h"
 
+#include "logBuffer.h"
+#include "logIndex.h"
+
 #include <string>
 #include <fstream>
+#include <atomic>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <condition_variable>
 
 class ModuleManager;
 
 class LogWriter {
 public:
 	LogWriter(ModuleManager* moduleManager);
+	LogWriter(ModuleManager* moduleManager, const std::string &configuration);
 	virtual ~LogWriter();
 
 	static bool isConfigured(const std::string &managerName);
@@ -26,14 +35,62 @@ public:
 
 	void serialize(int framenumber, const BlackBoard::Registry &registry);
 
+	/// what to do with a frame if the I/O thread can not keep up
+	enum QueuePolicy {
+		  DROP_FRAMES  ///< drop the frame (the module cycle is never stretched)
+		, BLOCK        ///< wait for the I/O thread (no frame is lost)
+	};
+
+	void setQueuePolicy(QueuePolicy policy, unsigned int queueSize);
+	void setCompression(int level);
+
+	/// number of frames waiting to be written
+	unsigned int getQueueDepth();
+
+	/// maximum number of frames that were waiting to be written at the same time
+	unsigned int getMaxQueueDepth() const {
+		return maxQueueDepth;
+	}
+
+	/// number of frames that were dropped because the queue was full
+	uint32_t getDroppedFrames() const {
+		return droppedFrames;
+	}
+
+	/// number of frames written to the file
+	uint32_t getWrittenFrames() const {
+		return writtenFrames;
+	}
+
 protected:
-	void serialize(Representation& representation);
+	void serialize(Representation& representation, LogBuffer &buffer);
+
+	LogBuffer* acquireBuffer(bool mayDrop);
+	void ioMain();
+	void compressFrame(LogBuffer &frame);
+
+	class IOThread : public Thread {
+	public:
+		IOThread(LogWriter &writer)
+			: writer(writer)
+		{}
+
+		virtual const char* getName() const override {
+			return "LogWriter";
+		}
+
+	protected:
+		LogWriter &writer;
+
+		virtual void threadMain() override {
+			writer.ioMain();
+		}
+	};
 
 	ModuleManager *manager;
 
 	// logging
 	std::ofstream *ofs;
-	SERIALIZER    *archive;
 
 	/// whether to log all representations
 	bool logAll;
@@ -49,6 +106,38 @@ protected:
 
 	/// flag whether the log file header has been written yet
 	bool isHeaderWritten;
+
+	// frames are serialized into buffers taken from the pool and written to
+	// the file by the I/O thread
+	std::unique_ptr<IOThread>               ioThread;
+	std::vector<std::unique_ptr<LogBuffer>> buffers;
+	std::deque<LogBuffer*>                  freeBuffers;
+	std::deque<LogBuffer*>                  queue;
+
+	// position of every written frame in the file (only used by the I/O thread)
+	LogIndex index;
+	uint64_t fileOffset;
+
+	/// zlib compression level of the frames (0 for no compression)
+	int compressionLevel;
+
+	/// frame being compressed (only used by the I/O thread)
+	LogBuffer compressedFrame;
+
+	std::mutex              queueMutex;
+	std::condition_variable queuedCV;
+	std::condition_variable writtenCV;
+	bool                    stopping;
+
+	QueuePolicy  policy;
+	unsigned int queueSize;
+
+	// statistics
+	unsigned int          maxQueueDepth;
+	std::atomic<uint32_t> droppedFrames;
+	std::atomic<uint32_t> writtenFrames;
+	uint64_t              uncompressedBytes;
+	uint64_t              compressedBytes;
 };
 
 
@@ -1,15 +1,202 @@
 #include "services.h"
 #include "stopwatch.h"
+#include "debug.h"
 #include "debugging/debugging.h"
-
-#include "communication/comm.h"
+#include "platform/system/cycle.h"
 
 #include <msg_debugging.pb.h>
 
-#include <sstream>
+#include <algorithm>
+#include <cmath>
 #include <time.h>
 
 
+/*------------------------------------------------------------------------------------------------*/
+
+namespace {
+	/// read the cycle counter (or a monotonic clock in nanoseconds where there is none)
+	inline uint64_t readTicks() {
+#ifdef HAVE_TICK_COUNTER
+		return (uint64_t)getticks();
+#else
+		struct timespec ts;
+		clock_gettime(CLOCK_MONOTONIC, &ts);
+		return (uint64_t)ts.tv_sec * 1000000000ull + ts.tv_nsec;
+#endif
+	}
+
+	/// histogram bucket of a value, 8 buckets per power of two
+	inline uint32_t getBucket(uint64_t value) {
+		if (value < 8)
+			return value;
+
+		uint32_t exponent = 63 - __builtin_clzll(value);
+		uint32_t bucket   = (exponent - 2) * 8 + ((value >> (exponent - 3)) & 7);
+		return std::min(bucket, Stopwatch::bucketCount - 1);
+	}
+
+	/// smallest value of a bucket
+	inline double getBucketStart(uint32_t bucket) {
+		if (bucket < 8)
+			return bucket;
+
+		uint32_t exponent = bucket / 8 + 2;
+		return std::ldexp(8 + bucket % 8, exponent - 3);
+	}
+
+	/// range of values of a bucket
+	inline double getBucketWidth(uint32_t bucket) {
+		if (bucket < 8)
+			return 1;
+
+		return std::ldexp(1, bucket / 8 - 1);
+	}
+
+	/// estimate a percentile (0..1) from a histogram, returns the middle of the bucket
+	double getPercentile(const std::vector<uint64_t> &histogram, double percentile) {
+		uint64_t count = 0;
+		for (uint64_t n : histogram)
+			count += n;
+
+		if (count == 0)
+			return 0;
+
+		uint64_t rank = std::max<uint64_t>(1, (uint64_t)std::ceil(percentile * count));
+		uint64_t seen = 0;
+		for (uint32_t bucket = 0; bucket < histogram.size(); bucket++) {
+			seen += histogram[bucket];
+			if (seen >= rank)
+				return getBucketStart(bucket) + getBucketWidth(bucket) / 2;
+		}
+
+		return 0;
+	}
+
+	/// counters are only written by a single thread, so no atomic increment is needed
+	template<typename T>
+	inline void increase(std::atomic<T> &counter, T by = 1) {
+		counter.store(counter.load(std::memory_order_relaxed) + by, std::memory_order_relaxed);
+	}
+
+	inline std::string getKey(const std::string& option, const std::string& stopWatchName) {
+		return option + '\n' + stopWatchName;
+	}
+}
+
+
+/*------------------------------------------------------------------------------------------------*/
+
+/** Registers the current thread with the Stopwatch on its first measurement,
+ ** and hands its measurements over when the thread ends.
+ */
+
+class StopwatchThreadRegistration {
+public:
+	StopwatchThreadRegistration()
+		: buffer(Stopwatch::getInstance().attachThread())
+	{}
+
+	~StopwatchThreadRegistration() {
+		Stopwatch::getInstance().detachThread(buffer);
+	}
+
+	Stopwatch::ThreadBuffer *buffer;
+};
+
+
+/*------------------------------------------------------------------------------------------------*/
+
+Stopwatch::Accumulator::Accumulator()
+	: startTicks(0)
+	, lastStartTicks(0)
+	, count(0)
+	, sum(0)
+	, minimum(0)
+	, maximum(0)
+	, last(0)
+	, lastStopTicks(0)
+	, discarded(0)
+{
+	for (uint32_t i = 0; i < bucketCount; i++) {
+		durations[i].store(0, std::memory_order_relaxed);
+		periods[i].store(0, std::memory_order_relaxed);
+	}
+}
+
+
+/*------------------------------------------------------------------------------------------------*/
+
+Stopwatch::ThreadBuffer::ThreadBuffer() {
+	for (uint32_t i = 0; i < maxStopwatches; i++)
+		accumulators[i].store(nullptr, std::memory_order_relaxed);
+}
+
+
+/*------------------------------------------------------------------------------------------------*/
+
+Stopwatch::Totals::Totals()
+	: count(0)
+	, sum(0)
+	, minimum(0)
+	, maximum(0)
+	, last(0)
+	, lastStopTicks(0)
+	, discarded(0)
+	, durations(bucketCount, 0)
+	, periods(bucketCount, 0)
+{
+}
+
+
+/*------------------------------------------------------------------------------------------------*/
+
+/** Add the (current) measurements of a thread.
+ */
+
+void Stopwatch::Totals::add(const Accumulator &accumulator) {
+	Totals other;
+	other.count         = accumulator.count.load(std::memory_order_relaxed);
+	other.sum           = accumulator.sum.load(std::memory_order_relaxed);
+	other.minimum       = accumulator.minimum.load(std::memory_order_relaxed);
+	other.maximum       = accumulator.maximum.load(std::memory_order_relaxed);
+	other.last          = accumulator.last.load(std::memory_order_relaxed);
+	other.lastStopTicks = accumulator.lastStopTicks.load(std::memory_order_relaxed);
+	other.discarded     = accumulator.discarded.load(std::memory_order_relaxed);
+	for (uint32_t i = 0; i < bucketCount; i++) {
+		other.durations[i] = accumulator.durations[i].load(std::memory_order_relaxed);
+		other.periods[i]   = accumulator.periods[i].load(std::memory_order_relaxed);
+	}
+
+	add(other);
+}
+
+
+/*------------------------------------------------------------------------------------------------*/
+
+/** Add the measurements of another thread.
+ */
+
+void Stopwatch::Totals::add(const Totals &other) {
+	discarded += other.discarded;
+
+	if (other.count > 0) {
+		minimum = (count == 0) ? other.minimum : std::min(minimum, other.minimum);
+		maximum = std::max(maximum, other.maximum);
+		count  += other.count;
+		sum    += other.sum;
+
+		if (other.lastStopTicks >= lastStopTicks) {
+			last          = other.last;
+			lastStopTicks = other.lastStopTicks;
+		}
+	}
+
+	for (uint32_t i = 0; i < bucketCount; i++) {
+		durations[i] += other.durations[i];
+		periods[i]   += other.periods[i];
+	}
+}
+
 
 /*------------------------------------------------------------------------------------------------*/
 
@@ -17,7 +204,13 @@
  */
 
 Stopwatch::Stopwatch()
-	: options()
+	: infos()
+	, handles()
+	, optionHandles()
+	, threadBuffers()
+	, retired()
+	, referenceTicks(readTicks())
+	, referenceTime(getCurrentMicroTime())
 {
 	cs.setName("Stopwatch");
 }
@@ -29,44 +222,103 @@ Stopwatch::Stopwatch()
  */
 
 Stopwatch::~Stopwatch() {
+	for (ThreadBuffer *buffer : threadBuffers) {
+		for (uint32_t handle = 0; handle < maxStopwatches; handle++)
+			delete buffer->accumulators[handle].load();
+		delete buffer;
+	}
 }
 
 
 /*------------------------------------------------------------------------------------------------*/
 
-/** Start a stopwatch.
+/** Register a stopwatch (or look up an already registered one).
  **
- ** This call requires a search for the stopwatch data, i.e. involves comparatively high overhead.
+ ** This call requires a search for the stopwatch data, i.e. involves comparatively high overhead,
+ ** so the handle should be kept and used for start() and stop().
  **
  ** @param option           Name of debug option this stopwatch belongs to
  ** @param stopWatchName    Name of stopwatch
+ **
+ ** @return handle of the stopwatch, INVALID_STOPWATCH if too many stopwatches exist
  */
 
-void Stopwatch::notifyStart(const std::string& option, const std::string& stopWatchName) {
-	notifyStart(getStopwatchReference(option, stopWatchName), option, stopWatchName);
+StopwatchHandle Stopwatch::registerStopwatch(const std::string& option, const std::string& stopWatchName) {
+	CriticalSectionLock lock(cs);
+
+	const std::string key = getKey(option, stopWatchName);
+	std::unordered_map<std::string, StopwatchHandle>::const_iterator it = handles.find(key);
+	if (it != handles.end())
+		return it->second;
+
+	if (infos.size() >= maxStopwatches) {
+		ERROR("Too many stopwatches, ignoring %s of %s", stopWatchName.c_str(), option.c_str());
+		return INVALID_STOPWATCH;
+	}
+
+	StopwatchHandle handle = infos.size();
+	infos.push_back(Info { option, stopWatchName });
+	handles[key] = handle;
+	optionHandles[option].push_back(handle);
+	return handle;
 }
 
 
 /*------------------------------------------------------------------------------------------------*/
 
-/** Stop the stopwatch.
+/** Start a stopwatch. Does not lock, the measurements are stored for the calling thread.
  **
- ** This call requires a search for the stopwatch data, i.e. involves comparatively high overhead.
+ ** @param handle   Handle of the stopwatch
+ */
+
+void Stopwatch::start(StopwatchHandle handle) {
+	if (handle >= maxStopwatches)
+		return;
+
+	Accumulator &accumulator = getAccumulator(handle);
+	uint64_t now = readTicks();
+
+	if (accumulator.lastStartTicks != 0)
+		increase(accumulator.periods[getBucket(now - accumulator.lastStartTicks)]);
+
+	accumulator.lastStartTicks = now;
+	accumulator.startTicks     = now;
+}
+
+
+/*------------------------------------------------------------------------------------------------*/
+
+/** Stop a stopwatch and record the time since it was started (by the calling thread).
+ ** A stop without a start in the calling thread is counted as discarded.
  **
- ** @param option           Name of debug option this stopwatch belongs to
- ** @param stopWatchName    Name of stopwatch
+ ** @param handle   Handle of the stopwatch
  */
 
-void Stopwatch::notifyStop(const std::string& option, const std::string& stopWatchName) {
-	StopWatchOptions::iterator option_it = options.find(option);
-	if (option_it == options.end())
+void Stopwatch::stop(StopwatchHandle handle) {
+	uint64_t now = readTicks();
+
+	if (handle >= maxStopwatches)
 		return;
 
-	StopwatchItems::iterator sw_it = (*option_it).second.find(stopWatchName);
-	if (sw_it == (*option_it).second.end()) // could happen if option got enabled just now
+	Accumulator &accumulator = getAccumulator(handle);
+	if (accumulator.startTicks == 0) { // started by another thread, or the option got enabled just now
+		increase(accumulator.discarded);
 		return;
+	}
+
+	uint64_t duration = now - accumulator.startTicks;
+	accumulator.startTicks = 0;
 
-	notifyStop((*sw_it).second, option, stopWatchName);
+	if (accumulator.count.load(std::memory_order_relaxed) == 0 || duration < accumulator.minimum.load(std::memory_order_relaxed))
+		accumulator.minimum.store(duration, std::memory_order_relaxed);
+	if (duration > accumulator.maximum.load(std::memory_order_relaxed))
+		accumulator.maximum.store(duration, std::memory_order_relaxed);
+
+	increase(accumulator.sum, duration);
+	increase(accumulator.durations[getBucket(duration)]);
+	accumulator.last.store(duration, std::memory_order_relaxed);
+	accumulator.lastStopTicks.store(now, std::memory_order_relaxed);
+	increase(accumulator.count);
 }
 
 
@@ -74,93 +326,112 @@ void Stopwatch::notifyStop(const std::string& option, const std::string& stopWat
 
 /** Start a stopwatch.
  **
- ** It is checked that option and stopWatchName belong to the stopwatchItem. If not, the call
- ** does not use stopwatchItem, however this will cause additional overhead to locate the correct
- ** stopwatchItem.
+ ** This call requires a search for the stopwatch data, i.e. involves comparatively high overhead.
  **
- ** @param stopwatchItem    Reference to a stopwatch, previously aquired with getStopwatchReference
  ** @param option           Name of debug option this stopwatch belongs to
  ** @param stopWatchName    Name of stopwatch
  */
 
-void Stopwatch::notifyStart(StopwatchItem& stopwatchItem, const std::string& option, const std::string& stopWatchName) {
-	if (stopwatchItem.option != option || stopwatchItem.name != stopWatchName) {
-		notifyStart(option, stopWatchName);
-		return;
-	}
-
-	stopwatchItem.isValid = false;
-	stopwatchItem.start   = getCurrentMicroTime();
-	stopwatchItem.stop    = stopwatchItem.start;
+void Stopwatch::notifyStart(const std::string& option, const std::string& stopWatchName) {
+	start(registerStopwatch(option, stopWatchName));
 }
 
 
 /*------------------------------------------------------------------------------------------------*/
 
-/** Stop a stopwatch.
+/** Stop the stopwatch.
  **
- ** It is checked that option and stopWatchName belong to the stopwatchItem. If not, the call
- ** does not use stopwatchItem, however this will cause additional overhead to locate the correct
- ** stopwatchItem.
+ ** This call requires a search for the stopwatch data, i.e. involves comparatively high overhead.
  **
- ** @param stopwatchItem    Reference to a stopwatch, previously aquired with getStopwatchReference
  ** @param option           Name of debug option this stopwatch belongs to
  ** @param stopWatchName    Name of stopwatch
  */
 
-void Stopwatch::notifyStop(StopwatchItem& stopwatchItem, const std::string& option, const std::string& stopWatchName) {
-	if (stopwatchItem.option != option || stopwatchItem.name != stopWatchName) {
-		notifyStop(option, stopWatchName);
-		return;
+void Stopwatch::notifyStop(const std::string& option, const std::string& stopWatchName) {
+	StopwatchHandle handle = INVALID_STOPWATCH;
+	{
+		CriticalSectionLock lock(cs);
+		std::unordered_map<std::string, StopwatchHandle>::const_iterator it = handles.find(getKey(option, stopWatchName));
+		if (it == handles.end())
+			return;
+		handle = it->second;
 	}
 
-	stopwatchItem.stop    = getCurrentMicroTime();
-	stopwatchItem.isValid = true;
+	stop(handle);
+}
+
+
+/*------------------------------------------------------------------------------------------------*/
+
+/** Retrieve all stopwatches of a debug option (e.g. to print a summary).
+ **
+ ** @param option   Name of debug option
+ **
+ ** @return statistics of the stopwatches (by name)
+ */
 
-	// update the statistics of the item
-	stopwatchItem.n++;
-	Millisecond value = Millisecond(stopwatchItem.stop - stopwatchItem.start);
+Stopwatch::StopwatchItems Stopwatch::getStopwatches(const std::string& option) {
+	// may wait for the calibration, so not while holding the lock
+	const double nanosecondsPerTick = getNanosecondsPerTick();
 
-	stopwatchItem.min = std::min(stopwatchItem.min, value);
-	stopwatchItem.max = std::max(stopwatchItem.max, value);
+	CriticalSectionLock lock(cs);
+
+	StopwatchItems items;
+	std::unordered_map<std::string, std::vector<StopwatchHandle>>::const_iterator it = optionHandles.find(option);
+	if (it == optionHandles.end())
+		return items;
 
-	// update the mean iteratively
-	// c(n) = c(n-1) + (x_n - c(n-1))/n
-	stopwatchItem.mean += (value - stopwatchItem.mean) / (double)stopwatchItem.n;
+	for (StopwatchHandle handle : it->second)
+		items[infos[handle].name] = createItem(handle, getTotals(handle), nanosecondsPerTick);
 
-	stopwatchItem.lastValue = value;
+	return items;
 }
 
 
 /*------------------------------------------------------------------------------------------------*/
 
-/** Retrieve a stopwatch by name.
+/** Retrieve the statistics of a stopwatch, combined over all threads.
  **
- ** @param option           Name of debug option this stopwatch belongs to
- ** @param stopWatchName    Name of stopwatch
+ ** @param handle   Handle of the stopwatch
  **
- ** @return stop watch reference. Not intended for direct use but as a parameter to start/stop.
+ ** @return statistics of the stopwatch
  */
 
-StopwatchItem& Stopwatch::getStopwatchReference(const std::string& option, const std::string& stopWatchName) {
+StopwatchItem Stopwatch::getStopwatch(StopwatchHandle handle) {
+	// may wait for the calibration, so not while holding the lock
+	const double nanosecondsPerTick = getNanosecondsPerTick();
+
 	CriticalSectionLock lock(cs);
 
-	StopWatchOptions::iterator option_it = options.find(option);
-	if (option_it == options.end()) {
-		options[option] = StopwatchItems();
-		option_it = options.find(option);
-	}
+	if (handle >= infos.size())
+		return StopwatchItem();
+
+	return createItem(handle, getTotals(handle), nanosecondsPerTick);
+}
+
 
-	StopwatchItems::iterator sw_it = (*option_it).second.find(stopWatchName);
-	if (sw_it == (*option_it).second.end()) {
-		(*option_it).second[stopWatchName] = StopwatchItem();
-		sw_it = (*option_it).second.find(stopWatchName);
+/*------------------------------------------------------------------------------------------------*/
 
-		(*sw_it).second.option = option;
-		(*sw_it).second.name   = stopWatchName;
+/** Combine the measurements of a stopwatch of all threads. The lock must be held.
+ **
+ ** @param handle   Handle of the stopwatch
+ **
+ ** @return measurements of the stopwatch
+ */
+
+Stopwatch::Totals Stopwatch::getTotals(StopwatchHandle handle) {
+	Totals totals;
+	std::unordered_map<StopwatchHandle, Totals>::const_iterator it = retired.find(handle);
+	if (it != retired.end())
+		totals.add(it->second);
+
+	for (ThreadBuffer *buffer : threadBuffers) {
+		Accumulator *accumulator = buffer->accumulators[handle].load(std::memory_order_acquire);
+		if (accumulator)
+			totals.add(*accumulator);
 	}
 
-	return (*sw_it).second;
+	return totals;
 }
 
 
@@ -172,8 +443,10 @@ StopwatchItem& Stopwatch::getStopwatchReference(const std::string& option, const
  */
 
 void Stopwatch::send(const std::string& option) {
+	StopwatchItems items = getStopwatches(option);
+
 	// only handle existing options
-	if (options.find(option) == options.end())
+	if (items.empty())
 		return;
 
 	// create option containter
@@ -186,10 +459,10 @@ void Stopwatch::send(const std::string& option) {
 	sw.set_option(option);
 
 	// send all valid stopwatches
-	for (StopwatchItems::const_iterator iter = options[option].begin();
-	     iter != options[option].end();
-	     ++iter)
-	{
+	for (StopwatchItems::const_iterator iter = items.begin(); iter != items.end(); ++iter) {
+		if (iter->second.n == 0)
+			continue;
+
 		de::fumanoids::message::Debugging::OptionStopwatch::StopwatchValues &val = *sw.add_values();
 
 		val.set_name(iter->second.name);
@@ -197,7 +470,154 @@ void Stopwatch::send(const std::string& option) {
 		val.set_minimum(Millisecond(iter->second.min).value());
 		val.set_maximum(Millisecond(iter->second.max).value());
 		val.set_mean(Millisecond(iter->second.mean).value());
+		val.set_percentile50(Millisecond(iter->second.percentile50).value());
+		val.set_percentile95(Millisecond(iter->second.percentile95).value());
+		val.set_percentile99(Millisecond(iter->second.percentile99).value());
+		val.set_jitter(Millisecond(iter->second.jitter).value());
 	}
 
-	services.getComm().broadcastMessage(msg);
+	Debugging::getInstance().sendMessage(Debugging::getInstance().getDebugOption(option), "", msg);
+}
+
+
+/*------------------------------------------------------------------------------------------------*/
+
+/** Get the time a histogram bucket starts at.
+ **
+ ** @param bucket               Index of the bucket
+ ** @param nanosecondsPerTick   Duration of a tick
+ **
+ ** @return smallest time that is counted in the bucket
+ */
+
+Millisecond Stopwatch::getBucketTime(uint32_t bucket, double nanosecondsPerTick) {
+	return getBucketStart(bucket) * nanosecondsPerTick / 1e6 * milliseconds;
+}
+
+
+/*------------------------------------------------------------------------------------------------*/
+
+/** Get the accumulator of the calling thread for a stopwatch, creates it if needed.
+ **
+ ** @param handle   Handle of the stopwatch
+ **
+ ** @return accumulator (only to be modified by the calling thread)
+ */
+
+Stopwatch::Accumulator& Stopwatch::getAccumulator(StopwatchHandle handle) {
+	static thread_local StopwatchThreadRegistration registration;
+
+	Accumulator *accumulator = registration.buffer->accumulators[handle].load(std::memory_order_relaxed);
+	if (nullptr == accumulator) {
+		accumulator = new Accumulator();
+		registration.buffer->accumulators[handle].store(accumulator, std::memory_order_release);
+	}
+
+	return *accumulator;
+}
+
+
+/*------------------------------------------------------------------------------------------------*/
+
+/** Create the buffer of a new thread.
+ */
+
+Stopwatch::ThreadBuffer* Stopwatch::attachThread() {
+	CriticalSectionLock lock(cs);
+
+	ThreadBuffer *buffer = new ThreadBuffer();
+	threadBuffers.push_back(buffer);
+	return buffer;
+}
+
+
+/*------------------------------------------------------------------------------------------------*/
+
+/** Keep the measurements of a thread that ends, and free its buffer.
+ */
+
+void Stopwatch::detachThread(ThreadBuffer *buffer) {
+	CriticalSectionLock lock(cs);
+
+	threadBuffers.erase(std::remove(threadBuffers.begin(), threadBuffers.end(), buffer), threadBuffers.end());
+
+	for (uint32_t handle = 0; handle < maxStopwatches; handle++) {
+		Accumulator *accumulator = buffer->accumulators[handle].load();
+		if (accumulator) {
+			retired[handle].add(*accumulator);
+			delete accumulator;
+		}
+	}
+
+	delete buffer;
+}
+
+
+/*------------------------------------------------------------------------------------------------*/
+
+/** Determine the duration of a tick, by comparing the tick counter with the
+ ** clock since the construction (at least 10ms are used for that). Only reads
+ ** the reference points, which never change, so the lock is not needed.
+ **
+ ** @return nanoseconds per tick
+ */
+
+double Stopwatch::getNanosecondsPerTick() {
+#ifdef HAVE_TICK_COUNTER
+	Millisecond elapsed = Millisecond(getCurrentMicroTime() - referenceTime);
+	if (elapsed < 10*milliseconds) {
+		delay(10*milliseconds - elapsed);
+		elapsed = Millisecond(getCurrentMicroTime() - referenceTime);
+	}
+
+	uint64_t ticks = readTicks() - referenceTicks;
+	if (ticks == 0)
+		return 1.;
+
+	return elapsed.value() * 1e6 / ticks;
+#else
+	return 1.;
+#endif
+}
+
+
+/*------------------------------------------------------------------------------------------------*/
+
+/** Convert the combined measurements into statistics.
+ */
+
+StopwatchItem Stopwatch::createItem(StopwatchHandle handle, const Totals &totals, double nanosecondsPerTick) {
+	StopwatchItem item;
+	item.option    = infos[handle].option;
+	item.name      = infos[handle].name;
+	item.n         = totals.count;
+	item.discarded = totals.discarded;
+
+	item.durations.assign(totals.durations.begin(), totals.durations.end());
+	item.periods.assign(totals.periods.begin(), totals.periods.end());
+
+	if (totals.count == 0)
+		return item;
+
+	const double msPerTick = nanosecondsPerTick / 1e6;
+
+	item.mean      = (double)totals.sum / totals.count * msPerTick * milliseconds;
+	item.min       = totals.minimum * msPerTick * milliseconds;
+	item.max       = totals.maximum * msPerTick * milliseconds;
+	item.lastValue = totals.last * msPerTick * milliseconds;
+
+	// percentiles from the histogram, but within the measured range
+	auto percentile = [&](double p) {
+		double ticks = getPercentile(totals.durations, p);
+		ticks = std::max((double)totals.minimum, std::min((double)totals.maximum, ticks));
+		return Millisecond(ticks * msPerTick * milliseconds);
+	};
+
+	item.percentile50 = percentile(0.50);
+	item.percentile95 = percentile(0.95);
+	item.percentile99 = percentile(0.99);
+
+	item.jitter = (getPercentile(totals.periods, 0.99) - getPercentile(totals.periods, 0.50)) * msPerTick * milliseconds;
+
+	return item;
 }
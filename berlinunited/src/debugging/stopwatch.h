@@ -1,4 +1,4 @@
-/* 
+/*
  * File:   Stopwatch.h
  * Author: thomas
  *
@@ -10,24 +10,40 @@
 
 #include <string>
 #include <map>
+#include <unordered_map>
+#include <vector>
+#include <atomic>
 
 #include <platform/system/timer.h>
 #include <platform/system/thread.h>
 #include <utils/patterns/singleton.h>
 
+
+/// handle of a registered stopwatch
+typedef uint32_t StopwatchHandle;
+
+#define INVALID_STOPWATCH ((StopwatchHandle)-1)
+
+
+/** Statistics of a stopwatch (a snapshot, combined over all threads that used it).
+ */
 class StopwatchItem {
 public:
 	StopwatchItem()
 		: option()
 		, name()
-		, start(0)
-		, stop(0)
-		, isValid(false)
-		, mean(0*milliseconds)
 		, n(0.0f)
-		, min(Millisecond(10*seconds)) // start with 10 s :)
+		, discarded(0)
+		, mean(0*milliseconds)
+		, min(0*milliseconds)
 		, max(0*milliseconds)
-		, lastValue(0)
+		, lastValue(0*milliseconds)
+		, percentile50(0*milliseconds)
+		, percentile95(0*milliseconds)
+		, percentile99(0*milliseconds)
+		, jitter(0*milliseconds)
+		, durations()
+		, periods()
 	{}
 
 	/** name of debug option */
@@ -36,21 +52,15 @@ public:
 	/** name of the stopwatch */
 	std::string name;
 
-	/** starting time in micro-seconds */
-	Microsecond start;
-
-	/** stopping time in micro-seconds */
-	Microsecond stop;
+	/** count */
+	float n;
 
-	/** true if the data (stop - start) is valid */
-	bool isValid;
+	/** number of stops without a start in the same thread, they are not measured */
+	uint64_t discarded;
 
 	// some statistics
 	/** the mean time */
 	Millisecond mean;
-	/** count */
-	float n;
-
 	/** the minimum time */
 	Millisecond min;
 	/** the maximum time */
@@ -58,8 +68,36 @@ public:
 
 	/** The last valid value */
 	Millisecond lastValue;
+
+	/** percentiles of the measured times */
+	Millisecond percentile50;
+	Millisecond percentile95;
+	Millisecond percentile99;
+
+	/** spread of the time between two starts (99th minus 50th percentile) */
+	Millisecond jitter;
+
+	/** histograms of the measured times and of the times between two starts,
+	 ** see Stopwatch::getBucketTime() */
+	std::vector<uint32_t> durations;
+	std::vector<uint32_t> periods;
 };
 
+
+/**
+ ** The Stopwatch measures how long code sections take.
+ **
+ ** Stopwatches are registered once and then referred to by their handle.
+ ** Timestamps are taken from the CPU's cycle counter (see cycle.h) where
+ ** available. Every thread accumulates its measurements in its own buffers
+ ** (without any locking), the statistics are combined when they are read.
+ ** Hence a stopwatch has to be stopped by the thread that started it, a stop
+ ** in another thread (or without any start) is only counted as discarded.
+ ** Besides mean, minimum and maximum, the durations and the times between two
+ ** starts are collected in logarithmic histograms (about 10% resolution) to
+ ** report percentiles and jitter.
+ */
+
 class Stopwatch : public Singleton<Stopwatch> {
 protected:
 	friend class Singleton<Stopwatch>;
@@ -70,31 +108,110 @@ public:
 
 	const char* getName() const { return "StopWatch"; }
 
-	// @Deprecated and shouldn't be used since access using this method is very slow
-	void notifyStart(const std::string& option, const std::string& stopWatchName);
+	/// maximum number of stopwatches
+	static const uint32_t maxStopwatches = 1024;
 
-	// @Deprecated and shouldn't be used since access using this method is very slow
-	void notifyStop(const std::string& option, const std::string& stopWatchName);
+	/// number of histogram buckets
+	static const uint32_t bucketCount = 8 * 40;
 
-	/** */
-	void notifyStart(StopwatchItem& stopwatchItem, const std::string& option, const std::string& stopWatchName);
+	StopwatchHandle registerStopwatch(const std::string& option, const std::string& stopWatchName);
 
-	/** */
-	void notifyStop(StopwatchItem& stopwatchItem, const std::string& option, const std::string& stopWatchName);
+	void start(StopwatchHandle handle);
+	void stop(StopwatchHandle handle);
 
-	/** */
-	StopwatchItem& getStopwatchReference(const std::string& option, const std::string& stopWatchName);
+	// @Deprecated and shouldn't be used since access using this method is slow
+	void notifyStart(const std::string& option, const std::string& stopWatchName);
+
+	// @Deprecated and shouldn't be used since access using this method is slow
+	void notifyStop(const std::string& option, const std::string& stopWatchName);
 
 	/** send out valid stopwatches for the option */
 	void send(const std::string& option);
 
+	typedef std::map<std::string, StopwatchItem>  StopwatchItems;
+
+	/** get the statistics of all stopwatches belonging to the option */
+	StopwatchItems getStopwatches(const std::string& option);
+
+	/** get the statistics of a stopwatch */
+	StopwatchItem getStopwatch(StopwatchHandle handle);
+
+	static Millisecond getBucketTime(uint32_t bucket, double nanosecondsPerTick);
+
+	/// measurements of a stopwatch by one thread
+	struct Accumulator {
+		Accumulator();
+
+		// only used by the owning thread
+		uint64_t startTicks;
+		uint64_t lastStartTicks;
+
+		// written by the owning thread only, read by everyone
+		std::atomic<uint64_t> count;
+		std::atomic<uint64_t> sum;
+		std::atomic<uint64_t> minimum;
+		std::atomic<uint64_t> maximum;
+		std::atomic<uint64_t> last;
+		std::atomic<uint64_t> lastStopTicks;
+		std::atomic<uint64_t> discarded;
+		std::atomic<uint32_t> durations[bucketCount];
+		std::atomic<uint32_t> periods[bucketCount];
+	};
+
+	/// accumulators of one thread, by handle
+	struct ThreadBuffer {
+		ThreadBuffer();
+
+		std::atomic<Accumulator*> accumulators[maxStopwatches];
+	};
+
 private:
 	CriticalSection cs;
 
-	typedef std::map<std::string, StopwatchItem>  StopwatchItems;
-	typedef std::map<std::string, StopwatchItems> StopWatchOptions;
-
-	StopWatchOptions options;
+	struct Info {
+		std::string option;
+		std::string name;
+	};
+
+	/// measurements of threads that have finished (in ticks)
+	struct Totals {
+		Totals();
+
+		uint64_t count;
+		uint64_t sum;
+		uint64_t minimum;
+		uint64_t maximum;
+		uint64_t last;
+		uint64_t lastStopTicks;
+		uint64_t discarded;
+		std::vector<uint64_t> durations;
+		std::vector<uint64_t> periods;
+
+		void add(const Accumulator &accumulator);
+		void add(const Totals &other);
+	};
+
+	/// registered stopwatches
+	std::vector<Info>                                          infos;
+	std::unordered_map<std::string, StopwatchHandle>           handles;
+	std::unordered_map<std::string, std::vector<StopwatchHandle>> optionHandles;
+
+	std::vector<ThreadBuffer*>                   threadBuffers;
+	std::unordered_map<StopwatchHandle, Totals> retired;
+
+	/// reference points to convert ticks into time
+	uint64_t    referenceTicks;
+	Microsecond referenceTime;
+
+	Accumulator& getAccumulator(StopwatchHandle handle);
+	Totals       getTotals(StopwatchHandle handle);
+
+	friend class StopwatchThreadRegistration;
+	ThreadBuffer* attachThread();
+	void          detachThread(ThreadBuffer *buffer);
+
+	double getNanosecondsPerTick();
+	StopwatchItem createItem(StopwatchHandle handle, const Totals &totals, double nanosecondsPerTick);
 };
 
 #endif  /* _STOPWATCH_H */
@@ -0,0 +1,316 @@
+#include "tracer.h"
+
+#include "debug.h"
+#include "management/config/config.h"
+
+#include <algorithm>
+#include <fstream>
+
+#include <stdio.h>
+#include <unistd.h>
+
+
+/*------------------------------------------------------------------------------------------------*/
+
+namespace {
+	auto cfgEnabled = ConfigRegistry::registerOption<bool>       ("debugging.trace.enabled", false,        "Record what the threads do (module execution, event callbacks, log file I/O) for a timeline view");
+	auto cfgEvents  = ConfigRegistry::registerOption<int>        ("debugging.trace.events",  16384,        "Number of trace events kept per thread");
+	auto cfgFile    = ConfigRegistry::registerOption<std::string>("debugging.trace.file",    "trace.json", "File the trace is written to on termination (Chrome trace format, open with chrome://tracing or ui.perfetto.dev)");
+
+	/// write a string as a JSON string
+	void writeJSONString(std::ostream &os, const char *text) {
+		os << '"';
+		for (const char *c = text; *c; c++) {
+			if (*c == '"' || *c == '\\')
+				os << '\\' << *c;
+			else if ((unsigned char)*c < 0x20) {
+				char escaped[8];
+				snprintf(escaped, sizeof(escaped), "\\u%04x", *c);
+				os << escaped;
+			} else
+				os << *c;
+		}
+		os << '"';
+	}
+}
+
+
+/*------------------------------------------------------------------------------------------------*/
+
+/** Creates the ring buffer of a thread when it records its first event, and
+ ** hands it back to the tracer when the thread ends.
+ */
+
+class TracerThreadRegistration {
+public:
+	TracerThreadRegistration()
+		: buffer(Tracer::getInstance().attachThread())
+	{}
+
+	~TracerThreadRegistration() {
+		Tracer::getInstance().detachThread(buffer);
+	}
+
+	Tracer::ThreadBuffer *buffer;
+};
+
+
+/*------------------------------------------------------------------------------------------------*/
+
+/**
+ ** Constructor
+ */
+
+Tracer::Tracer()
+	: enabled(false)
+	, bufferSize(16384)
+	, threadBuffers()
+	, nextThreadId(1)
+	, names()
+{
+	cs.setName("Tracer");
+}
+
+
+/*------------------------------------------------------------------------------------------------*/
+
+/**
+ ** Destructor
+ */
+
+Tracer::~Tracer() {
+	for (ThreadBuffer *buffer : threadBuffers)
+		delete buffer;
+}
+
+
+/*------------------------------------------------------------------------------------------------*/
+
+/**
+ ** Apply the configuration.
+ */
+
+void Tracer::init() {
+	setBufferSize(std::max(1, cfgEvents->get()));
+	setEnabled(cfgEnabled->get());
+}
+
+
+/*------------------------------------------------------------------------------------------------*/
+
+/**
+ ** Stop recording and write the trace to the configured file (if tracing was enabled).
+ */
+
+void Tracer::finish() {
+	if (false == isEnabled())
+		return;
+
+	setEnabled(false);
+
+	const std::string &filename = cfgFile->get();
+	if (filename.empty())
+		return;
+
+	if (writeChromeTrace(filename))
+		INFO("Trace written to %s", filename.c_str());
+}
+
+
+/*------------------------------------------------------------------------------------------------*/
+
+/**
+ ** Enable or disable the recording of events.
+ */
+
+void Tracer::setEnabled(bool enable) {
+	enabled.store(enable, std::memory_order_relaxed);
+}
+
+
+/*------------------------------------------------------------------------------------------------*/
+
+/**
+ ** Set the number of events kept per thread, applies to threads that record
+ ** their first event afterwards.
+ **
+ ** @param events   Size of the ring buffer of a thread
+ */
+
+void Tracer::setBufferSize(uint32_t events) {
+	CriticalSectionLock lock(cs);
+	bufferSize = std::max(1u, events);
+}
+
+
+/*------------------------------------------------------------------------------------------------*/
+
+/**
+ ** Get a copy of a name that remains valid as long as the tracer exists (for
+ ** names that are not string literals).
+ **
+ ** @param name   Name of a scope
+ **
+ ** @return permanent copy of the name
+ */
+
+const char* Tracer::intern(const std::string &name) {
+	CriticalSectionLock lock(cs);
+	return names.insert(name).first->c_str();
+}
+
+
+/*------------------------------------------------------------------------------------------------*/
+
+/**
+ ** Record a finished scope of the calling thread. Does not lock, if the ring
+ ** buffer of the thread is full, its oldest event is overwritten.
+ **
+ ** @param category   Category of the scope (e.g. "module")
+ ** @param name       Name of the scope
+ ** @param start      Start time (in ns, see now())
+ ** @param end        End time (in ns, see now())
+ */
+
+void Tracer::record(const char *category, const char *name, uint64_t start, uint64_t end) {
+	static thread_local TracerThreadRegistration registration;
+	ThreadBuffer *buffer = registration.buffer;
+
+	uint64_t index = buffer->written.load(std::memory_order_relaxed);
+	TraceEvent &event = buffer->events[index % buffer->events.size()];
+	event.category = category;
+	event.name     = name;
+	event.start    = start;
+	event.duration = end - start;
+	buffer->written.store(index + 1, std::memory_order_release);
+}
+
+
+/*------------------------------------------------------------------------------------------------*/
+
+/**
+ ** Drop the recorded events.
+ */
+
+void Tracer::clear() {
+	CriticalSectionLock lock(cs);
+
+	for (ThreadBuffer *buffer : threadBuffers)
+		buffer->written.store(0, std::memory_order_release);
+}
+
+
+/*------------------------------------------------------------------------------------------------*/
+
+/**
+ ** Write the recorded events in the Chrome trace (JSON) format. Events that
+ ** are overwritten while exporting are skipped, so the tracer should
+ ** preferably be disabled before.
+ **
+ ** @param os   Stream to write to
+ */
+
+void Tracer::exportChromeTrace(std::ostream &os) {
+	CriticalSectionLock lock(cs);
+
+	const int pid = getpid();
+
+	os << "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[";
+
+	bool first = true;
+	for (ThreadBuffer *buffer : threadBuffers) {
+		// copy the events first, then check which of them were overwritten meanwhile
+		const uint64_t size    = buffer->events.size();
+		const uint64_t written = buffer->written.load(std::memory_order_acquire);
+		const uint64_t begin   = written > size ? written - size : 0;
+
+		std::vector<TraceEvent> events;
+		events.reserve(written - begin);
+		for (uint64_t index = begin; index < written; index++)
+			events.push_back(buffer->events[index % size]);
+
+		const uint64_t writtenAfter = buffer->written.load(std::memory_order_acquire);
+		const uint64_t valid        = writtenAfter > size + begin ? writtenAfter - size - begin : 0;
+		if (valid > 0)
+			events.erase(events.begin(), events.begin() + std::min<uint64_t>(valid, events.size()));
+
+		os << (first ? "" : ",") << "\n{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":" << pid << ",\"tid\":" << buffer->id << ",\"args\":{\"name\":";
+		writeJSONString(os, buffer->name.c_str());
+		os << "}}";
+		first = false;
+
+		for (const TraceEvent &event : events) {
+			char times[64];
+			snprintf(times, sizeof(times), "%.3f,\"dur\":%.3f", event.start / 1000., event.duration / 1000.);
+
+			os << ",\n{\"ph\":\"X\",\"pid\":" << pid << ",\"tid\":" << buffer->id << ",\"cat\":";
+			writeJSONString(os, event.category);
+			os << ",\"name\":";
+			writeJSONString(os, event.name);
+			os << ",\"ts\":" << times << "}";
+		}
+	}
+
+	os << "\n]}\n";
+}
+
+
+/*------------------------------------------------------------------------------------------------*/
+
+/**
+ ** Write the recorded events to a file in the Chrome trace format.
+ **
+ ** @param filename   Name of the file
+ **
+ ** @return true iff the file was written
+ */
+
+bool Tracer::writeChromeTrace(const std::string &filename) {
+	std::ofstream ofs(filename.c_str());
+	if (false == ofs.is_open()) {
+		ERROR("Could not open trace file %s", filename.c_str());
+		return false;
+	}
+
+	exportChromeTrace(ofs);
+	return ofs.good();
+}
+
+
+/*------------------------------------------------------------------------------------------------*/
+
+/**
+ ** Create the ring buffer of the calling thread.
+ */
+
+Tracer::ThreadBuffer* Tracer::attachThread() {
+	std::string threadName = Thread::getCurrentThreadName();
+
+	CriticalSectionLock lock(cs);
+
+	ThreadBuffer *buffer = new ThreadBuffer();
+	buffer->id   = nextThreadId++;
+	buffer->name = threadName;
+	buffer->events.resize(bufferSize);
+	buffer->written.store(0, std::memory_order_relaxed);
+
+	threadBuffers.push_back(buffer);
+	return buffer;
+}
+
+
+/*------------------------------------------------------------------------------------------------*/
+
+/**
+ ** A thread ended, its events are kept for the export unless there are none.
+ */
+
+void Tracer::detachThread(ThreadBuffer *buffer) {
+	CriticalSectionLock lock(cs);
+
+	if (buffer->written.load(std::memory_order_relaxed) > 0)
+		return;
+
+	threadBuffers.erase(std::remove(threadBuffers.begin(), threadBuffers.end(), buffer), threadBuffers.end());
+	delete buffer;
+}
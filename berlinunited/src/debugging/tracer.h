@@ -0,0 +1,149 @@
+#ifndef TRACER_H_
+#define TRACER_H_
+
+#include "platform/system/thread.h"
+#include "utils/patterns/singleton.h"
+
+#include <atomic>
+#include <ostream>
+#include <string>
+#include <unordered_set>
+#include <vector>
+
+#include <stdint.h>
+#include <time.h>
+
+
+/** @addtogroup debug
+ * @{
+ */
+
+
+/*------------------------------------------------------------------------------------------------*/
+
+/// a finished scope of a thread (names are interned, see Tracer::intern())
+struct TraceEvent {
+	const char *category;
+	const char *name;
+	uint64_t    start;     ///< in ns
+	uint64_t    duration;  ///< in ns
+};
+
+
+/*------------------------------------------------------------------------------------------------*/
+
+/**
+ ** The Tracer records what the threads did when, to be viewed on a timeline
+ ** (exported in the Chrome trace format, which is e.g. read by
+ ** chrome://tracing and Perfetto).
+ **
+ ** Every thread records its finished scopes into its own ring buffer without
+ ** locking, so only the most recent events of each thread are kept. Nothing is
+ ** recorded unless the tracer is enabled.
+ **
+ ** Use TRACE_SCOPE(category, name) to record the rest of a block, the names
+ ** must remain valid (string literals or interned names).
+ */
+
+class Tracer : public Singleton<Tracer> {
+public:
+	virtual ~Tracer();
+
+	const char* getName() const { return "Tracer"; }
+
+	void init();
+	void finish();
+
+	/// whether events are recorded
+	inline bool isEnabled() const {
+		return enabled.load(std::memory_order_relaxed);
+	}
+
+	void setEnabled(bool enable);
+	void setBufferSize(uint32_t events);
+
+	const char* intern(const std::string &name);
+
+	void record(const char *category, const char *name, uint64_t start, uint64_t end);
+
+	void clear();
+
+	void exportChromeTrace(std::ostream &os);
+	bool writeChromeTrace(const std::string &filename);
+
+	/// current time in ns
+	static inline uint64_t now() {
+		struct timespec ts;
+		clock_gettime(CLOCK_MONOTONIC, &ts);
+		return (uint64_t)ts.tv_sec * 1000000000ull + ts.tv_nsec;
+	}
+
+protected:
+	Tracer();
+	friend class Singleton<Tracer>;
+
+	/// events of one thread
+	struct ThreadBuffer {
+		uint32_t                id;
+		std::string             name;
+		std::vector<TraceEvent> events;
+		std::atomic<uint64_t>   written;
+	};
+
+	friend class TracerThreadRegistration;
+	ThreadBuffer* attachThread();
+	void          detachThread(ThreadBuffer *buffer);
+
+	CriticalSection cs;
+
+	std::atomic<bool> enabled;
+	uint32_t          bufferSize;
+
+	std::vector<ThreadBuffer*>      threadBuffers;
+	uint32_t                        nextThreadId;
+	std::unordered_set<std::string> names;
+};
+
+
+/*------------------------------------------------------------------------------------------------*/
+
+/** Records the time from its construction to its destruction (if the tracer
+ ** is enabled at construction and a name is given).
+ */
+
+class TraceScope {
+public:
+	TraceScope(const char *category, const char *name)
+		: category(category)
+		, name(name)
+		, start((name && Tracer::getInstance().isEnabled()) ? Tracer::now() : 0)
+	{}
+
+	~TraceScope() {
+		if (start != 0)
+			Tracer::getInstance().record(category, name, start, Tracer::now());
+	}
+
+private:
+	const char *category;
+	const char *name;
+	uint64_t    start;
+};
+
+
+/*------------------------------------------------------------------------------------------------*/
+
+#ifdef NO_DEBUG
+#define TRACE_SCOPE(category, name) ((void) 0)
+#else
+#define TRACE_SCOPE_VARIABLE(line) _trace_scope_##line
+#define TRACE_SCOPE_NAME(line) TRACE_SCOPE_VARIABLE(line)
+#define TRACE_SCOPE(category, name) TraceScope TRACE_SCOPE_NAME(__LINE__)(category, name)
+#endif
+
+
+/**
+ * @}
+ */
+
+#endif /* TRACER_H_ */
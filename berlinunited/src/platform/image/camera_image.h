@@ -239,8 +239,15 @@ protected:
 
 		ar & currentDataLength;
 
-		currentData = std::shared_ptr<void>(malloc(currentDataLength), [](void *ptr) { free(ptr); });
-		ar & boost::serialization::make_binary_object(currentData.get(), currentDataLength);
+		// when playing back a memory-mapped log file, the image data is
+		// used where it is instead of copying it (a binary archive stores it
+		// as raw bytes)
+		currentData = aliasBinaryData(ar, currentDataLength);
+
+		if (nullptr == currentData) {
+			currentData = std::shared_ptr<void>(malloc(currentDataLength), [](void *ptr) { free(ptr); });
+			ar & boost::serialization::make_binary_object(currentData.get(), currentDataLength);
+		}
 
 		ar & pixelSize;
 		ar & timestamp;
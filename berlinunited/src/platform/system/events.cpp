@@ -1,6 +1,7 @@
 #include "events.h"
 
 #include "debug.h"
+#include "debugging/tracer.h"
 
 /*------------------------------------------------------------------------------------------------*/
 
@@ -10,6 +11,7 @@
 Events::Events()
 	: registry()
 	, typeRegistry()
+	, traceNames()
 	, cs()
 {
 	cs.setName("Events");
@@ -90,6 +92,7 @@ bool Events::unregisterForEvent(EventType eventTypeToUnregister, EventCallback *
 
 bool Events::trigger(EventType eventTypeToTrigger, void* param) {
 	EventVector eventVector;
+	const char *traceName = nullptr;
 
 	// Create save copy of registry[eventTypeToTrigger]
 	// like this triggered events can trigger again, while
@@ -97,9 +100,11 @@ bool Events::trigger(EventType eventTypeToTrigger, void* param) {
 	{
 		CriticalSectionLock lock(cs);
 		eventVector = registry[eventTypeToTrigger];
+		traceName   = traceNames[eventTypeToTrigger];
 	}
 	EventVector::iterator it, end = eventVector.end();
 	for (it = eventVector.begin(); it != end; it++) {
+		TraceScope trace("event", traceName);
 		(*it)->eventCallback(eventTypeToTrigger, param);
 	}
 
@@ -138,6 +143,7 @@ EventType Events::registerEventType(
 	}
 
 	typeRegistry[name] = newEventType;
+	traceNames[newEventType] = Tracer::getInstance().intern(name);
 	return newEventType;
 }
 
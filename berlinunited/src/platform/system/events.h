@@ -161,6 +161,9 @@ protected:
 	/// map assigning EventNames to EventTypes
 	std::map<std::string, EventType> typeRegistry;
 
+	/// names of the EventTypes (for tracing)
+	std::map<EventType, const char*> traceNames;
+
 private:
 	CriticalSection cs;
 };
@@ -15,6 +15,8 @@
 #include <stdio.h>
 #include <sys/stat.h>
 #include <fcntl.h>
+#include <pthread.h>
+#include <sched.h>
 
 
 /*------------------------------------------------------------------------------------------------*/
@@ -256,6 +258,43 @@ bool Thread::setRealTimePriority(int priority) {
 }
 
 
+/*------------------------------------------------------------------------------------------------*/
+
+/**
+ ** Restrict this thread to run on one CPU core only.
+ **
+ ** Prerequisite: thread must be running
+ **
+ ** @param core  Index of the core to run on
+ **
+ ** @returns true on success
+ */
+
+bool Thread::setAffinity(unsigned int core) {
+	// lock us down, to prevent thread from quitting while we work on it natively
+	std::unique_lock<std::mutex> lock(quitMutex);
+
+	if (false == isRunning() || false == threadObject.joinable())
+		return false;
+
+	std::thread::native_handle_type tid = threadObject.native_handle();
+	if (tid == 0 || core >= CPU_SETSIZE) {
+		return false;
+	}
+
+#ifdef __linux__
+	cpu_set_t cpus;
+	CPU_ZERO(&cpus);
+	CPU_SET(core, &cpus);
+
+	if (0 == pthread_setaffinity_np(tid, sizeof(cpus), &cpus))
+		return true;
+#endif
+
+	return false;
+}
+
+
 /*------------------------------------------------------------------------------------------------*/
 
 /**
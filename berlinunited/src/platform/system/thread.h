@@ -324,6 +324,9 @@ public:
 	bool setNiceness(int nice=0);
 	bool setRealTimePriority(int priority=0);
 
+	/// pin the thread to a CPU core
+	bool setAffinity(unsigned int core);
+
 	/// print information about currently running thread
 	static void printInfo();
 
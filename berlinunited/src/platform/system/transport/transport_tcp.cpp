@@ -3,6 +3,9 @@
 #include "debug.h"
 
 #include <arpa/inet.h>
+#include <string.h>
+
+#include <vector>
 
 CriticalSection TransportTCP::globalCS;
 
@@ -154,6 +157,64 @@ int TransportTCP::write(const void *data, uint32_t count) {
 }
 
 
+/*------------------------------------------------------------------------------------------------*/
+
+/** Send data gathered from several buffers.
+ **
+ ** @param iov      Buffers to send
+ ** @param iovcnt   Number of buffers
+ **
+ ** @return number of bytes written, negative numbers are inverted error codes
+ */
+
+int TransportTCP::write(const struct iovec *iov, int iovcnt) {
+	robottime_t lastTime     = getCurrentTime();
+	uint32_t    bytesWritten = 0;
+	uint32_t    count        = 0;
+
+	if (sock == -1)
+		return -EBADF;
+
+	// the buffers are advanced as they are written out
+	std::vector<struct iovec> toSend(iov, iov + iovcnt);
+	for (const struct iovec &buffer : toSend)
+		count += buffer.iov_len;
+
+	size_t first = 0;
+	do {
+		struct msghdr message;
+		memset(&message, 0, sizeof(message));
+		message.msg_iov    = &toSend[first];
+		message.msg_iovlen = toSend.size() - first;
+
+		ssize_t w = ::sendmsg(sock, &message, MSG_NOSIGNAL);
+
+		if (w == -1) {
+			if (errno == EBADF || errno == ECONNRESET || errno == ENOTCONN) {
+				WARNING("TCP Socket shutdown due to error %s (0x%x) while writing", strerror(errno), errno);
+				close();
+			}
+			break;
+		} else if (w > 0) {
+			lastTime = getCurrentTime();
+			bytesWritten += w;
+
+			// skip what was written
+			while (w > 0 && first < toSend.size()) {
+				size_t skip = std::min((size_t)w, toSend[first].iov_len);
+				toSend[first].iov_base  = (uint8_t*)toSend[first].iov_base + skip;
+				toSend[first].iov_len  -= skip;
+				w                      -= skip;
+				if (toSend[first].iov_len == 0)
+					first++;
+			}
+		}
+	} while (bytesWritten < count && (getCurrentTime() - lastTime < 500*milliseconds) );
+
+	return bytesWritten;
+}
+
+
 /*------------------------------------------------------------------------------------------------*/
 
 /** Read data
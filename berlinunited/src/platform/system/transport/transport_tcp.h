@@ -6,6 +6,8 @@
 
 #include <string>
 
+#include <sys/uio.h>
+
 
 /*------------------------------------------------------------------------------------------------*/
 
@@ -46,6 +48,7 @@ public:
 
 	/// write
 	virtual int write(const void *data, uint32_t count);
+	virtual int write(const struct iovec *iov, int iovcnt);
 
 	/// read
 	virtual int read(void *data, uint32_t count);
@@ -67,6 +67,12 @@ bool TransportUDP::open() {
 	int fcntl_flags = fcntl(sock, F_GETFL, 0);
 	fcntl(sock, F_SETFL, fcntl_flags | O_NONBLOCK);
 
+#ifdef SO_RXQ_OVFL
+	// have the kernel report the number of datagrams dropped because the receive buffer was full
+	int reportDrops = 1;
+	setsockopt(sock, SOL_SOCKET, SO_RXQ_OVFL, (void *) &reportDrops, sizeof(reportDrops));
+#endif
+
 	// construct sockaddr_in structure
 	struct sockaddr_in sa = { 0 };
 	sa.sin_family      = AF_INET;
@@ -240,6 +246,48 @@ int TransportUDP::write(const void *data, uint32_t count, struct sockaddr_in *re
 }
 
 
+/*------------------------------------------------------------------------------------------------*/
+
+/** Send data gathered from several buffers as one datagram.
+ **
+ ** @param iov         Buffers to send
+ ** @param iovcnt      Number of buffers
+ ** @param recipient   Recipient of the datagram, broadcast if NULL
+ **
+ ** @return number of bytes written (negative on error)
+ */
+
+int TransportUDP::write(const struct iovec *iov, int iovcnt, struct sockaddr_in *recipient) {
+	if (sock < 0)
+		return 0;
+
+	CriticalSectionLock lock(cs);
+
+	// if no recipient is specified, we assume a broadcast message
+	if (recipient == 0) {
+		if (lastInterfaceScan + Millisecond(15*seconds) < getCurrentTime())
+			collectInterfaces();
+
+		int written = 0;
+		for (uint32_t i=0; i < broadcastAddresses.size(); i++) {
+			written = std::max(written, write(iov, iovcnt, broadcastAddresses[i]));
+		}
+
+		return written;
+
+	} else {
+		struct msghdr message;
+		memset(&message, 0, sizeof(message));
+		message.msg_name    = recipient;
+		message.msg_namelen = sizeof *recipient;
+		message.msg_iov     = const_cast<struct iovec*>(iov);
+		message.msg_iovlen  = iovcnt;
+
+		return sendmsg(sock, &message, 0);
+	}
+}
+
+
 /*------------------------------------------------------------------------------------------------*/
 
 /** Read data
@@ -266,6 +314,22 @@ int TransportUDP::read(void *data, uint32_t count, struct sockaddr_in *remoteAdd
 }
 
 
+/*------------------------------------------------------------------------------------------------*/
+
+/** Read all available datagrams (up to count) with one system call. Does not
+ ** block.
+ **
+ ** @param messages   Message headers describing where to store the datagrams
+ ** @param count      Number of message headers
+ **
+ ** @return number of datagrams read, -1 on error (or if no data is available)
+ */
+
+int TransportUDP::read(struct mmsghdr *messages, uint32_t count) {
+	return recvmmsg(sock, messages, count, MSG_DONTWAIT, nullptr);
+}
+
+
 /*------------------------------------------------------------------------------------------------*/
 
 /** Wait for data
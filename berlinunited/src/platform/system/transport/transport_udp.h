@@ -8,6 +8,9 @@
 #include <string>
 #include <vector>
 
+#include <sys/socket.h>
+#include <sys/uio.h>
+
 
 /*------------------------------------------------------------------------------------------------*/
 
@@ -65,10 +68,12 @@ public:
 	/// write
 	virtual int write(const void *data, uint32_t count);
 	virtual int write(const void *data, uint32_t count, struct sockaddr_in *recipient);
+	virtual int write(const struct iovec *iov, int iovcnt, struct sockaddr_in *recipient);
 
 	/// read
 	virtual int read(void *data, uint32_t count);
 	virtual int read(void *data, uint32_t count, struct sockaddr_in *remoteAddressP);
+	virtual int read(struct mmsghdr *messages, uint32_t count);
 
 	/// wait for data
 	virtual bool waitForData(uint32_t, Microsecond timeout);
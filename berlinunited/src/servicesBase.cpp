@@ -8,6 +8,9 @@
 
 #include "communication/comm.h"
 
+#include "debugging/debugSender.h"
+#include "debugging/tracer.h"
+
 #include "management/commandLine.h"
 #include "management/config/config.h"
 #include "management/config/configSection.h"
@@ -124,12 +127,18 @@ bool ServicesBase::init(int argc, char* argv[], ServiceInitStructure* sis) {
 		name = ss.str();
 	}
 
+	// record a timeline of the threads if requested
+	Tracer::getInstance().init();
+
 	// now init the services we offer
 	comm->init();
 
 	// init the status output dispatcher
 	StatusOutput::getInstance().init();
 
+	// debug output is sent by its own thread from now on
+	DebugSender::getInstance().init();
+
 	// activate modules based on the configuration
 	moduleManagers.setActiveModules(getConfig());
 
@@ -216,6 +225,9 @@ void ServicesBase::terminate(bool notifyOfTermination) {
 	if (notifyOfTermination)
 		triggerTermination();
 
+	Tracer::getInstance().finish();
+
+	DebugSender::getInstance().cancel(true);
 	comm->cancel(true);
 
 	// wait a little bit
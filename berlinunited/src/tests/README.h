@@ -6,6 +6,11 @@
 Simply execute the application with command unittests.
 or unittestsxml to get an xml file with the results.
 
+Benchmarks only print their measurements, so they are disabled by default. Run
+them with
+
+  unittests --gtest_also_run_disabled_tests --gtest_filter='*Benchmark*'
+
 \section GTest How to test with Google Test
 
 "Google's framework for writing C++ tests on a variety of platforms (Linux, Mac
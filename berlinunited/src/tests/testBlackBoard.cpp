@@ -0,0 +1,104 @@
+#include <gtest/gtest.h>
+
+#include "ModuleFramework/BlackBoard.h"
+#include "ModuleFramework/DataHolder.h"
+#include "platform/system/timer.h"
+
+#include <sstream>
+
+
+/* ------------------------------------------------------------------------- */
+
+class TestBlackBoardRepresentation {
+public:
+	// volatile, so the benchmark loops are not optimized away
+	volatile int value = 0;
+};
+
+typedef DataHolder<TestBlackBoardRepresentation> TestBlackBoardData;
+
+
+/* ------------------------------------------------------------------------- */
+
+class TestBlackBoard: public ::testing::Test {
+protected:
+	virtual void SetUp() {
+	}
+
+	/// create a blackboard with some representations that are not used otherwise
+	void fill(BlackBoard &blackBoard, int count) {
+		for (int i = 0; i < count; i++) {
+			std::stringstream name;
+			name << "TestRepresentation" << i;
+			blackBoard.getRepresentation<TestBlackBoardData>(name.str());
+		}
+	}
+};
+
+
+/* ------------------------------------------------------------------------- */
+
+TEST_F(TestBlackBoard, HandleMatchesNamedAccess) {
+	BlackBoard blackBoard;
+	fill(blackBoard, 10);
+
+	BlackBoard::Handle<TestBlackBoardData> handle = blackBoard.getHandle<TestBlackBoardData>("TestRepresentation5");
+	ASSERT_TRUE(handle.isValid());
+	EXPECT_EQ(5, handle.getSlot());
+	EXPECT_EQ(&blackBoard.getRepresentation<TestBlackBoardData>("TestRepresentation5"), &*handle);
+
+	(**handle).value = 42;
+	EXPECT_EQ(42, (*blackBoard.getRepresentation<TestBlackBoardData>("TestRepresentation5")).value);
+	EXPECT_EQ("TestRepresentation5", blackBoard.getData(handle.getSlot())->getName());
+}
+
+
+/* ------------------------------------------------------------------------- */
+
+TEST_F(TestBlackBoard, HandleCreatesRepresentation) {
+	BlackBoard blackBoard;
+
+	BlackBoard::Handle<TestBlackBoardData> handle = blackBoard.getHandle<TestBlackBoardData>("NewRepresentation");
+	EXPECT_TRUE(handle.isValid());
+	EXPECT_EQ(1u, blackBoard.getSlotCount());
+	EXPECT_EQ(1u, blackBoard.getRegistry().count("NewRepresentation"));
+}
+
+
+/* ------------------------------------------------------------------------- */
+
+TEST_F(TestBlackBoard, RepresentationsDoNotMove) {
+	BlackBoard blackBoard;
+
+	TestBlackBoardData* first = &blackBoard.getRepresentation<TestBlackBoardData>("First");
+	fill(blackBoard, 1000);
+
+	EXPECT_EQ(first, &blackBoard.getRepresentation<TestBlackBoardData>("First"));
+}
+
+
+/* ------------------------------------------------------------------------- */
+
+TEST_F(TestBlackBoard, DISABLED_BenchmarkLookup) {
+	const int lookups = 1000000;
+
+	BlackBoard blackBoard;
+	fill(blackBoard, 100);
+
+	Microsecond start = getCurrentMicroTime();
+	for (int i = 0; i < lookups; i++)
+		(*blackBoard.getRepresentation<TestBlackBoardData>("TestRepresentation50")).value++;
+	Microsecond namedDuration = getCurrentMicroTime() - start;
+
+	BlackBoard::Handle<TestBlackBoardData> handle = blackBoard.getHandle<TestBlackBoardData>("TestRepresentation50");
+	start = getCurrentMicroTime();
+	for (int i = 0; i < lookups; i++)
+		(**handle).value++;
+	Microsecond handleDuration = getCurrentMicroTime() - start;
+
+	printf("Representation lookup: by name %.2f ns, by handle %.2f ns\n",
+			1000. * namedDuration.value() / lookups,
+			1000. * handleDuration.value() / lookups);
+
+	EXPECT_EQ(2*lookups, (**handle).value);
+}
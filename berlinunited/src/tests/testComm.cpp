@@ -1,12 +1,152 @@
 #include <gtest/gtest.h>
 #include "communication/comm.h"
+#include "communication/messageRegistry.h"
+#include "services.h"
 
+#include "msg_message.pb.h"
+#include "msg_debugging.pb.h"
+
+
+/* ------------------------------------------------------------------------- */
+
+/// records everything that is sent through it
+class TestConnection : public RemoteConnection {
+public:
+	virtual bool isConnected() override { return true; }
+	virtual bool connect()     override { return true; }
+
+	virtual int32_t read(uint8_t *data, uint32_t dataLength) override {
+		return -1;
+	}
+
+	virtual bool send(void const *data, uint32_t dataLength) override {
+		packages.push_back(std::string((const char*)data, dataLength));
+		return true;
+	}
+
+	virtual bool sendv(const struct iovec *iov, int iovcnt) override {
+		gathered++;
+		return RemoteConnection::sendv(iov, iovcnt);
+	}
+
+	virtual std::unique_ptr<RemoteConnection> duplicate() override {
+		return std::unique_ptr<RemoteConnection>(new TestConnection());
+	}
+
+	virtual uint32_t getMaxPackageSize() override {
+		return 65000;
+	}
+
+	std::vector<std::string> packages;
+	int gathered = 0;
+};
+
+
+/// counts the received debug texts
+class TestTextCallback : public MessageCallback {
+public:
+	virtual bool messageCallback(
+	        const std::string               &messageName,
+	        const google::protobuf::Message &msg,
+	        int32_t                          senderID,
+	        RemoteConnectionPtr             &remote) override
+	{
+		const de::fumanoids::message::Debugging &debugging = (const de::fumanoids::message::Debugging&)msg;
+		texts.push_back(debugging.optiontext().payload());
+		EXPECT_TRUE(remote.get() != nullptr);
+		return true;
+	}
+
+	std::vector<std::string> texts;
+};
+
+
+class TestableComm : public Comm {
+public:
+	TestableComm(Millisecond interval, uint32_t size) {
+		coalesceInterval = interval;
+		coalesceSize     = size;
+	}
+
+	using Comm::processBuffer;
+};
+
+
+/* ------------------------------------------------------------------------- */
 
 class TestComm : public ::testing::Test {
 protected:
 	virtual void SetUp() {
 	}
+
+	de::fumanoids::message::Message text(const std::string &payload) {
+		de::fumanoids::message::Message msg;
+		de::fumanoids::message::Debugging &debugging = *msg.MutableExtension(de::fumanoids::message::debugging);
+		debugging.mutable_optiontext()->set_payload(payload);
+		return msg;
+	}
+
+	uint8_t flags(const std::string &package) {
+		return (uint8_t)package[2];
+	}
 };
 
 TEST_F(TestComm, TestSomething) {
 }
+
+
+/* ------------------------------------------------------------------------- */
+
+TEST_F(TestComm, CoalescesSmallMessages) {
+	TestableComm comm(10*milliseconds, 1024);
+	std::shared_ptr<TestConnection> connection(new TestConnection());
+
+	for (int i = 0; i < 5; i++) {
+		de::fumanoids::message::Message msg = text(std::to_string(i));
+		comm.sendMessage(msg, connection);
+	}
+	EXPECT_EQ(0u, connection->packages.size());
+
+	// all messages go out in one package
+	comm.flushSendQueues();
+	ASSERT_EQ(1u, connection->packages.size());
+	EXPECT_EQ(1, connection->gathered);
+	EXPECT_EQ(4, flags(connection->packages[0]));
+
+	// and are received one after the other
+	TestTextCallback callback;
+	services.getMessageRegistry().registerMessageCallback(&callback, "debugging");
+
+	const std::string &package = connection->packages[0];
+	EXPECT_TRUE(comm.processBuffer((const uint8_t*)package.data(), package.size(), RemoteConnectionPtr(new TestConnection())));
+
+	services.getMessageRegistry().unregisterMessageCallback(&callback, "debugging");
+
+	std::vector<std::string> expected = { "0", "1", "2", "3", "4" };
+	EXPECT_TRUE(expected == callback.texts);
+}
+
+
+/* ------------------------------------------------------------------------- */
+
+TEST_F(TestComm, LargeMessagesAreNotHeldBack) {
+	TestableComm comm(10*milliseconds, 1024);
+	std::shared_ptr<TestConnection> connection(new TestConnection());
+
+	de::fumanoids::message::Message small = text("small");
+	de::fumanoids::message::Message large = text(std::string(2000, 'x'));
+
+	// the small message has to go out first
+	comm.sendMessage(small, connection);
+	comm.sendMessage(large, connection);
+	ASSERT_EQ(2u, connection->packages.size());
+	EXPECT_EQ(0, connection->gathered);
+	EXPECT_EQ(0, flags(connection->packages[0]));
+	EXPECT_GT(connection->packages[1].size(), 2000u);
+
+	// without coalescing everything is sent right away
+	TestableComm direct(0*milliseconds, 1024);
+	direct.sendMessage(small, connection);
+	EXPECT_EQ(3u, connection->packages.size());
+	EXPECT_EQ(connection->packages[0], connection->packages[2]);
+}
@@ -0,0 +1,176 @@
+#include <gtest/gtest.h>
+
+#include "ModuleFramework/CompactSerializer.h"
+#include "ModuleFramework/DataHolder.h"
+#include "debugging/logging/logBuffer.h"
+#include "platform/system/timer.h"
+#include "utils/units.h"
+
+#include <stdio.h>
+
+
+/* ------------------------------------------------------------------------- */
+
+enum TestMotorID {
+	TEST_MOTOR_HEAD = 1,
+	TEST_MOTOR_ARM  = 2,
+	TEST_MOTOR_LEG  = 3
+};
+
+struct TestMotorSettings {
+	int16_t speed = 0;
+	bool    limp  = false;
+
+	template<class Archive>
+	void serialize(Archive &ar, const unsigned int version) {
+		ar & speed;
+		ar & limp;
+	}
+};
+
+/// the same representation, once serialized with boost and once compact
+template<int N>
+class TestMotorRequest {
+public:
+	std::map<TestMotorID, Degree>            positions;
+	std::map<TestMotorID, TestMotorSettings> settings;
+	std::vector<float>                       weights;
+	std::string                              source;
+	robottime_t                              timestamp = 0*milliseconds;
+
+	/// added in version 2
+	int32_t priority = 0;
+
+	template<class Archive>
+	void serialize(Archive &ar, const unsigned int version) {
+		ar & positions;
+		ar & settings;
+		ar & weights;
+		ar & source;
+		ar & timestamp;
+
+		if (version >= 2)
+			ar & priority;
+	}
+
+	void fill(int frame) {
+		for (int i = 0; i < 20; i++) {
+			TestMotorID id = TestMotorID(i + 1);
+			positions[id] = (frame + i) * degrees;
+			settings[id].speed = frame;
+			settings[id].limp  = (i % 2) == 0;
+		}
+		weights.assign(24, frame * 0.5f);
+		source    = "Motion";
+		timestamp = frame * milliseconds;
+		priority  = frame;
+	}
+};
+
+typedef TestMotorRequest<0> TestBoostMotorRequest;
+typedef TestMotorRequest<1> TestCompactMotorRequest;
+typedef TestMotorRequest<2> TestCompactMotorRequestV1;
+
+REGISTER_SERIALIZATION(TestBoostMotorRequest, 2)
+REGISTER_COMPACT_SERIALIZATION(TestCompactMotorRequest,   1000, 2)
+REGISTER_COMPACT_SERIALIZATION(TestCompactMotorRequestV1, 1000, 1)
+
+
+/* ------------------------------------------------------------------------- */
+
+class TestCompactSerializer: public ::testing::Test {
+protected:
+	template<class T>
+	void serialize(DataHolder<T> &representation, LogBuffer &buffer) {
+		buffer.clear();
+		SERIALIZER archive(buffer, boost::archive::no_header | boost::archive::no_codecvt);
+		representation.serialize(archive);
+	}
+
+	template<class T>
+	bool deserialize(DataHolder<T> &representation, LogBuffer &buffer) {
+		LogInputBuffer input(buffer.data(), buffer.size());
+		DESERIALIZER archive(input, boost::archive::no_header | boost::archive::no_codecvt);
+		bool result = representation.deserialize(archive);
+		EXPECT_EQ(buffer.size(), input.consumed());
+		return result;
+	}
+
+	/// serialize the representation the given number of times, returns the size and the time per frame
+	template<class T>
+	std::pair<size_t, Microsecond> benchmark(int frames) {
+		DataHolder<T> representation("TestMotorRequest");
+		LogBuffer buffer;
+
+		Microsecond start = getCurrentMicroTime();
+		for (int i = 0; i < frames; i++) {
+			(*representation).fill(i);
+			serialize(representation, buffer);
+		}
+		Microsecond duration = getCurrentMicroTime() - start;
+
+		return std::make_pair(buffer.size(), duration / (double)frames);
+	}
+};
+
+
+/* ------------------------------------------------------------------------- */
+
+TEST_F(TestCompactSerializer, RoundTrip) {
+	DataHolder<TestCompactMotorRequest> original("TestMotorRequest");
+	(*original).fill(42);
+
+	LogBuffer buffer;
+	serialize(original, buffer);
+
+	DataHolder<TestCompactMotorRequest> copy("TestMotorRequest");
+	ASSERT_TRUE(deserialize(copy, buffer));
+
+	EXPECT_TRUE((*original).positions == (*copy).positions);
+	ASSERT_EQ(20u, (*copy).settings.size());
+	EXPECT_EQ(42, (*copy).settings[TEST_MOTOR_ARM].speed);
+	EXPECT_FALSE((*copy).settings[TEST_MOTOR_ARM].limp);
+	EXPECT_TRUE((*copy).settings[TEST_MOTOR_LEG].limp);
+	EXPECT_TRUE((*original).weights == (*copy).weights);
+	EXPECT_EQ("Motion", (*copy).source);
+	EXPECT_EQ(42*milliseconds, (*copy).timestamp);
+	EXPECT_EQ(42, (*copy).priority);
+}
+
+
+/* ------------------------------------------------------------------------- */
+
+TEST_F(TestCompactSerializer, Versions) {
+	LogBuffer buffer;
+
+	// an old version can be read by the new code
+	DataHolder<TestCompactMotorRequestV1> oldVersion("TestMotorRequest");
+	(*oldVersion).fill(7);
+	serialize(oldVersion, buffer);
+
+	DataHolder<TestCompactMotorRequest> newVersion("TestMotorRequest");
+	ASSERT_TRUE(deserialize(newVersion, buffer));
+	EXPECT_EQ(7*milliseconds, (*newVersion).timestamp);
+	EXPECT_EQ(0, (*newVersion).priority);
+
+	// but not the other way around
+	serialize(newVersion, buffer);
+	LogInputBuffer input(buffer.data(), buffer.size());
+	DESERIALIZER archive(input, boost::archive::no_header | boost::archive::no_codecvt);
+	EXPECT_FALSE(oldVersion.deserialize(archive));
+}
+
+
+/* ------------------------------------------------------------------------- */
+
+TEST_F(TestCompactSerializer, DISABLED_BenchmarkAgainstBoost) {
+	const int frames = 10000;
+
+	auto boosted = benchmark<TestBoostMotorRequest>(frames);
+	auto compact = benchmark<TestCompactMotorRequest>(frames);
+
+	printf("boost:   %4d bytes/frame, %.2f us/frame\n", (int)boosted.first, boosted.second.value());
+	printf("compact: %4d bytes/frame, %.2f us/frame\n", (int)compact.first, compact.second.value());
+
+	EXPECT_LT(compact.first, boosted.first);
+}
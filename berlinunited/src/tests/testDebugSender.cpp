@@ -0,0 +1,203 @@
+#include <gtest/gtest.h>
+
+#include "debugging/debugSender.h"
+
+#include "msg_debugging.pb.h"
+
+#include <algorithm>
+#include <thread>
+
+#include <stdio.h>
+
+
+/* ------------------------------------------------------------------------- */
+
+/// records the messages instead of sending them
+class TestableDebugSender : public DebugSender {
+public:
+	virtual void transmit(de::fumanoids::message::Message &message) override {
+		const de::fumanoids::message::Debugging &debugging = message.GetExtension(de::fumanoids::message::debugging);
+		sent.push_back(debugging.optiontext().payload());
+	}
+
+	std::vector<std::string> sent;
+};
+
+
+/* ------------------------------------------------------------------------- */
+
+class TestDebugSender : public ::testing::Test {
+protected:
+	virtual void SetUp() {
+		low.name       = "test.low";
+		low.priority   = PRIORITY_LOW;
+		normal.name    = "test.normal";
+		high.name      = "test.high";
+		high.priority  = PRIORITY_HIGH;
+	}
+
+	void queue(DebugSender &sender, const DebuggingOption &option, const std::string &payload, const std::string &key = "") {
+		de::fumanoids::message::Message msg;
+		msg.set_robotid(1);
+		msg.MutableExtension(de::fumanoids::message::debugging)->mutable_optiontext()->set_payload(payload);
+		sender.queue(&option, key, msg);
+	}
+
+	DebuggingOption low, normal, high;
+};
+
+
+/* ------------------------------------------------------------------------- */
+
+TEST_F(TestDebugSender, HigherPrioritiesFirst) {
+	TestableDebugSender sender;
+	sender.setLimits(0, 0, 100);
+
+	queue(sender, low,    "low");
+	queue(sender, normal, "normal");
+	queue(sender, high,   "high 1");
+	queue(sender, high,   "high 2");
+
+	sender.process(0*milliseconds);
+
+	std::vector<std::string> expected = { "high 1", "high 2", "normal", "low" };
+	EXPECT_TRUE(expected == sender.sent);
+	EXPECT_EQ(0u, sender.getPendingCount());
+}
+
+
+/* ------------------------------------------------------------------------- */
+
+TEST_F(TestDebugSender, TableUpdatesAreAggregated) {
+	TestableDebugSender sender;
+	sender.setLimits(0, 0, 100);
+
+	queue(sender, normal, "x = 1", "x");
+	queue(sender, normal, "y = 1", "y");
+	queue(sender, normal, "x = 2", "x");
+	queue(sender, normal, "x = 3", "x");
+
+	sender.process(0*milliseconds);
+
+	std::vector<std::string> expected = { "x = 3", "y = 1" };
+	EXPECT_TRUE(expected == sender.sent);
+	EXPECT_EQ(2u, sender.getAggregatedCount());
+
+	// once sent, a key is sent again
+	queue(sender, normal, "x = 4", "x");
+	sender.process(10*milliseconds);
+	EXPECT_EQ(3u, sender.sent.size());
+}
+
+
+/* ------------------------------------------------------------------------- */
+
+TEST_F(TestDebugSender, BandwidthIsLimited) {
+	TestableDebugSender sender;
+
+	// messages of about 30 bytes, 100 bytes per round
+	sender.setLimits(1000, 0, 100);
+	for (int i = 0; i < 10; i++)
+		queue(sender, normal, "message " + std::to_string(i));
+
+	sender.process(1000*milliseconds);
+	size_t sentFirst = sender.sent.size();
+	EXPECT_GT(sentFirst, 0u);
+	EXPECT_LT(sentFirst, 10u);
+
+	// a high priority message overtakes the waiting ones
+	queue(sender, high, "high");
+	sender.process(1100*milliseconds);
+	ASSERT_GT(sender.sent.size(), sentFirst);
+	EXPECT_EQ("high", sender.sent[sentFirst]);
+
+	for (int round = 0; round < 20; round++)
+		sender.process((1200 + 100*round)*milliseconds);
+	EXPECT_EQ(11u, sender.sent.size());
+	EXPECT_EQ("message 9", sender.sent.back());
+
+	// a limit per option holds back only that option
+	TestableDebugSender perOption;
+	perOption.setLimits(0, 1000, 100);
+	for (int i = 0; i < 10; i++)
+		queue(perOption, low, "low " + std::to_string(i));
+	queue(perOption, normal, "normal");
+
+	perOption.process(1000*milliseconds);
+	EXPECT_LT(perOption.sent.size(), 11u);
+	EXPECT_TRUE(std::find(perOption.sent.begin(), perOption.sent.end(), "normal") != perOption.sent.end());
+}
+
+
+/* ------------------------------------------------------------------------- */
+
+TEST_F(TestDebugSender, OldestLowPriorityMessagesAreDropped) {
+	TestableDebugSender sender;
+	sender.setLimits(0, 0, 3);
+
+	queue(sender, high,   "high");
+	queue(sender, low,    "low 1");
+	queue(sender, low,    "low 2");
+	queue(sender, normal, "normal");
+
+	sender.process(0*milliseconds);
+
+	std::vector<std::string> expected = { "high", "normal", "low 2" };
+	EXPECT_TRUE(expected == sender.sent);
+	EXPECT_EQ(1u, sender.getDroppedCount());
+}
+
+
+/* ------------------------------------------------------------------------- */
+
+TEST_F(TestDebugSender, ConcurrentProducers) {
+	TestableDebugSender sender;
+	sender.setLimits(0, 0, 100000);
+
+	const int threads  = 4;
+	const int messages = 2000;
+
+	std::vector<std::thread> producers;
+	for (int t = 0; t < threads; t++) {
+		producers.push_back(std::thread([&, t]() {
+			for (int i = 0; i < messages; i++)
+				queue(sender, normal, std::to_string(t) + " " + std::to_string(i));
+		}));
+	}
+
+	// consume while the producers are still running
+	for (int round = 0; round < 100 && sender.sent.size() < threads * messages; round++) {
+		sender.process(0*milliseconds);
+		std::this_thread::yield();
+	}
+
+	for (auto &producer : producers)
+		producer.join();
+	sender.process(0*milliseconds);
+
+	// everything arrived, and in order per producer
+	ASSERT_EQ((size_t)threads * messages, sender.sent.size());
+	std::vector<int> next(threads, 0);
+	for (const std::string &payload : sender.sent) {
+		int t, i;
+		ASSERT_EQ(2, sscanf(payload.c_str(), "%d %d", &t, &i));
+		EXPECT_EQ(next[t], i);
+		next[t] = i + 1;
+	}
+}
+
+
+/* ------------------------------------------------------------------------- */
+
+TEST_F(TestDebugSender, QueueIsDrainedWhenStopped) {
+	TestableDebugSender sender;
+	sender.setLimits(0, 0, 100);
+	sender.run();
+
+	queue(sender, normal, "last words");
+	sender.cancel(true);
+
+	std::vector<std::string> expected = { "last words" };
+	EXPECT_TRUE(expected == sender.sent);
+	EXPECT_EQ(0u, sender.getPendingCount());
+}
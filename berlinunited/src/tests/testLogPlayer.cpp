@@ -0,0 +1,169 @@
+#include <gtest/gtest.h>
+
+#include "debugging/logging/logPlayer.h"
+#include "debugging/logging/logWriter.h"
+#include "debugging/stopwatch.h"
+#include "ModuleFramework/ModuleManager.h"
+#include "ModuleFramework/Module.h"
+#include "ModuleFramework/DataHolder.h"
+#include "debug.h"
+
+#include <stdio.h>
+
+
+/* ------------------------------------------------------------------------- */
+
+class TestReplayInput {
+public:
+	int32_t value = 0;
+
+	template<class Archive>
+	void serialize(Archive &ar, const unsigned int version) {
+		ar & value;
+	}
+};
+
+class TestReplayOutput {
+public:
+	int32_t value = 0;
+
+	template<class Archive>
+	void serialize(Archive &ar, const unsigned int version) {
+		ar & value;
+	}
+};
+
+REGISTER_SERIALIZATION(TestReplayInput, 1)
+REGISTER_SERIALIZATION(TestReplayOutput, 1)
+
+BEGIN_DECLARE_MODULE(TestReplayModule)
+	REQUIRE(TestReplayInput)
+	PROVIDE(TestReplayOutput)
+END_DECLARE_MODULE(TestReplayModule)
+
+class TestReplayModule : public TestReplayModuleBase {
+public:
+	virtual void init() {}
+	virtual void execute() {
+		getTestReplayOutput().value = 2 * getTestReplayInput().value;
+	}
+};
+
+
+/* ------------------------------------------------------------------------- */
+
+REGISTER_DEBUG("testreplay.runtimes", STOPWATCH, BASIC);
+
+class TestReplayManager : public ModuleManager {
+public:
+	TestReplayManager() {
+		registerModule<TestReplayModule>("TestReplayModule", false);
+	}
+
+	virtual ~TestReplayManager() {
+		stopManager();
+	}
+
+	virtual const char* getName() const override {
+		return "TestReplay";
+	}
+
+	TestReplayInput& getInput() {
+		return *getBlackBoard().getRepresentation< DataHolder<TestReplayInput> >("TestReplayInput");
+	}
+
+	TestReplayOutput& getOutput() {
+		return *getBlackBoard().getRepresentation< DataHolder<TestReplayOutput> >("TestReplayOutput");
+	}
+
+	const BlackBoard::Registry& getRegistry() {
+		return getBlackBoard().getRegistry();
+	}
+};
+
+
+/* ------------------------------------------------------------------------- */
+
+class TestLogPlayer: public ::testing::Test {
+protected:
+	const std::string directory = "/tmp";
+	const std::string filename  = "testLogPlayer.log";
+
+	virtual void SetUp() {
+	}
+
+	virtual void TearDown() {
+		remove((directory + "/" + filename).c_str());
+	}
+
+	/// modules keep references to the representations of the first manager
+	/// they were executed in, so all tests have to share the manager
+	static TestReplayManager& getManager() {
+		static TestReplayManager manager;
+		return manager;
+	}
+
+	/// record a log in which the output of frame 5 does not match what the module computes
+	void recordLog(TestReplayManager &manager, int compressionLevel) {
+		LogWriter writer(&manager, "TestReplay:TestReplayInput,TestReplayOutput");
+		writer.setQueuePolicy(LogWriter::BLOCK, 4);
+		writer.setCompression(compressionLevel);
+		writer.start(directory, filename);
+		for (int i = 0; i < 10; i++) {
+			manager.getInput().value  = i;
+			manager.getOutput().value = (i == 5) ? -1 : 2*i;
+			writer.serialize(i, manager.getRegistry());
+		}
+		writer.stop();
+	}
+};
+
+
+/* ------------------------------------------------------------------------- */
+
+TEST_F(TestLogPlayer, ReplayComparesOutputWithLog) {
+	TestReplayManager &manager = getManager();
+	recordLog(manager, 0);
+
+	LogPlayer player(directory + "/" + filename + ":TestReplayModule");
+	ASSERT_EQ(10u, player.getFrameCount());
+
+	player.prepare(&manager);
+	LogPlayer::ReplayDiffs diffs = player.replay({ "TestReplayOutput" });
+
+	EXPECT_EQ(10u, player.getReplayedFrames());
+	ASSERT_EQ(1u, diffs.count("TestReplayOutput"));
+	EXPECT_EQ(10u, diffs["TestReplayOutput"].compared);
+	EXPECT_EQ(1u,  diffs["TestReplayOutput"].differing);
+	EXPECT_EQ(5u,  diffs["TestReplayOutput"].firstDifferingFrame);
+
+	// the module was executed for every frame and its runtime was measured
+	EXPECT_EQ(18, manager.getOutput().value);
+	Stopwatch::StopwatchItems stopwatches = Stopwatch::getInstance().getStopwatches("testreplay.runtimes");
+	ASSERT_EQ(1u, stopwatches.count("TestReplayModule"));
+	EXPECT_EQ(10, (int)stopwatches["TestReplayModule"].n);
+}
+
+
+/* ------------------------------------------------------------------------- */
+
+TEST_F(TestLogPlayer, ReplayCompressedLog) {
+	TestReplayManager &manager = getManager();
+	recordLog(manager, 6);
+
+	LogPlayer player(directory + "/" + filename + ":TestReplayModule");
+	ASSERT_EQ(10u, player.getFrameCount());
+
+	player.prepare(&manager);
+	LogPlayer::ReplayDiffs diffs = player.replay({ "TestReplayOutput" });
+
+	EXPECT_EQ(10u, player.getReplayedFrames());
+	EXPECT_EQ(10u, diffs["TestReplayOutput"].compared);
+	EXPECT_EQ(1u,  diffs["TestReplayOutput"].differing);
+	EXPECT_EQ(5u,  diffs["TestReplayOutput"].firstDifferingFrame);
+
+	// random access still works
+	EXPECT_TRUE(player.playFrameNumber(7));
+	EXPECT_EQ(7,  manager.getInput().value);
+	EXPECT_EQ(14, manager.getOutput().value);
+}
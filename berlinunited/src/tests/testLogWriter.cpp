@@ -0,0 +1,432 @@
+#include <gtest/gtest.h>
+
+#include "debugging/logging/logWriter.h"
+#include "debugging/logging/logBuffer.h"
+#include "debugging/logging/logFileHeader.h"
+#include "debugging/logging/logFrameHeader.h"
+#include "debugging/logging/logIndex.h"
+#include "debugging/logging/logInputArchive.h"
+#include "debugging/logging/logMappedFile.h"
+#include "debugging/logging/logRepresentationHeader.h"
+#include "ModuleFramework/ModuleManager.h"
+#include "ModuleFramework/DataHolder.h"
+#include "platform/system/timer.h"
+
+#include <boost/serialization/vector.hpp>
+
+#include <stdio.h>
+#include <zlib.h>
+
+
+/* ------------------------------------------------------------------------- */
+
+class TestLogRepresentation {
+public:
+	int32_t              frame = 0;
+	std::vector<int32_t> data;
+
+	template<class Archive>
+	void serialize(Archive &ar, const unsigned int version) {
+		ar & frame;
+		ar & data;
+	}
+};
+
+REGISTER_SERIALIZATION(TestLogRepresentation, 1)
+
+
+/* ------------------------------------------------------------------------- */
+
+class TestLogManager : public ModuleManager {
+public:
+	virtual const char* getName() const override {
+		return "TestLog";
+	}
+
+	TestLogRepresentation& getRepresentation() {
+		return *getBlackBoard().getRepresentation< DataHolder<TestLogRepresentation> >("TestLogRepresentation");
+	}
+
+	const BlackBoard::Registry& getRegistry() {
+		return getBlackBoard().getRegistry();
+	}
+};
+
+
+/* ------------------------------------------------------------------------- */
+
+class TestLogWriter: public ::testing::Test {
+protected:
+	const std::string directory = "/tmp";
+	const std::string filename  = "testLogWriter.log";
+
+	virtual void SetUp() {
+	}
+
+	virtual void TearDown() {
+		remove((directory + "/" + filename).c_str());
+	}
+
+	/// write the given number of frames, returns the time spent in the (calling) manager thread
+	Microsecond writeLog(LogWriter &writer, TestLogManager &manager, int frames) {
+		writer.start(directory, filename);
+
+		Microsecond duration = 0*microseconds;
+		for (int i = 0; i < frames; i++) {
+			manager.getRepresentation().frame = i;
+			Microsecond start = getCurrentMicroTime();
+			writer.serialize(i, manager.getRegistry());
+			duration += getCurrentMicroTime() - start;
+		}
+
+		writer.stop();
+		return duration;
+	}
+
+	/// read the header of the log file, returns the position of the first frame
+	uint64_t readHeader(const LogMappedFile &file, LogFileHeader &header) {
+		uint32_t headerSize = 0;
+		memcpy(&headerSize, file.data(), sizeof(headerSize));
+		LogInputBuffer headerBuffer(file.data() + sizeof(headerSize), headerSize);
+		DESERIALIZER headerArchive(headerBuffer);
+		headerArchive & header;
+
+		return sizeof(headerSize) + headerSize;
+	}
+
+	/// read the frame numbers logged in the representation
+	std::vector<int32_t> readLog(LogFileHeader &header) {
+		LogMappedFile file(directory + "/" + filename);
+		readHeader(file, header);
+
+		LogIndex index;
+		EXPECT_TRUE(index.read(file, file.size()));
+
+		std::vector<int32_t> frames;
+		for (size_t i = 0; i < index.size(); i++) {
+			LogFrameHeader frameHeader;
+			frameHeader.read(file.data() + index[i].offset);
+			EXPECT_EQ(index[i].framenumber, frameHeader.framenumber);
+
+			const char* frameData = file.data() + index[i].offset + LogFrameHeader::headerSize;
+			EXPECT_EQ(1, frameHeader.repCount);
+
+			LogRepresentationHeader repHeader;
+			repHeader.read(frameData);
+			EXPECT_EQ(frameHeader.framesize, LogRepresentationHeader::headerSize + repHeader.size);
+
+			LogInputBuffer buffer(frameData + LogRepresentationHeader::headerSize, repHeader.size);
+			DESERIALIZER archive(buffer, boost::archive::no_header | boost::archive::no_codecvt);
+			TestLogRepresentation representation;
+			archive & representation;
+
+			EXPECT_EQ(frameHeader.framenumber, (uint32_t)representation.frame);
+			frames.push_back(representation.frame);
+		}
+		return frames;
+	}
+};
+
+
+/* ------------------------------------------------------------------------- */
+
+TEST_F(TestLogWriter, BlockingWritesAllFrames) {
+	TestLogManager manager;
+	manager.getRepresentation().data.resize(1000);
+
+	LogWriter writer(&manager, "TestLog:TestLogRepresentation");
+	writer.setQueuePolicy(LogWriter::BLOCK, 2);
+	writeLog(writer, manager, 100);
+
+	EXPECT_EQ(0u, writer.getDroppedFrames());
+	EXPECT_EQ(100u, writer.getWrittenFrames());
+	EXPECT_LE(writer.getMaxQueueDepth(), 2u);
+
+	LogFileHeader header;
+	std::vector<int32_t> frames = readLog(header);
+
+	EXPECT_EQ(3u, header.version);
+	EXPECT_FALSE(header.compressed);
+	EXPECT_EQ("TestLog", header.moduleManagerName);
+	ASSERT_EQ(1u, header.representationNames.size());
+	EXPECT_EQ("TestLogRepresentation", header.representationNames[0]);
+
+	ASSERT_EQ(100u, frames.size());
+	for (int i = 0; i < 100; i++)
+		EXPECT_EQ(i, frames[i]);
+}
+
+
+/* ------------------------------------------------------------------------- */
+
+TEST_F(TestLogWriter, DroppedFramesDoNotCorruptLog) {
+	TestLogManager manager;
+	manager.getRepresentation().data.resize(100000);
+
+	LogWriter writer(&manager, "TestLog:TestLogRepresentation");
+	writer.setQueuePolicy(LogWriter::DROP_FRAMES, 2);
+	writeLog(writer, manager, 50);
+
+	LogFileHeader header;
+	std::vector<int32_t> frames = readLog(header);
+
+	// every frame is either written or dropped, the file header does not count
+	EXPECT_EQ(frames.size(), writer.getWrittenFrames());
+	EXPECT_EQ(50u, writer.getWrittenFrames() + writer.getDroppedFrames());
+	for (size_t i = 1; i < frames.size(); i++)
+		EXPECT_LT(frames[i-1], frames[i]);
+}
+
+
+/* ------------------------------------------------------------------------- */
+
+TEST_F(TestLogWriter, IndexLocatesFrames) {
+	TestLogManager manager;
+
+	LogWriter writer(&manager, "TestLog:TestLogRepresentation");
+	writer.setQueuePolicy(LogWriter::BLOCK, 4);
+	writeLog(writer, manager, 20);
+
+	LogMappedFile file(directory + "/" + filename);
+	LogFileHeader header;
+	uint64_t firstFrame = readHeader(file, header);
+
+	LogIndex index;
+	ASSERT_TRUE(index.read(file, file.size()));
+	ASSERT_EQ(20u, index.size());
+	EXPECT_EQ(firstFrame, index[0].offset);
+	for (size_t i = 1; i < index.size(); i++)
+		EXPECT_LE(index[i-1].timestamp, index[i].timestamp);
+
+	EXPECT_EQ(7u,  index.findFrame(7));
+	EXPECT_EQ(20u, index.findFrame(100));
+	EXPECT_EQ(0u,  index.findTime(index[0].timestamp - 1*milliseconds));
+	EXPECT_EQ(index[12].timestamp, index[index.findTime(index[12].timestamp)].timestamp);
+
+	// simulate a crash while writing the last frame
+	uint64_t truncatedSize = index.getFramesEnd() - 1;
+
+	// without the index, the complete frames are found by scanning
+	LogIndex rebuilt;
+	EXPECT_FALSE(rebuilt.read(file, truncatedSize));
+	rebuilt.rebuild(file, truncatedSize, firstFrame);
+
+	ASSERT_EQ(19u, rebuilt.size());
+	for (size_t i = 0; i < rebuilt.size(); i++) {
+		EXPECT_EQ(index[i].offset,      rebuilt[i].offset);
+		EXPECT_EQ(index[i].framenumber, rebuilt[i].framenumber);
+	}
+}
+
+
+/* ------------------------------------------------------------------------- */
+
+TEST_F(TestLogWriter, CompressedFramesKeepIndex) {
+	TestLogManager manager;
+	manager.getRepresentation().data.resize(10000);
+
+	LogWriter writer(&manager, "TestLog:TestLogRepresentation");
+	writer.setQueuePolicy(LogWriter::BLOCK, 4);
+	writer.setCompression(1);
+	writeLog(writer, manager, 20);
+
+	LogMappedFile file(directory + "/" + filename);
+	LogFileHeader header;
+	readHeader(file, header);
+	EXPECT_EQ(3u, header.version);
+	EXPECT_TRUE(header.compressed);
+
+	// the representation is mostly zeros
+	EXPECT_LT(file.size(), 20 * 10000 * sizeof(int32_t) / 10);
+
+	LogIndex index;
+	ASSERT_TRUE(index.read(file, file.size()));
+	ASSERT_EQ(20u, index.size());
+
+	// every frame can be uncompressed on its own
+	for (size_t i : { 12, 3 }) {
+		LogFrameHeader frameHeader;
+		frameHeader.read(file.data() + index[i].offset);
+		EXPECT_EQ(i, frameHeader.framenumber);
+
+		const char* frameData = file.data() + index[i].offset + LogFrameHeader::headerSize;
+		uint32_t uncompressedSize;
+		memcpy(&uncompressedSize, frameData, sizeof(uncompressedSize));
+
+		std::vector<char> data(uncompressedSize);
+		uLongf size = uncompressedSize;
+		ASSERT_EQ(Z_OK, uncompress((Bytef*)data.data(), &size, (const Bytef*)frameData + sizeof(uncompressedSize), frameHeader.framesize - sizeof(uncompressedSize)));
+		ASSERT_EQ(uncompressedSize, size);
+
+		LogInputBuffer buffer(data.data() + LogRepresentationHeader::headerSize, size - LogRepresentationHeader::headerSize);
+		DESERIALIZER archive(buffer, boost::archive::no_header | boost::archive::no_codecvt);
+		TestLogRepresentation representation;
+		archive & representation;
+		EXPECT_EQ((int32_t)i, representation.frame);
+		EXPECT_EQ(10000u, representation.data.size());
+	}
+}
+
+
+/* ------------------------------------------------------------------------- */
+
+/// gives access to the compression of a single frame
+class TestCompressingLogWriter : public LogWriter {
+public:
+	TestCompressingLogWriter(TestLogManager *manager)
+		: LogWriter(manager, "TestLog:TestLogRepresentation")
+	{}
+
+	const LogBuffer& compress(LogBuffer &frame, int level) {
+		compressionLevel = level;
+		compressFrame(frame);
+		return compressedFrame;
+	}
+};
+
+TEST_F(TestLogWriter, UncompressibleFramesAreStored) {
+	TestLogManager manager;
+	TestCompressingLogWriter writer(&manager);
+
+	const std::string data = "frame data that is not compressed";
+	LogFrameHeader header;
+	header.timestamp   = 0*milliseconds;
+	header.framenumber = 7;
+	header.framesize   = data.size();
+	header.repCount    = 1;
+
+	LogBuffer frame;
+	header.write(frame.at(frame.reserve(LogFrameHeader::headerSize)));
+	frame.append(data.data(), data.size());
+
+	// zlib rejects the level, the frame is kept as it is
+	const LogBuffer &stored = writer.compress(frame, 10);
+
+	LogFrameHeader storedHeader;
+	storedHeader.read(stored.data());
+	EXPECT_EQ(7u, storedHeader.framenumber);
+	ASSERT_EQ(sizeof(uint32_t) + data.size(), storedHeader.framesize);
+	ASSERT_EQ(LogFrameHeader::headerSize + storedHeader.framesize, stored.size());
+
+	uint32_t storedSize;
+	memcpy(&storedSize, stored.data() + LogFrameHeader::headerSize, sizeof(storedSize));
+	EXPECT_EQ(data.size() | LogFileHeader::storedFrameFlag, storedSize);
+	EXPECT_EQ(data, std::string(stored.data() + LogFrameHeader::headerSize + sizeof(storedSize), data.size()));
+
+	// a valid level compresses it again
+	writer.compress(frame, 1);
+	memcpy(&storedSize, stored.data() + LogFrameHeader::headerSize, sizeof(storedSize));
+	EXPECT_EQ(data.size(), storedSize);
+}
+
+
+/* ------------------------------------------------------------------------- */
+
+TEST_F(TestLogWriter, MappedFileDataIsAliased) {
+	TestLogManager manager;
+	manager.getRepresentation().data.resize(100);
+
+	LogWriter writer(&manager, "TestLog:TestLogRepresentation");
+	writer.setQueuePolicy(LogWriter::BLOCK, 4);
+	writeLog(writer, manager, 1);
+
+	std::shared_ptr<void> data;
+	const char* frameData;
+	{
+		LogMappedFile file(directory + "/" + filename);
+		ASSERT_TRUE(file.isMapped());
+
+		LogIndex index;
+		ASSERT_TRUE(index.read(file, file.size()));
+		std::shared_ptr<char> frame = file.read(index[0].offset, 32);
+		frameData = frame.get();
+		EXPECT_EQ(file.data() + index[0].offset, frameData);
+
+		// without an owner, nothing can be aliased
+		LogInputBuffer copyBuffer(frameData, 32);
+		EXPECT_TRUE(copyBuffer.alias(LogFrameHeader::headerSize) == nullptr);
+
+		// only a LogInputArchive makes the buffer known
+		LogInputBuffer buffer(frameData, 32, frame);
+		DESERIALIZER plainArchive(buffer, boost::archive::no_header | boost::archive::no_codecvt);
+		EXPECT_TRUE(getLogInputBuffer(plainArchive) == nullptr);
+		EXPECT_TRUE(aliasBinaryData(plainArchive, LogFrameHeader::headerSize) == nullptr);
+
+		LogInputArchive archive(buffer, boost::archive::no_header | boost::archive::no_codecvt);
+		DESERIALIZER &deserializer = archive;
+		ASSERT_EQ(&buffer, getLogInputBuffer(deserializer));
+		EXPECT_TRUE(aliasBinaryData(deserializer, 33) == nullptr);
+
+		data = aliasBinaryData(deserializer, LogFrameHeader::headerSize);
+		EXPECT_EQ((size_t)LogFrameHeader::headerSize, buffer.consumed());
+	}
+
+	// the data points into the mapping, which outlives the file object
+	ASSERT_TRUE(data != nullptr);
+	EXPECT_EQ(frameData, (const char*)data.get());
+	LogFrameHeader frameHeader;
+	frameHeader.read((const char*)data.get());
+	EXPECT_EQ(0u, frameHeader.framenumber);
+}
+
+
+/* ------------------------------------------------------------------------- */
+
+TEST_F(TestLogWriter, UnmappedFileIsRead) {
+	TestLogManager manager;
+	manager.getRepresentation().data.resize(100);
+
+	LogWriter writer(&manager, "TestLog:TestLogRepresentation");
+	writer.setQueuePolicy(LogWriter::BLOCK, 4);
+	writeLog(writer, manager, 5);
+
+	LogMappedFile mapped(directory + "/" + filename);
+	LogMappedFile file(directory + "/" + filename, false);
+	EXPECT_FALSE(file.isMapped());
+	EXPECT_TRUE(file.data() == nullptr);
+	EXPECT_EQ(mapped.size(), file.size());
+
+	LogIndex index;
+	ASSERT_TRUE(index.read(file, file.size()));
+	ASSERT_EQ(5u, index.size());
+
+	// the frames are read into buffers of their own
+	for (size_t i = 0; i < index.size(); i++) {
+		LogFrameHeader frameHeader;
+		frameHeader.read(file.read(index[i].offset, LogFrameHeader::headerSize).get());
+		EXPECT_EQ(i, frameHeader.framenumber);
+
+		const size_t frameSize = LogFrameHeader::headerSize + frameHeader.framesize;
+		std::shared_ptr<char> frame = file.read(index[i].offset, frameSize);
+		ASSERT_TRUE(frame != nullptr);
+		EXPECT_NE(mapped.data() + index[i].offset, frame.get());
+		EXPECT_EQ(0, memcmp(mapped.data() + index[i].offset, frame.get(), frameSize));
+	}
+
+	// nothing beyond the end of the file
+	EXPECT_TRUE(file.read(file.size() - 1, 2) == nullptr);
+	EXPECT_TRUE(file.read(file.size() - 1, 1) != nullptr);
+
+	LogIndex rebuilt;
+	rebuilt.rebuild(file, index.getFramesEnd(), index[0].offset);
+	EXPECT_EQ(5u, rebuilt.size());
+}
+
+
+/* ------------------------------------------------------------------------- */
+
+TEST_F(TestLogWriter, DISABLED_BenchmarkSerialize) {
+	const int frames = 200;
+
+	TestLogManager manager;
+	manager.getRepresentation().data.resize(10000);
+
+	LogWriter writer(&manager, "TestLog:TestLogRepresentation");
+	writer.setQueuePolicy(LogWriter::BLOCK, 16);
+	Microsecond duration = writeLog(writer, manager, frames);
+
+	printf("Log frame of %d bytes: %.2f us in the manager thread (max queue depth %d)\n",
+			(int)(10000*sizeof(int32_t)),
+			duration.value() / frames,
+			writer.getMaxQueueDepth());
+}
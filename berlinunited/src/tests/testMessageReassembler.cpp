@@ -0,0 +1,142 @@
+#include <gtest/gtest.h>
+
+#include "communication/messageReassembler.h"
+
+#include "msg_segment.pb.h"
+
+
+/* ------------------------------------------------------------------------- */
+
+class TestMessageReassembler : public ::testing::Test {
+protected:
+	const std::string data = "0123456789abcdefghijklmnopqrstuvwxyz";
+
+	/// create segment number 'number' of a message split into 'count' segments
+	de::fumanoids::message::MessageSegment segment(uint64_t id, uint32_t number, uint32_t count) {
+		size_t segmentSize = (data.size() + count - 1) / count;
+
+		de::fumanoids::message::MessageSegment segment;
+		segment.set_id(id);
+		segment.set_packagenumber(number);
+		segment.set_totalpackagecount(count);
+		segment.set_payload(data.substr(number*segmentSize, segmentSize));
+		return segment;
+	}
+};
+
+
+/* ------------------------------------------------------------------------- */
+
+TEST_F(TestMessageReassembler, OutOfOrder) {
+	MessageReassembler reassembler;
+	std::string message;
+
+	EXPECT_FALSE(reassembler.addSegment(1, segment(7, 2, 4), 0*milliseconds, message));
+	EXPECT_FALSE(reassembler.addSegment(1, segment(7, 0, 4), 0*milliseconds, message));
+	EXPECT_FALSE(reassembler.addSegment(1, segment(7, 3, 4), 0*milliseconds, message));
+
+	// duplicates are ignored
+	EXPECT_FALSE(reassembler.addSegment(1, segment(7, 3, 4), 0*milliseconds, message));
+	EXPECT_EQ(1u, reassembler.getPendingCount());
+
+	EXPECT_TRUE(reassembler.addSegment(1, segment(7, 1, 4), 0*milliseconds, message));
+	EXPECT_EQ(data, message);
+
+	EXPECT_EQ(0u, reassembler.getPendingCount());
+	EXPECT_EQ(0u, reassembler.getBufferedBytes());
+	EXPECT_EQ(1u, reassembler.getCompletedCount());
+}
+
+
+/* ------------------------------------------------------------------------- */
+
+TEST_F(TestMessageReassembler, SendersAreSeparated) {
+	MessageReassembler reassembler;
+	std::string message;
+
+	// two robots use the same segment id
+	EXPECT_FALSE(reassembler.addSegment(1, segment(3, 0, 2), 0*milliseconds, message));
+	EXPECT_FALSE(reassembler.addSegment(2, segment(3, 1, 2), 0*milliseconds, message));
+	EXPECT_EQ(2u, reassembler.getPendingCount());
+
+	EXPECT_TRUE(reassembler.addSegment(2, segment(3, 0, 2), 0*milliseconds, message));
+	EXPECT_EQ(data, message);
+	EXPECT_EQ(1u, reassembler.getPendingCount());
+}
+
+
+/* ------------------------------------------------------------------------- */
+
+TEST_F(TestMessageReassembler, IncompleteMessagesTimeOut) {
+	MessageReassembler reassembler(1024, 100*milliseconds);
+	std::string message;
+
+	EXPECT_FALSE(reassembler.addSegment(1, segment(1, 0, 2), 0*milliseconds, message));
+	EXPECT_FALSE(reassembler.addSegment(1, segment(2, 0, 2), 50*milliseconds, message));
+
+	reassembler.expire(120*milliseconds);
+	EXPECT_EQ(1u, reassembler.getPendingCount());
+	EXPECT_EQ(1u, reassembler.getDiscardedCount());
+
+	// the first message can not be completed anymore, the second one can
+	EXPECT_FALSE(reassembler.addSegment(1, segment(1, 1, 2), 130*milliseconds, message));
+	EXPECT_TRUE(reassembler.addSegment(1, segment(2, 1, 2), 140*milliseconds, message));
+	EXPECT_EQ(data, message);
+}
+
+
+/* ------------------------------------------------------------------------- */
+
+TEST_F(TestMessageReassembler, MemoryIsBounded) {
+	// room for two messages with one segment of 18 bytes each
+	const uint32_t messageBytes = 18 + MessageReassembler::getMetadataBytes(2);
+	MessageReassembler reassembler(2*messageBytes + 4, 1000*milliseconds, 1);
+	std::string message;
+
+	EXPECT_FALSE(reassembler.addSegment(1, segment(1, 0, 2), 0*milliseconds,  message));
+	EXPECT_FALSE(reassembler.addSegment(1, segment(2, 0, 2), 10*milliseconds, message));
+	EXPECT_EQ(2*messageBytes, reassembler.getBufferedBytes());
+
+	// the oldest message has to make room
+	EXPECT_FALSE(reassembler.addSegment(1, segment(3, 0, 2), 20*milliseconds, message));
+	EXPECT_EQ(2u,  reassembler.getPendingCount());
+	EXPECT_EQ(2*messageBytes, reassembler.getBufferedBytes());
+	EXPECT_EQ(1u,  reassembler.getDiscardedCount());
+
+	EXPECT_TRUE(reassembler.addSegment(1, segment(2, 1, 2), 30*milliseconds, message));
+	EXPECT_EQ(data, message);
+
+	// a message that is larger than the limit is never buffered completely
+	MessageReassembler small(20 + MessageReassembler::getMetadataBytes(2), 1000*milliseconds, 1);
+	EXPECT_FALSE(small.addSegment(1, segment(4, 0, 2), 0*milliseconds, message));
+	EXPECT_FALSE(small.addSegment(1, segment(4, 1, 2), 0*milliseconds, message));
+	EXPECT_EQ(0u, small.getBufferedBytes());
+	EXPECT_EQ(0u, small.getPendingCount());
+}
+
+
+/* ------------------------------------------------------------------------- */
+
+TEST_F(TestMessageReassembler, SegmentCountIsBounded) {
+	MessageReassembler reassembler;
+	std::string message;
+
+	// more segments than could ever fit into the memory
+	de::fumanoids::message::MessageSegment huge = segment(1, 0, 1);
+	huge.set_totalpackagecount(1u << 30);
+	EXPECT_FALSE(reassembler.addSegment(1, huge, 0*milliseconds, message));
+	EXPECT_EQ(0u, reassembler.getPendingCount());
+	EXPECT_EQ(0u, reassembler.getBufferedBytes());
+
+	// the bookkeeping of the segments alone would exceed the memory
+	MessageReassembler tiny(1000, 1000*milliseconds, 1);
+	huge.set_totalpackagecount(900);
+	EXPECT_FALSE(tiny.addSegment(1, huge, 0*milliseconds, message));
+	EXPECT_EQ(0u, tiny.getPendingCount());
+	EXPECT_EQ(0u, tiny.getBufferedBytes());
+	EXPECT_EQ(1u, tiny.getDiscardedCount());
+
+	// the accepted segments are charged with their bookkeeping
+	EXPECT_FALSE(reassembler.addSegment(1, segment(2, 0, 2), 0*milliseconds, message));
+	EXPECT_EQ(18 + MessageReassembler::getMetadataBytes(2), reassembler.getBufferedBytes());
+}
@@ -0,0 +1,329 @@
+#include <gtest/gtest.h>
+
+#include "ModuleFramework/ModuleManager.h"
+#include "ModuleFramework/Module.h"
+#include "platform/system/timer.h"
+#include "debug.h"
+
+#include <atomic>
+#include <chrono>
+#include <mutex>
+#include <thread>
+#include <sstream>
+
+
+/* ------------------------------------------------------------------------- */
+
+REGISTER_DEBUG("testmodulemanager.runtimes", STOPWATCH, BASIC);
+
+BEGIN_DECLARE_MODULE(TestModuleNop)
+END_DECLARE_MODULE(TestModuleNop)
+
+class TestModuleNop : public TestModuleNopBase {
+public:
+	static std::atomic<uint32_t> executions;
+
+	virtual void init() {}
+
+	virtual void execute() {
+		std::lock_guard<std::mutex> lock(lastThreadMutex);
+		lastThread = std::this_thread::get_id();
+		executions++;
+	}
+
+	static std::thread::id getLastThread() {
+		std::lock_guard<std::mutex> lock(lastThreadMutex);
+		return lastThread;
+	}
+
+private:
+	// written by the workers of the thread pool
+	static std::mutex      lastThreadMutex;
+	static std::thread::id lastThread;
+};
+
+std::mutex TestModuleNop::lastThreadMutex;
+std::thread::id TestModuleNop::lastThread;
+std::atomic<uint32_t> TestModuleNop::executions(0);
+
+
+/* ------------------------------------------------------------------------- */
+
+BEGIN_DECLARE_MODULE(TestModuleInit)
+END_DECLARE_MODULE(TestModuleInit)
+
+class TestModuleInit : public TestModuleInitBase {
+public:
+	static std::atomic<int> initializing;
+	static std::atomic<int> maxInitializing;
+
+	virtual void init() {
+		int current = ++initializing;
+		int max = maxInitializing;
+		while (current > max && false == maxInitializing.compare_exchange_weak(max, current)) {}
+
+		std::this_thread::sleep_for(std::chrono::milliseconds(2));
+		--initializing;
+	}
+
+	virtual void execute() {}
+};
+
+std::atomic<int> TestModuleInit::initializing(0);
+std::atomic<int> TestModuleInit::maxInitializing(0);
+
+
+/* ------------------------------------------------------------------------- */
+
+class TestRepresentationA { public: int value = 0; };
+class TestRepresentationB { public: int value = 0; };
+
+BEGIN_DECLARE_MODULE(TestModuleProviderA)
+	PROVIDE(TestRepresentationA)
+END_DECLARE_MODULE(TestModuleProviderA)
+
+class TestModuleProviderA : public TestModuleProviderABase {
+public:
+	virtual void init() {}
+	virtual void execute() { getTestRepresentationA().value++; }
+};
+
+BEGIN_DECLARE_MODULE(TestModuleProviderB)
+	REQUIRE(TestRepresentationA)
+	PROVIDE(TestRepresentationB)
+END_DECLARE_MODULE(TestModuleProviderB)
+
+class TestModuleProviderB : public TestModuleProviderBBase {
+public:
+	virtual void init() {}
+	virtual void execute() { getTestRepresentationB().value = getTestRepresentationA().value; }
+};
+
+BEGIN_DECLARE_MODULE(TestModuleConsumerA)
+	REQUIRE(TestRepresentationA)
+END_DECLARE_MODULE(TestModuleConsumerA)
+
+class TestModuleConsumerA : public TestModuleConsumerABase {
+public:
+	virtual void init() {}
+	virtual void execute() {}
+};
+
+BEGIN_DECLARE_MODULE(TestModuleConsumerB)
+	REQUIRE(TestRepresentationB)
+END_DECLARE_MODULE(TestModuleConsumerB)
+
+class TestModuleConsumerB : public TestModuleConsumerBBase {
+public:
+	virtual void init() {}
+	virtual void execute() {}
+};
+
+BEGIN_DECLARE_MODULE(TestModuleRecyclerB)
+	RECYCLE(TestRepresentationB)
+END_DECLARE_MODULE(TestModuleRecyclerB)
+
+class TestModuleRecyclerB : public TestModuleRecyclerBBase {
+public:
+	virtual void init() {}
+	virtual void execute() {}
+};
+
+
+/* ------------------------------------------------------------------------- */
+
+class TestModuleManagerInstance : public ModuleManager {
+public:
+	TestModuleManagerInstance(int moduleCount) {
+		for (int i = 0; i < moduleCount; i++) {
+			std::stringstream name;
+			name << "TestModuleNop" << i;
+			registerModule<TestModuleNop>(name.str(), true);
+		}
+		executor.run();
+	}
+
+	virtual ~TestModuleManagerInstance() {
+		executor.cancel();
+	}
+
+	virtual const char* getName() const override {
+		return "TestModuleManager";
+	}
+
+	void executeFrames(uint32_t frames) {
+		for (uint32_t i = 0; i < frames; i++)
+			executeModules();
+	}
+
+	const std::vector< std::vector<std::string> >& calculateExecutionLevels() {
+		calculateExecutionList();
+		return getExecutionLevels();
+	}
+
+	void startThreads(unsigned int count) {
+		threadPool.start(count);
+	}
+};
+
+
+/* ------------------------------------------------------------------------- */
+
+class TestModuleManager: public ::testing::Test {
+protected:
+	virtual void SetUp() {
+		TestModuleNop::executions = 0;
+	}
+
+	/// measure the average time to dispatch one frame of modules
+	Microsecond measureFrame(TestModuleManagerInstance &manager, uint32_t frames) {
+		manager.executeFrames(10); // warm up
+		Microsecond start = getCurrentMicroTime();
+		manager.executeFrames(frames);
+		return (getCurrentMicroTime() - start) / (double)frames;
+	}
+};
+
+
+/* ------------------------------------------------------------------------- */
+
+TEST_F(TestModuleManager, AsyncExecutesInExecutorThread) {
+	TestModuleManagerInstance manager(1);
+	manager.setExecutionMode(ModuleManager::EXECUTION_ASYNC);
+	manager.executeFrames(1);
+
+	EXPECT_EQ(1u, TestModuleNop::executions.load());
+	EXPECT_NE(std::this_thread::get_id(), TestModuleNop::getLastThread());
+}
+
+
+/* ------------------------------------------------------------------------- */
+
+TEST_F(TestModuleManager, InlineExecutesInManagerThread) {
+	TestModuleManagerInstance manager(1);
+	manager.setExecutionMode(ModuleManager::EXECUTION_INLINE);
+	manager.executeFrames(1);
+
+	EXPECT_EQ(1u, TestModuleNop::executions.load());
+	EXPECT_EQ(std::this_thread::get_id(), TestModuleNop::getLastThread());
+}
+
+
+/* ------------------------------------------------------------------------- */
+
+TEST_F(TestModuleManager, InlineWithBudgetExecutesInExecutorThread) {
+	TestModuleManagerInstance manager(1);
+	manager.setExecutionMode(ModuleManager::EXECUTION_INLINE);
+	manager.setModuleTimeBudget("TestModuleNop0", 5*milliseconds);
+	manager.executeFrames(1);
+
+	EXPECT_EQ(1u, TestModuleNop::executions.load());
+	EXPECT_NE(std::this_thread::get_id(), TestModuleNop::getLastThread());
+}
+
+
+/* ------------------------------------------------------------------------- */
+
+TEST_F(TestModuleManager, ExecutionLevelsFollowDependencies) {
+	TestModuleManagerInstance manager(0);
+
+	// register in reverse order of the dependencies
+	manager.registerModule<TestModuleConsumerB>("TestModuleConsumerB", true);
+	manager.registerModule<TestModuleConsumerA>("TestModuleConsumerA", true);
+	manager.registerModule<TestModuleProviderB>("TestModuleProviderB", true);
+	manager.registerModule<TestModuleRecyclerB>("TestModuleRecyclerB", true);
+	manager.registerModule<TestModuleProviderA>("TestModuleProviderA", true);
+
+	const auto& levels = manager.calculateExecutionLevels();
+	ASSERT_EQ(3u, levels.size());
+
+	// independent modules stay in the order of registration
+	EXPECT_TRUE(std::vector<std::string>({ "TestModuleRecyclerB", "TestModuleProviderA" }) == levels[0]);
+	EXPECT_TRUE(std::vector<std::string>({ "TestModuleConsumerA", "TestModuleProviderB" }) == levels[1]);
+	EXPECT_TRUE(std::vector<std::string>({ "TestModuleConsumerB" }) == levels[2]);
+}
+
+
+/* ------------------------------------------------------------------------- */
+
+TEST_F(TestModuleManager, DisabledModulesAreExecutedLast) {
+	TestModuleManagerInstance manager(0);
+	manager.registerModule<TestModuleConsumerA>("TestModuleConsumerA", false);
+	manager.registerModule<TestModuleProviderA>("TestModuleProviderA", true);
+
+	const auto& levels = manager.calculateExecutionLevels();
+	ASSERT_EQ(2u, levels.size());
+	EXPECT_TRUE(std::vector<std::string>({ "TestModuleProviderA" }) == levels[0]);
+	EXPECT_TRUE(std::vector<std::string>({ "TestModuleConsumerA" }) == levels[1]);
+}
+
+
+/* ------------------------------------------------------------------------- */
+
+TEST_F(TestModuleManager, ParallelExecution) {
+	TestModuleManagerInstance manager(8);
+	manager.setExecutionMode(ModuleManager::EXECUTION_INLINE);
+	manager.startThreads(3);
+	manager.executeFrames(100);
+
+	EXPECT_EQ(800u, TestModuleNop::executions.load());
+}
+
+
+/* ------------------------------------------------------------------------- */
+
+TEST_F(TestModuleManager, ParallelModulesAreInitializedSerially) {
+	TestModuleManagerInstance manager(0);
+	for (int i = 0; i < 4; i++) {
+		std::stringstream name;
+		name << "TestModuleInit" << i;
+		manager.registerModule<TestModuleInit>(name.str(), true);
+	}
+	manager.setExecutionMode(ModuleManager::EXECUTION_INLINE);
+	manager.startThreads(3);
+	manager.executeFrames(1);
+
+	EXPECT_EQ(1, TestModuleInit::maxInitializing.load());
+}
+
+
+/* ------------------------------------------------------------------------- */
+
+TEST_F(TestModuleManager, DISABLED_BenchmarkDispatchOverhead) {
+	const int      moduleCount = 20;
+	const uint32_t frames      = 1000;
+
+	TestModuleManagerInstance manager(moduleCount);
+
+	manager.setExecutionMode(ModuleManager::EXECUTION_ASYNC);
+	Microsecond asyncFrame = measureFrame(manager, frames);
+
+	manager.setExecutionMode(ModuleManager::EXECUTION_INLINE);
+	Microsecond inlineFrame = measureFrame(manager, frames);
+
+	printf("Dispatch overhead for %d modules: async %.2f us/frame, inline %.2f us/frame\n",
+			moduleCount, asyncFrame.value(), inlineFrame.value());
+
+	EXPECT_EQ((frames + 10) * 2 * moduleCount, TestModuleNop::executions.load());
+}
+
+
+/* ------------------------------------------------------------------------- */
+
+TEST_F(TestModuleManager, DISABLED_BenchmarkEmptyFrame) {
+	const int      moduleCount = 20;
+	const uint32_t frames      = 100000;
+
+	TestModuleManagerInstance manager(moduleCount);
+	manager.setExecutionMode(ModuleManager::EXECUTION_INLINE);
+	for (int i = 0; i < moduleCount; i++)
+		manager.setModuleEnabled("TestModuleNop" + std::to_string(i), false, i == moduleCount - 1);
+
+	// the runtimes are not measured, so only the overhead of executeModules() remains
+	ASSERT_FALSE(::Debugging::getInstance().getDebugOption("testmodulemanager.runtimes")->isEnabled());
+	Microsecond emptyFrame = measureFrame(manager, frames);
+
+	printf("Empty frame with %d disabled modules: %.3f us/frame\n", moduleCount, emptyFrame.value());
+
+	EXPECT_EQ(0u, TestModuleNop::executions.load());
+}
@@ -0,0 +1,143 @@
+#include <gtest/gtest.h>
+
+#include "ModuleFramework/PublishedRepresentation.h"
+#include "ModuleFramework/ModuleManager.h"
+#include "debug.h"
+
+#include <atomic>
+#include <thread>
+
+
+/* ------------------------------------------------------------------------- */
+
+class TestSnapshot {
+public:
+	TestSnapshot() {
+		set(0);
+	}
+
+	void set(int value) {
+		for (auto &v : values)
+			v = value;
+	}
+
+	bool isConsistent() const {
+		for (auto v : values) {
+			if (v != values[0])
+				return false;
+		}
+		return true;
+	}
+
+	int values[64];
+};
+
+
+/* ------------------------------------------------------------------------- */
+
+REGISTER_DEBUG("testpublisher.runtimes",  STOPWATCH, BASIC);
+REGISTER_DEBUG("testsubscriber.runtimes", STOPWATCH, BASIC);
+
+class TestExchangeManager : public ModuleManager {
+public:
+	TestExchangeManager(const char* name)
+		: name(name)
+	{}
+
+	virtual const char* getName() const override {
+		return name;
+	}
+
+	TestSnapshot& getSnapshot() {
+		return *getBlackBoard().getRepresentation< DataHolder<TestSnapshot> >("TestSnapshot");
+	}
+
+	void executeFrame() {
+		executeModules();
+	}
+
+private:
+	const char* name;
+};
+
+
+/* ------------------------------------------------------------------------- */
+
+class TestPublishedRepresentation: public ::testing::Test {
+protected:
+	virtual void SetUp() {
+	}
+};
+
+
+/* ------------------------------------------------------------------------- */
+
+TEST_F(TestPublishedRepresentation, LatestSnapshotWins) {
+	PublishedRepresentation<TestSnapshot> published;
+	EXPECT_FALSE(published.hasUpdate());
+
+	TestSnapshot snapshot;
+	for (int i = 1; i <= 3; i++) {
+		snapshot.set(i);
+		published.publish(snapshot);
+	}
+
+	EXPECT_TRUE(published.hasUpdate());
+	EXPECT_EQ(3, published.latest().values[0]);
+	EXPECT_FALSE(published.hasUpdate());
+	EXPECT_EQ(3, published.latest().values[0]);
+	EXPECT_EQ(3u, published.getSequence());
+}
+
+
+/* ------------------------------------------------------------------------- */
+
+TEST_F(TestPublishedRepresentation, ConcurrentSnapshotsAreConsistent) {
+	PublishedRepresentation<TestSnapshot> published;
+	std::atomic<bool> done(false);
+
+	std::thread producer([&]() {
+		TestSnapshot snapshot;
+		for (int i = 1; i <= 100000; i++) {
+			snapshot.set(i);
+			published.publish(snapshot);
+		}
+		done = true;
+	});
+
+	int last = 0;
+	bool consistent = true;
+	bool monotonic  = true;
+	while (false == done || published.hasUpdate()) {
+		const TestSnapshot &snapshot = published.latest();
+		consistent &= snapshot.isConsistent();
+		monotonic  &= snapshot.values[0] >= last;
+		last = snapshot.values[0];
+	}
+	producer.join();
+
+	EXPECT_TRUE(consistent);
+	EXPECT_TRUE(monotonic);
+	EXPECT_EQ(100000, published.latest().values[0]);
+}
+
+
+/* ------------------------------------------------------------------------- */
+
+TEST_F(TestPublishedRepresentation, ExchangeBetweenManagers) {
+	TestExchangeManager publisher("TestPublisher");
+	TestExchangeManager subscriber("TestSubscriber");
+
+	publisher.publishRepresentation<TestSnapshot>("TestExchange", "TestSnapshot");
+	subscriber.subscribeRepresentation<TestSnapshot>("TestExchange", "TestSnapshot");
+
+	publisher.getSnapshot().set(7);
+	publisher.executeFrame();
+	subscriber.executeFrame();
+	EXPECT_EQ(7, subscriber.getSnapshot().values[0]);
+
+	// the subscriber's own changes persist until something new is published
+	subscriber.getSnapshot().set(1);
+	subscriber.executeFrame();
+	EXPECT_EQ(1, subscriber.getSnapshot().values[0]);
+}
@@ -0,0 +1,144 @@
+#include <gtest/gtest.h>
+
+#include "debugging/stopwatch.h"
+
+#include <thread>
+#include <vector>
+
+
+/* ------------------------------------------------------------------------- */
+
+class TestStopwatch : public ::testing::Test {
+protected:
+	/// measure a busy wait of the given duration
+	void measure(StopwatchHandle handle, Microsecond duration) {
+		Stopwatch::getInstance().start(handle);
+		Microsecond end = getCurrentMicroTime() + duration;
+		while (getCurrentMicroTime() < end) {}
+		Stopwatch::getInstance().stop(handle);
+	}
+};
+
+
+/* ------------------------------------------------------------------------- */
+
+TEST_F(TestStopwatch, Handles) {
+	Stopwatch &stopwatch = Stopwatch::getInstance();
+
+	StopwatchHandle a = stopwatch.registerStopwatch("teststopwatch.handles", "a");
+	StopwatchHandle b = stopwatch.registerStopwatch("teststopwatch.handles", "b");
+	EXPECT_NE(a, b);
+	EXPECT_EQ(a, stopwatch.registerStopwatch("teststopwatch.handles", "a"));
+
+	// nothing measured yet
+	EXPECT_EQ(0, stopwatch.getStopwatch(a).n);
+
+	// stopping without a start is ignored
+	stopwatch.stop(a);
+	EXPECT_EQ(0, stopwatch.getStopwatch(a).n);
+	EXPECT_EQ(1u, stopwatch.getStopwatch(a).discarded);
+
+	measure(a, 100*microseconds);
+	stopwatch.notifyStart("teststopwatch.handles", "b");
+	stopwatch.notifyStop("teststopwatch.handles", "b");
+
+	Stopwatch::StopwatchItems items = stopwatch.getStopwatches("teststopwatch.handles");
+	ASSERT_EQ(2u, items.size());
+	EXPECT_EQ(1, items["a"].n);
+	EXPECT_EQ(1, items["b"].n);
+	EXPECT_EQ("teststopwatch.handles", items["a"].option);
+	EXPECT_GE(items["a"].lastValue.value(), 0.09);
+
+	// invalid handles are ignored
+	stopwatch.start(INVALID_STOPWATCH);
+	stopwatch.stop(INVALID_STOPWATCH);
+}
+
+
+/* ------------------------------------------------------------------------- */
+
+TEST_F(TestStopwatch, Percentiles) {
+	StopwatchHandle handle = Stopwatch::getInstance().registerStopwatch("teststopwatch.percentiles", "busy");
+
+	// 96 short and 4 long measurements, so a short one that is preempted does not move the percentiles
+	for (int i = 0; i < 100; i++)
+		measure(handle, (i % 25 == 24 ? 5000 : 200) * microseconds);
+
+	StopwatchItem item = Stopwatch::getInstance().getStopwatch(handle);
+	EXPECT_EQ(100, item.n);
+
+	EXPECT_LE(item.min.value(), item.percentile50.value());
+	EXPECT_LE(item.percentile50.value(), item.percentile95.value());
+	EXPECT_LE(item.percentile95.value(), item.percentile99.value());
+	EXPECT_LE(item.percentile99.value(), item.max.value());
+
+	// the buckets have a resolution of about 12%, a preempted measurement
+	// only takes longer, so the upper percentiles are only bounded from below
+	EXPECT_NEAR(0.2, item.percentile50.value(), 0.1);
+	EXPECT_GE(item.percentile95.value(), 0.1);
+	EXPECT_LT(item.percentile95.value(), item.percentile99.value());
+	EXPECT_GE(item.percentile99.value(), 4.0);
+	EXPECT_GT(item.mean.value(), item.percentile50.value());
+
+	// the starts are 200us apart (and 5ms after the long ones)
+	EXPECT_GT(item.jitter.value(), 3.0);
+
+	uint32_t count = 0;
+	for (uint32_t n : item.durations)
+		count += n;
+	EXPECT_EQ(100u, count);
+}
+
+
+/* ------------------------------------------------------------------------- */
+
+TEST_F(TestStopwatch, ThreadsAreCombined) {
+	StopwatchHandle handle = Stopwatch::getInstance().registerStopwatch("teststopwatch.threads", "work");
+
+	const int threads      = 4;
+	const int measurements = 1000;
+
+	std::vector<std::thread> workers;
+	for (int t = 0; t < threads; t++) {
+		workers.push_back(std::thread([&]() {
+			for (int i = 0; i < measurements; i++) {
+				Stopwatch::getInstance().start(handle);
+				Stopwatch::getInstance().stop(handle);
+			}
+		}));
+	}
+
+	// measurements of running threads may be read at any time
+	Stopwatch::getInstance().getStopwatch(handle);
+
+	for (auto &worker : workers)
+		worker.join();
+
+	// measurements of threads that ended are kept
+	EXPECT_EQ(threads * measurements, Stopwatch::getInstance().getStopwatch(handle).n);
+
+	measure(handle, 10*microseconds);
+	EXPECT_EQ(threads * measurements + 1, Stopwatch::getInstance().getStopwatch(handle).n);
+}
+
+
+/* ------------------------------------------------------------------------- */
+
+TEST_F(TestStopwatch, StopInOtherThreadIsDiscarded) {
+	StopwatchHandle handle = Stopwatch::getInstance().registerStopwatch("teststopwatch.otherthread", "work");
+
+	Stopwatch::getInstance().start(handle);
+	std::thread([handle]() {
+		Stopwatch::getInstance().stop(handle);
+	}).join();
+
+	StopwatchItem item = Stopwatch::getInstance().getStopwatch(handle);
+	EXPECT_EQ(0, item.n);
+	EXPECT_EQ(1u, item.discarded);
+
+	// the discarded stops of threads that ended are kept
+	Stopwatch::getInstance().stop(handle);
+	item = Stopwatch::getInstance().getStopwatch(handle);
+	EXPECT_EQ(1, item.n);
+	EXPECT_EQ(1u, item.discarded);
+}
@@ -0,0 +1,93 @@
+#include <gtest/gtest.h>
+
+#include "debugging/tracer.h"
+
+#include <sstream>
+#include <thread>
+
+
+/* ------------------------------------------------------------------------- */
+
+class TestTracer : public ::testing::Test {
+protected:
+	virtual void SetUp() {
+		Tracer::getInstance().clear();
+	}
+
+	virtual void TearDown() {
+		Tracer::getInstance().setEnabled(false);
+		Tracer::getInstance().clear();
+	}
+
+	static size_t count(const std::string &text, const std::string &pattern) {
+		size_t n = 0;
+		for (size_t pos = text.find(pattern); pos != std::string::npos; pos = text.find(pattern, pos + 1))
+			n++;
+		return n;
+	}
+
+	std::string exportTrace() {
+		std::stringstream ss;
+		Tracer::getInstance().exportChromeTrace(ss);
+		return ss.str();
+	}
+};
+
+
+/* ------------------------------------------------------------------------- */
+
+TEST_F(TestTracer, NothingIsRecordedWhenDisabled) {
+	Tracer::getInstance().setEnabled(false);
+	{
+		TRACE_SCOPE("test", "disabled");
+	}
+
+	EXPECT_EQ(0u, count(exportTrace(), "\"disabled\""));
+}
+
+
+/* ------------------------------------------------------------------------- */
+
+TEST_F(TestTracer, ScopesOfAllThreadsAreExported) {
+	Tracer::getInstance().setEnabled(true);
+
+	{
+		TRACE_SCOPE("test", "outer");
+		TRACE_SCOPE("test", "inner \"quoted\"");
+	}
+
+	std::thread worker([]() {
+		TRACE_SCOPE("test", "worker");
+	});
+	worker.join();
+
+	std::string trace = exportTrace();
+	EXPECT_EQ(0u, trace.find("{\"displayTimeUnit\":\"ms\",\"traceEvents\":["));
+	EXPECT_EQ(1u, count(trace, "\"name\":\"outer\""));
+	EXPECT_EQ(1u, count(trace, "\"name\":\"inner \\\"quoted\\\"\""));
+
+	// events of a thread that ended are kept
+	EXPECT_EQ(1u, count(trace, "\"name\":\"worker\""));
+	EXPECT_GE(count(trace, "\"ph\":\"M\""), 2u);
+}
+
+
+/* ------------------------------------------------------------------------- */
+
+TEST_F(TestTracer, RingBufferKeepsTheLatestEvents) {
+	Tracer::getInstance().setBufferSize(8);
+	Tracer::getInstance().setEnabled(true);
+
+	// a new thread gets the new buffer size
+	std::thread worker([]() {
+		for (int i = 0; i < 20; i++) {
+			TRACE_SCOPE("test", i < 12 ? "old" : "new");
+		}
+	});
+	worker.join();
+	Tracer::getInstance().setBufferSize(16384);
+
+	std::string trace = exportTrace();
+	EXPECT_EQ(0u, count(trace, "\"name\":\"old\""));
+	EXPECT_EQ(8u, count(trace, "\"name\":\"new\""));
+}
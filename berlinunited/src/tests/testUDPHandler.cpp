@@ -0,0 +1,104 @@
+#include <gtest/gtest.h>
+
+#include "communication/udpHandler.h"
+#include "communication/commHandlerManager.h"
+#include "platform/system/transport/transport_udp.h"
+
+#include <arpa/inet.h>
+#include <string.h>
+#include <unistd.h>
+
+
+/* ------------------------------------------------------------------------- */
+
+class TestUDPManager : public CommHandlerManager {
+public:
+	virtual bool process(RemoteConnectionPtr remote) override {
+		// the datagram is available without copying it
+		const uint8_t *data = remote->readInPlace(sizeof(uint32_t));
+		EXPECT_TRUE(data != nullptr);
+		if (nullptr == data)
+			return false;
+
+		uint32_t value;
+		memcpy(&value, data, sizeof(value));
+
+		CriticalSectionLock lock(cs);
+		values.push_back(value);
+
+		// keep some of the connections, their data has to stay valid
+		if (value % 10 == 0) {
+			kept.push_back(std::move(remote));
+			keptData.push_back(data);
+		}
+		return true;
+	}
+
+	size_t getCount() {
+		CriticalSectionLock lock(cs);
+		return values.size();
+	}
+
+	CriticalSection                  cs;
+	std::vector<uint32_t>            values;
+	std::vector<RemoteConnectionPtr> kept;
+	std::vector<const uint8_t*>      keptData;
+};
+
+
+/* ------------------------------------------------------------------------- */
+
+class TestUDPHandler : public ::testing::Test {
+protected:
+	const int port = 17123;
+};
+
+
+/* ------------------------------------------------------------------------- */
+
+TEST_F(TestUDPHandler, ReceivesBursts) {
+	TestUDPManager manager;
+
+	UDPHandler handler(&manager);
+	handler.init(port, port);
+	handler.run();
+
+	TransportUDP sender(0, port, false);
+	ASSERT_TRUE(sender.open());
+
+	struct sockaddr_in recipient;
+	memset(&recipient, 0, sizeof(recipient));
+	recipient.sin_family      = AF_INET;
+	recipient.sin_addr.s_addr = inet_addr("127.0.0.1");
+	recipient.sin_port        = htons(port);
+
+	// a burst larger than a batch
+	const uint32_t count = 3 * UDPHandler::batchSize + 5;
+	uint8_t datagram[1000] = { 0 };
+	for (uint32_t i = 0; i < count; i++) {
+		memcpy(datagram, &i, sizeof(i));
+		ASSERT_EQ((int)sizeof(datagram), sender.write(datagram, sizeof(datagram), &recipient));
+	}
+
+	for (int wait = 0; wait < 200 && manager.getCount() < count; wait++)
+		usleep(10000);
+
+	handler.cancel();
+
+	ASSERT_EQ(count, manager.getCount());
+	for (uint32_t i = 0; i < count; i++)
+		EXPECT_EQ(i, manager.values[i]);
+
+	// the buffers of the kept connections were not reused
+	ASSERT_EQ(count / 10 + 1, manager.keptData.size());
+	for (size_t i = 0; i < manager.keptData.size(); i++) {
+		uint32_t value;
+		memcpy(&value, manager.keptData[i], sizeof(value));
+		EXPECT_EQ(10*i, value);
+	}
+
+	UDPReceiveStatistics statistics = handler.getStatistics();
+	EXPECT_EQ(count, statistics.datagrams);
+	EXPECT_EQ(count * sizeof(datagram), statistics.bytes);
+	EXPECT_EQ(0u, statistics.drops);
+}
@@ -0,0 +1,102 @@
+#ifndef MPSCQUEUE_H_
+#define MPSCQUEUE_H_
+
+#include <atomic>
+
+
+/*------------------------------------------------------------------------------------------------*/
+
+/** Base class of elements that can be put into a MPSCQueue.
+ */
+
+class MPSCQueueNode {
+public:
+	MPSCQueueNode() : next(nullptr) {}
+
+private:
+	template<class T> friend class MPSCQueue;
+
+	std::atomic<MPSCQueueNode*> next;
+};
+
+
+/*------------------------------------------------------------------------------------------------*/
+
+/**
+ ** Lock-free queue with multiple producers and a single consumer (intrusive
+ ** linked list as described by D. Vyukov). Pushing never blocks and does not
+ ** need any system call, so it is safe to use from real-time threads.
+ **
+ ** The queue does not own its elements, T has to be derived from
+ ** MPSCQueueNode and an element may only be in one queue at a time.
+ */
+
+template<class T>
+class MPSCQueue {
+public:
+	MPSCQueue()
+		: head(&stub)
+		, tail(&stub)
+		, stub()
+	{}
+
+	/// add an element (may be called from any thread)
+	void push(T *element) {
+		push(static_cast<MPSCQueueNode*>(element));
+	}
+
+	/** Take the oldest element. Must only be called from one thread at a time.
+	 **
+	 ** @return the oldest element, nullptr if the queue is empty (or an element
+	 **         is just being added)
+	 */
+	T* pop() {
+		MPSCQueueNode *first = tail;
+		MPSCQueueNode *next  = first->next.load(std::memory_order_acquire);
+
+		// skip the stub node
+		if (first == &stub) {
+			if (nullptr == next)
+				return nullptr;
+
+			tail  = next;
+			first = next;
+			next  = next->next.load(std::memory_order_acquire);
+		}
+
+		if (next) {
+			tail = next;
+			return static_cast<T*>(first);
+		}
+
+		// a producer is in the middle of adding an element
+		if (first != head.load(std::memory_order_acquire))
+			return nullptr;
+
+		// the last element can only be taken with the stub behind it
+		push(&stub);
+		next = first->next.load(std::memory_order_acquire);
+		if (next) {
+			tail = next;
+			return static_cast<T*>(first);
+		}
+
+		return nullptr;
+	}
+
+private:
+	void push(MPSCQueueNode *node) {
+		node->next.store(nullptr, std::memory_order_relaxed);
+		MPSCQueueNode *previous = head.exchange(node, std::memory_order_acq_rel);
+		previous->next.store(node, std::memory_order_release);
+	}
+
+	std::atomic<MPSCQueueNode*> head;
+	MPSCQueueNode              *tail;
+	MPSCQueueNode               stub;
+
+	MPSCQueue(const MPSCQueue &) = delete;
+	MPSCQueue& operator=(const MPSCQueue &) = delete;
+};
+
+#endif /* MPSCQUEUE_H_ */
@@ -8,8 +8,13 @@
 #include <modules/motion/kinematic/kinematicengine/kinematicEngine.h>
 #include "modules/motion/motion.h"
 #include "management/config/config.h"
+#include "debugging/stopwatch.h"
+#include "debug.h"
 #include <utils/math/Math.h>
 
+#include <algorithm>
+#include <thread>
+
 namespace {
 	auto cfgSection          = ConfigRegistry::getSection("kinematicengine");
 	auto cfgEpsilon          = cfgSection->registerOption<double>("epsilon",      0.1, "the epsilon used in the regularization term for the pseudoinverse jacobian");
@@ -18,6 +23,8 @@ namespace {
 	auto cfgMaxAngleDiff     = cfgSection->registerOption<double>("maxAngleDiff", 45., "the maximum angle change to a motor that can be done in one iteration (degrees)");
 	auto cfgNoiseAngle       = cfgSection->registerOption<double>("angularNoise", 0.01, "angular noise which can be applied if a task is singular (degree)");
 	auto cfgIterationCnt     = cfgSection->registerOption<int>   ("iterationCnt", 3, "how often iterate the inverse kinematics per motion cycle");
+	auto cfgThreads          = cfgSection->registerOption<int>   ("threads", 0, "number of worker threads for the gravitation and speed calculation and the tasks of one level (0 = all in the motion thread, at most one less than the number of cores)");
+	auto cfgThreadPriority   = cfgSection->registerOption<int>   ("threadPriority", 1, "realtime priority of the worker threads, if it can not be set everything is calculated in the motion thread");
 }
 
 static std::string activeTasksName = "motion.kinematicengine.activeTasks";
@@ -31,11 +38,30 @@ KinematicEngine::KinematicEngine()
 }
 
 KinematicEngine::~KinematicEngine() {
+	m_inverseKinematic.setThreadPool(nullptr);
+	m_threadPool.stop();
 }
 
 
 void KinematicEngine::init()
 {
+	/* every worker needs a core of its own besides the one of the motion thread */
+	const int cores = std::max(1u, std::thread::hardware_concurrency());
+	int threads = cfgThreads->get();
+	if (threads >= cores) {
+		WARNING("kinematicengine.threads = %d, but there are only %d cores, using %d worker threads", threads, cores, cores - 1);
+		threads = cores - 1;
+	}
+	m_threadPool.start(threads > 0 ? threads : 0);
+
+	/* a worker that is preempted or migrated stalls the whole motion cycle, without realtime
+	 * priority and a core of its own the work is better done in the motion thread */
+	if (threads > 0 && false == m_threadPool.setRealTimePriority(cfgThreadPriority->get())) {
+		WARNING("Could not set up the kinematic engine workers with realtime priority, calculating everything in the motion thread");
+		m_threadPool.stop();
+	}
+	m_inverseKinematic.setThreadPool(&m_threadPool);
+
 	services.getEvents().registerForEvent(EVT_CONFIGURATION_LOADED, this);
 	eventCallback(EVT_CONFIGURATION_LOADED, &services.getConfig());
 }
@@ -65,19 +91,32 @@ void KinematicEngine::execute()
 
 	tree.setMotorSpeeds(getMotorAngles().getSpeeds());
 
-	std::map<MotorID, double> torques;
-	m_inverseKinematic.iterationStepGravitation(tree, torques, getKinematicEngineTasks().getGravityTasks());
-
-	std::map<MotorID, RPM> speedsToApply;
-	m_inverseKinematic.calculateSpeeds(tree, speedsToApply, tasks, getKinematicEngineTasks().getIdleTask());
+	/* the torques and the speeds only read the tree and are calculated side by side */
+	MotorVector<double> &torques = m_torques;
+	MotorVector<RPM> &speedsToApply = m_speedsToApply;
+	torques.invalidateAll();
+	speedsToApply.invalidateAll();
+	m_threadPool.execute({
+		[&]() {
+			m_inverseKinematic.iterationStepGravitation(tree, torques, getKinematicEngineTasks().getGravityTasks());
+		},
+		[&]() {
+			STOPWATCH_START("motion.runtimes", "KinematicEngine.calculateSpeeds");
+			m_inverseKinematic.calculateSpeeds(tree, speedsToApply, tasks, getKinematicEngineTasks().getIdleTask());
+			STOPWATCH_STOP("motion.runtimes", "KinematicEngine.calculateSpeeds");
+		}
+	});
 
-	std::map<MotorID, Degree> anglesToSet;
+	MotorVector<Degree> &anglesToSet = m_anglesToSet;
+	anglesToSet.invalidateAll();
 	for (int i = 0; i < cfgIterationCnt->get(); ++i) {
 		const KinematicEngineTaskDefaultPosition* idleTask = nullptr;
 		if (i == cfgIterationCnt->get() - 1) {
 			idleTask = getKinematicEngineTasks().getIdleTask();
 		}
+		STOPWATCH_START("motion.runtimes", "KinematicEngine.iterationStep");
 		m_inverseKinematic.iterationStep(tree, anglesToSet, tasks, idleTask);
+		STOPWATCH_STOP("motion.runtimes", "KinematicEngine.iterationStep");
 		tree.setMotorValues(anglesToSet);
 	}
 
@@ -85,24 +124,30 @@ void KinematicEngine::execute()
 
 
 	Degree helper(cfgMaxAngleDiff->get() * degrees);
-	for (std::pair<MotorID, Degree> const& motor : anglesToSet)
+	for (int i = 0; i < anglesToSet.size(); ++i)
 	{
-		Degree curPosition = getMotorAngles().getPosition(motor.first);
-		Degree angleChange = Math::limited(motor.second - curPosition, -helper, helper);
+		if (false == anglesToSet.isValid(i)) {
+			continue;
+		}
+
+		const MotorID id = tree.toExt(i);
+		Degree curPosition = getMotorAngles().getPosition(id);
+		Degree angleChange = Math::limited(anglesToSet[i] - curPosition, -helper, helper);
 
-		std::map<MotorID, RPM>::iterator element = speedsToApply.find(motor.first);
 		RPM speed = 0 * rounds_per_minute; // default speed
-		if (element != speedsToApply.end()) {
-			speed = abs(element->second);
-//			INFO("setting Speed for %d\t%05.5f", element->first, element->second.value());
+		if (speedsToApply.isValid(i)) {
+			speed = abs(speedsToApply[i]);
+//			INFO("setting Speed for %d\t%05.5f", id, speedsToApply[i].value());
 		}
-		getMotorPositionRequest().setSpeed(motor.first, speed);
-		getMotorPositionRequest().setPosition(motor.first, curPosition + angleChange);
+		getMotorPositionRequest().setSpeed(id, speed);
+		getMotorPositionRequest().setPosition(id, curPosition + angleChange);
 	}
 
-	for (std::pair<MotorID, double> const& motor : torques)
+	for (int i = 0; i < torques.size(); ++i)
 	{
-		getMotorPositionRequest().setForce(motor.first, motor.second);
+		if (torques.isValid(i)) {
+			getMotorPositionRequest().setForce(tree.toExt(i), torques[i]);
+		}
 	}
 
 	int level = 0;
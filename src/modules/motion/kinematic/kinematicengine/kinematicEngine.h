@@ -16,6 +16,8 @@
 #include "representations/hardware/motorAngles.h"
 #include "platform/system/events.h"
 
+#include "ModuleFramework/moduleThreadPool.h"
+
 #include <tools/kinematicEngine/inverseKinematicJacobian.h>
 
 #include <random>
@@ -44,6 +46,15 @@ public:
 private:
 	InverseKinematicJacobian m_inverseKinematic;
 
+	/* workers for the independent parts of a motion cycle, kept as long as the module exists
+	 * (stopped again if they can not run with realtime priority on their own cores) */
+	ModuleThreadPool m_threadPool;
+
+	/* the results of a cycle, kept to reuse their memory */
+	MotorVector<double> m_torques;
+	MotorVector<RPM>    m_speedsToApply;
+	MotorVector<Degree> m_anglesToSet;
+
 	std::uniform_real_distribution<double> distribution;
 
 	std::default_random_engine generator;
@@ -44,9 +44,9 @@ public:
 			RobotModel* model = RobotModel::createRobotModel();
 			model->init();
 
-			std::map<MotorID, bool> torque;
-			for (auto id : model->getRobotDescription()->getMotorIDs()) {
-				torque[id] = false;
+			MotorVector<bool> torque(model->getRobotDescription()->getMotorIndex().size());
+			for (int i = 0; i < torque.size(); ++i) {
+				torque.set(i, false);
 			}
 			model->getActuators()->setTorqueEnabled(torque);
 		}
@@ -129,9 +129,10 @@ void Motion::stopManager() {
  */
 
 void Motion::threadMain() {
-	// initialize our thread
-	executor.setRealTimePriority();
+	// initialize our thread (modules may be executed inline in this thread)
+	setRealTimePriority();
 	ModuleManager::startManager(1);
+	executor.setRealTimePriority();
 
 	Microsecond nextTriggerTime = getCurrentMicroTime();
 	const Hertz targetFPS = cfgFPS->get();
@@ -139,12 +140,16 @@ void Motion::threadMain() {
 
 	robottime_t abortRequestedTimestamp = 0*milliseconds;
 
+	// resolve the representations we need to look at once
+	BlackBoard::Handle< DataHolder<MotionStatus> > motionStatusHandle = getBlackBoard().getHandle< DataHolder<MotionStatus> >("MotionStatus");
+	BlackBoard::Handle< DataHolder<ActiveMotion> > activeMotionHandle = getBlackBoard().getHandle< DataHolder<ActiveMotion> >("ActiveMotion");
+
 	while (true) {
 		// if we were requested to stop, try to make sure that the robot is
 		// in a stable state
 		if (!isRunning()) {
-			MotionStatus& motionStatus = *getBlackBoard().getRepresentation< DataHolder<MotionStatus> >("MotionStatus");
-			ActiveMotion& activeMotion = *getBlackBoard().getRepresentation< DataHolder<ActiveMotion> >("ActiveMotion");
+			MotionStatus& motionStatus = **motionStatusHandle;
+			ActiveMotion& activeMotion = **activeMotionHandle;
 
 			// if abort was requested just now ...
 			if (abortRequestedTimestamp == 0*milliseconds) {
@@ -18,6 +18,10 @@
 using namespace std;
 
 
+namespace {
+	// Maximal number of jobs the worker teaches at once
+	const unsigned int maxJobsPerBatch = 64;
+}
 
 
 /*------------------------------------------------------------------------------------------------*/
@@ -91,8 +95,9 @@ float NeuralLearning::getBestQValueForState(const RL_State& s) const {
 	float bestValue = -9999;
 
 	// Try out each possible action
+	arma::vec qValues = getQValuesForState(s);
 	for (auto it(model->actions.begin()); it != model->actions.end(); ++it) {
-		float tmpValue = getQValue(s, it->second);
+		float tmpValue = qValues(it->first);
 
 		if (tmpValue > bestValue) {
 			bestValue = tmpValue;
@@ -108,13 +113,31 @@ float NeuralLearning::getBestQValueForState(const RL_State& s) const {
 
 
 
+arma::vec NeuralLearning::getQValuesForState(const RL_State& s) const {
+	// The pattern does not depend on the action, all networks get the same one
+	arma::vec pattern = generatePattern(s, model->getDefaultAction());
+
+	arma::vec qValues(Q_ANNs.size());
+	for (unsigned int a_idx = 0; a_idx < Q_ANNs.size(); a_idx++) {
+		qValues(a_idx) = Q_ANNs[a_idx]->getOutputsForPatterns(pattern)(0, 0);
+	}
+	return qValues;
+}
+
+
+
+/*------------------------------------------------------------------------------------------------*/
+
+
+
 // Compute: argmax_a : Q(s, a)
 RL_Action NeuralLearning::getBestActionForState(const RL_State& s) const {
 	float bestValue = -9999;
 	RL_Action bestAction = model->getRandomAction();
 
+	arma::vec qValues = getQValuesForState(s);
 	for (auto it(model->actions.begin()); it != model->actions.end(); ++it) {
-		float tmpValue = getQValue(s, it->second);
+		float tmpValue = qValues(it->first);
 		if (tmpValue > bestValue) {
 			bestValue = tmpValue;
 			bestAction = it->second;
@@ -157,8 +180,11 @@ void NeuralLearning::updateBySample(const RL_Sample& sample) {
 /*------------------------------------------------------------------------------------------------*/
 
 void NeuralLearning::propagateThroughEligibilityTrace(const RL_State& s, const RL_Action& a, float targetQ) {
+	// all updates of this sample are collected and taught in one batch per network
+	std::vector<NeuralJob> jobs;
+
 	// at (s, a) the eligibility trace is set to 1
-	updateQ(s, a, targetQ, 1);
+	jobs.push_back({s, a, targetQ, 1});
 	//jobQueue -> enqueue_force({s, a, targetQ, 1});
 //	jobQueue.push({s, a, targetQ, 1});
 
@@ -171,7 +197,7 @@ void NeuralLearning::propagateThroughEligibilityTrace(const RL_State& s, const R
 
 		// at every pair (s', a') where s' == s the eligibility trace is set to 0
 		if (false == tmp_s.isEqualToState(s)) {
-			updateQ(tmp_s, tmp_a, targetQ, traceDiscount);
+			jobs.push_back({tmp_s, tmp_a, targetQ, traceDiscount});
 //			jobQueue -> enqueue_force({tmp_s, tmp_a, targetQ, traceDiscount});
 //			jobQueue.push({tmp_s, tmp_a, targetQ, traceDiscount});
 
@@ -182,6 +208,8 @@ void NeuralLearning::propagateThroughEligibilityTrace(const RL_State& s, const R
 		}
 	}
 
+	updateQ(jobs);
+
 	// Push this experience in eligibility trace
 	eligibilityTrace.push_front(std::pair<RL_State, RL_Action>(s, a));
 
@@ -221,6 +249,39 @@ void NeuralLearning::updateQ(const RL_State& s, const RL_Action& a, float target
 
 
 
+void NeuralLearning::updateQ(const std::vector<NeuralJob>& jobs) {
+	// Sort the jobs by the network of their action
+	std::vector<std::vector<const NeuralJob*>> jobsOfNetwork(Q_ANNs.size());
+	for (const NeuralJob &job : jobs) {
+		jobsOfNetwork[model->getIndexForAction(job.action)].push_back(&job);
+	}
+
+	for (unsigned int a_idx = 0; a_idx < Q_ANNs.size(); a_idx++) {
+		const std::vector<const NeuralJob*> &batch = jobsOfNetwork[a_idx];
+		if (batch.empty()) {
+			continue;
+		}
+
+		// One pattern, teaching value and learning rate per column
+		arma::mat patterns(model->getDefaultState().parameters.size(), batch.size());
+		arma::mat teaching(1, batch.size());
+		arma::rowvec learningRates(batch.size());
+		for (unsigned int i = 0; i < batch.size(); i++) {
+			patterns.col(i)  = generatePattern(batch[i]->state, batch[i]->action);
+			teaching(0, i)   = batch[i]->targetQ;
+			learningRates(i) = learningRate * batch[i]->traceDiscount;
+		}
+
+		Q_ANNs[a_idx] -> teachBatch(patterns, teaching, learningRates);
+	}
+}
+
+
+
+/*------------------------------------------------------------------------------------------------*/
+
+
+
 float NeuralLearning::getQValue(const RL_State& s, const RL_Action& a) const {
 	//int a_idx = model->getIndexForAction2(a);
 	int a_idx = model->getIndexForAction(a);
@@ -274,19 +335,32 @@ arma::vec NeuralLearning::generatePattern(const RL_State& s, const RL_Action& a)
 
 
 void NeuralLearning::worker() {
+	std::vector<NeuralJob> jobs;
 	while (isRunning) {
-		NeuralJob job;
-		if (false == jobQueue.empty()) {
-			job = jobQueue.front();
-			jobQueue.pop();
-
+		{
 			CriticalSectionLock lock(cs);
-			updateQ(job.state, job.action, job.targetQ, job.traceDiscount);
 
-			if (jobQueue.size() < 1000) {
-				jobQueue.push(job);
+			// Teach up to maxJobsPerBatch jobs at once
+			jobs.clear();
+			while (false == jobQueue.empty() && jobs.size() < maxJobsPerBatch) {
+				jobs.push_back(jobQueue.front());
+				jobQueue.pop();
+			}
+
+			if (false == jobs.empty()) {
+				updateQ(jobs);
+
+				for (const NeuralJob &job : jobs) {
+					if (jobQueue.size() < 1000) {
+						jobQueue.push(job);
+					}
+				}
 			}
 		}
+
+		if (jobs.empty()) {
+			std::this_thread::yield();
+		}
 	}
 }
 
@@ -19,6 +19,7 @@
 
 
 #include "rlModel.h"
+#include "platform/system/thread.h"
 #include "tools/concurrency/threadSafeQueue.h"
 
 #include "messages/msg_repatd.pb.h"
@@ -112,6 +113,16 @@ public:
 	float getBestQValueForState(const RL_State& s) const;
 
 
+	/**
+	 * Computes the Q-Values of all actions for a state at once.
+	 * The pattern of the state is generated only once and fed to the networks of all actions.
+	 *
+	 * @param s State to get the Q-Values for
+	 * @return Q-Value of each action, indexed by the action's index
+	 */
+	arma::vec getQValuesForState(const RL_State& s) const;
+
+
 	/**
 	 * This method delivers the best action for a given state by using
 	 * the Q-Function, calculated by the QLearning algorithm.
@@ -170,6 +181,15 @@ public:
 	void updateQ(const RL_State& s, const RL_Action& a, float targetQ, float traceDiscount);
 
 
+	/**
+	 * Updates the Q-Values for several jobs. The jobs are grouped by their action and
+	 * each action's network is taught its jobs in one batch.
+	 *
+	 * @param jobs The states and actions to update with their target Q-Values and trace discounts
+	 */
+	void updateQ(const std::vector<NeuralJob>& jobs);
+
+
 	/**
 	 * If we already have an experience for the state at the given index, we return
 	 * the Q-Value. Otherwise return 0.
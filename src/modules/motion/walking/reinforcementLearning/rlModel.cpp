@@ -17,7 +17,7 @@ RL_Model::RL_Model()
 : numberOfStates(0)
 , numberOfActions(0)
 {
-	// Empty!
+	radialDistances.fill(0);
 }
 
 
@@ -29,6 +29,11 @@ void RL_Model::addStateParameter(string name, int defaultValue, int minValue, in
 	// Add new parameter only if it does not exist yet.
 	if (stateSpace.find(name) != stateSpace.end()) { return; }
 
+	if (stateSpace.size() >= RL_MAX_PARAMETERS) {
+		ERROR("Model::addStateParameter(): Too many state parameters, ignoring %s", name.c_str());
+		return;
+	}
+
 	int range = 1 + maxValue - minValue;
 	stateSpace[name] = {defaultValue, minValue, maxValue, range, radialDistance};
 
@@ -40,6 +45,12 @@ void RL_Model::addStateParameter(string name, int defaultValue, int minValue, in
 
 	// We need the new index shifts to be able to compute the new actions
 	indexShiftsStates = computeIndexShiftsStates();
+	stateEncoding     = computeEncoding(stateSpace, indexShiftsStates);
+
+	int p = 0;
+	for (auto it(stateSpace.begin()); it != stateSpace.end(); ++it, ++p) {
+		radialDistances[p] = it->second.radialDistance;
+	}
 }
 
 
@@ -50,6 +61,11 @@ void RL_Model::addActionParameter(string name, int defaultValue, int minValue, i
 	// Add new parameter only if it does not exist yet.
 	if (actionSpace.find(name) != actionSpace.end()) { return; }
 
+	if (actionSpace.size() >= RL_MAX_PARAMETERS) {
+		ERROR("Model::addActionParameter(): Too many action parameters, ignoring %s", name.c_str());
+		return;
+	}
+
 	int range = 1 + maxValue - minValue;
 	actionSpace[name] = {defaultValue, minValue, maxValue, range, impact};
 
@@ -61,6 +77,7 @@ void RL_Model::addActionParameter(string name, int defaultValue, int minValue, i
 
 	// We need the new index shifts to be able to compute the new actions
 	indexShiftsActions = computeIndexShiftsActions();
+	actionEncoding     = computeEncoding(actionSpace, indexShiftsActions);
 	actions = computeAllActions();
 }
 
@@ -68,20 +85,20 @@ void RL_Model::addActionParameter(string name, int defaultValue, int minValue, i
 /*------------------------------------------------------------------------------------------------*/
 
 
+// The parameters of the action and the encoding are both sorted by name,
+// so they are walked through side by side instead of looking up every name.
 int RL_Model::getIndexForAction(const RL_Action& action) const {
 	unsigned int index = 0;
+	int p = 0;
 	for (auto it(action.parameters.begin()); it != action.parameters.end(); ++it) {
-		int localPos = 0;
-		if (actionSpace.count(it->first)) {
-			localPos = it->second - actionSpace.at(it->first).minValue;
-		} else {
-			printf("Model::getIndexForAction(): No such action-parameter: %s\n", it->first.c_str());
+		while (p < actionEncoding.numberOfParameters && actionEncoding.names[p] < it->first) {
+			p++;
 		}
 
-		if (indexShiftsActions.count(it->first)) {
-			index += localPos * indexShiftsActions.at(it->first);
+		if (p < actionEncoding.numberOfParameters && actionEncoding.names[p] == it->first) {
+			index += (it->second - actionEncoding.minValues[p]) * actionEncoding.strides[p];
 		} else {
-			printf("Model::getIndexForAction(): No such indexShift: %s\n", it->first.c_str());
+			printf("Model::getIndexForAction(): No such action-parameter: %s\n", it->first.c_str());
 		}
 	}
 	return index;
@@ -93,17 +110,16 @@ int RL_Model::getIndexForAction(const RL_Action& action) const {
 
 int RL_Model::getIndexForState(const RL_State& state) const {
 	unsigned int index = 0;
+	int p = 0;
 	for (auto it(state.parameters.begin()); it != state.parameters.end(); ++it) {
-		int localPos = 0;
-		if (stateSpace.count(it->first)) {
-			localPos = it->second - stateSpace.at(it->first).minValue;
-		} else {
-			printf("Model::getIndexForState(): No such state-parameter: %s\n", it->first.c_str());
+		while (p < stateEncoding.numberOfParameters && stateEncoding.names[p] < it->first) {
+			p++;
 		}
-		if (indexShiftsStates.count(it->first)) {
-			index += localPos * indexShiftsStates.at(it->first);
+
+		if (p < stateEncoding.numberOfParameters && stateEncoding.names[p] == it->first) {
+			index += (it->second - stateEncoding.minValues[p]) * stateEncoding.strides[p];
 		} else {
-			printf("Model::getIndexForState(): No such indexShift: %s\n", it->first.c_str());
+			printf("Model::getIndexForState(): No such state-parameter: %s\n", it->first.c_str());
 		}
 	}
 	return index;
@@ -146,15 +162,12 @@ bool RL_Model::actionIndexIsValid(int index) const {
 
 
 RL_State RL_Model::getStateForIndex(int index) const {
+	RL_Coordinates coordinates;
+	stateEncoding.decode(index, coordinates);
+
 	RL_State state;
-	for (auto it(stateSpace.rbegin()); it != stateSpace.rend(); ++it) {
-		if (indexShiftsStates.count(it->first)) {
-			int parameterValue = index / int(indexShiftsStates.at(it->first));
-			state.parameters[it->first] = parameterValue + it->second.minValue;
-			index -= parameterValue * indexShiftsStates.at(it->first);
-		} else {
-			printf("Model::getStateForIndex(%d): No such state-parameter: %s\n", index, it->first.c_str());
-		}
+	for (int p = 0; p < stateEncoding.numberOfParameters; p++) {
+		state.parameters[stateEncoding.names[p]] = coordinates[p] + stateEncoding.minValues[p];
 	}
 	return state;
 }
@@ -164,15 +177,12 @@ RL_State RL_Model::getStateForIndex(int index) const {
 
 
 RL_Action RL_Model::getActionForIndex(int index) const {
+	RL_Coordinates coordinates;
+	actionEncoding.decode(index, coordinates);
+
 	RL_Action action;
-	for (auto it(actionSpace.rbegin()); it != actionSpace.rend(); ++it) {
-		if (indexShiftsActions.count(it->first)) {
-			int parameterValue = index / int(indexShiftsActions.at(it->first));
-			action.parameters[it->first] = parameterValue + it->second.minValue;
-			index -= parameterValue * indexShiftsActions.at(it->first);
-		} else {
-			printf("Model::getActionForIndex(%d): No such action-parameter: %s\n", index, it->first.c_str());
-		}
+	for (int p = 0; p < actionEncoding.numberOfParameters; p++) {
+		action.parameters[actionEncoding.names[p]] = coordinates[p] + actionEncoding.minValues[p];
 	}
 	return action;
 }
@@ -312,6 +322,23 @@ map<string, int> RL_Model::computeIndexShiftsActions() {
 /*------------------------------------------------------------------------------------------------*/
 
 
+template<class Space>
+RL_Encoding RL_Model::computeEncoding(const Space& space, const map<string, int>& indexShifts) {
+	RL_Encoding encoding;
+	for (auto it(space.begin()); it != space.end(); ++it) {
+		int p = encoding.numberOfParameters++;
+		encoding.names.push_back(it->first);
+		encoding.strides[p]   = indexShifts.at(it->first);
+		encoding.minValues[p] = it->second.minValue;
+		encoding.ranges[p]    = it->second.range;
+	}
+	return encoding;
+}
+
+
+/*------------------------------------------------------------------------------------------------*/
+
+
 double RL_Model::getImpact(std::string actionParameterName) {
 	if (actionSpace.count(actionParameterName)) {
 		return actionSpace[actionParameterName].impact;
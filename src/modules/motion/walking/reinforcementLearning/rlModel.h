@@ -10,6 +10,7 @@
 #ifndef RLMODEL_H_
 #define RLMODEL_H_
 
+#include <array>
 #include <map>
 #include <string>
 #include <vector>
@@ -54,6 +55,56 @@ struct RL_ActionParameter {
 };
 
 
+/**
+ * The maximal number of state parameters (and of action parameters) of a model.
+ */
+#define RL_MAX_PARAMETERS 16
+
+
+/**
+ * The values of all parameters of a state (or an action) in the fixed order of the model's
+ * encoding, each relative to the parameter's minValue.
+ * These are the digits of the mixed-radix index: index = sum(coordinates[p] * strides[p]).
+ */
+typedef std::array<int, RL_MAX_PARAMETERS> RL_Coordinates;
+
+
+/**
+ * The compiled encoding of a parameter space: the parameters in a fixed order (the order of the
+ * names, like in the stateSpace / actionSpace map) with their strides within the index.
+ */
+struct RL_Encoding {
+	int numberOfParameters;
+	std::vector<std::string> names;
+	RL_Coordinates strides;
+	RL_Coordinates minValues;
+	RL_Coordinates ranges;
+
+	RL_Encoding()
+		: numberOfParameters(0)
+	{
+		strides.fill(0);
+		minValues.fill(0);
+		ranges.fill(0);
+	}
+
+	inline int encode(const RL_Coordinates& coordinates) const {
+		int index = 0;
+		for (int p = 0; p < numberOfParameters; p++) {
+			index += coordinates[p] * strides[p];
+		}
+		return index;
+	}
+
+	inline void decode(int index, RL_Coordinates& coordinates) const {
+		for (int p = numberOfParameters - 1; p >= 0; p--) {
+			coordinates[p] = index / strides[p];
+			index -= coordinates[p] * strides[p];
+		}
+	}
+};
+
+
 /**
  *  A sample is an experience the agent uses to learn.
  */
@@ -81,6 +132,10 @@ public:
 	std::map <std::string, int> indexShiftsActions;   // What to add/subtract to a state's index, when changing a certain parameter.
 	std::map <std::string, int> indexShiftsStates;    // What to add/subtract to a state's index, when changing a certain parameter.
 
+	RL_Encoding stateEncoding;                        // The state parameters in the order of the digits of a state's index
+	RL_Encoding actionEncoding;                       // The action parameters in the order of the digits of an action's index
+	RL_Coordinates radialDistances;                   // radialDistance of the state parameters, ordered like stateEncoding
+
 
 	RL_Model();
 
@@ -133,6 +188,29 @@ public:
 	int getIndexForAction(const RL_Action& action) const;
 
 
+	/**
+	 * Computes the coordinates of the state with the given index (see RL_Coordinates).
+	 * Other than getStateForIndex() this needs no lookups by name and allocates nothing.
+	 *
+	 * @param index Index of the state
+	 * @param coordinates The values of the state's parameters relative to their minValue
+	 */
+	inline void getCoordinatesForStateIndex(int index, RL_Coordinates& coordinates) const {
+		stateEncoding.decode(index, coordinates);
+	}
+
+
+	/**
+	 * Computes the index of the state with the given coordinates (see RL_Coordinates).
+	 *
+	 * @param coordinates The values of the state's parameters relative to their minValue
+	 * @return The index of the state.
+	 */
+	inline int getStateIndexForCoordinates(const RL_Coordinates& coordinates) const {
+		return stateEncoding.encode(coordinates);
+	}
+
+
 	/**
 	 * Returns true, if the parameters, represented by the given index are
 	 * within the bounds of the parameter space. Returns false, if it is outside.
@@ -288,6 +366,17 @@ private:
 	std::map<std::string, int> computeIndexShiftsActions();
 
 
+	/**
+	 * Helper function.
+	 * Compiles the encoding of the state parameters or the action parameters
+	 * from the index shifts.
+	 *
+	 * @return Parameters in the order of the digits of the index with their strides
+	 */
+	template<class Space>
+	static RL_Encoding computeEncoding(const Space& space, const std::map<std::string, int>& indexShifts);
+
+
 	/**
 	 * Computes a list (map) of all possible actions
 	 * @return
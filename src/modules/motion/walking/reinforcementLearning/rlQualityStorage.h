@@ -9,80 +9,131 @@
 #define RLQUALITYSTORAGE_H_
 
 #include "debug.h"
+#include "rlModel.h"
 
-#include <vector>
-
-/*------------------------------------------------------------------------------------------------*/
-
-struct ActionsForState {
-	// constructor
-	ActionsForState(int numberOfActions)
-		: numberOfActions(numberOfActions)
-	{
-		// reserve 10 initial values set to zero
-		actionValues.resize(numberOfActions, 0);
-		hasLearned = false;
-	}
-
-	const float& operator[](unsigned index) const {
-		return actionValues[index];
-	}
-
-	void setAction(int action, float value) {
-		ASSERT((int)actionValues.size() == numberOfActions);
-		actionValues[action] = value;
-		hasLearned = true;
-	}
-
-	// the action values
-	std::vector<float> actionValues;
-
-	bool hasLearned;
-	int numberOfActions;
-};
+#include <atomic>
+#include <cmath>
+#include <memory>
+#include <new>
 
+#include <stdint.h>
+#include <stdlib.h>
 
 /*------------------------------------------------------------------------------------------------*/
 
+/*
+ * The Q-values of all states and actions in one contiguous array (numberOfStates x numberOfActions,
+ * the actions of a state are adjacent) that starts at a cache line, plus one bit per state that
+ * tells whether anything was learned for it yet.
+ *
+ * All values are atomics, update() is a compare-and-swap loop. So any number of threads may read
+ * and update concurrently without locking, as long as nobody calls init() at the same time.
+ */
 class RLQualityStorage {
 public:
+	static const size_t CACHE_LINE_SIZE = 64;
+
 	RLQualityStorage()
-		: numberOfActions(0)
+		: numberOfStates(0)
+		, numberOfActions(0)
 	{}
 
 	void init(const RL_Model* model) {
 		init(model->numberOfStates, model->numberOfActions);
 	}
 
-	void init(unsigned int  expectedStorageCapacity, unsigned int numberOfActions) {
-		storage.clear();
+	void init(unsigned int numberOfStates, unsigned int numberOfActions) {
+		this->numberOfStates  = numberOfStates;
 		this->numberOfActions = numberOfActions;
-		if (expectedStorageCapacity > 0)
-			storage.resize(expectedStorageCapacity, numberOfActions);
+
+		size_t count = size_t(numberOfStates) * numberOfActions;
+		void *memory = nullptr;
+		if (count > 0 && 0 != posix_memalign(&memory, CACHE_LINE_SIZE, count * sizeof(std::atomic<float>))) {
+			throw std::bad_alloc();
+		}
+
+		values.reset(static_cast<std::atomic<float>*>(memory));
+		for (size_t i = 0; i < count; ++i) {
+			new (&values[i]) std::atomic<float>(0.f);
+		}
+
+		size_t words = (numberOfStates + 63) / 64;
+		learned.reset(words > 0 ? new std::atomic<uint64_t>[words] : nullptr);
+		for (size_t i = 0; i < words; ++i) {
+			learned[i].store(0, std::memory_order_relaxed);
+		}
 	}
 
+	/// number of states
 	size_t size() const {
-		return storage.size();
+		return numberOfStates;
 	}
 
-	const ActionsForState& operator[](unsigned index) const {
-		return storage[index];
+	inline unsigned int getNumberOfActionsPerState() const {
+		return numberOfActions;
 	}
 
-	ActionsForState& operator[](unsigned index) {
-		if (index >= storage.size()) {
-			storage.resize(index+1, numberOfActions);
-		}
+	/// whether any action of the state was set yet
+	inline bool hasLearned(unsigned state) const {
+		ASSERT(state < numberOfStates);
+		return (learned[state / 64].load(std::memory_order_acquire) >> (state % 64)) & 1;
+	}
 
-		return storage[index];
+	/// the value of the action in the state, 0 if nothing was learned for the state
+	inline float get(unsigned state, unsigned action) const {
+		return at(state, action).load(std::memory_order_relaxed);
 	}
 
-	inline unsigned int getNumberOfActionsPerState() const {
-		return numberOfActions;
+	inline void set(unsigned state, unsigned action, float value) {
+		at(state, action).store(value, std::memory_order_relaxed);
+		markLearned(state);
+	}
+
+	/**
+	 * atomically replace the value of the action in the state by f(value)
+	 * a new value that is not finite is dropped
+	 * @return whether the value was replaced
+	 */
+	template<typename F>
+	bool update(unsigned state, unsigned action, F f) {
+		std::atomic<float> &value = at(state, action);
+
+		float current = value.load(std::memory_order_relaxed);
+		float next;
+		do {
+			next = f(current);
+			if (false == std::isfinite(next)) {
+				return false;
+			}
+		} while (false == value.compare_exchange_weak(current, next, std::memory_order_relaxed));
+
+		markLearned(state);
+		return true;
 	}
 
 private:
-	std::vector<ActionsForState> storage;
+	struct FreeDeleter {
+		void operator()(std::atomic<float> *memory) const {
+			free(memory);
+		}
+	};
+
+	inline std::atomic<float>& at(unsigned state, unsigned action) const {
+		ASSERT(state < numberOfStates && action < numberOfActions);
+		return values[size_t(state) * numberOfActions + action];
+	}
+
+	inline void markLearned(unsigned state) {
+		uint64_t bit = uint64_t(1) << (state % 64);
+		if (0 == (learned[state / 64].load(std::memory_order_relaxed) & bit)) {
+			learned[state / 64].fetch_or(bit, std::memory_order_release);
+		}
+	}
+
+	std::unique_ptr<std::atomic<float>[], FreeDeleter> values;
+	std::unique_ptr<std::atomic<uint64_t>[]>           learned;
+
+	unsigned int numberOfStates;
 	unsigned int numberOfActions;
 };
 
@@ -7,6 +7,7 @@
 
 #include "rlREPATD.h"
 
+#include <algorithm>
 #include <fstream>
 #include <iostream>
 //#include <thread>
@@ -15,7 +16,9 @@
 #include <stdlib.h>
 
 #include "debug.h"
+#include "debugging/stopwatch.h"
 #include "utils/utils.h"
+#include "management/config/configRegistry.h"
 
 #include <google/protobuf/io/zero_copy_stream_impl.h>
 
@@ -24,6 +27,12 @@
 using namespace std;
 
 
+/*------------------------------------------------------------------------------------------------*/
+
+
+namespace {
+	auto cfgWorkerThreads = ConfigRegistry::registerOption<int>("motions.learningwalker.repatdWorkers", 2, "Number of threads performing the radial expansions of REPATD");
+}
 
 
 /*------------------------------------------------------------------------------------------------*/
@@ -39,7 +48,7 @@ RL_REPATD::RL_REPATD()
 	, traceLength(0)
 	, traceDecayRate(0)
 	, jobQueue(256)
-	, workerAtWork(false)
+	, accessingQ(0)
 
 	, initialized(false)
 	, isRunning(true)
@@ -48,9 +57,6 @@ RL_REPATD::RL_REPATD()
 	isSaving.store(false);
 	isLoading.store(false);
 	isRunning.store(true);
-
-	cs.setName("REPATD_WORKER");
-	notWorking.setName("REPATD NOT WORKING");
 }
 
 
@@ -58,17 +64,18 @@ RL_REPATD::RL_REPATD()
 
 
 RL_REPATD::~RL_REPATD() {
-	while (true == workerAtWork.load()) {
-		std::this_thread::yield();
-	}
-
 	isRunning.store(false);
 	isLoading.store(false);
 	isSaving.store(false);
 	initialized.store(false);
 
-	if (workerThread.joinable())
-		workerThread.join();
+	// wake up the workers waiting for a job
+	jobQueue.stop();
+
+	for (std::thread &workerThread : workerThreads) {
+		if (workerThread.joinable())
+			workerThread.join();
+	}
 
 	printf("REPATD DONE.\n");
 }
@@ -85,8 +92,7 @@ void RL_REPATD::init(RL_Model* _model, float _discountRate, float _traceDecayRat
 	traceLength        = _traceLength;
 	learningRate       = _learningRate;
 
-	granularityRatios  = computeGranularityRatios();
-	radialExpansionList    = computeRadialExpansion();
+	prepareRadialExpansion();
 
 	initialized.store(true);
 
@@ -94,7 +100,10 @@ void RL_REPATD::init(RL_Model* _model, float _discountRate, float _traceDecayRat
 
 	printf("REPATD: INITIALIZED\n");
 
-	workerThread = std::thread(&RL_REPATD::worker, this);
+	int numberOfWorkers = std::max(1, cfgWorkerThreads->get());
+	for (int i = 0; i < numberOfWorkers; i++) {
+		workerThreads.push_back(std::thread(&RL_REPATD::worker, this));
+	}
 }
 
 
@@ -103,15 +112,13 @@ void RL_REPATD::init(RL_Model* _model, float _discountRate, float _traceDecayRat
 
 // Compute: max_a : Q(s, a)
 float RL_REPATD::getBestQValueForState(int s) const {
-	CriticalSectionLock lock2(notWorking);
+	QAccess access(*this);
 
 	// return default value if we are currently loading
-	if (true == isLoading.load())
+	if (false == access.isValid())
 		return 0.;
 
-	CriticalSectionLock lock(cs);
-
-	if (false == Q[s].hasLearned)
+	if (false == Q.hasLearned(s))
 		return 0;
 
 	float bestValue = -INFINITY;
@@ -134,16 +141,14 @@ float RL_REPATD::getBestQValueForState(int s) const {
 
 // Compute: argmax_a : Q(s, a)
 int RL_REPATD::getBestActionIndexForState(int s, bool currentlyLearning) const {
-	CriticalSectionLock lock2(notWorking);
+	QAccess access(*this);
 
 	// return default if we are loading
-	if (true == isLoading.load())
+	if (false == access.isValid())
 		return model->getDefaultActionIndex();
 
-	CriticalSectionLock lock(cs);
-
 	// If there is no experience yet
-	if (false == Q[s].hasLearned) {
+	if (false == Q.hasLearned(s)) {
 		if (currentlyLearning) {
 			return model->getRandomActionIndex();
 		} else {
@@ -197,10 +202,10 @@ RL_Action RL_REPATD::getEGreedyActionForState(const RL_State& s, float epsilon)
 
 
 void RL_REPATD::updateBySample(const RL_Sample& sample) {
-	CriticalSectionLock lock(notWorking);
+	QAccess access(*this);
 
-	// Don't update if current model is being saved
-	if (true == isSaving.load())
+	// Don't update if current model is being saved or loaded
+	if (false == access.isValid() || true == isSaving.load())
 		return;
 
 	int s      = model->getIndexForState(sample.state);
@@ -251,13 +256,34 @@ void RL_REPATD::propagateThroughEligibilityTrace(int s, int a, float targetQ) {
 
 
 
-void RL_REPATD::performRadialExpansion(int state, int action, float targetQ,  float traceDiscount) {
-	for (unsigned int i = 0; i < radialExpansionList.size(); i++) {
-		int neighborStateIndex = state + radialExpansionList[i].diffIndex;
-		if (isInRadialDistance(state, neighborStateIndex)) {
-			if (model->stateIndexIsValid(neighborStateIndex)) {
-				updateQ(neighborStateIndex, action, targetQ, radialExpansionList[i].distanceDiscount, traceDiscount);
-			}
+void RL_REPATD::performRadialExpansion(int state, int action, float targetQ,  float traceDiscount, std::vector<char> &isInStateSpace) {
+	QAccess access(*this);
+
+	if (false == access.isValid() || true == isSaving.load())
+		return;
+
+	RL_Coordinates coordinates;
+	model->getCoordinatesForStateIndex(state, coordinates);
+
+	// A neighbour exists iff every parameter stays within its range. Checked for all entries
+	// parameter by parameter, so the inner loop is branch-free and can be vectorized.
+	const int numberOfEntries = radialExpansion.entries.size();
+	isInStateSpace.assign(numberOfEntries, 1);
+	for (int p = 0; p < model->stateEncoding.numberOfParameters; p++) {
+		const int lowerBound = -coordinates[p];
+		const int upperBound = model->stateEncoding.ranges[p] - 1 - coordinates[p];
+		const int *offsets   = radialExpansion.offsets[p].data();
+		char *inside         = isInStateSpace.data();
+
+		for (int i = 0; i < numberOfEntries; i++) {
+			inside[i] &= (offsets[i] >= lowerBound) & (offsets[i] <= upperBound);
+		}
+	}
+
+	for (int i = 0; i < numberOfEntries; i++) {
+		if (isInStateSpace[i]) {
+			const RadialExpansionEntry &entry = radialExpansion.entries[i];
+			updateQ(state + entry.diffIndex, action, targetQ, entry.distanceDiscount, traceDiscount);
 		}
 	}
 }
@@ -269,19 +295,13 @@ void RL_REPATD::performRadialExpansion(int state, int action, float targetQ,  fl
 
 
 void RL_REPATD::updateQ(int state, int action, float targetQ, float distanceDiscount, float traceDiscount) {
-	CriticalSectionLock lock(notWorking);
-
-	if (true == isLoading.load() || true == isSaving.load())
-		return;
+	float rate = learningRate * distanceDiscount * traceDiscount;
 
-	float qValue = getQValue(state, action);
-	float error = (targetQ - qValue);
-	float new_value = qValue + (learningRate * distanceDiscount * traceDiscount * error);
-
-	if (new_value != INFINITY && new_value != -INFINITY && new_value != NAN) {
-		CriticalSectionLock lock(cs);
-		Q[state].setAction(action, new_value);
-	}
+	// a value that was not learned yet is 0
+	Q.update(state, action, [targetQ, rate](float qValue) {
+		float error = (targetQ - qValue);
+		return qValue + (rate * error);
+	});
 }
 
 
@@ -339,9 +359,16 @@ float RL_REPATD::getDistance(const RL_State& s1, const RL_State& s2) const {
 
 
 float RL_REPATD::getDistance(int s1, int s2) const {
-	RL_State state1 = model->getStateForIndex(s1);
-	RL_State state2 = model->getStateForIndex(s2);
-	return getDistance(state1, state2);
+	RL_Coordinates state1, state2;
+	model->getCoordinatesForStateIndex(s1, state1);
+	model->getCoordinatesForStateIndex(s2, state2);
+
+	float distance = 0;
+	for (int p = 0; p < model->stateEncoding.numberOfParameters; p++) {
+		float tmpDistance = (state1[p] - state2[p]) * parameterGranularityRatios[p];
+		distance += tmpDistance * tmpDistance;
+	}
+	return sqrt(distance);
 }
 
 
@@ -367,9 +394,16 @@ bool RL_REPATD::isInRadialDistance(const RL_State& s1, const RL_State& s2) const
 
 
 bool RL_REPATD::isInRadialDistance(int s1, int s2) const {
-	RL_State state1 = model->getStateForIndex(s1);
-	RL_State state2 = model->getStateForIndex(s2);
-	return isInRadialDistance(state1, state2);
+	RL_Coordinates state1, state2;
+	model->getCoordinatesForStateIndex(s1, state1);
+	model->getCoordinatesForStateIndex(s2, state2);
+
+	for (int p = 0; p < model->stateEncoding.numberOfParameters; p++) {
+		if (std::abs(state1[p] - state2[p]) > model->radialDistances[p]) {
+			return false;
+		}
+	}
+	return true;
 }
 
 
@@ -392,19 +426,11 @@ float RL_REPATD::radial(float x, float standardDeviation) {
 
 
 
-std::vector<RadialExpansionEntry> RL_REPATD::computeRadialExpansion() {
-	std::vector<RadialExpansionEntry> radialExpansion;
+RadialExpansion RL_REPATD::computeRadialExpansion() {
+	RadialExpansion expansion;
 
 	int maxRadialDistance = 0;   // needed for discount calculation
 
-	// compute root sate index
-	RL_State rState;
-	for (auto it(model->stateSpace.begin()); it != model->stateSpace.end(); ++it) {
-		rState.parameters[it->first] = int((it->second.maxValue + it->second.minValue) / 2);
-	}
-	int rootIndex = model->getIndexForState(rState);
-
-
 	// Create clockwork
 	std::vector<int> cw_minValues;
 	std::vector<int> cw_maxValues;
@@ -432,16 +458,42 @@ std::vector<RadialExpansionEntry> RL_REPATD::computeRadialExpansion() {
 			tmp_n++;
 		}
 
+		// the clockwork counts the parameters in the order of the state space, just like the encoding,
+		// so its values are the offsets of the neighbour's coordinates
+		RL_Coordinates offsets;
+		offsets.fill(0);
+		for (int p = 0; p < tmp_n; p++) {
+			offsets[p] = cw->getValue()[p];
+			expansion.offsets[p].push_back(offsets[p]);
+		}
+
 		// use the state to compute entry for radial expansion
 		RadialExpansionEntry entry;
-		entry.diffIndex        = model->getIndexForState(tmpState) - rootIndex;
+		entry.diffIndex        = model->getStateIndexForCoordinates(offsets);
 		entry.distanceDiscount = radial(getDistance(rootState, tmpState), maxRadialDistance / 3.0);
-		radialExpansion.push_back(entry);
+		expansion.entries.push_back(entry);
 
 		cw->increment();
 	}
+	delete cw;
+
+	return expansion;
+}
+
+
+/*------------------------------------------------------------------------------------------------*/
+
+
+
+void RL_REPATD::prepareRadialExpansion() {
+	granularityRatios = computeGranularityRatios();
+
+	parameterGranularityRatios.fill(0);
+	for (int p = 0; p < model->stateEncoding.numberOfParameters; p++) {
+		parameterGranularityRatios[p] = granularityRatios.at(model->stateEncoding.names[p]);
+	}
 
-	return radialExpansion;
+	radialExpansion = computeRadialExpansion();
 }
 
 
@@ -451,16 +503,12 @@ std::vector<RadialExpansionEntry> RL_REPATD::computeRadialExpansion() {
 
 
 float RL_REPATD::getQValue(int s, int a) const {
-	CriticalSectionLock lock(notWorking);
+	QAccess access(*this);
 
-	if (true == isLoading.load())
+	if (false == access.isValid())
 		return 0.;
 
-	if (Q[s].hasLearned) {
-		return Q[s][a];
-	} else {
-		return 0.0;
-	}
+	return Q.get(s, a);
 }
 
 
@@ -470,13 +518,10 @@ float RL_REPATD::getQValue(int s, int a) const {
 
 
 void RL_REPATD::saveWhatWasLearnedAsync(string fileName) {
-	{
-		CriticalSectionLock lock(notWorking);
-		bool expectedCurrentValue = false;
-		if (!isSaving.compare_exchange_strong(expectedCurrentValue, true)) {
-			ERROR("saveWhatWasLearned called while already saving");
-			return; // Don't save if a saving routine is already running
-		}
+	bool expectedCurrentValue = false;
+	if (!isSaving.compare_exchange_strong(expectedCurrentValue, true)) {
+		ERROR("saveWhatWasLearned called while already saving");
+		return; // Don't save if a saving routine is already running
 	}
 
 	std::thread t(&RL_REPATD::saveWhatWasLearned, this, fileName);
@@ -564,10 +609,10 @@ void RL_REPATD::saveWhatWasLearned(string fileName) {
 
 	std::stringstream outputStr;
 	for (int stateIndex = 0; stateIndex < (int)Q.size(); stateIndex++) {
-		if (Q[stateIndex].hasLearned) {
+		if (Q.hasLearned(stateIndex)) {
 			outputStr.write("1", 1);
 			for (unsigned int actionIndex = 0; actionIndex < Q.getNumberOfActionsPerState(); actionIndex++) {
-				float value = Q[stateIndex][actionIndex];
+				float value = Q.get(stateIndex, actionIndex);
 				outputStr.write( reinterpret_cast< const char* >( &value ), sizeof(value) );
 			}
 		} else {
@@ -611,6 +656,12 @@ bool RL_REPATD::loadWhatWasLearned(string fileName) {
 	ASSERT(true == isLoading.load());
 	ASSERT(true == isInitialized());
 
+	// the model and Q are replaced below, wait until nobody uses them anymore
+	{
+		std::unique_lock<std::mutex> lock(accessMutex);
+		accessReleasedCV.wait(lock, [this]{ return accessingQ.load() == 0; });
+	}
+
 	robottime_t sysTime = getCurrentTime();
 
 	loadingSucceeded = false;
@@ -669,8 +720,7 @@ sysTime = getCurrentTime();
 	learningRate   = repatd.learningrate();
 	traceLength    = repatd.tracelength();
 
-	granularityRatios   = computeGranularityRatios();
-	radialExpansionList = computeRadialExpansion();
+	prepareRadialExpansion();
 
 printf("runtime --- setup:\t%.1f ms\n", (getCurrentTime()-sysTime).value());
 sysTime = getCurrentTime();
@@ -697,11 +747,16 @@ sysTime = getCurrentTime();
 				break;
 			}
 
+			if (stateIndex >= Q.size()) {
+				WARNING("REPATD: Stored Q has more states than the model, ignoring the rest.");
+				break;
+			}
+
 			// if this state was learned, read the actions
 			if (learned == '1') {
 				for (unsigned int actionIndex = 0; actionIndex < Q.getNumberOfActionsPerState(); actionIndex++) {
 					data.read( reinterpret_cast< char* >( &value ), sizeof(value) );
-					Q[stateIndex].setAction(actionIndex, value);
+					Q.set(stateIndex, actionIndex, value);
 				}
 			}
 
@@ -715,7 +770,9 @@ printf("Read %d states\n", stateIndex);
 			int s_idx   = repatd.q().entry(e).state();
 			int a_idx   = repatd.q().entry(e).action();
 			float value = repatd.q().entry(e).value();
-			Q[s_idx].setAction(a_idx, value);
+			if (s_idx >= 0 && s_idx < (int)Q.size() && a_idx >= 0 && a_idx < (int)Q.getNumberOfActionsPerState()) {
+				Q.set(s_idx, a_idx, value);
+			}
 		}
 	}
 
@@ -738,26 +795,15 @@ sysTime = getCurrentTime();
 
 
 void RL_REPATD::worker() {
-	while (   false == isRunning.load()
-	       || false == initialized.load()
-	       || true == isSaving.load()
-	       || true == isLoading.load())
-	{
-		std::this_thread::yield();
-	}
-
-
+	// workers are started by init(), jobs only come afterwards
 	printf("REPATD: Worker Thread started\n");
 
-	while (isRunning.load()) {
-		workerAtWork = true;
-		RadialExpansionJob job;
-		bool thereIsNewJob = jobQueue.dequeue(job);
-
-		if (thereIsNewJob) {
-			performRadialExpansion(job.stateIndex, job.actionIndex, job.targetQ, job.traceDiscount);
-		}
-		workerAtWork = false;
+	RadialExpansionJob job;
+	std::vector<char> isInStateSpace;
+	while (isRunning.load() && jobQueue.dequeue_wait(job)) {
+		STOPWATCH_START("motion.runtimes", "REPATD.radialExpansion");
+		performRadialExpansion(job.stateIndex, job.actionIndex, job.targetQ, job.traceDiscount, isInStateSpace);
+		STOPWATCH_STOP("motion.runtimes", "REPATD.radialExpansion");
 	}
 	printf("REPATD: Worker Thread DONE.\n");
 }
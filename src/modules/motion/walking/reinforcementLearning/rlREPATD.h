@@ -9,9 +9,12 @@
 #ifndef RLREPATD_H_
 #define RLREPATD_H_
 
+#include <array>
 #include <atomic>
+#include <condition_variable>
 #include <list>
 #include <map>
+#include <mutex>
 #include <unordered_map>
 #include <string>
 #include <vector>
@@ -43,6 +46,17 @@ struct RadialExpansionEntry {
 };
 
 
+/**
+ * The radial expansion around any state. Additionally to the entries, the change of every state
+ * parameter is stored per entry, one contiguous array per parameter. This way the entries whose
+ * neighbours lie within the state space are found for all entries at once, parameter by parameter.
+ */
+struct RadialExpansion {
+	std::vector<RadialExpansionEntry> entries;
+	std::vector<int> offsets[RL_MAX_PARAMETERS];                // offsets[p][e]: change of parameter p (see RL_Encoding) for entries[e]
+};
+
+
 
 
 class RL_REPATD {
@@ -145,14 +159,16 @@ public:
 	 * @param targetQ Value for the Q-Function that the states should converge to.
 	 * @param rootState The initial state the radial expansion is starting from
 	 * @param traceDiscount How much less the next state in the eligibility trace is being influenced
+	 * @param isInStateSpace Scratch memory of the calling worker, reused for every expansion
 	 */
-	void performRadialExpansion(int state, int action, float targetQ,  float traceDiscount);
+	void performRadialExpansion(int state, int action, float targetQ,  float traceDiscount, std::vector<char> &isInStateSpace);
 
 
 	/**
 	 * A Q-Value for a given state is being updated, depending on the distance to the center of the
 	 * radial expansion on depending on the distance within the eligibility trace.
 	 * The state's current Q-Value is a weighted average of experiences.
+	 * The update is atomic, so any number of workers may update at the same time.
 	 *
 	 * @param state The state the Q-Value is updated for
 	 * @param targetQ The Value the state's Q-Value is converging to
@@ -186,6 +202,7 @@ public:
 	/**
 	 * Calculates the weighted euclidean distance.
 	 * The weights are the granularity ratios.
+	 * Works on the coordinates of the states, without creating State-Objects.
 	 *
 	 * @param s1 First State
 	 * @param s2 Second State
@@ -218,7 +235,7 @@ public:
 	 *
 	 * @return Radial Expansion stored in a spanning tree.
 	 */
-	std::vector<RadialExpansionEntry> computeRadialExpansion();
+	RadialExpansion computeRadialExpansion();
 
 
 	/**
@@ -262,6 +279,12 @@ private:
 	void worker();
 
 
+	/**
+	 * Computes everything that is derived from the model for the radial expansions.
+	 */
+	void prepareRadialExpansion();
+
+
 	/**
 	 * Loads the model and all learned information from a Protobuf Message.
 	 * Thereby model, Q, e and stateActionCounter are being overwritten.
@@ -308,18 +331,48 @@ protected:
 
 
 	// Radial Expansion
-	std::vector<RadialExpansionEntry> radialExpansionList;
+	RadialExpansion radialExpansion;
 	std::map<std::string, float> granularityRatios;             // We remember this for fast distance-calculation
+	std::array<float, RL_MAX_PARAMETERS> parameterGranularityRatios; // The same ordered like the model's RL_Encoding
 
 
-	// Worker Thread
-	mutable CriticalSection cs;
-	mutable CriticalSection notWorking;
+	// Worker Threads
 	int jobQueueLength;
 	ThreadSafeQueue<RadialExpansionJob> jobQueue;               // Queue of all the radial expansions that are jet to perform
 
-	std::thread workerThread;
-	std::atomic<bool> workerAtWork;
+	std::vector<std::thread> workerThreads;                     // Perform the radial expansions concurrently (Q is lock-free)
+	mutable std::atomic<int> accessingQ;                        // Number of threads currently using Q and the model, see QAccess
+	mutable std::mutex accessMutex;                             // Together with accessReleasedCV, lets loading wait for accessingQ to drop to 0
+	mutable std::condition_variable accessReleasedCV;
+
+
+	/**
+	 * Registers a thread as using Q and the model for the lifetime of the object.
+	 * Loading replaces both, so it waits until nobody uses them anymore. While
+	 * loading, isValid() is false and the caller must not touch them.
+	 */
+	class QAccess {
+	public:
+		QAccess(const RL_REPATD &repatd)
+			: repatd(repatd)
+		{
+			repatd.accessingQ++;
+		}
+
+		~QAccess() {
+			if (0 == --repatd.accessingQ) {
+				std::lock_guard<std::mutex> lock(repatd.accessMutex);
+				repatd.accessReleasedCV.notify_all();
+			}
+		}
+
+		bool isValid() const {
+			return false == repatd.isLoading.load();
+		}
+
+	private:
+		const RL_REPATD &repatd;
+	};
 
 	std::atomic<bool> initialized;
 	std::atomic<bool> isRunning;
@@ -54,52 +54,201 @@ void SL_NeuronalNetwork::init(vector<int> _layerDescription) {
 	}
 
 	outputErrors = arma::ones(layerDescription[layerDescription.size()-1]);
+
+	// The batch buffers get their sizes with the first batch
+	BatchBuffers buffers;
+	buffers.activations = vector<arma::mat>(layerDescription.size());
+	buffers.nets        = vector<arma::mat>(layerDescription.size() - 1);
+	buffers.errors      = vector<arma::mat>(layerDescription.size() - 1);
+	buffers.propagated  = vector<arma::mat>(layerDescription.size() - 1);
+	trainingBuffers  = buffers;
+	inferenceBuffers = buffers;
 }
 
 
 /*------------------------------------------------------------------------------------------------*/
 
 
-arma::vec SL_NeuronalNetwork::getOutputForPattern(arma::vec inputPattern) {
-	if (int(inputPattern.n_rows) != layerDescription[0]) {
-		printf("outPutForPattern :: Wrong dimensions of input pattern! Given %d, expected: %d\n", int(inputPattern.n_rows), layerDescription[0]);
+arma::vec SL_NeuronalNetwork::getOutputForPattern(const arma::vec& inputPattern) {
+	return getOutputsForPatterns(inputPattern);
+}
+
+
+/*------------------------------------------------------------------------------------------------*/
+
+
+arma::mat SL_NeuronalNetwork::getOutputsForPatterns(const arma::mat& inputPatterns) {
+	if (int(inputPatterns.n_rows) != layerDescription[0]) {
+		printf("outPutForPattern :: Wrong dimensions of input pattern! Given %d, expected: %d\n", int(inputPatterns.n_rows), layerDescription[0]);
+		return arma::zeros(layerDescription[layerDescription.size()-1], inputPatterns.n_cols);
 	}
 
-	// Augment input vector with 1
-	outputs[0] = inputPattern;
-	inputPattern = augmentOne(inputPattern);
+	feedForwardBatch(inputPatterns, inferenceBuffers);
 
-	// Propagate input through the layers
-	arma::vec output;
-	for (unsigned int layer = 1; layer < layerDescription.size(); layer++) {
-		// Compute outputs for the current layer
-		output = sigmoid(trans(arma::trans(inputPattern) * weights[layer-1]));
+	// The output layer without its row of ones
+	const arma::mat &output = inferenceBuffers.activations[layerDescription.size()-1];
+	return output.rows(0, output.n_rows - 2);
+}
 
-		// Augmented output of current layer is input of next layer
-		inputPattern = augmentOne(output);
+/*------------------------------------------------------------------------------------------------*/
+
+
+void SL_NeuronalNetwork::teachPattern(const arma::vec& inputPattern, const arma::vec& teachingPattern, double learningRate) {
+	teachBatch(inputPattern, teachingPattern, learningRate);
+	//resilientWeightUpdate(0.5, 1.2);
+}
+
+
+/*------------------------------------------------------------------------------------------------*/
+
+
+void SL_NeuronalNetwork::teachBatch(const arma::mat& inputPatterns, const arma::mat& teachingPatterns, double learningRate) {
+	if (false == checkBatch(inputPatterns, teachingPatterns)) {
+		return;
 	}
 
-	return output;
+	trainingBuffers.learningRates.set_size(inputPatterns.n_cols);
+	trainingBuffers.learningRates.fill(learningRate);
+
+	feedForwardBatch(inputPatterns, trainingBuffers);
+	backPropagationBatch(teachingPatterns);
+	batchWeightUpdate();
 }
 
+
 /*------------------------------------------------------------------------------------------------*/
 
 
-void SL_NeuronalNetwork::teachPattern(arma::vec inputPattern, arma::vec teachingPattern, double learningRate) {
-	if (int(inputPattern.n_rows) != layerDescription[0]) {
-		printf("teachPattern :: Wrong dimensions of input pattern! Given %d, expected: %d\n", int(teachingPattern.n_rows), layerDescription[0]);
+void SL_NeuronalNetwork::teachBatch(const arma::mat& inputPatterns, const arma::mat& teachingPatterns, const arma::rowvec& learningRates) {
+	if (false == checkBatch(inputPatterns, teachingPatterns)) {
 		return;
 	}
 
-	if (int(teachingPattern.n_rows) != layerDescription[layerDescription.size()-1]) {
-		printf("teachPattern :: Wrong dimensions of teaching pattern! Given %d, expected: %d\n", int(teachingPattern.n_rows), layerDescription[layerDescription.size()-1]);
+	if (learningRates.n_elem != inputPatterns.n_cols) {
+		printf("teachBatch :: Wrong number of learning rates! Given %d, expected: %d\n", int(learningRates.n_elem), int(inputPatterns.n_cols));
 		return;
 	}
 
-	feedForwardStep(inputPattern, teachingPattern);
-	backPropagationStep();
-	classicWeightUpdate(learningRate);
-	//resilientWeightUpdate(0.5, 1.2);
+	trainingBuffers.learningRates = learningRates;
+
+	feedForwardBatch(inputPatterns, trainingBuffers);
+	backPropagationBatch(teachingPatterns);
+	batchWeightUpdate();
+}
+
+
+/*------------------------------------------------------------------------------------------------*/
+
+
+bool SL_NeuronalNetwork::checkBatch(const arma::mat& inputPatterns, const arma::mat& teachingPatterns) const {
+	if (int(inputPatterns.n_rows) != layerDescription[0]) {
+		printf("teachPattern :: Wrong dimensions of input pattern! Given %d, expected: %d\n", int(inputPatterns.n_rows), layerDescription[0]);
+		return false;
+	}
+
+	if (int(teachingPatterns.n_rows) != layerDescription[layerDescription.size()-1]) {
+		printf("teachPattern :: Wrong dimensions of teaching pattern! Given %d, expected: %d\n", int(teachingPatterns.n_rows), layerDescription[layerDescription.size()-1]);
+		return false;
+	}
+
+	if (teachingPatterns.n_cols != inputPatterns.n_cols) {
+		printf("teachPattern :: Number of teaching patterns (%d) differs from number of input patterns (%d)\n", int(teachingPatterns.n_cols), int(inputPatterns.n_cols));
+		return false;
+	}
+
+	return true;
+}
+
+
+/*------------------------------------------------------------------------------------------------*/
+
+
+void SL_NeuronalNetwork::feedForwardBatch(const arma::mat& inputPatterns, BatchBuffers& buffers) {
+	const unsigned int n = inputPatterns.n_cols;
+
+	// The outputs of each layer are augmented with a row of ones for the bias weights.
+	// It only needs to be set when the buffer is resized.
+	for (unsigned int layer = 0; layer < layerDescription.size(); layer++) {
+		arma::mat &activation = buffers.activations[layer];
+		if (activation.n_rows != unsigned(layerDescription[layer] + 1) || activation.n_cols != n) {
+			activation.set_size(layerDescription[layer] + 1, n);
+			activation.row(layerDescription[layer]).fill(1.0);
+		}
+	}
+	buffers.activations[0].rows(0, layerDescription[0] - 1) = inputPatterns;
+
+	// Propagate the inputs through the layers
+	for (unsigned int layer = 1; layer < layerDescription.size(); layer++) {
+		// Weighted inputs of all units for all patterns: [k x n] = [(m+1) x k]^T * [(m+1) x n]
+		arma::mat &net = buffers.nets[layer-1];
+		net = arma::trans(weights[layer-1]) * buffers.activations[layer-1];
+
+		arma::mat &activation = buffers.activations[layer];
+		for (unsigned int col = 0; col < n; col++) {
+			for (unsigned int unit = 0; unit < net.n_rows; unit++) {
+				activation(unit, col) = sigmoid(net(unit, col));
+			}
+		}
+	}
+}
+
+
+/*------------------------------------------------------------------------------------------------*/
+
+
+void SL_NeuronalNetwork::backPropagationBatch(const arma::mat& teachingPatterns) {
+	const unsigned int n      = teachingPatterns.n_cols;
+	const unsigned int output = layerDescription.size() - 1;
+
+	// Output layer: derivative of the sigmoid times the output error
+	{
+		const arma::mat &activation = trainingBuffers.activations[output];
+		arma::mat &error = trainingBuffers.errors[output-1];
+		error.set_size(layerDescription[output], n);
+
+		for (unsigned int col = 0; col < n; col++) {
+			for (unsigned int unit = 0; unit < error.n_rows; unit++) {
+				double o = activation(unit, col);
+				error(unit, col) = o * (1.0 - o) * (o - teachingPatterns(unit, col));
+			}
+		}
+	}
+
+	// Hidden layers: derivative of the sigmoid times the error propagated back through the (non-bias) weights
+	for (unsigned int layer = output - 1; layer > 0; layer--) {
+		arma::mat &propagated = trainingBuffers.propagated[layer];
+		propagated = weights[layer] * trainingBuffers.errors[layer];
+
+		const arma::mat &activation = trainingBuffers.activations[layer];
+		arma::mat &error = trainingBuffers.errors[layer-1];
+		error.set_size(layerDescription[layer], n);
+
+		for (unsigned int col = 0; col < n; col++) {
+			for (unsigned int unit = 0; unit < error.n_rows; unit++) {
+				double o = activation(unit, col);
+				error(unit, col) = o * (1.0 - o) * propagated(unit, col);
+			}
+		}
+	}
+}
+
+
+/*------------------------------------------------------------------------------------------------*/
+
+
+void SL_NeuronalNetwork::batchWeightUpdate() {
+	const arma::rowvec &learningRates = trainingBuffers.learningRates;
+
+	for (unsigned int layer = 0; layer < layerDescription.size()-1; layer++) {
+		// Weight the errors of each sample with its learning rate
+		arma::mat &error = trainingBuffers.errors[layer];
+		for (unsigned int col = 0; col < error.n_cols; col++) {
+			error.col(col) *= learningRates(col);
+		}
+
+		// Sum of the gradients of all samples: [(m+1) x k] = [(m+1) x n] * [k x n]^T
+		weights[layer] -= trainingBuffers.activations[layer] * arma::trans(error);
+	}
 }
 
 
@@ -19,7 +19,12 @@
  * The neuronal network that is implemented in this class is a feed forward network.
  * It can be used to learn a complicated function by training the network incrementally
  * with samples. A sample consists of a pattern (input-std::vector) and a teaching-std::vector.
- * The only method you should use are: init(), teachPattern() and getOutputForPattern().
+ * The only method you should use are: init(), teachPattern() and getOutputForPattern(),
+ * or their batched variants teachBatch() and getOutputsForPatterns().
+ *
+ * The batched variants take one pattern per column and pass all of them through a layer
+ * with a single matrix product. They work on buffers that are kept between the calls, so
+ * batches of the same size do not allocate. The single pattern methods use them as well.
  */
 
 class SL_NeuronalNetwork {
@@ -35,6 +40,21 @@ public:
 	arma::vec outputErrors;
 
 
+	/**
+	 * Buffers for the batched passes through the network.
+	 */
+	struct BatchBuffers {
+		std::vector<arma::mat> activations;  // [(m+1) x n], where m = #neurons in layer i; outputs augmented with a row of ones
+		std::vector<arma::mat> nets;         // [m x n], where m = #neurons in layer i+1; weighted inputs of the units
+		std::vector<arma::mat> errors;       // [m x n], where m = #neurons in layer i+1; layer errors
+		std::vector<arma::mat> propagated;   // [(m+1) x n], where m = #neurons in layer i; errors[i] propagated back through weights[i]
+		arma::rowvec learningRates;          // [n], one per sample
+	};
+
+	BatchBuffers trainingBuffers;            // used by teachBatch()
+	BatchBuffers inferenceBuffers;           // used by getOutputsForPatterns(), so the network may be queried while it is taught
+
+
 	/**
 	 * Empty constructor
 	 */
@@ -56,7 +76,17 @@ public:
 	 * @param inputPattern Input-Vector
 	 * @return Output-Vector
 	 */
-	arma::vec getOutputForPattern(arma::vec inputPattern);
+	arma::vec getOutputForPattern(const arma::vec& inputPattern);
+
+
+	/**
+	 * Computes the outputs for several input patterns at once.
+	 * The weights of the network are not being updated.
+	 *
+	 * @param inputPatterns Input-Vectors, one per column
+	 * @return Output-Vectors, one per column
+	 */
+	arma::mat getOutputsForPatterns(const arma::mat& inputPatterns);
 
 
 	/**
@@ -67,7 +97,30 @@ public:
 	 * @param teachingPattern The correct answer to the input-std::vector
 	 * @param learningRate Speed of the gradient descent
 	 */
-	void teachPattern(arma::vec inputPattern, arma::vec teachingPattern, double learningRate);
+	void teachPattern(const arma::vec& inputPattern, const arma::vec& teachingPattern, double learningRate);
+
+
+	/**
+	 * Performs the Backpropagation algorithm for a mini-batch of samples.
+	 * The gradients of all samples are computed with the current weights and summed up,
+	 * so teaching a batch of one sample is the same as teachPattern().
+	 *
+	 * @param inputPatterns Input-Vectors, one per column
+	 * @param teachingPatterns The correct answers to the input-vectors, one per column
+	 * @param learningRate Speed of the gradient descent
+	 */
+	void teachBatch(const arma::mat& inputPatterns, const arma::mat& teachingPatterns, double learningRate);
+
+
+	/**
+	 * Performs the Backpropagation algorithm for a mini-batch of samples,
+	 * each sample with its own learning rate.
+	 *
+	 * @param inputPatterns Input-Vectors, one per column
+	 * @param teachingPatterns The correct answers to the input-vectors, one per column
+	 * @param learningRates Speed of the gradient descent for each sample
+	 */
+	void teachBatch(const arma::mat& inputPatterns, const arma::mat& teachingPatterns, const arma::rowvec& learningRates);
 
 
 	/**
@@ -162,6 +215,43 @@ public:
 
 	arma::vec maxToOne(arma::vec x);
 
+
+private:
+
+	/**
+	 * Helper function for the batched passes.
+	 * Computes the outputs of all layers for the input patterns.
+	 *
+	 * @param inputPatterns Input-Vectors, one per column
+	 * @param buffers Buffers to store the outputs in
+	 */
+	void feedForwardBatch(const arma::mat& inputPatterns, BatchBuffers& buffers);
+
+
+	/**
+	 * Helper function for the batched Backpropagation algorithm.
+	 * Computes the layer errors for the outputs computed by feedForwardBatch().
+	 *
+	 * @param teachingPatterns The correct answers to the input-vectors, one per column
+	 */
+	void backPropagationBatch(const arma::mat& teachingPatterns);
+
+
+	/**
+	 * Helper function for the batched Backpropagation algorithm.
+	 * Updates the weights by the gradients of all samples, each weighted with its learning rate
+	 * (trainingBuffers.learningRates).
+	 */
+	void batchWeightUpdate();
+
+
+	/**
+	 * Checks the dimensions of a batch of samples.
+	 *
+	 * @return true iff they fit to the network
+	 */
+	bool checkBatch(const arma::mat& inputPatterns, const arma::mat& teachingPatterns) const;
+
 };
 
 #endif /* SLNEURONALNETWORK_H_ */
@@ -37,20 +37,19 @@ void MotorPositionWriter::init() {
 
 
 void MotorPositionWriter::execute() {
-	auto positions = getMotorPositionRequest().getPositionRequests();
-	auto offsets   = getMotorPositionRequest().getOffsetRequests();
-	auto speeds    = getMotorPositionRequest().getSpeedRequests();
-	auto torques   = getMotorPositionRequest().getTorqueRequests();
+	MotorPositionRequest const& request = getMotorPositionRequest();
+	Actuators *actuators = getHardware().getActuators();
 
-	getHardware().getActuators()->setOffsets(offsets);
-	getHardware().getActuators()->setPositionsAndSpeeds(positions, speeds);
-	getHardware().getActuators()->setTorqueEnabled(torques);
+	actuators->setOffsets(request.getOffsetRequests());
+	actuators->setPositionsAndSpeeds(request.getPositionRequests(), request.getSpeedRequests());
+	actuators->setTorqueEnabled(request.getTorqueRequests());
 
 
 	RobotDescription const& robotDescription =*(services.getRobotModel().getRobotDescription());
-	for (auto id : robotDescription.getMotorIDs()) {
-		DEBUG_TABLE(motionMotorValuesName, robotDescription.getMotorName(id) , Degree(getMotorPositionRequest().getPositionRequests()[id]).value());
-		DEBUG_TABLE(motionMotorSpeedName, robotDescription.getMotorName(id) , getMotorPositionRequest().getSpeedRequests()[id].value());
+	MotorIndex const& motorIndex = robotDescription.getMotorIndex();
+	for (int i = 0; i < motorIndex.size(); ++i) {
+		DEBUG_TABLE(motionMotorValuesName, robotDescription.getMotorName(motorIndex.toExt(i)), request.getPositionRequests().get(i, 0*degrees).value());
+		DEBUG_TABLE(motionMotorSpeedName, robotDescription.getMotorName(motorIndex.toExt(i)), request.getSpeedRequests().get(i, 0*rounds_per_minute).value());
 	}
 
 	// hack to stay in a clean module structure
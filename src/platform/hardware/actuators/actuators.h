@@ -11,6 +11,7 @@
 #include <map>
 #include "utils/units.h"
 #include "platform/hardware/robot/motorIDs.h"
+#include "platform/hardware/robot/motorVector.h"
 
 class Actuators {
 public:
@@ -33,17 +34,17 @@ public:
 	/// get statistics about the motors
 	virtual MotorStatistics              getStatistics()  const { return {}; }
 
-	/// set the positions and speeds of the servos
-	virtual void setPositionsAndSpeeds(const std::map<MotorID, Degree> &positions, const std::map<MotorID, RPM> &speeds) {}
+	/// set the positions and speeds of the servos (only the valid ones, indexed like the robot description's MotorIndex)
+	virtual void setPositionsAndSpeeds(const MotorVector<Degree> &positions, const MotorVector<RPM> &speeds) {}
 
-	/// set the servo offsets
-	virtual void setOffsets(const std::map<MotorID, Degree> &motors) {}
+	/// set the servo offsets (only the valid ones)
+	virtual void setOffsets(const MotorVector<Degree> &motors) {}
 
 	/// save the servo offsets
 	virtual void saveOffsets() {}
 
-	/// enable/disable the torque
-	virtual void setTorqueEnabled(const std::map<MotorID, bool> &motors) {}
+	/// enable/disable the torque (only the valid ones)
+	virtual void setTorqueEnabled(const MotorVector<bool> &motors) {}
 
 	/// enable/disable the servo LEDs
 	virtual void setLED(const std::map<MotorID, bool> &active) {}
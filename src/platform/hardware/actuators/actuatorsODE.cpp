@@ -8,6 +8,7 @@
 #include "actuatorsODE.h"
 
 #include <tools/kinematicEngine/physics/ODEMotor.h>
+#include <representations/motion/kinematicTree.h>
 
 ActuatorsODE::ActuatorsODE(PhysicsEnvironment *environment, KinematicTree *tree)
 	: m_physicsEnvironment(environment)
@@ -22,6 +23,17 @@ ActuatorsODE::ActuatorsODE(PhysicsEnvironment *environment, KinematicTree *tree)
 		motorData[motor.first].position = motor.second->getCurAngle();
 		motorData[motor.first].speed    = motor.second->getCurSpeed();
 	}
+
+	/* the tree's motor indices are the ones of the motor vectors */
+	mMotorsByIndex.assign(m_tree->getMotorCt(), nullptr);
+	for (int i = 0; i < m_tree->getMotorCt(); ++i)
+	{
+		std::map<MotorID, ODEMotor*>::iterator iter = physicsMotors.find(m_tree->toExt(i));
+		if (iter != physicsMotors.end())
+		{
+			mMotorsByIndex[i] = iter->second;
+		}
+	}
 }
 
 ActuatorsODE::~ActuatorsODE() {
@@ -44,30 +56,25 @@ void ActuatorsODE::simulatorCallback(Second timeDelta)
 		motorData[motor.first].speed    = motor.second->getCurSpeed();
 	}
 
-	for (std::pair<MotorID, Degree> motor : mTargetAngles)
+	for (uint i = 0; i < mMotorsByIndex.size(); ++i)
 	{
-		std::map<MotorID, ODEMotor*>::iterator iter = physicsMotors.find(motor.first);
-		if (iter != physicsMotors.end())
+		ODEMotor *motor = mMotorsByIndex[i];
+		if (nullptr == motor)
 		{
-			iter->second->setDesiredAngle(motor.second);
+			continue;
 		}
-	}
 
-	for (std::pair<MotorID, RPM> motor : mTargetSpeeds)
-	{
-		std::map<MotorID, ODEMotor*>::iterator iter = physicsMotors.find(motor.first);
-		if (iter != physicsMotors.end())
+		if (i < (uint)mTargetAngles.size() && mTargetAngles.isValid(i))
 		{
-			iter->second->setDesiredSpeed(motor.second);
+			motor->setDesiredAngle(mTargetAngles[i]);
 		}
-	}
-
-	for (std::pair<MotorID, bool> motor : mTorqueEnabled)
-	{
-		std::map<MotorID, ODEMotor*>::iterator iter = physicsMotors.find(motor.first);
-		if (iter != physicsMotors.end())
+		if (i < (uint)mTargetSpeeds.size() && mTargetSpeeds.isValid(i))
+		{
+			motor->setDesiredSpeed(mTargetSpeeds[i]);
+		}
+		if (i < (uint)mTorqueEnabled.size() && mTorqueEnabled.isValid(i))
 		{
-			iter->second->enableMotor(motor.second);
+			motor->enableMotor(mTorqueEnabled[i]);
 		}
 	}
 
@@ -111,7 +118,7 @@ std::map<MotorID, MotorData> ActuatorsODE::getMotorData() const
 }
 
 /// set the positions and speeds of the servos
-void ActuatorsODE::setPositionsAndSpeeds(const std::map<MotorID, Degree> &positions, const std::map<MotorID, RPM> &speeds)
+void ActuatorsODE::setPositionsAndSpeeds(const MotorVector<Degree> &positions, const MotorVector<RPM> &speeds)
 {
 	CriticalSectionLock csl(m_cs);
 
@@ -120,7 +127,7 @@ void ActuatorsODE::setPositionsAndSpeeds(const std::map<MotorID, Degree> &positi
 }
 
 /// enable/disable the torque
-void ActuatorsODE::setTorqueEnabled(const std::map<MotorID, bool> &motors)
+void ActuatorsODE::setTorqueEnabled(const MotorVector<bool> &motors)
 {
 	CriticalSectionLock csl(m_cs);
 	mTorqueEnabled = motors;
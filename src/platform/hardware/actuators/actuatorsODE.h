@@ -30,10 +30,10 @@ public:
 	virtual std::map<MotorID, MotorData> getMotorData()   const override;
 
 	/// set the positions and speeds of the servos
-	virtual void setPositionsAndSpeeds(const std::map<MotorID, Degree> &positions, const std::map<MotorID, RPM> &speeds) override;
+	virtual void setPositionsAndSpeeds(const MotorVector<Degree> &positions, const MotorVector<RPM> &speeds) override;
 
 	/// enable/disable the torque
-	virtual void setTorqueEnabled(const std::map<MotorID, bool> &motors) override;
+	virtual void setTorqueEnabled(const MotorVector<bool> &motors) override;
 
 	virtual void simulatorCallback(Second timeDelta);
 private:
@@ -42,9 +42,12 @@ private:
 
 	std::map<MotorID, MotorData> motorData;
 
-	std::map<MotorID, Degree> mTargetAngles;
-	std::map<MotorID, RPM> mTargetSpeeds;
-	std::map<MotorID, bool> mTorqueEnabled;
+	MotorVector<Degree> mTargetAngles;
+	MotorVector<RPM> mTargetSpeeds;
+	MotorVector<bool> mTorqueEnabled;
+
+	/// the physics motor of every index of the motor vectors (nullptr if it is not simulated)
+	std::vector<ODEMotor*> mMotorsByIndex;
 
 	CriticalSection m_cs;
 };
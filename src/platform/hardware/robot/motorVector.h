@@ -0,0 +1,148 @@
+#ifndef MOTORVECTOR_H
+#define MOTORVECTOR_H
+
+#include <algorithm>
+#include <cassert>
+#include <vector>
+
+#include <stdint.h>
+
+#include "platform/hardware/robot/motorIDs.h"
+
+
+/*------------------------------------------------------------------------------------------------*/
+
+/// maximum number of servos a MotorVector can hold (one bit of the validity mask each)
+#define MOTORVECTOR_MAX_MOTORS 64
+
+
+/*------------------------------------------------------------------------------------------------*/
+
+/** The MotorIndex maps the MotorIDs of the servos of a robot onto the contiguous
+ ** indices 0..n-1 in ascending order of the IDs. This is the same order the
+ ** kinematic tree uses for its motors (KinematicTree::toInt()), so both can be
+ ** used interchangeably.
+ */
+class MotorIndex {
+public:
+	MotorIndex() {}
+
+	explicit MotorIndex(const Motors &motors)
+		: ids(motors.begin(), motors.end())
+	{
+		assert(ids.size() <= MOTORVECTOR_MAX_MOTORS);
+	}
+
+	/// number of servos
+	inline int size() const {
+		return ids.size();
+	}
+
+	/// index of the servo, -1 if the ID does not belong to a servo
+	inline int toInt(MotorID id) const {
+		std::vector<MotorID>::const_iterator it = std::lower_bound(ids.begin(), ids.end(), id);
+		if (it == ids.end() || *it != id)
+			return -1;
+		return it - ids.begin();
+	}
+
+	/// MotorID of the servo at the index
+	inline MotorID toExt(int index) const {
+		return ids[index];
+	}
+
+private:
+	std::vector<MotorID> ids;
+};
+
+
+/*------------------------------------------------------------------------------------------------*/
+
+/** A MotorVector holds one value per servo, stored contiguously by the index
+ ** of the servo (see MotorIndex). Every value is marked valid once it is set,
+ ** so a MotorVector can hold the values of only some of the motors (e.g. the
+ ** motors a motion requested), just as a std::map<MotorID, T> with a subset
+ ** of the motors would.
+ **
+ ** Invalidating keeps the values and the memory, so a MotorVector that is
+ ** reused every cycle does not allocate.
+ */
+template<typename T>
+class MotorVector {
+public:
+	MotorVector()
+		: valid(0)
+	{}
+
+	explicit MotorVector(int size)
+		: values(size)
+		, valid(0)
+	{
+		assert(size <= MOTORVECTOR_MAX_MOTORS);
+	}
+
+	/// number of motors (valid or not)
+	inline int size() const {
+		return values.size();
+	}
+
+	/// change the number of motors, the values of the remaining motors are kept
+	void resize(int size) {
+		assert(size <= MOTORVECTOR_MAX_MOTORS);
+		values.resize(size);
+		if (size < MOTORVECTOR_MAX_MOTORS)
+			valid &= (uint64_t(1) << size) - 1;
+	}
+
+	/// whether the value of the motor at the index was set
+	inline bool isValid(int index) const {
+		return (valid >> index) & 1;
+	}
+
+	/// whether any value is valid
+	inline bool any() const {
+		return valid != 0;
+	}
+
+	/// value of the motor at the index (the last one set, even if it was invalidated since)
+	inline T operator[](int index) const {
+		return values[index];
+	}
+
+	/// value of the motor at the index if it is valid, otherwise the default value
+	inline T get(int index, const T &defaultValue) const {
+		if (index < 0 || index >= size() || false == isValid(index))
+			return defaultValue;
+		return values[index];
+	}
+
+	/// set the value of the motor at the index and mark it valid
+	inline void set(int index, const T &value) {
+		values[index] = value;
+		valid |= uint64_t(1) << index;
+	}
+
+	inline void invalidate(int index) {
+		valid &= ~(uint64_t(1) << index);
+	}
+
+	inline void invalidateAll() {
+		valid = 0;
+	}
+
+	template<class Archive>
+	void serialize(Archive & ar, const unsigned int version) {
+		ar & values;
+		ar & valid;
+	}
+
+private:
+	std::vector<T> values;
+	uint64_t       valid;
+};
+
+typedef MotorVector<Degree> MotorPositionVector;
+typedef MotorVector<RPM>    MotorSpeedVector;
+
+
+#endif
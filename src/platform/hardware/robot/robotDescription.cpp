@@ -75,6 +75,8 @@ RobotDescription::RobotDescription(std::string robotDescriptionPath) {
 		}
 	}
 
+	motorIndex = MotorIndex(motorIDs);
+
 	// push the added configuration options to the active configuration
 //FIXME!!!!
 //	ConfigRegistry::getInstance().applyDefaultValuesTo(&services.getConfig());
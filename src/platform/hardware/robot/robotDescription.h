@@ -2,6 +2,7 @@
 #define ROBOTDESCRIPTION_H__
 
 #include "tools/kinematicEngine/kinematicNode.h"
+#include "platform/hardware/robot/motorVector.h"
 
 #include <boost/property_tree/ptree.hpp>
 
@@ -27,6 +28,11 @@ public:
 		return motorIDs;
 	}
 
+	/// the indices of the servos in a MotorVector
+	inline const MotorIndex& getMotorIndex() const {
+		return motorIndex;
+	}
+
 	const std::string getMotorName(MotorID id) const {
 		const auto &it = m_nodes.find(id);
 		if (it != m_nodes.end()) {
@@ -56,6 +62,7 @@ public:
 private:
 	std::map<MotorID, KinematicNode*> m_nodes;
 	std::set<MotorID> motorIDs;
+	MotorIndex        motorIndex;
 
 	/**
 	 * generate the kinematic tree from a given xml file (robot description)
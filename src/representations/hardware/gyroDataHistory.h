@@ -3,7 +3,7 @@
 
 #include "gyroData.h"
 
-#include "ModuleFramework/Serializer.h"
+#include "ModuleFramework/CompactSerializer.h"
 
 #include "platform/system/timer.h"
 
@@ -44,7 +44,7 @@ protected:
 	}
 };
 
-REGISTER_SERIALIZATION(GyroDataHistory, 1)
+REGISTER_COMPACT_SERIALIZATION(GyroDataHistory, 2, 1)
 
 
 #endif
@@ -23,7 +23,27 @@
 #include <boost/optional/optional.hpp>
 
 
-KinematicTree::KinematicTree() {
+KinematicTree::KinematicTree()
+	: m_cacheValid(false)
+{
+}
+
+KinematicTree::KinematicTree(KinematicTree const& other)
+	: m_nodes(other.m_nodes)
+	, m_nodeToInt(other.m_nodeToInt)
+	, m_nodeToExt(other.m_nodeToExt)
+	, m_motorNodes(other.m_motorNodes)
+	, m_cacheValid(false)
+{
+}
+
+KinematicTree& KinematicTree::operator=(KinematicTree const& other) {
+	m_nodes     = other.m_nodes;
+	m_nodeToInt = other.m_nodeToInt;
+	m_nodeToExt = other.m_nodeToExt;
+	m_motorNodes = other.m_motorNodes;
+	invalidate();
+	return *this;
 }
 
 KinematicTree::~KinematicTree() {
@@ -39,36 +59,58 @@ void KinematicTree::setup(const RobotDescription &robotDescription) {
 		}
 	}
 
+	for (MotorID id : m_nodeToExt) {
+		m_motorNodes.push_back(m_nodes[id]);
+	}
+
 	// for each node, set the correct parent (this will auto-fill the children)
 	for (const auto& in : robotDescription.getNodes()) {
 		const KinematicNode* otherParentNode = robotDescription.getNodes().at(in.first)->getParent();
 		if (otherParentNode)
 			m_nodes[in.first]->setParent( m_nodes[ otherParentNode->getID() ] );
 	}
+
+	invalidate();
 }
 
 void KinematicTree::setMotorValue(MotorID id, Degree value) {
 	m_nodes[id]->setValue(value.value());
+	invalidate();
 }
 
 void KinematicTree::setMotorValues(std::map<MotorID, Degree> const& values) {
-	for (auto e : values) {
+	for (auto const& e : values) {
 		m_nodes[e.first]->setValue(e.second.value());
 	}
+	invalidate();
 }
 
-void KinematicTree::getMotorValues(std::map<MotorID, Degree> & values) const {
-	for (auto node : m_nodes) {
-		if (!(node.second->isFixedNode())) {
-			values[node.first] = node.second->getValue() * degrees;
+void KinematicTree::setMotorValues(MotorVector<Degree> const& values) {
+	const int cnt = std::min<int>(values.size(), m_motorNodes.size());
+	for (int i = 0; i < cnt; ++i) {
+		if (values.isValid(i)) {
+			m_motorNodes[i]->setValue(values[i].value());
 		}
 	}
+	invalidate();
 }
 
-void KinematicTree::getMotorSpeeds(std::map<MotorID, RPM> & values) const {
-	for (auto node : m_nodes) {
-		if (!(node.second->isFixedNode())) {
-			values[node.first] = node.second->getValueDerivative() * 60. / (2. * M_PI) * rounds_per_minute;
+void KinematicTree::getMotorValues(MotorVector<Degree> & values) const {
+	values.resize(m_motorNodes.size());
+	values.invalidateAll();
+	for (uint i = 0; i < m_motorNodes.size(); ++i) {
+		if (!(m_motorNodes[i]->isFixedNode())) {
+			values.set(i, m_motorNodes[i]->getValue() * degrees);
+		}
+	}
+}
+
+void KinematicTree::getMotorSpeeds(MotorVector<RPM> & values) const {
+	values.resize(m_motorNodes.size());
+	values.invalidateAll();
+	for (uint i = 0; i < m_motorNodes.size(); ++i) {
+		if (!(m_motorNodes[i]->isFixedNode())) {
+			values.set(i, m_motorNodes[i]->getValueDerivative() * 60. / (2. * M_PI) * rounds_per_minute);
 		}
 	}
 }
@@ -83,50 +125,28 @@ void KinematicTree::setMotorSpeeds(std::map<MotorID, RPM> const& values) {
 	}
 }
 
+void KinematicTree::setMotorSpeeds(MotorVector<RPM> const& values) {
+	const int cnt = std::min<int>(values.size(), m_motorNodes.size());
+	for (int i = 0; i < cnt; ++i) {
+		if (values.isValid(i)) {
+			m_motorNodes[i]->setValueDerivative((2. * M_PI * values[i] / 60.).value());
+		}
+	}
+}
+
 
 arma::mat44 KinematicTree::getTransitionMatrixFromTo(MotorID from, MotorID to) const
 {
-	arma::mat44 ret = arma::eye(4, 4);
-
-	{
-		// check that nodes exist
-		const KinematicNode *fromNode = getNode(from);
-		const KinematicNode *backNode = getNode(to);
-		if (nullptr == fromNode || nullptr == backNode)
-			return ret;
-
-		arma::mat44 forward  = arma::eye(4, 4);
-		arma::mat44 backward = arma::eye(4, 4);
-
-		while (fromNode != backNode)
-		{
-			/* traverse up */
-			forward =  forward * fromNode->getBackwardMatrix();
-			if (NULL != fromNode->getParent())
-			{
-				fromNode = fromNode->getParent();
-			} else
-			{
-				break;
-			}
-		}
-		while (backNode != fromNode)
-		{
-			/* traverse down */
-			backward = backNode->getForwardMatrix() * backward;
-			if (NULL != backNode->getParent())
-			{
-				backNode = backNode->getParent();
-			} else
-			{
-				break;
-			}
-		}
+	// check that nodes exist
+	const KinematicNode *fromNode = getNode(from);
+	const KinematicNode *toNode   = getNode(to);
+	if (nullptr == fromNode || nullptr == toNode)
+		return arma::eye(4, 4);
 
-		ret = forward * backward;
-	}
-	return ret;
+	updateCache();
+	return getCache(fromNode).fromRoot * getCache(toNode).toRoot;
 }
+
 /**
  * clip an angle to be applied to a motor (the values are defined in the robotdescription.xml)
  * @param id
@@ -371,42 +391,12 @@ void KinematicTree::drawPoseSub(DebugStream3D &debug3d, const KinematicNode *bas
 
 KinematicMass KinematicTree::getCOM() const
 {
-	const KinematicNode *node = getNode(EFFECTOR_ID_ROOT);
-	if (nullptr == node) {
+	if (nullptr == getNode(EFFECTOR_ID_ROOT)) {
 		return KinematicMass();
 	}
 
-	KinematicMass ret = node->getEquivalentMass();
-
-	for (const KinematicNode *child : node->getChildren())
-	{
-		ret += getCOMSub(child, arma::eye(4, 4));
-	}
-
-	ret.m_position = ret.m_position * 1. / ret.m_massGrams;
-
-	return ret;
-}
-
-KinematicMass KinematicTree::getCOMSub(const KinematicNode *node, arma::mat44 prev) const
-{
-	KinematicMass ret;
-	arma::mat44 base = prev * node->getForwardMatrix();
-
-	ret += node->getEquivalentMass();
-
-	arma::colvec4 helper;
-	helper.rows(0, 2) = ret.m_position;
-	helper(3) = 1.;
-	arma::colvec4 position = base * helper;
-	ret.m_position = position.rows(0, 2) * ret.m_massGrams;
-
-	for (const KinematicNode *child : node->getChildren())
-	{
-		ret += getCOMSub(child, base);
-	}
-
-	return ret;
+	updateCache();
+	return m_com;
 }
 
 KinematicMass KinematicTree::getCOM(MotorID node) const
@@ -426,7 +416,6 @@ KinematicMass KinematicTree::getCOM(MotorID base, MotorID end) const
 {
 	KinematicMass ret;
 
-	arma::mat44 forward = arma::eye(4, 4);
 	KinematicPath path = getPathFromNodeToNode(base, end);
 
 	if (path.empty())
@@ -438,24 +427,22 @@ KinematicMass KinematicTree::getCOM(MotorID base, MotorID end) const
 
 	ret.m_position = ret.m_position * ret.m_massGrams;
 
-	uint nodeCnt = 0;
-	for (KinematicPathNode const &node : path)
+	updateCache();
+	const arma::mat44 &firstFromRoot = getCache(path[0].m_node).fromRoot;
+
+	/* we already have the first node of the path */
+	for (uint nodeCnt = 1; nodeCnt < path.size(); ++nodeCnt)
 	{
-		if (0 == nodeCnt)
-		{
-			/* we already have that node */
-			++nodeCnt;
-			continue;
-		}
-		forward = forward * path[nodeCnt - 1].m_node->getMatrixToRelative(node.m_node->getID());
-		KinematicMass equivMass = node.m_node->getEquivalentMass();
+		const KinematicNode *node = path[nodeCnt].m_node;
+		const arma::mat44 forward = firstFromRoot * getCache(node).toRoot;
+
+		KinematicMass equivMass = node->getEquivalentMass();
 		arma::colvec4 posHelper = arma::ones(4);
 		posHelper.rows(0, 2) = equivMass.m_position;
 		posHelper = forward * posHelper;
 		equivMass.m_position = posHelper.rows(0, 2) * equivMass.m_massGrams;
 
 		ret += equivMass;
-		++nodeCnt;
 	}
 
 	ret.m_position = ret.m_position * 1. / ret.m_massGrams;
@@ -530,11 +517,23 @@ void KinematicTree::calculateEffectorsPositions(
 		const KinematicNode *node,
 		arma::mat44 const& prev) const
 {
-	const arma::mat44 base = prev * node->getForwardMatrix();
-	positions[node->getID()] = base.col(3).rows(0, 2);
+	updateCache();
+
+	/* prev * forward matrices from node down to each effector == toFrame * (effector -> root) */
+	const arma::mat44 toFrame = prev * node->getForwardMatrix() * getCache(node).fromRoot;
+	calculateEffectorsPositionsSub(positions, node, toFrame);
+}
+
+void KinematicTree::calculateEffectorsPositionsSub(
+		std::map<MotorID, arma::colvec3> &positions,
+		const KinematicNode *node,
+		arma::mat44 const& toFrame) const
+{
+	const arma::colvec4 position = toFrame * getCache(node).toRoot.col(3);
+	positions[node->getID()] = position.rows(0, 2);
 
 	for (const KinematicNode* const &child : node->getChildren()) {
-		calculateEffectorsPositions(positions, child, base);
+		calculateEffectorsPositionsSub(positions, child, toFrame);
 	}
 }
 
@@ -543,9 +542,103 @@ void KinematicTree::setGyroscopeAngles(arma::mat33 _rotMat) {
 	if (gyroIter != m_nodes.end())
 	{
 		gyroIter->second->setAdditionalExtrinsicRotation(_rotMat);
+		invalidate();
 	} else {
 //		ERROR("Try setting extrinsic angles for gyroscope which is not present!");
 	}
 
 }
 
+
+/**
+ * recalculate the cached transforms and masses (if outdated) in one pass from the top of the tree
+ */
+void KinematicTree::updateCache() const
+{
+	if (m_cacheValid.load(std::memory_order_acquire)) {
+		return;
+	}
+
+	std::lock_guard<std::mutex> lock(m_cacheMutex);
+	if (m_cacheValid.load(std::memory_order_relaxed)) {
+		return;
+	}
+
+	const arma::mat44 identity = arma::eye(4, 4);
+	for (auto const& it : m_nodes) {
+		const KinematicNode *node = it.second;
+		if (nullptr != node->getParent()) {
+			continue;
+		}
+
+		/* the top of the tree defines the frame, its own forward matrix is not applied */
+		NodeCache &cache = m_cache[node->getID()];
+		cache.toRoot      = identity;
+		cache.fromRoot    = identity;
+		cache.subtreeMass = node->getEquivalentMass();
+		cache.comSub      = node->getEquivalentMass();
+
+		for (const KinematicNode *child : node->getChildren())
+		{
+			updateCacheSub(child, identity, identity);
+
+			NodeCache const& childCache = m_cache[child->getID()];
+			cache.subtreeMass += childCache.subtreeMass;
+			cache.comSub      += childCache.comSub;
+		}
+
+		if (EFFECTOR_ID_ROOT == node->getID()) {
+			m_com = cache.comSub;
+			m_com.m_position = m_com.m_position * 1. / m_com.m_massGrams;
+		}
+	}
+
+	m_cacheValid.store(true, std::memory_order_release);
+}
+
+void KinematicTree::updateCacheSub(const KinematicNode *node, arma::mat44 const& parentToRoot, arma::mat44 const& parentFromRoot) const
+{
+	NodeCache &cache = m_cache[node->getID()];
+	cache.toRoot   = parentToRoot * node->getForwardMatrix();
+	cache.fromRoot = node->getBackwardMatrix() * parentFromRoot;
+
+	cache.subtreeMass = node->getEquivalentMass();
+	cache.subtreeMass.applyTransformation(cache.toRoot);
+
+	cache.comSub = KinematicMass();
+	cache.comSub += node->getEquivalentMass();
+	cache.comSub.applyTransformation(cache.toRoot);
+	cache.comSub.m_position = cache.comSub.m_position * cache.comSub.m_massGrams;
+
+	for (const KinematicNode *child : node->getChildren())
+	{
+		updateCacheSub(child, cache.toRoot, cache.fromRoot);
+
+		NodeCache const& childCache = m_cache[child->getID()];
+		cache.subtreeMass += childCache.subtreeMass;
+		cache.comSub      += childCache.comSub;
+	}
+}
+
+KinematicTree::NodeCache const& KinematicTree::getCache(const KinematicNode *node) const
+{
+	return m_cache.at(node->getID());
+}
+
+arma::mat44 const& KinematicTree::getNodeToRootMatrix(const KinematicNode *node) const
+{
+	updateCache();
+	return getCache(node).toRoot;
+}
+
+arma::mat44 const& KinematicTree::getRootToNodeMatrix(const KinematicNode *node) const
+{
+	updateCache();
+	return getCache(node).fromRoot;
+}
+
+KinematicMass const& KinematicTree::getSubtreeMass(const KinematicNode *node) const
+{
+	updateCache();
+	return getCache(node).subtreeMass;
+}
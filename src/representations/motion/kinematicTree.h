@@ -17,29 +17,51 @@
 
 #include "platform/hardware/robot/robotDescription.h"
 #include "platform/hardware/robot/motorIDs.h"
+#include "platform/hardware/robot/motorVector.h"
 
 #include <boost/property_tree/ptree.hpp>
 
 #include <array>
+#include <atomic>
 #include <map>
+#include <mutex>
 #include <armadillo>
 
 
+/*
+ * The transforms of all nodes into the root frame and the masses of all subtrees are cached.
+ * Whatever changes a transform (setup(), setMotorValue(s)(), setGyroscopeAngles(), the non-const
+ * getNode()) marks the cache dirty, the next query recalculates it in one pass through the tree.
+ * This is the kinematic state the tasks derive their jacobians from (see getNodeToRootMatrix(),
+ * getRootToNodeMatrix() and getSubtreeMass()).
+ */
 class KinematicTree {
 public:
 	KinematicTree();
+	KinematicTree(KinematicTree const& other);
 	virtual ~KinematicTree();
 
+	KinematicTree& operator=(KinematicTree const& other);
+
 	void setup(const RobotDescription &robotDescription);
 
 	void setMotorValue(MotorID id, Degree value);
 	void setMotorValues(std::map<MotorID, Degree> const& values);
 
+	/**
+	 * set the valid values, the vector is indexed like toInt()
+	 */
+	void setMotorValues(MotorVector<Degree> const& values);
+
 	void setMotorSpeed(MotorID id, RPM value);
 	void setMotorSpeeds(std::map<MotorID, RPM> const& values);
+	void setMotorSpeeds(MotorVector<RPM> const& values);
 
-	void getMotorValues(std::map<MotorID, Degree> & values) const;
-	void getMotorSpeeds(std::map<MotorID, RPM> & values) const;
+	/**
+	 * get the values of all motors, the vector is indexed like toInt()
+	 */
+	void getMotorValues(MotorVector<Degree> & values) const;
+	void getMotorSpeeds(MotorVector<RPM> & values) const;
 
 	void setGyroscopeAngles(arma::mat33 _rotMat);
 
@@ -97,7 +119,18 @@ public:
 		return m_nodeToExt[_id];
     }
 
+	/**
+	 * the node of the motor with the internal index (see toInt())
+	 */
+	inline const KinematicNode* getMotorNode(int _id) const {
+		return m_motorNodes[_id];
+	}
+
+	/**
+	 * the node may be modified, so the cached transforms are invalidated
+	 */
 	KinematicNode* getNode(MotorID id) {
+		invalidate();
 		return const_cast<KinematicNode*>(((const KinematicTree*)(this))->getNode(id));
 	}
 
@@ -109,14 +142,55 @@ public:
 	 */
 	void calculateEffectorsPositions(std::map<MotorID, arma::colvec3> &positions, const KinematicNode *node, arma::mat44 const& prev) const;
 
+	/**
+	 * transformation from the coordinate frame of the node into the one of the root node (cached)
+	 * the columns are the node's axes and origin in the root frame
+	 */
+	arma::mat44 const& getNodeToRootMatrix(const KinematicNode *node) const;
+
+	/**
+	 * transformation from the coordinate frame of the root node into the one of the node (cached)
+	 */
+	arma::mat44 const& getRootToNodeMatrix(const KinematicNode *node) const;
+
+	/**
+	 * the combined equivalent masses of the node and all nodes below it (cached)
+	 * @return mass and center of mass in the coordinate frame of the root node
+	 */
+	KinematicMass const& getSubtreeMass(const KinematicNode *node) const;
+
+	/**
+	 * mark the cached transforms as outdated (done automatically by all setters)
+	 */
+	inline void invalidate() {
+		m_cacheValid.store(false, std::memory_order_release);
+	}
+
 private:
+	struct NodeCache {
+		arma::mat44 toRoot;        // node frame -> root frame
+		arma::mat44 fromRoot;      // root frame -> node frame
+		KinematicMass subtreeMass; // in the root frame
+		KinematicMass comSub;      // the same accumulated as getCOM() always did (m_position is weighted with the mass)
+	};
+
 	std::map<MotorID, KinematicNode*> m_nodes;
 	std::map<MotorID, int>            m_nodeToInt;
 	std::vector<MotorID>              m_nodeToExt;
+	std::vector<KinematicNode*>       m_motorNodes;  // indexed like m_nodeToExt
+
+	mutable std::map<MotorID, NodeCache> m_cache;
+	mutable KinematicMass                m_com;
+	mutable std::atomic<bool>            m_cacheValid;
+	mutable std::mutex                   m_cacheMutex;
 
 	void drawPoseSub(DebugStream3D &debug3d, const KinematicNode *baseNode, arma::mat44 prev, bool includeMasses, bool includeEquivalentMasses) const;
 
-	KinematicMass getCOMSub(const KinematicNode *node, arma::mat44 prev) const;
+	void updateCache() const;
+	void updateCacheSub(const KinematicNode *node, arma::mat44 const& parentToRoot, arma::mat44 const& parentFromRoot) const;
+	NodeCache const& getCache(const KinematicNode *node) const;
+
+	void calculateEffectorsPositionsSub(std::map<MotorID, arma::colvec3> &positions, const KinematicNode *node, arma::mat44 const& toFrame) const;
 
 
 	arma::colvec4 getLinearMomentumSub(const KinematicNode *node, bool traversingUp, KinematicMass& o_massToPassBack) const;
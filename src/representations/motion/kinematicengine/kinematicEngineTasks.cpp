@@ -16,13 +16,8 @@ KinematicEngineTasks::KinematicEngineTasks()
 	, m_tree() {
 
 	m_tree.setup(*services.getRobotModel().getRobotDescription());
-	std::map<MotorID, Degree> values;
+	MotorVector<Degree> values;
 	m_tree.getMotorValues(values);
-
-	for (auto value : values) {
-		value.second = 0 * degrees;
-	}
-
 	m_tree.setMotorValues(values);
 	m_tree.setGyroscopeAngles(arma::eye(3, 3));
 }
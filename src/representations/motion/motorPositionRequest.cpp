@@ -7,66 +7,122 @@
 #include "platform/hardware/robot/robotDescription.h"
 
 
-void MotorPositionRequest::clear(bool _totalClear) {
-	for (auto& e : positions) {
-		e.second.second = _totalClear?0:std::max(0, e.second.second-1);
-	}
-	for (auto& e : offsets) {
-		e.second.second = false;
-	}
-	for (auto& e : speeds) {
-		e.second.second = false;
-	}
-	for (auto& e : forces) {
-		e.second.second = false;
+void MotorPositionRequest::prepare() {
+	MotorIndex const& motorIndex = services.getRobotModel().getRobotDescription()->getMotorIndex();
+	const int size = motorIndex.size();
+	if (   positions.size()    != size || (int)positionHolds.size() != size
+	    || offsets.size()      != size || speeds.size()             != size
+	    || forces.size()       != size || torques.size()            != size
+	    || torqueStates.size() != size)
+	{
+		positions.resize(size);
+		positionHolds.resize(size, 0);
+		offsets.resize(size);
+		speeds.resize(size);
+		forces.resize(size);
+		torques.resize(size);
+		torqueStates.resize(size);
 	}
-	for (auto& e : torques) {
-		e.second.second = false;
+}
+
+int MotorPositionRequest::toIndex(MotorID _id) {
+	prepare();
+	return services.getRobotModel().getRobotDescription()->getMotorIndex().toInt(_id);
+}
+
+void MotorPositionRequest::clear(bool _totalClear) {
+	for (int i = 0; i < positions.size(); ++i) {
+		positionHolds[i] = _totalClear?0:std::max(0, positionHolds[i]-1);
+		if (positionHolds[i] == 0) {
+			positions.invalidate(i);
+		}
 	}
+	offsets.invalidateAll();
+	speeds.invalidateAll();
+	forces.invalidateAll();
+	torques.invalidateAll();
 }
 
 void MotorPositionRequest::setPosition(MotorID _id, Degree _angle) {
-	if (positions.find(_id) != positions.end() && positions.at(_id).second == 5) {
+	const int index = toIndex(_id);
+	if (index < 0) {
+		WARNING("Position requested for motor %d which is no servo", _id);
+		return;
+	}
+	setPositionAt(index, _angle);
+}
+void MotorPositionRequest::setPositionAt(int _index, Degree _angle) {
+	if (positionHolds[_index] == 5) {
 //		WARNING("Overwriting position of motor %d (%s) with value %.1f degrees (old value: %f.1f)",
 //				_id,
 //				services.getRobotModel().getRobotDescription()->getMotorName(_id).c_str(),
 //				getMotorName(_id).c_str(),
 //				_angle.value(),
-//				positions.at(_id).first.value());
+//				positions[_index].value());
 	}
-	positions[_id] = {_angle, 5};
+	positions.set(_index, _angle);
+	positionHolds[_index] = 5;
 }
+
 void MotorPositionRequest::setOffset(MotorID _id, Degree _offsetAngle) {
-	if (offsets.find(_id) != offsets.end() && offsets.at(_id).second) {
+	const int index = toIndex(_id);
+	if (index < 0) {
+		WARNING("Offset requested for motor %d which is no servo", _id);
+		return;
+	}
+	setOffsetAt(index, _offsetAngle);
+}
+void MotorPositionRequest::setOffsetAt(int _index, Degree _offsetAngle) {
+	if (offsets.isValid(_index)) {
+		const MotorID id = services.getRobotModel().getRobotDescription()->getMotorIndex().toExt(_index);
 		WARNING("Overwriting offset of motor %d (%s) with value %f degrees (old: value: %f)",
-				_id,
-				services.getRobotModel().getRobotDescription()->getMotorName(_id).c_str(),
+				id,
+				services.getRobotModel().getRobotDescription()->getMotorName(id).c_str(),
 				_offsetAngle.value(),
-				offsets.at(_id).first.value());
+				offsets[_index].value());
 	}
-	offsets[_id] = {_offsetAngle, true};
+	offsets.set(_index, _offsetAngle);
 }
+
 void MotorPositionRequest::setSpeed(MotorID _id, RPM _speed) {
-	if (speeds.find(_id) != speeds.end() && speeds.at(_id).second) {
+	const int index = toIndex(_id);
+	if (index < 0) {
+		WARNING("Speed requested for motor %d which is no servo", _id);
+		return;
+	}
+	setSpeedAt(index, _speed);
+}
+void MotorPositionRequest::setSpeedAt(int _index, RPM _speed) {
+	if (speeds.isValid(_index)) {
+		const MotorID id = services.getRobotModel().getRobotDescription()->getMotorIndex().toExt(_index);
 		WARNING("Overwriting speed of motor %d (%s) with value %f rounds per minute",
-				_id,
-				services.getRobotModel().getRobotDescription()->getMotorName(_id).c_str(),
+				id,
+				services.getRobotModel().getRobotDescription()->getMotorName(id).c_str(),
 				_speed.value());
 	}
-	speeds[_id] = {_speed, true};
+	speeds.set(_index, _speed);
 }
 
 
 void MotorPositionRequest::setTorque(MotorID _id, bool _on) {
-	auto iter = torques.find(_id);
-	if (iter != torques.end() && iter->second.second) {
+	const int index = toIndex(_id);
+	if (index < 0) {
+		WARNING("Torque requested for motor %d which is no servo", _id);
+		return;
+	}
+	setTorqueAt(index, _on);
+}
+void MotorPositionRequest::setTorqueAt(int _index, bool _on) {
+	if (torques.isValid(_index)) {
+		const MotorID id = services.getRobotModel().getRobotDescription()->getMotorIndex().toExt(_index);
 		WARNING("Overwriting torque of motor %d (%s) with value %d",
-				_id,
-				services.getRobotModel().getRobotDescription()->getMotorName(_id).c_str(),
+				id,
+				services.getRobotModel().getRobotDescription()->getMotorName(id).c_str(),
 				_on);
 	}
-	if (iter == torques.end() || iter->second.first != _on) {
-		torques[_id] = {_on, true};
+	if (false == torqueStates.isValid(_index) || torqueStates[_index] != _on) {
+		torques.set(_index, _on);
+		torqueStates.set(_index, _on);
 	}
 }
 void MotorPositionRequest::setPositionAndSpeed(MotorID _id, Degree _angle, RPM _speed) {
@@ -76,13 +132,18 @@ void MotorPositionRequest::setPositionAndSpeed(MotorID _id, Degree _angle, RPM _
 
 void MotorPositionRequest::setForce(MotorID _id, double force)
 {
-	if (forces.find(_id) != forces.end() && forces.at(_id).second) {
+	const int index = toIndex(_id);
+	if (index < 0) {
+		WARNING("Force requested for motor %d which is no servo", _id);
+		return;
+	}
+	if (forces.isValid(index)) {
 		WARNING("Overwriting force of motor %d (%s) with value %f",
 				_id,
 				services.getRobotModel().getRobotDescription()->getMotorName(_id).c_str(),
 				force);
 	}
-	forces[_id] = {force, true};
+	forces.set(index, force);
 }
 
 void MotorPositionRequest::setAllTorques(bool _on) {
@@ -92,120 +153,67 @@ void MotorPositionRequest::setAllTorques(bool _on) {
 }
 
 Degree MotorPositionRequest::getPosition(MotorID _id) const {
-	if (positions.find(_id) == positions.end()) {
+	const int index = services.getRobotModel().getRobotDescription()->getMotorIndex().toInt(_id);
+	if (index < 0 || index >= positions.size()) {
 		return 0*degrees;
 	}
-	return positions.at(_id).first;
+	return positions[index];
 }
 RPM MotorPositionRequest::getSpeed(MotorID _id) const {
-	if (speeds.find(_id) == speeds.end()) {
+	const int index = services.getRobotModel().getRobotDescription()->getMotorIndex().toInt(_id);
+	if (index < 0 || index >= speeds.size()) {
 		return 0*rounds_per_minute;
 	}
 
-	return speeds.at(_id).first;
+	return speeds[index];
 }
 Degree MotorPositionRequest::getOffset(MotorID _id) const {
-	if (offsets.find(_id) == offsets.end()) {
+	const int index = services.getRobotModel().getRobotDescription()->getMotorIndex().toInt(_id);
+	if (index < 0 || index >= offsets.size()) {
 		return 0*degrees;
 	}
-	return offsets.at(_id).first;
-}
-
-std::map<MotorID, Degree> MotorPositionRequest::getPositionRequests() const {
-	std::map<MotorID, Degree> retMap;
-	for (auto e : positions) {
-		if (e.second.second > 0) {
-			retMap[e.first] = e.second.first;
-		}
-	}
-	return retMap;
-}
-std::map<MotorID, Degree> MotorPositionRequest::getOffsetRequests() const {
-	std::map<MotorID, Degree> retMap;
-	for (auto e : offsets) {
-		if (e.second.second) {
-			retMap[e.first] = e.second.first;
-		}
-	}
-	return retMap;
-}
-std::map<MotorID, RPM> MotorPositionRequest::getSpeedRequests() const {
-	std::map<MotorID, RPM> retMap;
-	for (auto e : speeds) {
-		if (e.second.second) {
-			retMap[e.first] = e.second.first;
-		}
-	}
-	return retMap;
-
-}
-
-std::map<MotorID, double> MotorPositionRequest::getForceRequests() const {
-	std::map<MotorID, double> retMap;
-	for (auto e : forces) {
-		if (e.second.second) {
-			retMap[e.first] = e.second.first;
-		}
-	}
-	return retMap;
-
-}
-
-std::map<MotorID, bool> MotorPositionRequest::getTorqueRequests() const {
-	std::map<MotorID, bool> retMap;
-	for (auto e : torques) {
-		if (e.second.second) {
-			retMap[e.first] = e.second.first;
-		}
-	}
-	return retMap;
+	return offsets[index];
 }
 
 
 void MotorPositionRequest::merge(const MotorPositionRequest& _request) {
-	for (auto e : _request.positions) {
-		if (e.second.second > 0) {
-			setPosition(e.first, e.second.first);
+	prepare();
+	for (int i = 0; i < std::min(positions.size(), _request.positions.size()); ++i) {
+		if (_request.positions.isValid(i)) {
+			setPositionAt(i, _request.positions[i]);
 		}
-	}
-	for (auto e : _request.offsets) {
-		if (e.second.second) {
-			setOffset(e.first, e.second.first);
+		if (_request.offsets.isValid(i)) {
+			setOffsetAt(i, _request.offsets[i]);
 		}
-	}
-	for (auto e : _request.speeds) {
-		if (e.second.second) {
-			setSpeed(e.first, e.second.first);
+		if (_request.speeds.isValid(i)) {
+			setSpeedAt(i, _request.speeds[i]);
 		}
-	}
-	for (auto e : _request.torques) {
-		if (e.second.second) {
-			setTorque(e.first, e.second.first);
+		if (_request.torques.isValid(i)) {
+			setTorqueAt(i, _request.torques[i]);
 		}
 	}
 }
 void MotorPositionRequest::mergeHeadOnly(const MotorPositionRequest& _request) {
-	std::set<MotorID> headIDs = { MOTOR_HEAD_PITCH, MOTOR_HEAD_TURN};
+	MotorIndex const& motorIndex = services.getRobotModel().getRobotDescription()->getMotorIndex();
+	prepare();
 
-	for (auto e : _request.positions) {
-		if (e.second.second > 0 && (headIDs.find(e.first) != headIDs.end())) {
-			setPosition(e.first, e.second.first);
+	for (MotorID id : { MOTOR_HEAD_PITCH, MOTOR_HEAD_TURN}) {
+		const int i = motorIndex.toInt(id);
+		if (i < 0 || i >= std::min(positions.size(), _request.positions.size())) {
+			continue;
 		}
-	}
-	for (auto e : _request.offsets) {
-		if (e.second.second && (headIDs.find(e.first) != headIDs.end())) {
-			setOffset(e.first, e.second.first);
+
+		if (_request.positions.isValid(i)) {
+			setPositionAt(i, _request.positions[i]);
 		}
-	}
-	for (auto e : _request.speeds) {
-		if (e.second.second && (headIDs.find(e.first) != headIDs.end())) {
-			setSpeed(e.first, e.second.first);
+		if (_request.offsets.isValid(i)) {
+			setOffsetAt(i, _request.offsets[i]);
 		}
-	}
-	for (auto e : _request.torques) {
-		if (e.second.second && (headIDs.find(e.first) != headIDs.end())) {
-			setTorque(e.first, e.second.first);
+		if (_request.speeds.isValid(i)) {
+			setSpeedAt(i, _request.speeds[i]);
+		}
+		if (_request.torques.isValid(i)) {
+			setTorqueAt(i, _request.torques[i]);
 		}
 	}
 }
-
@@ -3,17 +3,35 @@
 
 #include <array>
 
-#include "ModuleFramework/Serializer.h"
+#include "ModuleFramework/CompactSerializer.h"
 #include "platform/hardware/robot/motorIDs.h"
+#include "platform/hardware/robot/motorVector.h"
 #include "platform/system/timer.h"
 #include "utils/units.h"
 
+/**
+ * The requests are kept in MotorVectors (indexed like the robot description's MotorIndex) which are
+ * only invalidated by clear(), so the motion cycle neither allocates nor copies them.
+ */
 class MotorPositionRequest {
-	std::map<MotorID, std::pair<Degree, int>>  positions; // Indicates target position of motor
-	std::map<MotorID, std::pair<Degree, bool>> offsets;   // Indicates the offset of this motor
-	std::map<MotorID, std::pair<RPM, bool>>    speeds;    // Indicates speed of motor
-	std::map<MotorID, std::pair<double, bool>> forces;    // Indicates torque of motor
-	std::map<MotorID, std::pair<bool, bool>>   torques;   // Indicates if torque should be enabled
+	MotorVector<Degree> positions;     // Indicates target position of motor
+	std::vector<int>    positionHolds; // for how many clear()s a position stays requested
+	MotorVector<Degree> offsets;       // Indicates the offset of this motor
+	MotorVector<RPM>    speeds;        // Indicates speed of motor
+	MotorVector<double> forces;        // Indicates torque of motor
+	MotorVector<bool>   torques;       // Indicates if torque should be enabled
+	MotorVector<bool>   torqueStates;  // the last torque requested for a motor (valid once requested)
+
+	/// size the vectors for the motors of the robot (on first use)
+	void prepare();
+
+	/// index of the motor (-1 if the motor is no servo)
+	int toIndex(MotorID _id);
+
+	void setPositionAt(int _index, Degree _angle);
+	void setOffsetAt(int _index, Degree _angleOffset);
+	void setSpeedAt(int _index, RPM _speed);
+	void setTorqueAt(int _index, bool _on);
 
 public:
 	/** this will clear the request, so double request can be detected*/
@@ -31,11 +49,11 @@ public:
 	Degree getOffset(MotorID _id) const;
 	RPM getSpeed(MotorID _id) const;
 
-	std::map<MotorID, Degree> getPositionRequests() const;
-	std::map<MotorID, Degree> getOffsetRequests() const;
-	std::map<MotorID, RPM>    getSpeedRequests() const;
-	std::map<MotorID, double> getForceRequests() const;
-	std::map<MotorID, bool>   getTorqueRequests() const;
+	const MotorVector<Degree>& getPositionRequests() const { return positions; }
+	const MotorVector<Degree>& getOffsetRequests()   const { return offsets;   }
+	const MotorVector<RPM>&    getSpeedRequests()    const { return speeds;    }
+	const MotorVector<double>& getForceRequests()    const { return forces;    }
+	const MotorVector<bool>&   getTorqueRequests()   const { return torques;   }
 
 	// merges the request in _request into this representation
 	// This is for cognition -> motion exchange
@@ -50,10 +68,21 @@ protected:
 		ar & offsets;
 		ar & speeds;
 		ar & torques;
+
+		if (version >= 3) {
+			ar & positionHolds;
+			ar & forces;
+			ar & torqueStates;
+		} else if (Archive::is_loading::value) {
+			// older logs do not contain the state, start over with the size of the positions
+			positionHolds.assign(positions.size(), 0);
+			forces       = MotorVector<double>(positions.size());
+			torqueStates = MotorVector<bool>(positions.size());
+		}
 	}
 };
 
-REGISTER_SERIALIZATION(MotorPositionRequest, 1)
+REGISTER_COMPACT_SERIALIZATION(MotorPositionRequest, 1, 3)
 
 
 #endif
@@ -69,7 +69,7 @@ bool Services::init(int argc, char* argv[], ServiceInitStructure* sis) {
 	for (auto optionName : optionNames) {
 		DebuggingOption *debugOption = ::Debugging::getInstance().getDebugOption(optionName);
 		if (debugOption) {
-			debugOption->enabled = true;
+			debugOption->setEnabled(true);
 		}
 	}
 
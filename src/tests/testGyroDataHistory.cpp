@@ -0,0 +1,97 @@
+#include <gtest/gtest.h>
+
+#include "representations/hardware/gyroDataHistory.h"
+
+#include "ModuleFramework/DataHolder.h"
+#include "debugging/logging/logBuffer.h"
+#include "platform/system/timer.h"
+
+#include <stdio.h>
+
+
+/* ------------------------------------------------------------------------- */
+
+class TestGyroDataHistory: public ::testing::Test {
+protected:
+	/// fill the whole history, as the gyro reader does within a second
+	void fill(GyroDataHistory &history, int frame) {
+		for (int i = 0; i < MAXGYROHISTORY; i++) {
+			arma::mat33 rotation;
+			rotation.fill((frame + i) * 0.01);
+			std::array<Degree, 3> angles = {{ (frame + i) * degrees, i * degrees, -i * degrees }};
+			history.addGyroValue(GyroData((frame * MAXGYROHISTORY + i + 1) * milliseconds, angles, rotation, arma::colvec4()));
+		}
+	}
+
+	void serialize(DataHolder<GyroDataHistory> &representation, LogBuffer &buffer) {
+		buffer.clear();
+		SERIALIZER archive(buffer, boost::archive::no_header | boost::archive::no_codecvt);
+		representation.serialize(archive);
+	}
+
+	bool deserialize(DataHolder<GyroDataHistory> &representation, LogBuffer &buffer) {
+		LogInputBuffer input(buffer.data(), buffer.size());
+		DESERIALIZER archive(input, boost::archive::no_header | boost::archive::no_codecvt);
+		bool result = representation.deserialize(archive);
+		EXPECT_EQ(buffer.size(), input.consumed());
+		return result;
+	}
+};
+
+
+/* ------------------------------------------------------------------------- */
+
+TEST_F(TestGyroDataHistory, RoundTrip) {
+	DataHolder<GyroDataHistory> original("GyroDataHistory");
+	fill(*original, 3);
+
+	LogBuffer buffer;
+	serialize(original, buffer);
+
+	DataHolder<GyroDataHistory> copy("GyroDataHistory");
+	ASSERT_TRUE(deserialize(copy, buffer));
+
+	for (int i = 0; i < MAXGYROHISTORY; i++) {
+		robottime_t timestamp = (3 * MAXGYROHISTORY + i + 1) * milliseconds;
+		const GyroData &expected = (*original).getGyroValue(timestamp);
+		const GyroData &actual   = (*copy).getGyroValue(timestamp);
+
+		EXPECT_EQ(expected.getTimestamp(), actual.getTimestamp());
+		EXPECT_EQ(expected.getPitch().value(), actual.getPitch().value());
+		EXPECT_EQ(expected.getRoll().value(),  actual.getRoll().value());
+		EXPECT_EQ(expected.getYaw().value(),   actual.getYaw().value());
+		EXPECT_EQ(0u, arma::accu(expected.getRotMat() != actual.getRotMat()));
+	}
+}
+
+
+/* ------------------------------------------------------------------------- */
+
+TEST_F(TestGyroDataHistory, DISABLED_BenchmarkSerialization) {
+	const int frames = 10000;
+
+	DataHolder<GyroDataHistory> history("GyroDataHistory");
+	fill(*history, 0);
+	LogBuffer buffer;
+	size_t boostBytes = 0, compactBytes = 0;
+
+	// the boost archive, as used before the compact serialization
+	Microsecond start = getCurrentMicroTime();
+	for (int i = 0; i < frames; i++) {
+		buffer.clear();
+		SERIALIZER archive(buffer, boost::archive::no_header | boost::archive::no_codecvt);
+		archive << *history;
+		boostBytes = buffer.size();
+	}
+	Microsecond boostTime = (getCurrentMicroTime() - start) / (double)frames;
+
+	start = getCurrentMicroTime();
+	for (int i = 0; i < frames; i++) {
+		serialize(history, buffer);
+		compactBytes = buffer.size();
+	}
+	Microsecond compactTime = (getCurrentMicroTime() - start) / (double)frames;
+
+	printf("boost:    %5d bytes/frame, %.2f us/frame\n", (int)boostBytes,   boostTime.value());
+	printf("compact:  %5d bytes/frame, %.2f us/frame\n", (int)compactBytes, compactTime.value());
+}
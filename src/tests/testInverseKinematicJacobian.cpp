@@ -0,0 +1,185 @@
+#include <gtest/gtest.h>
+
+#include "platform/hardware/robot/robotDescription.h"
+#include "platform/system/timer.h"
+#include "representations/motion/kinematicTree.h"
+#include "tools/kinematicEngine/inverseKinematicJacobian.h"
+#include "tools/kinematicEngine/tasks/kinematicEngineTaskCOMWholeRobot.h"
+#include "tools/kinematicEngine/tasks/kinematicEngineTaskLocation.h"
+
+#include <memory>
+#include <stdio.h>
+
+
+/* ------------------------------------------------------------------------- */
+
+/// the solver, extended by the step as it was computed with explicit inverses
+class TestInverseKinematicJacobianSolver : public InverseKinematicJacobian {
+public:
+	double referenceIterationStep(KinematicTree const& tree, MotorVector<Degree>& o_angles, KinematicEngineTasksContainer const& alltasks) const {
+		double totalError = 0;
+		const uint motorCnt = tree.getMotorCt();
+
+		arma::colvec values(motorCnt);
+		for (uint i = 0; i < motorCnt; ++i) {
+			const KinematicNode *node = tree.getMotorNode(i);
+			values(i) = node->isFixedNode() ? 0. : Radian(node->getValue() * degrees).value();
+		}
+
+		arma::colvec summedDiffs = arma::zeros(motorCnt);
+		arma::mat eye = arma::eye(motorCnt, motorCnt);
+		arma::mat nullspace = arma::zeros(motorCnt, motorCnt);
+
+		for (uint l = 0; l < KinematicEngineTasksTypes::NUM_TASK_LEVELS; ++l) {
+			if (alltasks[l].empty())
+				continue;
+
+			arma::mat jacobian;
+			arma::colvec error;
+			getJacobianForTasks(tree, alltasks[l], jacobian, true);
+			getErrorForTasks(tree, alltasks[l], error);
+
+			arma::mat dog = eye - nullspace;
+			summedDiffs += dog * (pseudoInverse(jacobian, m_epsilon) * error);
+			nullspace += dog * (pseudoInverse(jacobian, m_nullspaceEpsilon) * jacobian);
+
+			totalError += arma::dot(error, error);
+		}
+
+		for (uint i = 0; i < motorCnt; ++i)
+			values(i) += Math::limited(summedDiffs(i), -m_maxValueChange, m_maxValueChange);
+
+		o_angles.resize(motorCnt);
+		for (uint i = 0; i < motorCnt; ++i)
+			o_angles.set(i, tree.clipAngleForMotor(tree.toExt(i), Degree(values(i) * radians)));
+
+		return totalError;
+	}
+
+private:
+	static arma::mat pseudoInverse(arma::mat const& matrix, double epsilon) {
+		arma::mat helper = matrix * matrix.t();
+		return matrix.t() * arma::inv(helper + epsilon * arma::eye(helper.n_rows, helper.n_cols));
+	}
+};
+
+
+/* ------------------------------------------------------------------------- */
+
+class TestInverseKinematicJacobian: public ::testing::Test {
+protected:
+	virtual void SetUp() {
+		// the defaults of the kinematic engine
+		solver.setEpsilon(0.1);
+		solver.setNullspaceEpsilon(0.00000001);
+		solver.setMaxValueChange(45.);
+	}
+
+	/** Set up the tree of the robot description and tasks moving every limb
+	 ** (and the center of mass) a little away from its current position.
+	 **
+	 ** Loading a robot description sets the global motor and effector IDs,
+	 ** so the default description has to be loaded last.
+	 */
+	void setup(const std::string &robotDescriptionFile) {
+		description.reset(new RobotDescription(robotDescriptionFile));
+		ASSERT_FALSE(description->getNodes().empty()) << robotDescriptionFile;
+
+		tree = KinematicTree();
+		tree.setup(*description);
+
+		tasks = KinematicEngineTasksContainer();
+		ownedTasks.clear();
+
+		const MotorID root = tree.getNodeID("root");
+		const arma::colvec3 offset = arma::ones(3) * 0.02;
+
+		for (const auto &it : description->getNodes()) {
+			const KinematicNode *node = tree.getNode(it.first);
+			if (false == node->getChildren().empty() || false == hasServoAbove(node))
+				continue;
+
+			const arma::colvec3 position = tree.getTransitionMatrixFromTo(root, it.first).col(3).rows(0, 2);
+			ownedTasks.emplace_back(new KinematicEngineTaskLocation(node->getName(), root, it.first, tree, position + offset));
+
+			// the first limb is the constraint, the others are regular tasks
+			uint level = tasks[KinematicEngineTasksTypes::TASK_LEVEL_GROUND_CONTACT_CONSTRAINT].empty()
+			           ? KinematicEngineTasksTypes::TASK_LEVEL_GROUND_CONTACT_CONSTRAINT
+			           : KinematicEngineTasksTypes::TASK_LEVEL_REGULAR;
+			tasks[level].push_back(ownedTasks.back().get());
+		}
+
+		KinematicEngineTaskCOMWholeRobot *com = new KinematicEngineTaskCOMWholeRobot("com", root, tree);
+		com->setTarget(tree.getCOM().m_position + offset);
+		ownedTasks.emplace_back(com);
+		tasks[KinematicEngineTasksTypes::TASK_LEVEL_DYNAMICS_CONSTRAINT].push_back(com);
+	}
+
+	bool hasServoAbove(const KinematicNode *node) const {
+		for (; node != nullptr; node = node->getParent())
+			if (node->isServo())
+				return true;
+		return false;
+	}
+
+	/// the number of rows of all tasks
+	int countRows() const {
+		int rows = 0;
+		for (const auto &level : tasks)
+			for (const KinematicEngineTask *task : level)
+				rows += task->getDimensionCnt();
+		return rows;
+	}
+
+	TestInverseKinematicJacobianSolver solver;
+
+	std::unique_ptr<RobotDescription> description;
+	KinematicTree tree;
+	KinematicEngineTasksContainer tasks;
+	std::vector<std::unique_ptr<KinematicEngineTask>> ownedTasks;
+};
+
+
+/* ------------------------------------------------------------------------- */
+
+TEST_F(TestInverseKinematicJacobian, IterationStepMatchesInverse) {
+	for (const char *file : { "arm.xml", "car.xml", "quadcopter.xml", "robotDescription.xml" }) {
+		setup(file);
+
+		MotorVector<Degree> angles, referenceAngles;
+		double error          = solver.iterationStep(tree, angles, tasks);
+		double referenceError = solver.referenceIterationStep(tree, referenceAngles, tasks);
+
+		EXPECT_NEAR(referenceError, error, 1e-9) << file;
+		ASSERT_EQ(referenceAngles.size(), angles.size()) << file;
+		for (int i = 0; i < angles.size(); i++)
+			EXPECT_NEAR(referenceAngles[i].value(), angles[i].value(), 1e-6) << file << " motor " << tree.toExt(i);
+	}
+}
+
+
+/* ------------------------------------------------------------------------- */
+
+TEST_F(TestInverseKinematicJacobian, DISABLED_BenchmarkIterationStep) {
+	const int iterations = 2000;
+
+	for (const char *file : { "arm.xml", "car.xml", "quadcopter.xml", "robotDescription.xml" }) {
+		setup(file);
+
+		MotorVector<Degree> angles;
+		solver.iterationStep(tree, angles, tasks); // size the workspaces
+
+		Microsecond start = getCurrentMicroTime();
+		for (int i = 0; i < iterations; i++)
+			solver.referenceIterationStep(tree, angles, tasks);
+		Microsecond inverseTime = (getCurrentMicroTime() - start) / (double)iterations;
+
+		start = getCurrentMicroTime();
+		for (int i = 0; i < iterations; i++)
+			solver.iterationStep(tree, angles, tasks);
+		Microsecond choleskyTime = (getCurrentMicroTime() - start) / (double)iterations;
+
+		printf("%-20s %2d motors, %2d rows: inverse %7.2f us/iterationStep, cholesky %7.2f us/iterationStep\n",
+				file, tree.getMotorCt(), countRows(), inverseTime.value(), choleskyTime.value());
+	}
+}
@@ -0,0 +1,136 @@
+#include <gtest/gtest.h>
+
+#include "services.h"
+#include "platform/hardware/robot/robotModel.h"
+#include "platform/hardware/robot/robotDescription.h"
+#include "representations/motion/motorPositionRequest.h"
+
+#include "ModuleFramework/DataHolder.h"
+#include "debugging/logging/logBuffer.h"
+#include "platform/system/timer.h"
+
+#include "messages/msg_motorstatus.pb.h"
+
+#include <stdio.h>
+
+
+/* ------------------------------------------------------------------------- */
+
+class TestMotorPositionRequest: public ::testing::Test {
+protected:
+	/// request every motor of the robot, as a motion would
+	void fill(MotorPositionRequest &request, int frame) {
+		request.clear();
+		for (MotorID id : services.getRobotModel().getRobotDescription()->getMotorIDs()) {
+			request.setPositionAndSpeed(id, ((frame + id) % 90) * degrees, 30*rounds_per_minute);
+			request.setTorque(id, (frame % 2) == 0);
+		}
+	}
+
+	void serialize(DataHolder<MotorPositionRequest> &representation, LogBuffer &buffer) {
+		buffer.clear();
+		SERIALIZER archive(buffer, boost::archive::no_header | boost::archive::no_codecvt);
+		representation.serialize(archive);
+	}
+
+	bool deserialize(DataHolder<MotorPositionRequest> &representation, LogBuffer &buffer) {
+		LogInputBuffer input(buffer.data(), buffer.size());
+		DESERIALIZER archive(input, boost::archive::no_header | boost::archive::no_codecvt);
+		bool result = representation.deserialize(archive);
+		EXPECT_EQ(buffer.size(), input.consumed());
+		return result;
+	}
+};
+
+
+/* ------------------------------------------------------------------------- */
+
+TEST_F(TestMotorPositionRequest, RoundTrip) {
+	DataHolder<MotorPositionRequest> original("MotorPositionRequest");
+	fill(*original, 42);
+
+	LogBuffer buffer;
+	serialize(original, buffer);
+
+	DataHolder<MotorPositionRequest> copy("MotorPositionRequest");
+	ASSERT_TRUE(deserialize(copy, buffer));
+
+	const MotorVector<Degree> &positions = (*original).getPositionRequests();
+	ASSERT_EQ(positions.size(), (*copy).getPositionRequests().size());
+	for (int i = 0; i < positions.size(); i++) {
+		EXPECT_TRUE((*copy).getPositionRequests().isValid(i));
+		EXPECT_EQ(positions[i].value(), (*copy).getPositionRequests()[i].value());
+		EXPECT_EQ((*original).getSpeedRequests()[i].value(), (*copy).getSpeedRequests()[i].value());
+		EXPECT_EQ((*original).getTorqueRequests()[i], (*copy).getTorqueRequests()[i]);
+	}
+
+	// the positions are held for a few frames after the request was loaded, too
+	(*copy).clear();
+	for (int i = 0; i < positions.size(); i++)
+		EXPECT_TRUE((*copy).getPositionRequests().isValid(i));
+	EXPECT_FALSE((*copy).getSpeedRequests().any());
+
+	MotorPositionRequest merged;
+	merged.merge(*copy);
+	EXPECT_EQ(positions.size(), merged.getPositionRequests().size());
+}
+
+
+/* ------------------------------------------------------------------------- */
+
+TEST_F(TestMotorPositionRequest, DISABLED_BenchmarkSerialization) {
+	const int frames = 10000;
+
+	DataHolder<MotorPositionRequest> request("MotorPositionRequest");
+	LogBuffer buffer;
+	size_t boostBytes = 0, compactBytes = 0, protobufBytes = 0;
+
+	// the boost archive, as used before the compact serialization
+	Microsecond start = getCurrentMicroTime();
+	for (int i = 0; i < frames; i++) {
+		fill(*request, i);
+		buffer.clear();
+		SERIALIZER archive(buffer, boost::archive::no_header | boost::archive::no_codecvt);
+		archive << *request;
+		boostBytes = buffer.size();
+	}
+	Microsecond boostTime = (getCurrentMicroTime() - start) / (double)frames;
+
+	start = getCurrentMicroTime();
+	for (int i = 0; i < frames; i++) {
+		fill(*request, i);
+		serialize(request, buffer);
+		compactBytes = buffer.size();
+	}
+	Microsecond compactTime = (getCurrentMicroTime() - start) / (double)frames;
+
+	// a MotorStatus message, which only carries the positions
+	const MotorIndex &motorIndex = services.getRobotModel().getRobotDescription()->getMotorIndex();
+	de::fumanoids::message::MotorStatus status;
+	std::string data;
+	start = getCurrentMicroTime();
+	for (int i = 0; i < frames; i++) {
+		fill(*request, i);
+		const MotorVector<Degree> &positions = (*request).getPositionRequests();
+		status.Clear();
+		status.set_type(de::fumanoids::message::MotorStatus::MOTOR_POSITION);
+		for (int m = 0; m < positions.size(); m++) {
+			if (false == positions.isValid(m))
+				continue;
+
+			de::fumanoids::message::Entry *entry = status.add_motormap();
+			entry->set_motorid(motorIndex.toExt(m));
+			entry->set_value(positions[m].value());
+		}
+		status.SerializeToString(&data);
+		protobufBytes = data.size();
+	}
+	Microsecond protobufTime = (getCurrentMicroTime() - start) / (double)frames;
+
+	printf("%d motors\n", motorIndex.size());
+	printf("boost:    %4d bytes/frame, %.2f us/frame\n", (int)boostBytes,    boostTime.value());
+	printf("compact:  %4d bytes/frame, %.2f us/frame\n", (int)compactBytes,  compactTime.value());
+	printf("protobuf: %4d bytes/frame, %.2f us/frame (positions only)\n", (int)protobufBytes, protobufTime.value());
+
+	EXPECT_LT(compactBytes, boostBytes);
+}
@@ -0,0 +1,116 @@
+#include <gtest/gtest.h>
+
+#include "modules/motion/walking/reinforcementLearning/rlModelFactory.h"
+#include "modules/motion/walking/reinforcementLearning/rlREPATD.h"
+#include "platform/system/timer.h"
+
+#include <memory>
+#include <random>
+#include <stdio.h>
+
+
+/* ------------------------------------------------------------------------- */
+
+/// REPATD, extended by the radial expansion as it was done before the model was compiled
+class TestRL_REPATDReference : public RL_REPATD {
+public:
+	/// creates two RL_States per neighbour and compares them parameter by parameter
+	void referenceRadialExpansion(int state, int action, float targetQ, float traceDiscount) {
+		for (const RadialExpansionEntry &entry : radialExpansion.entries) {
+			int neighborStateIndex = state + entry.diffIndex;
+			if (model->stateIndexIsValid(neighborStateIndex)
+			    && isInRadialDistance(model->getStateForIndex(state), model->getStateForIndex(neighborStateIndex)))
+			{
+				updateQ(neighborStateIndex, action, targetQ, entry.distanceDiscount, traceDiscount);
+			}
+		}
+	}
+
+	unsigned int getNumberOfStates() const {
+		return model->numberOfStates;
+	}
+
+	unsigned int getNumberOfActions() const {
+		return model->numberOfActions;
+	}
+
+	size_t getRadialExpansionSize() const {
+		return radialExpansion.entries.size();
+	}
+};
+
+
+/* ------------------------------------------------------------------------- */
+
+class TestRLREPATD: public ::testing::Test {
+protected:
+	virtual void SetUp() {
+		model.reset(RL_ModelFactory::createSimpleModel());
+		repatd.init(model.get(), 0.9, 0.9, 0.1, 10);
+		reference.init(model.get(), 0.9, 0.9, 0.1, 10);
+	}
+
+	/// random (but reproducible) expansion jobs
+	std::vector<RadialExpansionJob> createJobs(int count) {
+		std::mt19937 random(1);
+		std::uniform_int_distribution<int> states(0, model->numberOfStates - 1);
+		std::uniform_int_distribution<int> actions(0, model->numberOfActions - 1);
+
+		std::vector<RadialExpansionJob> jobs;
+		for (int i = 0; i < count; i++)
+			jobs.push_back({ states(random), actions(random), 1.f + i, 0.9f });
+		return jobs;
+	}
+
+	std::unique_ptr<RL_Model> model;
+	TestRL_REPATDReference repatd;
+	TestRL_REPATDReference reference;
+};
+
+
+/* ------------------------------------------------------------------------- */
+
+TEST_F(TestRLREPATD, RadialExpansionMatchesReference) {
+	std::vector<char> isInStateSpace;
+	for (const RadialExpansionJob &job : createJobs(20)) {
+		repatd.performRadialExpansion(job.stateIndex, job.actionIndex, job.targetQ, job.traceDiscount, isInStateSpace);
+		reference.referenceRadialExpansion(job.stateIndex, job.actionIndex, job.targetQ, job.traceDiscount);
+	}
+
+	int learned = 0, mismatches = 0;
+	for (unsigned int s = 0; s < repatd.getNumberOfStates(); s++) {
+		for (unsigned int a = 0; a < repatd.getNumberOfActions(); a++) {
+			if (reference.getQValue(s, a) != repatd.getQValue(s, a))
+				mismatches++;
+			if (repatd.getQValue(s, a) != 0)
+				learned++;
+		}
+	}
+
+	EXPECT_GT(learned, 0);
+	EXPECT_EQ(0, mismatches);
+}
+
+
+/* ------------------------------------------------------------------------- */
+
+TEST_F(TestRLREPATD, DISABLED_BenchmarkRadialExpansion) {
+	// the reference takes about a second for a handful of expansions
+	std::vector<RadialExpansionJob> referenceJobs = createJobs(5);
+	std::vector<RadialExpansionJob> jobs          = createJobs(200);
+
+	Microsecond start = getCurrentMicroTime();
+	for (const RadialExpansionJob &job : referenceJobs)
+		reference.referenceRadialExpansion(job.stateIndex, job.actionIndex, job.targetQ, job.traceDiscount);
+	Microsecond referenceTime = getCurrentMicroTime() - start;
+
+	std::vector<char> isInStateSpace;
+	start = getCurrentMicroTime();
+	for (const RadialExpansionJob &job : jobs)
+		repatd.performRadialExpansion(job.stateIndex, job.actionIndex, job.targetQ, job.traceDiscount, isInStateSpace);
+	Microsecond time = getCurrentMicroTime() - start;
+
+	printf("%d states, %d entries per expansion\n", repatd.getNumberOfStates(), (int)repatd.getRadialExpansionSize());
+	printf("reference: %8.1f radial expansions/s\n", referenceJobs.size() * 1e6 / referenceTime.value());
+	printf("compiled:  %8.1f radial expansions/s\n", jobs.size() * 1e6 / time.value());
+}
@@ -8,7 +8,8 @@
 #ifndef THREADSAFEQUEUE_H_
 #define THREADSAFEQUEUE_H_
 
-#include "ModuleFramework/Module.h"
+#include <condition_variable>
+#include <mutex>
 #include <queue>
 
 
@@ -18,22 +19,27 @@ public:
 
 	unsigned int maxSize;
 	std::queue<T> queue;
-	CriticalSection cs;
+	std::mutex mutex;
+	std::condition_variable notEmpty;
+	bool stopped;
 
 
 	ThreadSafeQueue(unsigned int _maxSize) {
 		maxSize = _maxSize;
-		cs.setName("ThreadSafeQueue");
+		stopped = false;
 	}
 
 
 	bool enqueue(T newElem) {
-		CriticalSectionLock lock(cs);
-		if (queue.size() >= maxSize) {
-			return false;
-		}
+		{
+			std::lock_guard<std::mutex> lock(mutex);
+			if (queue.size() >= maxSize) {
+				return false;
+			}
 
-		queue.push(newElem);
+			queue.push(newElem);
+		}
+		notEmpty.notify_one();
 		return true;
 	}
 
@@ -45,20 +51,22 @@ public:
 	 * @return true, if no element had to be deleted, otherwise false.
 	 */
 	bool enqueue_force(T newElem) {
-		CriticalSectionLock lock(cs);
-		if (queue.size() >= maxSize) {
-			queue.pop();
-			queue.push(newElem);
-			return false;
-		} else {
+		bool dropped = false;
+		{
+			std::lock_guard<std::mutex> lock(mutex);
+			if (queue.size() >= maxSize) {
+				queue.pop();
+				dropped = true;
+			}
 			queue.push(newElem);
-			return true;
 		}
+		notEmpty.notify_one();
+		return false == dropped;
 	}
 
 
 	bool dequeue(T& target) {
-		CriticalSectionLock lock(cs);
+		std::lock_guard<std::mutex> lock(mutex);
 		if (queue.size() <= 0) {
 			return false;
 		}
@@ -68,6 +76,36 @@ public:
 		return true;
 	}
 
+
+	/**
+	 * Waits until an element is available and dequeues it.
+	 * @param target
+	 * @return false if the queue was stopped (see stop()), target is unchanged then.
+	 */
+	bool dequeue_wait(T& target) {
+		std::unique_lock<std::mutex> lock(mutex);
+		notEmpty.wait(lock, [this]{ return stopped || false == queue.empty(); });
+		if (stopped) {
+			return false;
+		}
+
+		target = queue.front();
+		queue.pop();
+		return true;
+	}
+
+
+	/**
+	 * Wakes up all threads waiting in dequeue_wait(), which returns false from now on.
+	 */
+	void stop() {
+		{
+			std::lock_guard<std::mutex> lock(mutex);
+			stopped = true;
+		}
+		notEmpty.notify_all();
+	}
+
 };
 
 #endif /* THREADSAFEQUEUE_H_ */
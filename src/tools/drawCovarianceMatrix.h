@@ -45,7 +45,7 @@ inline void drawCovarianceMatrix(const std::string&  debugName,
 {
 
 	DebuggingOption *_debug_option = ::Debugging::getInstance().getDebugOption(debugName);
-	if (_debug_option->enabled) {
+	if (_debug_option->isEnabled()) {
 		ImageDebugger& imageDebugger = Debugging::getInstance().getImageDebugger();
 
 		imageDebugger.setColor(_debug_option, red, green, blue);
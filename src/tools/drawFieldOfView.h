@@ -25,7 +25,7 @@ inline void drawFieldOfView(const std::string& debugName,
                             const ImageDimensions& imageDimensions)
 {
 	DebuggingOption* _debug_option = ::Debugging::getInstance().getDebugOption(debugName);
-	if (_debug_option->enabled) {
+	if (_debug_option->isEnabled()) {
 		ImageDebugger &imageDebugger = ::Debugging::getInstance().getImageDebugger();
 
 		// some tmp variables
@@ -13,6 +13,7 @@
 InverseKinematicJacobian::InverseKinematicJacobian()
 	: InverseKinematics()
 	, m_epsilon(DEFAULT_EPSILON)
+	, m_threadPool(nullptr)
 {
 }
 
@@ -21,194 +22,222 @@ InverseKinematicJacobian::~InverseKinematicJacobian()
 }
 
 
+namespace {
+	/*
+	 * cholesky factorization of (A + epsilon * I) = L * L^T, only the lower triangle of o_factor is written
+	 * returns false if the matrix is not positive definite (i.e. epsilon is 0 and A is singular)
+	 */
+	bool choleskyFactorize(arma::mat const& A, double epsilon, arma::mat &o_factor)
+	{
+		const uint n = A.n_rows;
+		o_factor.set_size(n, n);
+
+		for (uint j = 0; j < n; ++j)
+		{
+			double diagonal = A(j, j) + epsilon;
+			for (uint k = 0; k < j; ++k)
+			{
+				diagonal -= o_factor(j, k) * o_factor(j, k);
+			}
+			if (diagonal <= 0.)
+			{
+				return false;
+			}
+			o_factor(j, j) = sqrt(diagonal);
+
+			for (uint i = j + 1; i < n; ++i)
+			{
+				double sum = A(i, j);
+				for (uint k = 0; k < j; ++k)
+				{
+					sum -= o_factor(i, k) * o_factor(j, k);
+				}
+				o_factor(i, j) = sum / o_factor(j, j);
+			}
+		}
+		return true;
+	}
+
+	/*
+	 * solve (A + epsilon * I) * X = B in place (every column of io_B is one right hand side)
+	 */
+	void dampedSolve(arma::mat const& A, double epsilon, arma::mat const& factor, bool factorized, arma::mat &io_B)
+	{
+		if (false == factorized)
+		{
+			/* only happens without dampening */
+			io_B = arma::pinv(A + epsilon * arma::eye(A.n_rows, A.n_cols)) * io_B;
+			return;
+		}
+
+		const uint n = factor.n_rows;
+		for (uint c = 0; c < io_B.n_cols; ++c)
+		{
+			double *b = io_B.colptr(c);
+
+			/* L * y = b */
+			for (uint i = 0; i < n; ++i)
+			{
+				double sum = b[i];
+				for (uint k = 0; k < i; ++k)
+				{
+					sum -= factor(i, k) * b[k];
+				}
+				b[i] = sum / factor(i, i);
+			}
+
+			/* L^T * x = y */
+			for (int i = n - 1; i >= 0; --i)
+			{
+				double sum = b[i];
+				for (uint k = i + 1; k < n; ++k)
+				{
+					sum -= factor(k, i) * b[k];
+				}
+				b[i] = sum / factor(i, i);
+			}
+		}
+	}
+}
+
+
+void InverseKinematicJacobian::Workspace::resize(uint motorCnt)
+{
+	/* set_size() keeps the memory if the size did not change */
+	values.set_size(motorCnt);
+	summedDiffs.zeros(motorCnt);
+	nullspace.zeros(motorCnt, motorCnt);
+	dog.set_size(motorCnt, motorCnt);
+	nullspaceUpdate.set_size(motorCnt, motorCnt);
+}
+
+
 double InverseKinematicJacobian::iterationStep(
 		KinematicTree const& tree
-		, std::map<MotorID, Degree>& o_angles
+		, MotorVector<Degree>& o_angles
 		, KinematicEngineTasksContainer const& alltasks
 		, const KinematicEngineTaskDefaultPosition* idleTask
 	) const
 {
 	double totalError = 0;
 
-	std::map<MotorID, Degree> curMotorValues;
-	tree.getMotorValues(curMotorValues);
-	uint motorCnt = tree.getMotorCt();
+	const uint motorCnt = tree.getMotorCt();
+	Workspace &workspace = m_stepWorkspace;
+	workspace.resize(motorCnt);
 
-	arma::colvec motorValuesVec = arma::zeros(motorCnt);
-	for (std::pair<MotorID, Degree> const& curValue : curMotorValues)
+	for (uint i = 0; i < motorCnt; ++i)
 	{
-		motorValuesVec(tree.toInt(curValue.first)) = Radian(curValue.second).value();
+		const KinematicNode *node = tree.getMotorNode(i);
+		workspace.values(i) = node->isFixedNode() ? 0. : Radian(node->getValue() * degrees).value();
 	}
 
-	arma::colvec summedJointAngleDiffs = arma::zeros(motorCnt);
-	arma::mat nullspaceEyeMat = arma::eye(motorCnt, motorCnt);
-	arma::mat nullspaceMat = arma::zeros(motorCnt, motorCnt);
-
 	for (uint l(0); l < KinematicEngineTasksTypes::level::NUM_TASK_LEVELS; ++l) {
 		std::vector<const KinematicEngineTask*> const& tasks = alltasks[l];
 
 		if (tasks.size() > 0) {
-			arma::mat dogMat = nullspaceEyeMat - nullspaceMat;
-			arma::mat jacobian = getJacobianForTasks(tree, tasks, true);
-			arma::colvec errorVec = getErrorForTasks(tree, tasks);
-
-
-			/* build the pseudo inverse jacobian */
-			arma::mat pseudoInverseJacobian = buildPseudoInverse(jacobian, m_epsilon);
-
-			const arma::colvec jointDiffs = pseudoInverseJacobian * errorVec;
-			const arma::colvec jointDiffsDecorr = dogMat * jointDiffs;
-			summedJointAngleDiffs += jointDiffsDecorr;
-
-//			std::cout.precision(3);
-//			std::cout << std::fixed << std::setw(13);
-//			nullspaceMat.raw_print(std::cout); printf("\n");
-//			jacobian.raw_print(std::cout); printf("\n");
-
-//			jointDiffs.t().raw_print(std::cout); printf("\n");
-//			jointDiffsDecorr.t().raw_print(std::cout); printf("\n");
-//			summedJointAngleDiffs.t().raw_print(std::cout); printf("\n");
+			LevelWorkspace &level = workspace.levels[l];
+			if ((nullptr != m_threadPool) && (m_threadPool->getThreadCount() > 0) && (tasks.size() > 1))
+			{
+				getJacobianAndErrorForTasksConcurrently(tree, tasks, level);
+			} else
+			{
+				getJacobianForTasks(tree, tasks, level.jacobian, true);
+				getErrorForTasks(tree, tasks, level.error);
+			}
 
-			nullspaceMat += dogMat * (buildPseudoInverse(jacobian, m_nullspaceEpsilon) * jacobian);
+			solveLevel(level, workspace, m_epsilon);
 
-			totalError += arma::dot(errorVec, errorVec);
+			totalError += arma::dot(level.error, level.error);
 		}
 	}
 
-//	std::cout.precision(3);
-//	std::cout << std::fixed << std::setw(7);
-//	nullspaceMat.raw_print(std::cout); printf("\n");
-
-
 	if (nullptr != idleTask) {
-		arma::mat helper = arma::mat(nullspaceEyeMat - nullspaceMat);
-		arma::colvec errorVec = idleTask->getErrors(tree);
-		arma::colvec angleDiffVec = ((nullspaceEyeMat - nullspaceMat) * errorVec);
-
-//		std::cout.precision(3);
-//		std::cout << std::fixed << std::setw(7);
-//		errorVec.t().raw_print(std::cout);
-//		angleDiffVec.t().raw_print(std::cout); printf("\n");
-
-		summedJointAngleDiffs += angleDiffVec;
+		const arma::colvec errorVec = idleTask->getErrors(tree);
+		workspace.dog.eye();
+		workspace.dog -= workspace.nullspace;
+		workspace.summedDiffs += workspace.dog * errorVec;
 	}
 
-	for (uint32_t i = 0; i < summedJointAngleDiffs.n_rows; ++i)
+	for (uint32_t i = 0; i < workspace.summedDiffs.n_rows; ++i)
 	{
-		summedJointAngleDiffs(i) = Math::limited(summedJointAngleDiffs(i), -m_maxValueChange, m_maxValueChange);
+		workspace.summedDiffs(i) = Math::limited(workspace.summedDiffs(i), -m_maxValueChange, m_maxValueChange);
 	}
 
-	motorValuesVec += summedJointAngleDiffs;
+	workspace.values += workspace.summedDiffs;
 
-	for (uint i = 0; i < motorValuesVec.n_rows; ++i)
+	o_angles.resize(motorCnt);
+	for (uint i = 0; i < workspace.values.n_rows; ++i)
 	{
-		Radian newAngle = motorValuesVec(i) * radians;
+		Radian newAngle = workspace.values(i) * radians;
 
 		/* clip */
 		MotorID id = tree.toExt(i);
 		Degree newAngleDeg = tree.clipAngleForMotor(id, Degree(newAngle));
-		o_angles[id] = newAngleDeg;
+		o_angles.set(i, newAngleDeg);
 	}
 
 	return totalError;
-
-	return 0;
 }
 
 double InverseKinematicJacobian::calculateSpeeds(
 		KinematicTree const& tree
-		, std::map<MotorID, RPM>& o_speeds
+		, MotorVector<RPM>& o_speeds
 		, KinematicEngineTasksContainer const& tasks
 		, const KinematicEngineTaskDefaultPosition* idleTask
 	) const
 {
 	double totalError = 0;
-	uint motorCnt = tree.getMotorCt();
 
-	std::map<MotorID, RPM> curMotorSpeeds;
-	tree.getMotorSpeeds(curMotorSpeeds);
+	const uint motorCnt = tree.getMotorCt();
+	Workspace &workspace = m_speedWorkspace;
+	workspace.resize(motorCnt);
 
-	arma::colvec motorSpeedsVec = arma::zeros(motorCnt);
-	for (std::pair<MotorID, RPM> const& curValue : curMotorSpeeds)
+	for (uint i = 0; i < motorCnt; ++i)
 	{
-		// convert rounds per minute to radian per second
-		motorSpeedsVec(tree.toInt(curValue.first)) = (curValue.second).value() / 60. * (2. * M_PI);
+		// in radian per second
+		const KinematicNode *node = tree.getMotorNode(i);
+		workspace.values(i) = node->isFixedNode() ? 0. : node->getValueDerivative();
 	}
 
-	arma::colvec summedJointSpeedDiffs = arma::zeros(motorCnt);
-	arma::mat nullspaceEyeMat = arma::eye(motorCnt, motorCnt);
-	arma::mat nullspaceMat = arma::zeros(motorCnt, motorCnt);
-
 	for (uint l(0); l < KinematicEngineTasksTypes::level::NUM_TASK_LEVELS; ++l) {
 		std::vector<const KinematicEngineTask*> const& _tasks = tasks[l];
 
 		if (_tasks.size() > 0) {
-			arma::mat dogMat = nullspaceEyeMat - nullspaceMat;
-
-			arma::mat jacobian = getJacobianForTasks(tree, _tasks, false);
+			LevelWorkspace &level = workspace.levels[l];
+			getJacobianForTasks(tree, _tasks, level.jacobian, false);
 
 			// how much "error" (mother function)
-			arma::colvec speedTarget = getSpeedTargetForTasks(tree, _tasks);
-
-			// how much "error" derivative (speed)
-			arma::colvec speedVec = jacobian * motorSpeedsVec;
-
-			// the actual error
-			arma::colvec speedError = speedTarget - speedVec;
-
-//			const arma::colvec jointDiffs = jacobian.t() * speedError;
-			const arma::colvec jointDiffs = buildPseudoInverse(jacobian, m_speedEpsilon) * speedError;
-//			const arma::colvec jointDiffs = buildPseudoInverse(jacobian, m_speedEpsilon) * speedTarget - motorSpeedsVec;
-
-			summedJointSpeedDiffs += dogMat * jointDiffs;
+			getSpeedTargetForTasks(tree, _tasks, level.error);
 
-//			std::cout.precision(6);
-//			std::cout << std::fixed << std::setw(15);
-//			nullspaceMat.raw_print(std::cout); printf("\n");
-//			jacobian.raw_print(std::cout); printf("\n");
-//			speedTarget.t().raw_print(std::cout);
-//			speedVec.t().raw_print(std::cout);
-//			speedError.t().raw_print(std::cout);
-//			motorSpeedsVec.t().raw_print(std::cout);
-//			summedJointSpeedDiffs.t().raw_print(std::cout);
-//			printf("\n");
+			// minus how much "error" derivative (speed) is the actual error
+			level.error -= level.jacobian * workspace.values;
 
+			solveLevel(level, workspace, m_speedEpsilon);
 
-			nullspaceMat += dogMat * (buildPseudoInverse(jacobian, m_nullspaceEpsilon) * jacobian);
-
-			totalError += arma::dot(speedError, speedError);
+			totalError += arma::dot(level.error, level.error);
 		}
 	}
 
-
-//	std::cout.precision(3);
-//	std::cout << std::fixed << std::setw(10);
-//	nullspaceMat.raw_print(std::cout); printf("\n\n\n");
-
 	if (nullptr != idleTask) {
-		arma::mat helper = arma::mat(nullspaceEyeMat - nullspaceMat);
-		arma::colvec errorVec = idleTask->getErrors(tree);
-		summedJointSpeedDiffs += (helper * errorVec) * idleTask->getSpeed();
+		const arma::colvec errorVec = idleTask->getErrors(tree);
+		workspace.dog.eye();
+		workspace.dog -= workspace.nullspace;
+		workspace.summedDiffs += (workspace.dog * errorVec) * idleTask->getSpeed();
 	}
 
+	workspace.summedDiffs += workspace.values;
 
-//	motorSpeedsVec.t().raw_print(std::cout);
-//	summedJointSpeedDiffs.t().raw_print(std::cout);
-
-	summedJointSpeedDiffs += motorSpeedsVec;
-
-	for (uint i = 0; i < summedJointSpeedDiffs.n_rows; ++i)
+	o_speeds.resize(motorCnt);
+	for (uint i = 0; i < workspace.summedDiffs.n_rows; ++i)
 	{
-		RPM newSpeed = summedJointSpeedDiffs(i) * 60. / (2. * M_PI) * rounds_per_minute;
-
-		MotorID id = tree.toExt(i);
-		o_speeds[id] = newSpeed;
+		RPM newSpeed = workspace.summedDiffs(i) * 60. / (2. * M_PI) * rounds_per_minute;
+		o_speeds.set(i, newSpeed);
 	}
 
 	return totalError;
 }
 
-double InverseKinematicJacobian::iterationStepGravitation(KinematicTree const& tree, std::map<MotorID, double>& o_torques, std::vector<const KinematicEngineTask*> const& tasks) const
+double InverseKinematicJacobian::iterationStepGravitation(KinematicTree const& tree, MotorVector<double>& o_torques, std::vector<const KinematicEngineTask*> const& tasks) const
 {
 	const uint32_t numTasks = tasks.size();
 
@@ -260,10 +289,10 @@ double InverseKinematicJacobian::iterationStepGravitation(KinematicTree const& t
 
 		arma::colvec torques = pseudoInverseJacobian * errorVec;
 
+		o_torques.resize(numCols);
 		for (uint i = 0; i < torques.n_rows; ++i)
 		{
-			MotorID id = tree.toExt(i);
-			o_torques[id] = torques(i);
+			o_torques.set(i, torques(i));
 		}
 
 		return arma::dot(errorVec, errorVec);
@@ -272,112 +301,97 @@ double InverseKinematicJacobian::iterationStepGravitation(KinematicTree const& t
 	return 0;
 }
 
-arma::mat InverseKinematicJacobian::getJacobianForTasks(KinematicTree const& tree, std::vector<const KinematicEngineTask*> const& tasks, bool normalize) const
+void InverseKinematicJacobian::getJacobianForTasks(KinematicTree const& tree, std::vector<const KinematicEngineTask*> const& tasks, arma::mat &o_jacobian, bool normalize) const
 {
-	const uint32_t numTasks = tasks.size();
-	uint numCols = tree.getMotorCt();
+	const uint numCols = tree.getMotorCt();
 
-	arma::mat jacobian = arma::zeros(1, numCols);
-	if ((0 < numTasks) &&
-		(0 < numCols)) /* at least one task and at least one motor */
+	/* build the "big" jacobian */
+	o_jacobian.zeros(calculateNumRows(tasks), numCols);
+
+	uint32_t beginRow = 0;
+	for (const KinematicEngineTask *const &task : tasks)
 	{
-		/* calculate the size of the jacobian and the task vector */
-		uint32_t numRows = 0;
-		for (const KinematicEngineTask* const &task : tasks)
+		if (task->hasTarget())
 		{
-			if (task->hasTarget()) {
-				numRows += task->getDimensionCnt();
-			}
+			const uint32_t endRow = beginRow + task->getDimensionCnt() - 1;
+			o_jacobian.rows(beginRow, endRow) = task->getJacobianForTask(tree, normalize) * 1. / task->getWeight();
+			beginRow = endRow + 1;
 		}
+	}
+}
 
-		/* build the "big" jacobian */
-		jacobian = arma::zeros(numRows, numCols);
+void InverseKinematicJacobian::getErrorForTasks(KinematicTree const& tree, std::vector<const KinematicEngineTask*> const& tasks, arma::colvec &o_error) const
+{
+	o_error.zeros(calculateNumRows(tasks));
 
-		uint32_t beginRow = 0;
-		for (const KinematicEngineTask *const &task : tasks)
+	uint32_t beginRow = 0;
+	for (const KinematicEngineTask *const &task : tasks)
+	{
+		if (task->hasTarget())
 		{
-			if (task->hasTarget())
-			{
-				const uint32_t endRow = beginRow + task->getDimensionCnt() - 1;
-
-				arma::mat jacobianForTask = task->getJacobianForTask(tree, normalize) * 1. / task->getWeight();
-				jacobian.submat(beginRow, 0, endRow, numCols - 1) = jacobianForTask;
-
-				beginRow = endRow + 1;
-			}
+			const uint32_t endRow = beginRow + task->getDimensionCnt() - 1;
+			o_error.rows(beginRow, endRow) = task->getError(tree) * task->getWeight();
+			beginRow = endRow + 1;
 		}
 	}
-
-	return jacobian;
 }
 
-arma::colvec InverseKinematicJacobian::getErrorForTasks(KinematicTree const& tree, std::vector<const KinematicEngineTask*> const& tasks) const
+void InverseKinematicJacobian::getSpeedTargetForTasks(KinematicTree const& tree, std::vector<const KinematicEngineTask*> const& tasks, arma::colvec &o_target) const
 {
-	const uint32_t numTasks = tasks.size();
+	o_target.zeros(calculateNumRows(tasks));
 
-	arma::colvec errorVec = arma::zeros(1);
-	if (0 < numTasks) /* at least one task */
+	uint32_t beginRow = 0;
+	for (const KinematicEngineTask *const &task : tasks)
 	{
-		uint32_t numRows = 0;
-		for (const KinematicEngineTask* const &task : tasks)
+		if (task->hasTarget())
 		{
-			if (task->hasTarget()) {
-				numRows += task->getDimensionCnt();
-			}
-		}
-		errorVec = arma::zeros(numRows);
+			const uint32_t endRow = beginRow + task->getDimensionCnt() - 1;
+			arma::colvec error = task->getError(tree) * task->getWeight();
 
-		uint32_t beginRow = 0;
-		for (const KinematicEngineTask *const &task : tasks)
-		{
-			if (task->hasTarget())
-			{
-				const uint32_t endRow = beginRow + task->getDimensionCnt() - 1;
-				arma::colvec error = task->getError(tree);
-				errorVec.rows(beginRow, endRow) = error * task->getWeight();
-				beginRow = endRow + 1;
+			if (task->hasSpeed() && arma::norm(error, 2) > 0.000000001 ) {
+				error *= task->getSpeedToReachTarget() / arma::norm(error, 2);
 			}
+
+			o_target.rows(beginRow, endRow) = error;
+			beginRow = endRow + 1;
 		}
 	}
-
-	return errorVec;
 }
 
-arma::colvec InverseKinematicJacobian::getSpeedTargetForTasks(KinematicTree const& tree, std::vector<const KinematicEngineTask*> const& tasks) const
+void InverseKinematicJacobian::getJacobianAndErrorForTasksConcurrently(KinematicTree const& tree, std::vector<const KinematicEngineTask*> const& tasks, LevelWorkspace &level) const
 {
-	const uint32_t numTasks = tasks.size();
-
-	arma::colvec errorVec = arma::zeros(1);
-	if (0 < numTasks) /* at least one task */
+	const uint numRows = calculateNumRows(tasks);
+	level.jacobian.zeros(numRows, tree.getMotorCt());
+	level.error.zeros(numRows);
+
+	/* the rows of every task are fixed before anything is calculated */
+	level.beginRows.clear();
+	level.jobs.clear();
+	uint32_t beginRow = 0;
+	for (const KinematicEngineTask *const &task : tasks)
 	{
-		uint32_t numRows = 0;
-		for (const KinematicEngineTask* const &task : tasks)
+		level.beginRows.push_back(beginRow);
+		if (task->hasTarget())
 		{
-			if (task->hasTarget()) {
-				numRows += task->getDimensionCnt();
-			}
+			beginRow += task->getDimensionCnt();
 		}
-		errorVec = arma::zeros(numRows);
+	}
 
-		uint32_t beginRow = 0;
-		for (const KinematicEngineTask *const &task : tasks)
+	for (uint32_t i = 0; i < tasks.size(); ++i)
+	{
+		const KinematicEngineTask *task = tasks[i];
+		if (task->hasTarget())
 		{
-			if (task->hasTarget())
-			{
-				const uint32_t endRow = beginRow + task->getDimensionCnt() - 1;
-				arma::colvec error = task->getError(tree) * task->getWeight();
-
-				if (task->hasSpeed() && arma::norm(error, 2) > 0.000000001 ) {
-					error *= task->getSpeedToReachTarget() / arma::norm(error, 2);
-				}
-
-				errorVec.rows(beginRow, endRow) = error;
-				beginRow = endRow + 1;
-			}
+			const uint32_t taskBeginRow = level.beginRows[i];
+			level.jobs.push_back([&tree, &level, task, taskBeginRow]() {
+				const uint32_t endRow = taskBeginRow + task->getDimensionCnt() - 1;
+				level.jacobian.rows(taskBeginRow, endRow) = task->getJacobianForTask(tree, true) * 1. / task->getWeight();
+				level.error.rows(taskBeginRow, endRow) = task->getError(tree) * task->getWeight();
+			});
 		}
 	}
 
-	return errorVec;
+	m_threadPool->execute(level.jobs);
 }
 
 int InverseKinematicJacobian::calculateNumRows(std::vector<const KinematicEngineTask*> const& tasks) const
@@ -393,11 +407,42 @@ int InverseKinematicJacobian::calculateNumRows(std::vector<const KinematicEngine
 }
 
 
-arma::mat InverseKinematicJacobian::buildPseudoInverse(arma::mat matrix, double epsilon) const
+/*
+ * add the contribution of one task level:
+ *   jointDiffs = J^T * (J * J^T + epsilon * I)^-1 * error, decorrelated by the nullspace of the higher levels
+ *   nullspace += (I - nullspace) * J^T * (J * J^T + nullspaceEpsilon * I)^-1 * J
+ */
+void InverseKinematicJacobian::solveLevel(LevelWorkspace &level, Workspace &workspace, double epsilon) const
 {
-	arma::mat helper = matrix * matrix.t();
-	const arma::mat I = arma::eye(helper.n_rows, helper.n_cols);
-	arma::mat pseudoInverseJacobian = matrix.t() * arma::inv((helper + epsilon * I));
-	return pseudoInverseJacobian;
-}
+	if (0 == level.jacobian.n_rows)
+	{
+		/* no task of this level has a target */
+		return;
+	}
+
+	workspace.dog.eye();
+	workspace.dog -= workspace.nullspace;
 
+	level.gram = level.jacobian * level.jacobian.t();
+
+	const bool factorized = choleskyFactorize(level.gram, epsilon, level.factor);
+	level.solution = level.error;
+	dampedSolve(level.gram, epsilon, level.factor, factorized, level.solution);
+
+	level.jointDiffs = level.jacobian.t() * level.solution;
+	workspace.summedDiffs += workspace.dog * level.jointDiffs;
+
+	/* the nullspace projector reuses the factorization if possible */
+	level.projector = level.jacobian;
+	if (m_nullspaceEpsilon == epsilon)
+	{
+		dampedSolve(level.gram, epsilon, level.factor, factorized, level.projector);
+	} else
+	{
+		const bool nullspaceFactorized = choleskyFactorize(level.gram, m_nullspaceEpsilon, level.nullspaceFactor);
+		dampedSolve(level.gram, m_nullspaceEpsilon, level.nullspaceFactor, nullspaceFactorized, level.projector);
+	}
+
+	workspace.nullspaceUpdate = level.jacobian.t() * level.projector;
+	workspace.nullspace += workspace.dog * workspace.nullspaceUpdate;
+}
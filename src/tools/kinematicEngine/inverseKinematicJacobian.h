@@ -10,12 +10,24 @@
 
 #include "inverseKinematics.h"
 
+#include "ModuleFramework/moduleThreadPool.h"
+
+#include <array>
 #include <vector>
 #include <random>
 
 /*
  * inverse kinematics with dampened least squares method
  * the dampening factor is m_epsilon and should be chosen carefully
+ *
+ * (J * J^T + epsilon * I) is never inverted but factorized (cholesky) and the factorization is
+ * shared by the step and the nullspace projector if both use the same epsilon.
+ * All matrices are kept between the calls, so once the task sizes settle no memory is allocated.
+ * Hence iterationStep() and calculateSpeeds() must not be called concurrently with themselves, but
+ * they use separate matrices and may run concurrently with each other and iterationStepGravitation().
+ *
+ * If a thread pool is set, iterationStep() assembles the jacobians and errors of the tasks of one
+ * level concurrently (every task fills its own rows, so the result does not depend on the order).
  */
 class InverseKinematicJacobian : public InverseKinematics {
 public:
@@ -24,21 +36,21 @@ public:
 
 	virtual double iterationStep(
 			KinematicTree const& tree
-			, std::map<MotorID, Degree>& o_angles
+			, MotorVector<Degree>& o_angles
 			, KinematicEngineTasksContainer const& tasks
 			, const KinematicEngineTaskDefaultPosition* idleTask = nullptr
 		) const;
 
 	virtual double calculateSpeeds(
 			KinematicTree const& tree
-			, std::map<MotorID, RPM>& o_speeds
+			, MotorVector<RPM>& o_speeds
 			, KinematicEngineTasksContainer const& tasks
 			, const KinematicEngineTaskDefaultPosition* idleTask = nullptr
 		) const;
 
 	virtual double iterationStepGravitation(
 			KinematicTree const& tree
-			, std::map<MotorID, double>& torques
+			, MotorVector<double>& o_torques
 			, std::vector<const KinematicEngineTask*> const&
 		) const;
 
@@ -55,6 +67,14 @@ public:
 		m_nullspaceEpsilon = newEpsilon;
 	}
 
+	/**
+	 * the pool used to assemble the task levels in iterationStep() (nullptr == in the calling thread)
+	 * iterationStep() must not be called from within a task of this pool
+	 */
+	void setThreadPool(ModuleThreadPool *threadPool) {
+		m_threadPool = threadPool;
+	}
+
 protected:
 	/**
 	 * the epsilon used in the regularisation term when generating the pseudo inverse jacobian
@@ -65,14 +85,49 @@ protected:
 
 	double m_nullspaceEpsilon;
 
+	ModuleThreadPool *m_threadPool;
 
-	arma::mat getJacobianForTasks(KinematicTree const& tree, std::vector<const KinematicEngineTask*> const& tasks, bool normalize = false) const;
-	arma::colvec getErrorForTasks(KinematicTree const& tree, std::vector<const KinematicEngineTask*> const& tasks) const;
-	arma::colvec getSpeedTargetForTasks(KinematicTree const& tree, std::vector<const KinematicEngineTask*> const& tasks) const;
+
+	/*
+	 * the matrices of one task level
+	 */
+	struct LevelWorkspace {
+		arma::mat jacobian;         // rows x motors
+		arma::colvec error;         // rows
+		arma::colvec solution;      // rows, (J * J^T + epsilon * I)^-1 * error
+		arma::mat gram;             // rows x rows, J * J^T
+		arma::mat factor;           // rows x rows, cholesky factor of (J * J^T + epsilon * I)
+		arma::mat nullspaceFactor;  // rows x rows, the same with the nullspace epsilon
+		arma::mat projector;        // rows x motors, (J * J^T + epsilon * I)^-1 * J
+		arma::colvec jointDiffs;    // motors
+
+		std::vector<uint32_t> beginRows;             // first row of every task
+		std::vector<ModuleThreadPool::Task> jobs;    // one per task with a target
+	};
+
+	struct Workspace {
+		arma::colvec values;        // motors
+		arma::colvec summedDiffs;   // motors
+		arma::mat nullspace;        // motors x motors
+		arma::mat dog;              // motors x motors, I - nullspace
+		arma::mat nullspaceUpdate;  // motors x motors
+		std::array<LevelWorkspace, KinematicEngineTasksTypes::NUM_TASK_LEVELS> levels;
+
+		void resize(uint motorCnt);
+	};
+
+	mutable Workspace m_stepWorkspace;
+	mutable Workspace m_speedWorkspace;
+
+	void getJacobianForTasks(KinematicTree const& tree, std::vector<const KinematicEngineTask*> const& tasks, arma::mat &o_jacobian, bool normalize = false) const;
+	void getErrorForTasks(KinematicTree const& tree, std::vector<const KinematicEngineTask*> const& tasks, arma::colvec &o_error) const;
+	void getSpeedTargetForTasks(KinematicTree const& tree, std::vector<const KinematicEngineTask*> const& tasks, arma::colvec &o_target) const;
+
+	void getJacobianAndErrorForTasksConcurrently(KinematicTree const& tree, std::vector<const KinematicEngineTask*> const& tasks, LevelWorkspace &level) const;
 
 	int calculateNumRows(std::vector<const KinematicEngineTask*> const& tasks) const;
 
-	arma::mat buildPseudoInverse(arma::mat matrix, double epsilon) const;
+	void solveLevel(LevelWorkspace &level, Workspace &workspace, double epsilon) const;
 };
 
 #endif /* INVERSEKINEMATICJACOBIAN_H_ */
@@ -26,21 +26,21 @@ public:
 
 	virtual double iterationStep(
 			KinematicTree const& tree
-			, std::map<MotorID, Degree>& o_angles
+			, MotorVector<Degree>& o_angles
 			, KinematicEngineTasksContainer const& tasks
 			, const KinematicEngineTaskDefaultPosition* idleTask = nullptr
 		) const = 0;
 
 	virtual double calculateSpeeds(
 			KinematicTree const& tree
-			, std::map<MotorID, RPM>& o_speeds
+			, MotorVector<RPM>& o_speeds
 			, KinematicEngineTasksContainer const& tasks
 			, const KinematicEngineTaskDefaultPosition* idleTask = nullptr
 		) const = 0;
 
 	virtual double iterationStepGravitation(
 			KinematicTree const& tree
-			, std::map<MotorID, double>& torques
+			, MotorVector<double>& o_torques
 			, std::vector<const KinematicEngineTask*> const&
 		) const = 0;
 
@@ -7,7 +7,85 @@
 
 #include <tools/kinematicEngine/tasks/kinematicEngineTask.h>
 
+#include <algorithm>
+
 KinematicEngineTask::~KinematicEngineTask() {
 	// TODO Auto-generated destructor stub
 }
 
+
+namespace {
+	/* the combined mass without the part (both given in the same frame) */
+	KinematicMass withoutPart(KinematicMass const& total, KinematicMass const& part)
+	{
+		KinematicMass ret;
+		ret.m_massGrams = total.m_massGrams - part.m_massGrams;
+		if (ret.m_massGrams > 0.) {
+			ret.m_position = (total.m_position * total.m_massGrams - part.m_position * part.m_massGrams) * 1. / ret.m_massGrams;
+		} else {
+			ret.m_massGrams = 0.;
+			ret.m_position = arma::zeros(3);
+		}
+		return ret;
+	}
+
+	/* how rotating the node moves the mass (given in the root frame) times its weight, in the root frame */
+	arma::colvec3 getMassMomentDerivative(const KinematicTree &kinematicTree, const KinematicNode *node, KinematicMass mass)
+	{
+		if (mass.m_massGrams <= 0.) {
+			return arma::zeros(3);
+		}
+
+		mass.applyTransformation(kinematicTree.getRootToNodeMatrix(node));
+		const arma::colvec3 partialDerivative = node->getPartialDerivativeOfLocationToEffector(mass.m_position) * mass.m_massGrams;
+		return kinematicTree.getNodeToRootMatrix(node).submat(0, 0, 2, 2) * partialDerivative;
+	}
+}
+
+void KinematicEngineTask::getMassMomentJacobian(const KinematicTree &kinematicTree, arma::mat &o_jacobian) const
+{
+	o_jacobian.zeros(3, kinematicTree.getMotorCt());
+
+	const KinematicNode *base = kinematicTree.getNode(m_baseNode);
+	if (nullptr == base) {
+		return;
+	}
+
+	/* the joints between the base and the top of the tree move everything above them */
+	std::vector<const KinematicNode*> ancestors;
+	const KinematicNode *top = base;
+	while (nullptr != top->getParent()) {
+		top = top->getParent();
+		ancestors.push_back(top);
+	}
+
+	KinematicMass const& total = kinematicTree.getSubtreeMass(top);
+	const arma::mat33 rootToBase = kinematicTree.getRootToNodeMatrix(base).submat(0, 0, 2, 2);
+
+	for (int i = 0; i < kinematicTree.getMotorCt(); ++i)
+	{
+		const KinematicNode *node = kinematicTree.getNode(kinematicTree.toExt(i));
+		if (nullptr == node || node->isFixedNode()) {
+			continue;
+		}
+
+		KinematicMass const& subtreeMass = kinematicTree.getSubtreeMass(node);
+		arma::colvec3 derivative;
+
+		if (node == base) {
+			/* the base moves its children's masses as well as everything above it (inversely) */
+			KinematicMass ownMass = node->getEquivalentMass();
+			ownMass.applyTransformation(kinematicTree.getNodeToRootMatrix(node));
+
+			derivative = getMassMomentDerivative(kinematicTree, node, withoutPart(subtreeMass, ownMass))
+			           - getMassMomentDerivative(kinematicTree, node, withoutPart(total, subtreeMass));
+		} else if (std::find(ancestors.begin(), ancestors.end(), node) != ancestors.end()) {
+			/* negative influence since the rotation of everything above is inverse */
+			derivative = -getMassMomentDerivative(kinematicTree, node, withoutPart(total, subtreeMass));
+		} else {
+			derivative = getMassMomentDerivative(kinematicTree, node, subtreeMass);
+		}
+
+		o_jacobian.col(i) = rootToBase * derivative;
+	}
+}
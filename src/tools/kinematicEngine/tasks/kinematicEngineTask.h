@@ -193,6 +193,15 @@ protected:
 		return retJacobian;
 	}
 
+	/**
+	 * calculate the jacobian of the robot's mass moment (mass [g] times center of mass [m]) in the
+	 * coordinate frame of the base node: every joint moves the masses on its side that does not
+	 * contain the base node. All columns are taken from the kinematic state cached by the tree.
+	 * @param kinematicTree
+	 * @param o_jacobian 3 x motors
+	 */
+	void getMassMomentJacobian(const KinematicTree &kinematicTree, arma::mat &o_jacobian) const;
+
 	inline void normJacobian(arma::mat &jacobian) const
 	{
 		double maxNorm = 0.;
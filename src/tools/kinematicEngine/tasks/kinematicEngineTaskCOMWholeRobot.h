@@ -52,9 +52,6 @@ public:
 	}
 
 private:
-
-	arma::mat getJacobianForTaskSub(const KinematicTree &kinematicTree, const KinematicNode *node, const KinematicNode *prevNode, KinematicMass &o_mass, bool commingFromParent) const;
-
 	SubDimension m_subDimension;
 
 	uint m_dimCnt;
@@ -30,13 +30,13 @@ void KinematicEngineTaskDefaultPosition::setDefaultValues(KinematicTree const& t
 arma::colvec KinematicEngineTaskDefaultPosition::getErrors(KinematicTree const& tree) const
 {
 	uint motorCnt = tree.getMotorCt();
-	std::map<MotorID, Degree> values;
-	tree.getMotorValues(values);
-
 	arma::colvec curValues = arma::zeros(motorCnt);
 
 	for (uint i = 0; i < motorCnt; ++i) {
-		curValues(i) = Radian(values[tree.toExt(i)]).value();
+		const KinematicNode *node = tree.getMotorNode(i);
+		if (false == node->isFixedNode()) {
+			curValues(i) = Radian(node->getValue() * degrees).value();
+		}
 	}
 
 	return (m_defaultValues - curValues) * m_weight;
@@ -37,17 +37,9 @@ arma::mat KinematicEngineTaskLinearMomentum::getJacobianForTask(const KinematicT
 
 	if (false != m_hasTarget)
 	{
-		arma::mat jacobian = arma::zeros(m_target.n_rows, kinematicTree.getMotorCt());
-
-		const KinematicNode *node = kinematicTree.getNode(m_baseNode);
-
-		KinematicMass massFromParent, massFromChildren;
-
-		for (const KinematicNode* child: node->getChildren()) {
-			jacobian += child->getForwardMatrix().submat(0, 0, 2, 2) * getJacobianForTaskSub(kinematicTree, node, false, massFromChildren);
-		}
-
-		jacobian += getJacobianForTaskSub(kinematicTree, node, true, massFromChildren);
+		/* the linear momentum is the derivative of the mass moment */
+		arma::mat jacobian;
+		getMassMomentJacobian(kinematicTree, jacobian);
 
 		removeDOFfromJacobian(jacobian, kinematicTree);
 		retJacobian = removeSubdimensions(jacobian, m_subDimension, m_dimCnt);
@@ -59,54 +51,6 @@ arma::mat KinematicEngineTaskLinearMomentum::getJacobianForTask(const KinematicT
 	return retJacobian;
 }
 
-arma::mat KinematicEngineTaskLinearMomentum::getJacobianForTaskSub(const KinematicTree &kinematicTree,
-				const KinematicNode *node,
-				bool traversingUp,
-				KinematicMass &o_massFromSubTree) const
-{
-	KinematicMass attachedNodesMass;
-	arma::mat retJacobian = arma::zeros(m_target.n_rows, kinematicTree.getMotorCt());
-	if (traversingUp) {
-		const KinematicNode* parent = node->getParent();
-		if (nullptr != parent) {
-			const arma::mat33 parentToNodeRotMat = parent->getBackwardMatrix().submat(0, 0, 2, 2);
-			retJacobian = parentToNodeRotMat * getJacobianForTaskSub(kinematicTree, node->getParent(), true, attachedNodesMass);
-
-			for (const KinematicNode* sibling : parent->getChildren()) {
-				if (sibling != node) {
-					retJacobian += parentToNodeRotMat * sibling->getForwardMatrix().submat(0, 0, 2, 2) * getJacobianForTaskSub(kinematicTree, sibling, false, attachedNodesMass);
-				}
-			}
-
-			attachedNodesMass += parent->getEquivalentMass();
-			attachedNodesMass.applyTransformation(node->getBackwardMatrix());
-			o_massFromSubTree += attachedNodesMass;
-
-			if (!node->isFixedNode()) {
-				const int idx = kinematicTree.toInt(node->getID());
-				arma::colvec4 momentumDerivative = node->getPartialDerivativeOfLocationToEffector(attachedNodesMass.m_position) * attachedNodesMass.m_massGrams;
-				retJacobian.col(idx) = momentumDerivative.rows(0, 2);
-			}
-		}
-	} else {
-		for (const KinematicNode *child : node->getChildren()) {
-			retJacobian += child->getForwardMatrix().submat(0, 0, 2, 2) * getJacobianForTaskSub(kinematicTree, child, false, attachedNodesMass);
-		}
-
-		if (!node->isFixedNode()) {
-			const int idx = kinematicTree.toInt(node->getID());
-			KinematicMass curNodesMass = attachedNodesMass + node->getEquivalentMass();
-			arma::colvec4 momentumDerivative = node->getPartialDerivativeOfLocationToEffector(curNodesMass.m_position) * curNodesMass.m_massGrams;
-
-			retJacobian.col(idx) = momentumDerivative.rows(0, 2);
-
-			curNodesMass.applyTransformation(node->getForwardMatrix());
-			o_massFromSubTree += curNodesMass;
-		}
-	}
-	return retJacobian;
-}
-
 arma::colvec KinematicEngineTaskLinearMomentum::getError(const KinematicTree &kinematicTree) const {
 	arma::colvec3 actualLinMomentum = kinematicTree.getLinearMomentum(m_baseNode);
 
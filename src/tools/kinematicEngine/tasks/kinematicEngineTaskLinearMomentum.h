@@ -58,12 +58,6 @@ public:
 	}
 
 private:
-
-	arma::mat getJacobianForTaskSub(const KinematicTree &kinematicTree,
-			const KinematicNode *node,
-			bool traversingUp,
-			KinematicMass &o_massFromSubTree) const;
-
 	SubDimension m_subDimension;
 
 	uint m_dimCnt;
@@ -51,37 +51,30 @@ arma::mat KinematicEngineTaskLocation::getJacobianForTask(const KinematicTree &k
 	arma::mat jacobian = arma::zeros(m_target.n_rows, kinematicTree.getMotorCt());
 	arma::mat retJacobian = arma::zeros(m_dimCnt, kinematicTree.getMotorCt());
 
-	if (false != m_hasTarget)
+	if ((false != m_hasTarget) && (false == m_invPath.empty()))
 	{
-		arma::mat44 forward = arma::eye(4, 4);
-		arma::mat44 intermediateTransition = arma::eye(4, 4);
+		/* the path starts at the endeffector and ends at the base */
+		const arma::colvec4 effectorInRoot = kinematicTree.getNodeToRootMatrix(m_invPath.front().m_node).col(3);
+		const arma::mat33 rootToBase = kinematicTree.getRootToNodeMatrix(m_invPath.back().m_node).submat(0, 0, 2, 2);
 
-		for (uint32_t pathIndex = 0; pathIndex < m_invPath.size(); ++pathIndex)
+		for (KinematicPathNode const& pathNode : m_invPath)
 		{
-			const KinematicNode *node = m_invPath[pathIndex].m_node;
-
-			arma::colvec3 vecToEndeffector = forward.col(3).rows(0, 2);
+			const KinematicNode *node = pathNode.m_node;
 
 			if ((false == node->isFixedNode()) &&
-				(KinematicPathNode::Direction::LINK != m_invPath[pathIndex].m_direction))
+				(KinematicPathNode::Direction::LINK != pathNode.m_direction))
 			{
-				arma::colvec3 partialDerivative = node->getPartialDerivativeOfLocationToEffector(vecToEndeffector);
-				if (KinematicPathNode::Direction::FROM_PARENT == m_invPath[pathIndex].m_direction)
+				const arma::colvec4 vecToEndeffector = kinematicTree.getRootToNodeMatrix(node) * effectorInRoot;
+
+				arma::colvec3 partialDerivative = node->getPartialDerivativeOfLocationToEffector(vecToEndeffector.rows(0, 2));
+				if (KinematicPathNode::Direction::FROM_PARENT == pathNode.m_direction)
 				{
 					/* in this case the rotation axis of the joint is inverted... */
 					partialDerivative = -partialDerivative;
 				}
-				jacobian.col(kinematicTree.toInt(node->getID())) = partialDerivative;
-			}
-
-			if (pathIndex < m_invPath.size() - 1)
-			{
-				const KinematicNode *nextNode = m_invPath[pathIndex + 1].m_node;
-				intermediateTransition = node->getInvMatrixToRelative(nextNode->getID());
-				forward = intermediateTransition * forward;
 
-				/* update the previously calculated entries in the jacobian according to our current orientation */
-				jacobian = intermediateTransition.submat(0, 0, 2, 2) * jacobian;
+				/* the partial derivative is expressed in the node's coordinate frame */
+				jacobian.col(kinematicTree.toInt(node->getID())) = rootToBase * (kinematicTree.getNodeToRootMatrix(node).submat(0, 0, 2, 2) * partialDerivative);
 			}
 		}
 
@@ -40,41 +40,41 @@ arma::mat KinematicEngineTaskOrientation::getJacobianForTask(const KinematicTree
 {
 	arma::mat jacobian = arma::zeros(m_target.n_rows, kinematicTree.getMotorCt());
 
-	arma::mat33 forward = arma::eye(3, 3);
-	arma::mat33 intermediateTransition = arma::eye(3, 3);
+	if (m_invPath.empty())
+	{
+		return jacobian;
+	}
+
+	/* the path starts at the endeffector and ends at the base, the jacobian is expressed in the reference coordinate system */
+	const arma::colvec3 effectorAxisInRoot = kinematicTree.getNodeToRootMatrix(m_invPath.front().m_node).submat(0, 0, 2, 2).col(m_axis);
+	const KinematicNode *referenceNode = kinematicTree.getNode(m_referenceCoordinateSystem);
+	if (nullptr == referenceNode)
+	{
+		referenceNode = m_invPath.back().m_node;
+	}
+	const arma::mat33 rootToReference = kinematicTree.getRootToNodeMatrix(referenceNode).submat(0, 0, 2, 2);
 
-	for (uint32_t pathIndex = 0; pathIndex < m_invPath.size(); ++pathIndex)
+	for (KinematicPathNode const& pathNode : m_invPath)
 	{
-		const KinematicNode *node = m_invPath[pathIndex].m_node;
-		arma::colvec3 orientationOfNode = forward.col(m_axis);
+		const KinematicNode *node = pathNode.m_node;
 
 		if ((false == node->isFixedNode()) &&
-			(KinematicPathNode::Direction::LINK != m_invPath[pathIndex].m_direction))
+			(KinematicPathNode::Direction::LINK != pathNode.m_direction))
 		{
+			const arma::colvec3 orientationOfNode = kinematicTree.getRootToNodeMatrix(node).submat(0, 0, 2, 2) * effectorAxisInRoot;
+
 			arma::colvec3 partialDerivative = node->getPartialDerivativeOfOrientationToEffector(orientationOfNode);
-			if (KinematicPathNode::Direction::FROM_PARENT == m_invPath[pathIndex].m_direction)
+			if (KinematicPathNode::Direction::FROM_PARENT == pathNode.m_direction)
 			{
 				/* in this case the rotation axis of the joint is inverted... */
 				partialDerivative = -partialDerivative;
 			}
-			jacobian.col(kinematicTree.toInt(node->getID())) = partialDerivative;
-		}
 
-		if (pathIndex < m_invPath.size() - 1)
-		{
-			const KinematicNode *nextNode = m_invPath[pathIndex + 1].m_node;
-			intermediateTransition = node->getInvMatrixToRelative(nextNode->getID()).submat(0, 0, 2, 2);
-			forward = intermediateTransition * forward;
-
-			/* update the previously calculated entries in the jacobian according to our current orientation */
-			jacobian = intermediateTransition * jacobian;
+			/* the partial derivative is expressed in the node's coordinate frame */
+			jacobian.col(kinematicTree.toInt(node->getID())) = rootToReference * (kinematicTree.getNodeToRootMatrix(node).submat(0, 0, 2, 2) * partialDerivative);
 		}
 	}
 
-	/* transform the jacobian into the reference coordinate system */
-	arma::mat33 transformToReferenceSystem = kinematicTree.getTransitionMatrixFromTo(m_referenceCoordinateSystem, m_baseNode).submat(0, 0, 2, 2);
-
-	jacobian = transformToReferenceSystem * jacobian;
 	removeDOFfromJacobian(jacobian, kinematicTree);
 
 	return jacobian;